@@ -0,0 +1,668 @@
+/**********************************************************************************
+ * bedAlgebra.cpp                                                                 *
+ * Written by Patrick Reilly                                                      *
+ * Version 1.0 written 2026/10/18                                                 *
+ * Description:                                                                   *
+ *  Evaluates set algebra (union, intersection, subtraction, and complement       *
+ *  against the .fai) of BEDs and position lists in a single sweep over the       *
+ *  scaffolds of the .fai, writing any of the resulting BEDs and the number of    *
+ *  bases in each, so a chain of sort | bedtools merge/intersect/subtract/        *
+ *  complement | awk sum pipelines runs as one process reading each input once.   *
+ *  Expressions are named, and later expressions can use earlier ones.            *
+ *  The records of each scaffold must be consecutive in the inputs, but the       *
+ *  scaffolds may come in any order, and inputs in .fai scaffold order can be     *
+ *  streamed with -S, holding only one scaffold of each in memory.                *
+ *                                                                                *
+ * Syntax: bedAlgebra -g [.fai] -e '[name]=[expression]' [-e ...]                 *
+ *         -o [name]=[output BED] [-o ...] -s [comma-separated names to sum]      *
+ **********************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <getopt.h>
+#include <cstdlib>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <algorithm>
+#include <utility>
+#include "snpLogStore.h"
+
+//Define constants for getopt:
+#define no_argument 0
+#define required_argument 1
+#define optional_argument 2
+
+//Version:
+#define VERSION "1.0"
+
+//Usage/help:
+#define USAGE "bedAlgebra\nUsage:\n bedAlgebra -g [FASTA .fai] -e '[name]=[expression]' [-e ...]\n\t-o [name]=[output BED, - for STDOUT] [-o ...]\n\t-s [comma-separated names to output base counts of]\n\t-S (inputs are grouped by scaffold in .fai order, so stream them)\n Expressions combine BEDs, sites:[scaffold and 1-based position TSV],\n genome (all of the .fai), and names of earlier expressions with\n ~ (complement), & (intersect), | (union), and - (subtract), e.g.\n -e 'TN=~(ERs.bed | FNs.bed | FPs.bed | TPs.bed)' -e 'TNc=TN & callable.bed'\n"
+
+using namespace std;
+
+vector<string> splitString(string line_to_split, char delimiter) {
+   vector<string> line_vector;
+   string element;
+   istringstream line_to_split_stream(line_to_split);
+   while (getline(line_to_split_stream, element, delimiter)) {
+      line_vector.push_back(element);
+   }
+   return line_vector;
+}
+
+//Sorted, non-overlapping, non-adjacent half-open intervals of a scaffold:
+typedef vector<pair<long, long>> intervalList;
+
+//Sort intervals if they aren't already, and merge overlapping and adjacent ones
+// (as bedtools merge does):
+void normalizeIntervals(intervalList &intervals) {
+   if (!is_sorted(intervals.begin(), intervals.end())) {
+      sort(intervals.begin(), intervals.end());
+   }
+   size_t merged = 0;
+   for (size_t i = 0; i < intervals.size(); i++) {
+      if (intervals[i].second <= intervals[i].first) {
+         continue;
+      }
+      if (merged > 0 && intervals[i].first <= intervals[merged-1].second) {
+         intervals[merged-1].second = max(intervals[merged-1].second, intervals[i].second);
+      } else {
+         intervals[merged++] = intervals[i];
+      }
+   }
+   intervals.resize(merged);
+}
+
+intervalList unionOf(const intervalList &a, const intervalList &b) {
+   intervalList result;
+   result.reserve(a.size() + b.size());
+   size_t i = 0, j = 0;
+   while (i < a.size() || j < b.size()) {
+      const pair<long, long> &next = (j >= b.size() || (i < a.size() && a[i].first <= b[j].first)) ? a[i++] : b[j++];
+      if (!result.empty() && next.first <= result.back().second) {
+         result.back().second = max(result.back().second, next.second);
+      } else {
+         result.push_back(next);
+      }
+   }
+   return result;
+}
+
+intervalList intersectionOf(const intervalList &a, const intervalList &b) {
+   intervalList result;
+   size_t i = 0, j = 0;
+   while (i < a.size() && j < b.size()) {
+      long start = max(a[i].first, b[j].first);
+      long end = min(a[i].second, b[j].second);
+      if (start < end) {
+         result.push_back(make_pair(start, end));
+      }
+      if (a[i].second < b[j].second) {
+         i++;
+      } else {
+         j++;
+      }
+   }
+   return result;
+}
+
+intervalList differenceOf(const intervalList &a, const intervalList &b) {
+   intervalList result;
+   size_t j = 0;
+   for (auto a_iterator = a.begin(); a_iterator != a.end(); ++a_iterator) {
+      long start = a_iterator->first;
+      //Intervals of b ending before this one can't overlap any later ones either:
+      while (j < b.size() && b[j].second <= start) {
+         j++;
+      }
+      size_t k = j;
+      while (k < b.size() && b[k].first < a_iterator->second) {
+         if (b[k].first > start) {
+            result.push_back(make_pair(start, b[k].first));
+         }
+         start = max(start, b[k].second);
+         k++;
+      }
+      if (start < a_iterator->second) {
+         result.push_back(make_pair(start, a_iterator->second));
+      }
+   }
+   return result;
+}
+
+//Node of the syntax tree of an expression:
+struct exprNode {
+   //'i' input, 'n' earlier expression, 'g' genome, '~' complement,
+   // '&' intersection, '|' union, '-' subtraction:
+   char op;
+   size_t index;
+   int left, right;
+};
+
+//A BED or position list read one scaffold at a time, holding on to the records of
+// scaffolds it reaches before they're swept:
+class intervalInput {
+   public:
+      string path;
+      bool positions = 0;
+      unsigned long num_records = 0;
+      bool open() {
+         input_file.open(path);
+         return !input_file;
+      }
+      //Intervals of a scaffold (returning an error code, 0 on success), reading up to
+      // the first record of a later scaffold if sorted, or further if not:
+      int fetch(uint32_t scaffold_id, scaffoldIDs &scaffold_ids, const vector<bool> &swept, uint32_t num_fai_scaffolds, bool sorted, intervalList &intervals);
+      //Read the rest of the input, so its remaining scaffolds are known:
+      int drain(scaffoldIDs &scaffold_ids, const vector<bool> &swept) {
+         intervalList unused;
+         return fetch(scaffoldIDs::missing, scaffold_ids, swept, 0, 0, unused);
+      }
+      //Scaffolds read but not yet swept:
+      void heldScaffolds(vector<uint32_t> &scaffolds) const {
+         for (auto held_iterator = held.begin(); held_iterator != held.end(); ++held_iterator) {
+            scaffolds.push_back(held_iterator->first);
+         }
+      }
+   private:
+      ifstream input_file;
+      bool has_next = 0;
+      uint32_t next_id = scaffoldIDs::missing;
+      pair<long, long> next_interval;
+      map<uint32_t, intervalList> held;
+      int readRecord(scaffoldIDs &scaffold_ids);
+      int readBlock(scaffoldIDs &scaffold_ids, intervalList &intervals);
+};
+
+//Read the next record into next_id and next_interval, returning 0 at the end of the
+// input, 1 for a record, or -1 for a malformed line:
+int intervalInput::readRecord(scaffoldIDs &scaffold_ids) {
+   string line;
+   while (getline(input_file, line)) {
+      if (line.empty() || line[0] == '#' || line.compare(0, 5, "track") == 0 || line.compare(0, 7, "browser") == 0) {
+         continue;
+      }
+      size_t starts[3], ends[3];
+      size_t num_fields = fieldBounds(line, starts, ends, 3);
+      if (num_fields < (positions ? 2U : 3U)) {
+         cerr << "Line of " << path << " does not have the appropriate number of fields: " << line << endl;
+         return -1;
+      }
+      char *end_pointer;
+      long start = strtol(line.c_str() + starts[1], &end_pointer, 10);
+      if (end_pointer == line.c_str() + starts[1]) {
+         cerr << "Unable to parse position on line of " << path << ": " << line << endl;
+         return -1;
+      }
+      long end;
+      if (positions) {
+         //Convert 1-based positions to intervals of one base:
+         end = start--;
+      } else {
+         end = strtol(line.c_str() + starts[2], &end_pointer, 10);
+         if (end_pointer == line.c_str() + starts[2]) {
+            cerr << "Unable to parse end on line of " << path << ": " << line << endl;
+            return -1;
+         }
+      }
+      next_id = scaffold_ids.add(line, ends[0]);
+      next_interval = make_pair(start, end);
+      num_records++;
+      return 1;
+   }
+   return 0;
+}
+
+//Read the block of consecutive records of the scaffold of next_id:
+int intervalInput::readBlock(scaffoldIDs &scaffold_ids, intervalList &intervals) {
+   uint32_t block_id = next_id;
+   while (has_next && next_id == block_id) {
+      intervals.push_back(next_interval);
+      int read_status = readRecord(scaffold_ids);
+      if (read_status < 0) {
+         return 6;
+      }
+      has_next = read_status > 0;
+   }
+   normalizeIntervals(intervals);
+   return 0;
+}
+
+int intervalInput::fetch(uint32_t scaffold_id, scaffoldIDs &scaffold_ids, const vector<bool> &swept, uint32_t num_fai_scaffolds, bool sorted, intervalList &intervals) {
+   intervals.clear();
+   auto held_iterator = held.find(scaffold_id);
+   if (held_iterator != held.end()) {
+      intervals.swap(held_iterator->second);
+      held.erase(held_iterator);
+      return 0;
+   }
+   if (!has_next && input_file.is_open()) {
+      int read_status = readRecord(scaffold_ids);
+      if (read_status < 0) {
+         return 6;
+      }
+      has_next = read_status > 0;
+   }
+   while (has_next) {
+      if (next_id < swept.size() && swept[next_id]) {
+         if (sorted) {
+            cerr << path << " is not grouped by scaffold in .fai order at scaffold " << scaffold_ids.name(next_id) << ", so it can't be streamed.  Quitting." << endl;
+         } else {
+            cerr << "Records of scaffold " << scaffold_ids.name(next_id) << " are not consecutive in " << path << ".  Quitting." << endl;
+         }
+         return 7;
+      }
+      if (next_id == scaffold_id) {
+         return readBlock(scaffold_ids, intervals);
+      }
+      //Inputs in .fai order have nothing on this scaffold if they've moved past it:
+      if (sorted && next_id < num_fai_scaffolds && next_id > scaffold_id) {
+         return 0;
+      }
+      //Later records of a scaffold that hasn't been swept yet are simply added to it:
+      intervalList &block = held[next_id];
+      int block_status = readBlock(scaffold_ids, block);
+      if (block_status != 0) {
+         return block_status;
+      }
+   }
+   return 0;
+}
+
+//Recursive descent parser of expressions, in order of increasing precedence:
+// | and - (left to right), &, and then ~ and parentheses:
+class exprParser {
+   public:
+      exprParser(vector<exprNode> &expr_nodes, vector<intervalInput> &expr_inputs, map<string, size_t> &input_indices, const map<string, size_t> &expr_names) : nodes(expr_nodes), inputs(expr_inputs), input_index(input_indices), names(expr_names) {}
+      //Parse an expression into nodes, returning the index of its root, or -1 on error:
+      int parse(const string &expression) {
+         tokens.clear();
+         position = 0;
+         tokenize(expression);
+         int root = parseUnion();
+         if (root >= 0 && position < tokens.size()) {
+            cerr << "Unexpected " << tokens[position] << " at the end of expression " << expression << endl;
+            return -1;
+         }
+         return root;
+      }
+   private:
+      vector<exprNode> &nodes;
+      vector<intervalInput> &inputs;
+      map<string, size_t> &input_index;
+      const map<string, size_t> &names;
+      vector<string> tokens;
+      size_t position;
+      //Parentheses, ~, &, and | are tokens anywhere, but - only on its own, since it
+      // also appears in paths:
+      void tokenize(const string &expression) {
+         string token;
+         for (size_t i = 0; i <= expression.length(); i++) {
+            char c = i < expression.length() ? expression[i] : ' ';
+            if (c == ' ' || c == '\t' || c == '(' || c == ')' || c == '~' || c == '&' || c == '|') {
+               if (!token.empty()) {
+                  tokens.push_back(token);
+                  token.clear();
+               }
+               if (c != ' ' && c != '\t') {
+                  tokens.push_back(string(1, c));
+               }
+            } else {
+               token += c;
+            }
+         }
+      }
+      int addNode(char op, size_t index, int left, int right) {
+         nodes.push_back({op, index, left, right});
+         return nodes.size() - 1;
+      }
+      int parseUnion() {
+         int left = parseIntersection();
+         while (left >= 0 && position < tokens.size() && (tokens[position] == "|" || tokens[position] == "-")) {
+            char op = tokens[position++][0];
+            int right = parseIntersection();
+            if (right < 0) {
+               return -1;
+            }
+            left = addNode(op, 0, left, right);
+         }
+         return left;
+      }
+      int parseIntersection() {
+         int left = parseUnary();
+         while (left >= 0 && position < tokens.size() && tokens[position] == "&") {
+            position++;
+            int right = parseUnary();
+            if (right < 0) {
+               return -1;
+            }
+            left = addNode('&', 0, left, right);
+         }
+         return left;
+      }
+      int parseUnary() {
+         if (position >= tokens.size()) {
+            return -1;
+         }
+         string token = tokens[position++];
+         if (token == "~") {
+            int operand = parseUnary();
+            return operand < 0 ? -1 : addNode('~', 0, operand, -1);
+         }
+         if (token == "(") {
+            int inner = parseUnion();
+            if (inner < 0 || position >= tokens.size() || tokens[position] != ")") {
+               return -1;
+            }
+            position++;
+            return inner;
+         }
+         if (token == ")" || token == "&" || token == "|" || token == "-") {
+            return -1;
+         }
+         if (token == "genome") {
+            return addNode('g', 0, -1, -1);
+         }
+         auto name_iterator = names.find(token);
+         if (name_iterator != names.end()) {
+            return addNode('n', name_iterator->second, -1, -1);
+         }
+         //Each input is read once, however many expressions use it:
+         auto input_iterator = input_index.find(token);
+         if (input_iterator == input_index.end()) {
+            intervalInput input;
+            input.positions = token.compare(0, 6, "sites:") == 0;
+            input.path = input.positions ? token.substr(6) : token;
+            inputs.push_back(move(input));
+            input_iterator = input_index.insert(make_pair(token, inputs.size() - 1)).first;
+         }
+         return addNode('i', input_iterator->second, -1, -1);
+      }
+};
+
+//Evaluate a node on the current scaffold:
+intervalList evaluate(const vector<exprNode> &nodes, int node, const vector<intervalList> &input_intervals, const vector<intervalList> &expr_intervals, long scaffold_length) {
+   const exprNode &n = nodes[node];
+   switch (n.op) {
+      case 'i':
+         return input_intervals[n.index];
+      case 'n':
+         return expr_intervals[n.index];
+      case 'g':
+         return scaffold_length > 0 ? intervalList(1, make_pair(0L, scaffold_length)) : intervalList();
+      case '~':
+         return differenceOf(scaffold_length > 0 ? intervalList(1, make_pair(0L, scaffold_length)) : intervalList(), evaluate(nodes, n.left, input_intervals, expr_intervals, scaffold_length));
+      case '&':
+         return intersectionOf(evaluate(nodes, n.left, input_intervals, expr_intervals, scaffold_length), evaluate(nodes, n.right, input_intervals, expr_intervals, scaffold_length));
+      case '|':
+         return unionOf(evaluate(nodes, n.left, input_intervals, expr_intervals, scaffold_length), evaluate(nodes, n.right, input_intervals, expr_intervals, scaffold_length));
+      default:
+         return differenceOf(evaluate(nodes, n.left, input_intervals, expr_intervals, scaffold_length), evaluate(nodes, n.right, input_intervals, expr_intervals, scaffold_length));
+   }
+}
+
+int main(int argc, char **argv) {
+   //.fai path, expressions, outputs, and names to output the base counts of:
+   string fai_path;
+   vector<string> expression_specs, output_specs;
+   vector<string> sum_names;
+
+   //Stream inputs grouped by scaffold in .fai order:
+   bool sorted = 0;
+
+   //Option for debugging:
+   bool debug = 0;
+
+   //Variables for getopt_long:
+   int optchar;
+   int structindex = 0;
+   extern int optind;
+   //Create the struct used for getopt:
+   const struct option longoptions[] {
+      {"input_fai", required_argument, 0, 'g'},
+      {"expression", required_argument, 0, 'e'},
+      {"output_bed", required_argument, 0, 'o'},
+      {"sums", required_argument, 0, 's'},
+      {"sorted", no_argument, 0, 'S'},
+      {"debug", no_argument, 0, 'd'},
+      {"version", no_argument, 0, 'v'},
+      {"help", no_argument, 0, 'h'}
+   };
+   //Read in the options:
+   while ((optchar = getopt_long(argc, argv, "g:e:o:s:Sdvh", longoptions, &structindex)) > -1) {
+      switch(optchar) {
+         case 'g':
+            cerr << "Using FASTA .fai index: " << optarg << endl;
+            fai_path = optarg;
+            break;
+         case 'e':
+            cerr << "Evaluating expression: " << optarg << endl;
+            expression_specs.push_back(optarg);
+            break;
+         case 'o':
+            cerr << "Outputting BED: " << optarg << endl;
+            output_specs.push_back(optarg);
+            break;
+         case 's':
+            cerr << "Outputting base counts of: " << optarg << endl;
+            sum_names = splitString(optarg, ',');
+            break;
+         case 'S':
+            cerr << "Streaming inputs grouped by scaffold in .fai order" << endl;
+            sorted = 1;
+            break;
+         case 'd':
+            cerr << "Debugging mode enabled." << endl;
+            debug = 1;
+            break;
+         case 'v':
+            cerr << "bedAlgebra version " << VERSION << endl;
+            return 0;
+            break;
+         case 'h':
+            cerr << USAGE;
+            return 0;
+            break;
+         default:
+            cerr << "Unknown option " << (unsigned char)optchar << " supplied." << endl;
+            cerr << USAGE;
+            return 1;
+            break;
+      }
+   }
+
+   //Ignore positional arguments
+   if (optind < argc) {
+      cerr << "Ignoring extra positional arguments starting at " << argv[optind++] << endl;
+   }
+
+   if (expression_specs.empty() || (output_specs.empty() && sum_names.empty())) {
+      cerr << "Missing expressions, or outputs or names to sum.  Quitting." << endl;
+      return 2;
+   }
+
+   //Read in the scaffold order and scaffold lengths from the .fai file, with scaffold IDs in .fai order:
+   scaffoldIDs scaffold_ids;
+   vector<long> scaffold_lengths;
+   if (!fai_path.empty()) {
+      ifstream fasta_fai;
+      fasta_fai.open(fai_path);
+      if (!fasta_fai) {
+         cerr << "Error opening FASTA .fai index file " << fai_path << ".  Quitting." << endl;
+         return 3;
+      }
+      string failine;
+      while (getline(fasta_fai, failine)) {
+         vector<string> line_vector = splitString(failine, '\t');
+         if (line_vector.size() < 2) {
+            continue;
+         }
+         uint32_t scaffold_id = scaffold_ids.add(line_vector[0]);
+         if (scaffold_id == scaffold_lengths.size()) {
+            scaffold_lengths.push_back(stol(line_vector[1]));
+         }
+      }
+      fasta_fai.close();
+   } else if (sorted) {
+      cerr << "Streaming requires the .fai to give the scaffold order, so ignoring -S." << endl;
+      sorted = 0;
+   }
+   uint32_t num_fai_scaffolds = scaffold_lengths.size();
+
+   //Parse the expressions, in the order given:
+   vector<exprNode> nodes;
+   vector<intervalInput> inputs;
+   map<string, size_t> input_index;
+   map<string, size_t> expr_index;
+   vector<string> expr_names;
+   vector<int> expr_roots;
+   bool uses_genome = 0;
+   exprParser parser(nodes, inputs, input_index, expr_index);
+   for (auto spec_iterator = expression_specs.begin(); spec_iterator != expression_specs.end(); ++spec_iterator) {
+      size_t equals = spec_iterator->find('=');
+      string name = equals == string::npos ? "" : spec_iterator->substr(0, equals);
+      if (name.empty() || name == "genome" || name.find_first_not_of("ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789_") != string::npos) {
+         cerr << "Expression " << *spec_iterator << " should be [name]=[expression], with a name of letters, digits, and underscores other than genome.  Quitting." << endl;
+         return 4;
+      }
+      if (expr_index.count(name) > 0) {
+         cerr << "Expression " << name << " is defined more than once.  Quitting." << endl;
+         return 4;
+      }
+      size_t first_node = nodes.size();
+      int root = parser.parse(spec_iterator->substr(equals+1));
+      if (root < 0) {
+         cerr << "Unable to parse expression " << *spec_iterator << ".  Quitting." << endl;
+         return 4;
+      }
+      for (size_t i = first_node; i < nodes.size(); i++) {
+         uses_genome = uses_genome || nodes[i].op == 'g' || nodes[i].op == '~';
+      }
+      expr_index[name] = expr_roots.size();
+      expr_names.push_back(name);
+      expr_roots.push_back(root);
+   }
+   if (uses_genome && fai_path.empty()) {
+      cerr << "Complements and genome require the .fai.  Quitting." << endl;
+      return 2;
+   }
+
+   //Identify the expressions to output and to sum:
+   vector<ofstream> output_files(output_specs.size());
+   vector<pair<size_t, ostream *>> outputs;
+   for (size_t i = 0; i < output_specs.size(); i++) {
+      size_t equals = output_specs[i].find('=');
+      string name = equals == string::npos ? "" : output_specs[i].substr(0, equals);
+      if (expr_index.count(name) == 0) {
+         cerr << "Output " << output_specs[i] << " should be [name]=[output BED] for the name of an expression.  Quitting." << endl;
+         return 4;
+      }
+      string output_path = output_specs[i].substr(equals+1);
+      if (output_path == "-") {
+         outputs.push_back(make_pair(expr_index[name], &cout));
+      } else {
+         output_files[i].open(output_path);
+         if (!output_files[i]) {
+            cerr << "Error opening output BED " << output_path << ".  Quitting." << endl;
+            return 8;
+         }
+         outputs.push_back(make_pair(expr_index[name], &output_files[i]));
+      }
+   }
+   vector<size_t> sums;
+   for (auto name_iterator = sum_names.begin(); name_iterator != sum_names.end(); ++name_iterator) {
+      if (expr_index.count(*name_iterator) == 0) {
+         cerr << "No expression named " << *name_iterator << " to output the base count of.  Quitting." << endl;
+         return 4;
+      }
+      sums.push_back(expr_index[*name_iterator]);
+   }
+
+   for (auto input_iterator = inputs.begin(); input_iterator != inputs.end(); ++input_iterator) {
+      if (input_iterator->open()) {
+         cerr << "Error opening input " << input_iterator->path << ".  Quitting." << endl;
+         return 5;
+      }
+      if (debug) {
+         cerr << "Reading " << (input_iterator->positions ? "positions" : "BED") << " " << input_iterator->path << endl;
+      }
+   }
+
+   //Sweep the scaffolds of the .fai in order, and then any scaffolds only found in
+   // the inputs in the order they were first read:
+   vector<bool> swept;
+   vector<intervalList> input_intervals(inputs.size());
+   vector<intervalList> expr_intervals(expr_roots.size());
+   vector<unsigned long> bases(expr_roots.size(), 0);
+   uint32_t scaffold_id = 0;
+   bool drained = 0;
+   vector<uint32_t> extra_scaffolds;
+   size_t next_extra = 0;
+   while (1) {
+      if (scaffold_id >= num_fai_scaffolds) {
+         if (!drained) {
+            for (auto input_iterator = inputs.begin(); input_iterator != inputs.end(); ++input_iterator) {
+               int drain_status = input_iterator->drain(scaffold_ids, swept);
+               if (drain_status != 0) {
+                  return drain_status;
+               }
+               input_iterator->heldScaffolds(extra_scaffolds);
+            }
+            sort(extra_scaffolds.begin(), extra_scaffolds.end());
+            extra_scaffolds.erase(unique(extra_scaffolds.begin(), extra_scaffolds.end()), extra_scaffolds.end());
+            drained = 1;
+         }
+         if (next_extra >= extra_scaffolds.size()) {
+            break;
+         }
+         scaffold_id = extra_scaffolds[next_extra++];
+      }
+      for (size_t i = 0; i < inputs.size(); i++) {
+         int fetch_status = inputs[i].fetch(scaffold_id, scaffold_ids, swept, num_fai_scaffolds, sorted, input_intervals[i]);
+         if (fetch_status != 0) {
+            return fetch_status;
+         }
+      }
+      long scaffold_length = scaffold_id < num_fai_scaffolds ? scaffold_lengths[scaffold_id] : 0;
+      for (size_t e = 0; e < expr_roots.size(); e++) {
+         expr_intervals[e] = evaluate(nodes, expr_roots[e], input_intervals, expr_intervals, scaffold_length);
+         for (auto interval_iterator = expr_intervals[e].begin(); interval_iterator != expr_intervals[e].end(); ++interval_iterator) {
+            bases[e] += interval_iterator->second - interval_iterator->first;
+         }
+      }
+      const string &scaffold = scaffold_ids.name(scaffold_id);
+      for (auto output_iterator = outputs.begin(); output_iterator != outputs.end(); ++output_iterator) {
+         const intervalList &intervals = expr_intervals[output_iterator->first];
+         for (auto interval_iterator = intervals.begin(); interval_iterator != intervals.end(); ++interval_iterator) {
+            *(output_iterator->second) << scaffold << '\t' << interval_iterator->first << '\t' << interval_iterator->second << '\n';
+         }
+      }
+      if (swept.size() <= scaffold_id) {
+         swept.resize(scaffold_id + 1, 0);
+      }
+      swept[scaffold_id] = 1;
+      if (!drained) {
+         scaffold_id++;
+      }
+   }
+
+   for (size_t i = 0; i < output_files.size(); i++) {
+      if (output_files[i].is_open()) {
+         output_files[i].close();
+      }
+   }
+   cout.flush();
+   for (auto sum_iterator = sums.begin(); sum_iterator != sums.end(); ++sum_iterator) {
+      cout << expr_names[*sum_iterator] << "=" << bases[*sum_iterator] << endl;
+   }
+   if (debug) {
+      for (auto input_iterator = inputs.begin(); input_iterator != inputs.end(); ++input_iterator) {
+         cerr << "Read " << input_iterator->num_records << " records from " << input_iterator->path << endl;
+      }
+      cerr << "Swept " << swept.size() << " scaffolds" << endl;
+   }
+
+   return 0;
+}
@@ -0,0 +1,271 @@
+/**********************************************************************************
+ * binarySNPlog.h                                                                 *
+ * Written by Patrick Reilly                                                      *
+ * Version 1.0 written 2026/10/18                                                 *
+ * Description:                                                                   *
+ *  Binary form of a SNP log/INSNP (scaffold, position, old allele, new allele,   *
+ *  and optionally depth), laid out so it can be mmapped and walked per scaffold  *
+ *  without parsing.  All integers are little-endian, as written by x86.          *
+ *                                                                                *
+ *  Layout:                                                                       *
+ *   header: char magic[8] = "SNPLOGB1", uint32 version, uint32 num_scaffolds,    *
+ *           uint64 num_records, uint64 names_offset, uint64 positions_offset,    *
+ *           uint64 alleles_offset, uint64 depths_offset (0 if no depths)         *
+ *   scaffold table (right after the header), one entry per scaffold:            *
+ *           uint64 name_offset (into the names blob), uint32 name_length,       *
+ *           uint32 reserved, uint64 first_record, uint64 num_records             *
+ *   names blob: scaffold names, not NUL-terminated                               *
+ *   uint32 positions[num_records]: 1-based, sorted within each scaffold          *
+ *   uint8 alleles[num_records]: (old allele code << 4) | new allele code,        *
+ *           with codes as in int2bases (0-3 ACGT, 4 N, 5-10 MRWSYK)              *
+ *   uint32 depths[num_records] (optional)                                        *
+ **********************************************************************************/
+
+#ifndef BINARYSNPLOG_H
+#define BINARYSNPLOG_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <map>
+#include <array>
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#define BINARY_SNPLOG_MAGIC "SNPLOGB1"
+#define BINARY_SNPLOG_VERSION 1
+
+struct binarySNPlogHeader {
+   char magic[8];
+   uint32_t version;
+   uint32_t num_scaffolds;
+   uint64_t num_records;
+   uint64_t names_offset;
+   uint64_t positions_offset;
+   uint64_t alleles_offset;
+   uint64_t depths_offset;
+};
+
+struct binarySNPlogScaffold {
+   uint64_t name_offset;
+   uint32_t name_length;
+   uint32_t reserved;
+   uint64_t first_record;
+   uint64_t num_records;
+};
+
+//Allele codes match int2bases, anything else is stored as N:
+inline uint8_t baseToCode(char base) {
+   switch(base) {
+      case 'A':
+      case 'a':
+         return 0;
+      case 'C':
+      case 'c':
+         return 1;
+      case 'G':
+      case 'g':
+         return 2;
+      case 'T':
+      case 't':
+         return 3;
+      case 'M':
+      case 'm':
+         return 5;
+      case 'R':
+      case 'r':
+         return 6;
+      case 'W':
+      case 'w':
+         return 7;
+      case 'S':
+      case 's':
+         return 8;
+      case 'Y':
+      case 'y':
+         return 9;
+      case 'K':
+      case 'k':
+         return 10;
+      default:
+         return 4;
+   }
+}
+
+inline char codeToBase(uint8_t code) {
+   const char int2bases[] = {'A', 'C', 'G', 'T', 'N', 'M', 'R', 'W', 'S', 'Y', 'K'};
+   return code < 11 ? int2bases[code] : 'N';
+}
+
+//Accumulates records in any order, and writes them grouped by scaffold
+// (in order of first appearance) and sorted by position:
+class binarySNPlogWriter {
+   public:
+      bool with_depths = 0;
+      void add(const std::string &scaffold, uint32_t position, char oldallele, char newallele, uint32_t depth = 0) {
+         auto scaffold_iterator = scaffold_ids.find(scaffold);
+         if (scaffold_iterator == scaffold_ids.end()) {
+            scaffold_iterator = scaffold_ids.insert(std::make_pair(scaffold, scaffold_names.size())).first;
+            scaffold_names.push_back(scaffold);
+            records.push_back(std::vector<std::array<uint32_t, 3>>());
+         }
+         records[scaffold_iterator->second].push_back({position, (uint32_t)((baseToCode(oldallele) << 4) | baseToCode(newallele)), depth});
+      }
+      bool write(const std::string &path) {
+         binarySNPlogHeader header;
+         memcpy(header.magic, BINARY_SNPLOG_MAGIC, 8);
+         header.version = BINARY_SNPLOG_VERSION;
+         header.num_scaffolds = scaffold_names.size();
+         header.num_records = 0;
+         std::vector<binarySNPlogScaffold> scaffold_table(scaffold_names.size());
+         uint64_t names_length = 0;
+         for (size_t i = 0; i < scaffold_names.size(); i++) {
+            std::stable_sort(records[i].begin(), records[i].end(), [](const std::array<uint32_t, 3> &a, const std::array<uint32_t, 3> &b) {
+               return a[0] < b[0];
+            });
+            scaffold_table[i].name_offset = names_length;
+            scaffold_table[i].name_length = scaffold_names[i].length();
+            scaffold_table[i].reserved = 0;
+            scaffold_table[i].first_record = header.num_records;
+            scaffold_table[i].num_records = records[i].size();
+            names_length += scaffold_names[i].length();
+            header.num_records += records[i].size();
+         }
+         header.names_offset = sizeof(header) + scaffold_table.size() * sizeof(binarySNPlogScaffold);
+         //Keep the positions 4-byte aligned for mmapped access:
+         header.positions_offset = (header.names_offset + names_length + 3) & ~(uint64_t)3;
+         header.alleles_offset = header.positions_offset + header.num_records * sizeof(uint32_t);
+         header.depths_offset = with_depths ? ((header.alleles_offset + header.num_records + 3) & ~(uint64_t)3) : 0;
+         std::ofstream output_file;
+         output_file.open(path, std::ios::binary);
+         if (!output_file) {
+            return 1;
+         }
+         output_file.write((const char *)&header, sizeof(header));
+         output_file.write((const char *)scaffold_table.data(), scaffold_table.size() * sizeof(binarySNPlogScaffold));
+         for (auto name_iterator = scaffold_names.begin(); name_iterator != scaffold_names.end(); ++name_iterator) {
+            output_file.write(name_iterator->data(), name_iterator->length());
+         }
+         padTo(output_file, header.positions_offset);
+         for (size_t i = 0; i < records.size(); i++) {
+            for (auto record_iterator = records[i].begin(); record_iterator != records[i].end(); ++record_iterator) {
+               output_file.write((const char *)&((*record_iterator)[0]), sizeof(uint32_t));
+            }
+         }
+         for (size_t i = 0; i < records.size(); i++) {
+            for (auto record_iterator = records[i].begin(); record_iterator != records[i].end(); ++record_iterator) {
+               uint8_t alleles = (*record_iterator)[1];
+               output_file.put(alleles);
+            }
+         }
+         if (with_depths) {
+            padTo(output_file, header.depths_offset);
+            for (size_t i = 0; i < records.size(); i++) {
+               for (auto record_iterator = records[i].begin(); record_iterator != records[i].end(); ++record_iterator) {
+                  output_file.write((const char *)&((*record_iterator)[2]), sizeof(uint32_t));
+               }
+            }
+         }
+         output_file.close();
+         return !output_file;
+      }
+   private:
+      std::map<std::string, size_t> scaffold_ids;
+      std::vector<std::string> scaffold_names;
+      std::vector<std::vector<std::array<uint32_t, 3>>> records;
+      void padTo(std::ofstream &output_file, uint64_t offset) {
+         while ((uint64_t)output_file.tellp() < offset) {
+            output_file.put('\0');
+         }
+      }
+};
+
+//Read-only mmapped view of a binary SNP log:
+class binarySNPlogReader {
+   public:
+      const binarySNPlogHeader *header = nullptr;
+      const binarySNPlogScaffold *scaffolds = nullptr;
+      const char *names = nullptr;
+      const uint32_t *positions = nullptr;
+      const uint8_t *alleles = nullptr;
+      const uint32_t *depths = nullptr;
+      //Check if a file starts with the binary SNP log magic:
+      static bool isBinarySNPlog(const std::string &path) {
+         char magic[8];
+         std::ifstream input_file;
+         input_file.open(path, std::ios::binary);
+         if (!input_file || !input_file.read(magic, 8)) {
+            return 0;
+         }
+         return memcmp(magic, BINARY_SNPLOG_MAGIC, 8) == 0;
+      }
+      bool open(const std::string &path) {
+         int fd = ::open(path.c_str(), O_RDONLY);
+         if (fd < 0) {
+            return 1;
+         }
+         struct stat file_stats;
+         if (fstat(fd, &file_stats) != 0 || (size_t)file_stats.st_size < sizeof(binarySNPlogHeader)) {
+            ::close(fd);
+            return 1;
+         }
+         mapped_length = file_stats.st_size;
+         void *mapped = mmap(NULL, mapped_length, PROT_READ, MAP_PRIVATE, fd, 0);
+         ::close(fd);
+         if (mapped == MAP_FAILED) {
+            return 1;
+         }
+         mapped_file = (const char *)mapped;
+         header = (const binarySNPlogHeader *)mapped_file;
+         //Every section has to lie within the file before we hand out pointers into it:
+         if (memcmp(header->magic, BINARY_SNPLOG_MAGIC, 8) != 0 || header->version != BINARY_SNPLOG_VERSION || header->num_records > mapped_length || !inFile(sizeof(binarySNPlogHeader), (uint64_t)header->num_scaffolds * sizeof(binarySNPlogScaffold)) || !inFile(header->names_offset, 0) || !inFile(header->positions_offset, header->num_records * sizeof(uint32_t)) || !inFile(header->alleles_offset, header->num_records) || (header->depths_offset > 0 && !inFile(header->depths_offset, header->num_records * sizeof(uint32_t)))) {
+            close();
+            return 1;
+         }
+         scaffolds = (const binarySNPlogScaffold *)(mapped_file + sizeof(binarySNPlogHeader));
+         for (uint32_t i = 0; i < header->num_scaffolds; i++) {
+            if (scaffolds[i].name_offset > mapped_length - header->names_offset || !inFile(header->names_offset + scaffolds[i].name_offset, scaffolds[i].name_length) || scaffolds[i].num_records > header->num_records || scaffolds[i].first_record > header->num_records - scaffolds[i].num_records) {
+               close();
+               return 1;
+            }
+         }
+         names = mapped_file + header->names_offset;
+         positions = (const uint32_t *)(mapped_file + header->positions_offset);
+         alleles = (const uint8_t *)(mapped_file + header->alleles_offset);
+         depths = header->depths_offset > 0 ? (const uint32_t *)(mapped_file + header->depths_offset) : nullptr;
+         return 0;
+      }
+      std::string scaffoldName(size_t i) const {
+         return std::string(names + scaffolds[i].name_offset, scaffolds[i].name_length);
+      }
+      void close() {
+         if (mapped_file != nullptr) {
+            munmap((void *)mapped_file, mapped_length);
+         }
+         mapped_file = nullptr;
+         header = nullptr;
+         scaffolds = nullptr;
+         names = nullptr;
+         positions = nullptr;
+         alleles = nullptr;
+         depths = nullptr;
+      }
+      ~binarySNPlogReader() {
+         close();
+      }
+   private:
+      const char *mapped_file = nullptr;
+      size_t mapped_length = 0;
+      //Whether length bytes starting at offset are all within the mapped file
+      // (without overflowing on corrupt offsets):
+      bool inFile(uint64_t offset, uint64_t length) const {
+         return offset <= mapped_length && length <= mapped_length - offset;
+      }
+};
+
+#endif
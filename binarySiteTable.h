@@ -0,0 +1,179 @@
+/**********************************************************************************
+ * binarySiteTable.h                                                              *
+ * Written by Patrick Reilly                                                      *
+ * Version 1.0 written 2026/10/18                                                 *
+ * Description:                                                                   *
+ *  Columnar table of the sites classified by compareSNPlogs (scaffold,           *
+ *  position, reference, truth, and observed alleles, and class), with           *
+ *  dictionary-encoded columns and a summary of the counts in the report, laid   *
+ *  out so each column can be read in one go (e.g. readBin() in R, or           *
+ *  numpy.fromfile()) without parsing.  All integers are little-endian, as       *
+ *  written by x86, and every section starts 8-byte aligned.                      *
+ *                                                                                *
+ *  Layout:                                                                       *
+ *   header: char magic[8] = "SITETAB1", uint32 version, uint32 num_scaffolds,    *
+ *           uint64 num_sites, uint32 num_alleles, uint32 num_classes,            *
+ *           uint32 num_summary, uint32 reserved,                                 *
+ *           then an (offset, length) uint64 pair for each of the dictionaries:  *
+ *           scaffolds, alleles, classes, and summary names,                      *
+ *           then uint64 offsets of the summary values and of the scaffold,       *
+ *           position, ref, truth, observed, and class columns                    *
+ *   dictionaries: newline-separated labels, where a code is the line number     *
+ *           (from 0) of its label: scaffolds in .fai order, alleles as in        *
+ *           int2bases (0-3 ACGT, 4 N, 5-10 MRWSYK), and classes TP, FN, FP, ER   *
+ *   uint64 summary[num_summary]: counts named by the summary names dictionary   *
+ *   uint32 scaffold[num_sites]: scaffold code                                    *
+ *   uint32 position[num_sites]: 1-based                                          *
+ *   uint8 ref[num_sites], truth[num_sites], observed[num_sites]: allele codes    *
+ *           (truth is the ref allele at FPs, observed is the ref allele at FNs   *
+ *           without a call, and N at masked or indel FNs)                        *
+ *   uint8 class[num_sites]: class code                                           *
+ **********************************************************************************/
+
+#ifndef BINARYSITETABLE_H
+#define BINARYSITETABLE_H
+
+#include <fstream>
+#include <string>
+#include <vector>
+#include <utility>
+#include <cstdint>
+#include <cstring>
+
+#define BINARY_SITE_TABLE_MAGIC "SITETAB1"
+#define BINARY_SITE_TABLE_VERSION 1
+
+struct binarySiteTableHeader {
+   char magic[8];
+   uint32_t version;
+   uint32_t num_scaffolds;
+   uint64_t num_sites;
+   uint32_t num_alleles;
+   uint32_t num_classes;
+   uint32_t num_summary;
+   uint32_t reserved;
+   uint64_t scaffolds_offset, scaffolds_length;
+   uint64_t alleles_offset, alleles_length;
+   uint64_t classes_offset, classes_length;
+   uint64_t summary_names_offset, summary_names_length;
+   uint64_t summary_offset;
+   uint64_t scaffold_column_offset;
+   uint64_t position_column_offset;
+   uint64_t ref_column_offset;
+   uint64_t truth_column_offset;
+   uint64_t observed_column_offset;
+   uint64_t class_column_offset;
+};
+
+//Accumulates the columns of sites in the order they're classified, and writes them
+// along with the dictionaries and the summary counts:
+class binarySiteTableWriter {
+   public:
+      std::vector<std::string> scaffold_names, allele_labels, class_labels;
+      void add(uint32_t scaffold, uint32_t position, uint8_t ref_allele, uint8_t truth_allele, uint8_t observed_allele, uint8_t site_class) {
+         scaffolds.push_back(scaffold);
+         positions.push_back(position);
+         ref_alleles.push_back(ref_allele);
+         truth_alleles.push_back(truth_allele);
+         observed_alleles.push_back(observed_allele);
+         classes.push_back(site_class);
+      }
+      void addSummary(const std::string &name, uint64_t value) {
+         summary.push_back(std::make_pair(name, value));
+      }
+      bool write(const std::string &path) {
+         binarySiteTableHeader header;
+         memset(&header, 0, sizeof(header));
+         memcpy(header.magic, BINARY_SITE_TABLE_MAGIC, 8);
+         header.version = BINARY_SITE_TABLE_VERSION;
+         header.num_scaffolds = scaffold_names.size();
+         header.num_sites = positions.size();
+         header.num_alleles = allele_labels.size();
+         header.num_classes = class_labels.size();
+         header.num_summary = summary.size();
+         std::vector<std::string> summary_names;
+         for (auto summary_iterator = summary.begin(); summary_iterator != summary.end(); ++summary_iterator) {
+            summary_names.push_back(summary_iterator->first);
+         }
+         std::string scaffolds_blob = joinLines(scaffold_names), alleles_blob = joinLines(allele_labels), classes_blob = joinLines(class_labels), summary_names_blob = joinLines(summary_names);
+         uint64_t offset = sizeof(header);
+         header.scaffolds_offset = offset;
+         header.scaffolds_length = scaffolds_blob.length();
+         offset = align(offset + scaffolds_blob.length());
+         header.alleles_offset = offset;
+         header.alleles_length = alleles_blob.length();
+         offset = align(offset + alleles_blob.length());
+         header.classes_offset = offset;
+         header.classes_length = classes_blob.length();
+         offset = align(offset + classes_blob.length());
+         header.summary_names_offset = offset;
+         header.summary_names_length = summary_names_blob.length();
+         offset = align(offset + summary_names_blob.length());
+         header.summary_offset = offset;
+         offset = align(offset + summary.size() * sizeof(uint64_t));
+         header.scaffold_column_offset = offset;
+         offset = align(offset + scaffolds.size() * sizeof(uint32_t));
+         header.position_column_offset = offset;
+         offset = align(offset + positions.size() * sizeof(uint32_t));
+         header.ref_column_offset = offset;
+         offset = align(offset + ref_alleles.size());
+         header.truth_column_offset = offset;
+         offset = align(offset + truth_alleles.size());
+         header.observed_column_offset = offset;
+         offset = align(offset + observed_alleles.size());
+         header.class_column_offset = offset;
+         std::ofstream output_file;
+         output_file.open(path, std::ios::binary);
+         if (!output_file) {
+            return 1;
+         }
+         output_file.write((const char *)&header, sizeof(header));
+         output_file.write(scaffolds_blob.data(), scaffolds_blob.length());
+         padTo(output_file, header.alleles_offset);
+         output_file.write(alleles_blob.data(), alleles_blob.length());
+         padTo(output_file, header.classes_offset);
+         output_file.write(classes_blob.data(), classes_blob.length());
+         padTo(output_file, header.summary_names_offset);
+         output_file.write(summary_names_blob.data(), summary_names_blob.length());
+         padTo(output_file, header.summary_offset);
+         for (auto summary_iterator = summary.begin(); summary_iterator != summary.end(); ++summary_iterator) {
+            output_file.write((const char *)&(summary_iterator->second), sizeof(uint64_t));
+         }
+         padTo(output_file, header.scaffold_column_offset);
+         output_file.write((const char *)scaffolds.data(), scaffolds.size() * sizeof(uint32_t));
+         padTo(output_file, header.position_column_offset);
+         output_file.write((const char *)positions.data(), positions.size() * sizeof(uint32_t));
+         padTo(output_file, header.ref_column_offset);
+         output_file.write((const char *)ref_alleles.data(), ref_alleles.size());
+         padTo(output_file, header.truth_column_offset);
+         output_file.write((const char *)truth_alleles.data(), truth_alleles.size());
+         padTo(output_file, header.observed_column_offset);
+         output_file.write((const char *)observed_alleles.data(), observed_alleles.size());
+         padTo(output_file, header.class_column_offset);
+         output_file.write((const char *)classes.data(), classes.size());
+         output_file.close();
+         return !output_file;
+      }
+   private:
+      std::vector<uint32_t> scaffolds, positions;
+      std::vector<uint8_t> ref_alleles, truth_alleles, observed_alleles, classes;
+      std::vector<std::pair<std::string, uint64_t>> summary;
+      static uint64_t align(uint64_t offset) {
+         return (offset + 7) & ~(uint64_t)7;
+      }
+      static std::string joinLines(const std::vector<std::string> &labels) {
+         std::string blob;
+         for (auto label_iterator = labels.begin(); label_iterator != labels.end(); ++label_iterator) {
+            blob += *label_iterator;
+            blob += '\n';
+         }
+         return blob;
+      }
+      void padTo(std::ofstream &output_file, uint64_t offset) {
+         while ((uint64_t)output_file.tellp() < offset) {
+            output_file.put('\0');
+         }
+      }
+};
+
+#endif
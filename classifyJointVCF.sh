@@ -0,0 +1,103 @@
+#!/bin/bash
+REF="$1"
+#REF: Path to the FASTA used as a reference for mapping
+GROUNDTRUTH="$2"
+#GROUNDTRUTH: Path to INSNP-formatted ground truth file
+CALLER="$3"
+#CALLER: Short name for the variant caller used
+# e.g. HC for GATK HaplotypeCaller, MPILEUP for samtools mpileup and bcftools call
+SPECIAL="$4"
+#SPECIAL: Special options indicating input files to use, e.g. no_markdup, no_IR
+JOINTPREFIX="$5"
+#JOINTPREFIX: Prefix for joint genotyping VCF
+shift 5
+#The remaining arguments are the prefixes of the samples in the joint VCF,
+# which are classified in a single pass over it, leaving the INSNP and
+# classified TSVs that classifySites.sh would otherwise make for each
+
+JOINTOUTPUTDIR=""
+if [[ ${JOINTPREFIX} =~ \/ ]]; then #If the joint VCF prefix has a path
+   JOINTOUTPUTDIR="`dirname ${JOINTPREFIX}`/"
+   JOINTPREFIX=`basename ${JOINTPREFIX}`
+fi
+
+NOMARKDUP=""
+REALIGNED=""
+#Check that the input VCF file is there:
+if [[ $SPECIAL =~ "no_markdup" ]]; then
+   NOMARKDUP="_nomarkdup"
+fi
+if [[ ! $SPECIAL =~ "no_IR" ]]; then
+   REALIGNED="_realigned"
+fi
+if [[ $CALLER =~ "HC" ]]; then
+   VCFSUFFIX=".vcf"
+   GZIPPED=""
+   INSNPSUFFIX="_GGVCFs_unfiltered_INSNP.tsv"
+elif [[ $CALLER =~ "MPILEUP" ]]; then
+   VCFSUFFIX=".vcf"
+   GZIPPED=".gz"
+   INSNPSUFFIX="_unfiltered_INSNP.tsv"
+else
+   echo "Unable to determine VCF suffix for variant caller ${CALLER}"
+   exit 2
+fi
+
+INPUTVCF="${JOINTOUTPUTDIR}${JOINTPREFIX}${NOMARKDUP}${REALIGNED}_${CALLER}_joint${VCFSUFFIX}${GZIPPED}"
+if [[ ! -e "${INPUTVCF}" ]]; then
+   if [[ $CALLER =~ "HC" && -e "${INPUTVCF}.gz" ]]; then
+      INPUTVCF="${INPUTVCF}.gz"
+   else
+      echo "Unable to find input VCF ${INPUTVCF} for variant caller ${CALLER}"
+      exit 3
+   fi
+fi
+echo "Using jointly-genotyped VCF ${INPUTVCF}"
+
+SCRIPTDIR=`dirname $0`
+if [[ ! -x "$(command -v ${SCRIPTDIR}/compareSNPlogs)" ]]; then
+   echo "compareSNPlogs has not been compiled, please run the Makefile."
+   exit 10;
+fi
+
+if [[ "$#" -lt "1" ]]; then
+   echo "No samples to classify for jointly-genotyped VCF ${INPUTVCF}"
+   exit 4
+fi
+
+#Sample sheet of the VCF sample name, ground truth, output prefix, and INSNP
+# path for each sample, named as in classifySites.sh:
+SAMPLESHEET="${JOINTOUTPUTDIR}${JOINTPREFIX}${NOMARKDUP}${REALIGNED}_${CALLER}_joint_samples.tsv"
+#Use the binary index of the ground truth made by indexSNPlog if present:
+if [[ -e "${GROUNDTRUTH}.bin" ]]; then
+   echo "Using binary index ${GROUNDTRUTH}.bin of ground truth ${GROUNDTRUTH}"
+   GROUNDTRUTH="${GROUNDTRUTH}.bin"
+fi
+rm -f ${SAMPLESHEET}
+for SAMPLEPREFIX in "$@"
+   do
+   OUTPUTDIR=""
+   PREFIX="${SAMPLEPREFIX}"
+   if [[ ${PREFIX} =~ \/ ]]; then #If the prefix has a path
+      OUTPUTDIR="`dirname ${PREFIX}`/"
+      PREFIX=`basename ${PREFIX}`
+   fi
+   INTPREFIX="${OUTPUTDIR}${PREFIX}${NOMARKDUP}${REALIGNED}_${CALLER}_joint"
+   printf "%s\t%s\t%s\t%s\n" "${PREFIX}" "${GROUNDTRUTH}" "${INTPREFIX}" "${INTPREFIX}${INSNPSUFFIX}" >> ${SAMPLESHEET}
+done
+
+#The indeldist special option annotates the distance to the closest indel
+# in the joint VCF during the same pass:
+INDELDISTOPTS=""
+if [[ $SPECIAL =~ "indeldist" ]]; then
+   INDELDISTOPTS="-x ${INPUTVCF}"
+fi
+
+echo "Classifying sites for all $# samples of ${INPUTVCF} caller ${CALLER}"
+echo "${SCRIPTDIR}/compareSNPlogs -i ${REF}.fai -j ${INPUTVCF} -s ${SAMPLESHEET} -C ${CALLER} ${INDELDISTOPTS}"
+${SCRIPTDIR}/compareSNPlogs -i ${REF}.fai -j ${INPUTVCF} -s ${SAMPLESHEET} -C ${CALLER} ${INDELDISTOPTS}
+COMPARECODE=$?
+if [[ ${COMPARECODE} -ne 0 ]]; then
+   echo "compareSNPlogs on jointly-genotyped VCF ${INPUTVCF} failed with exit code ${COMPARECODE}"
+   exit 5
+fi
@@ -120,8 +120,9 @@ fi
 SCRIPTDIR=`dirname $0`
 source ${SCRIPTDIR}/pipeline_environment.sh
 
-#Check that the necessary scripts/tools exist:
-if [[ ! -x "$(command -v ${BEDTOOLS})" ]]; then
+#Check that the necessary scripts/tools exist (BEDtools is only needed if
+# bedAlgebra wasn't compiled):
+if [[ ! -x "${SCRIPTDIR}/bedAlgebra" && ! -x "$(command -v ${BEDTOOLS})" ]]; then
    echo "BEDtools appears to be missing, could not find at ${BEDTOOLS}."
    exit 9;
 fi
@@ -137,79 +138,153 @@ if [[ ! -e "${MASKINGBED}" ]]; then
    MASKINGBED=""
 fi
 
-echo "Converting VCF to unfiltered INSNP for ${PREFIX} caller ${CALLER}"
-INSNP=""
-if [[ $CALLER =~ "HC" ]]; then
-   #Generate unfiltered INSNP from all-sites VCF generated by
-   # GenotypeGVCFs:
-   INSNP="${INTPREFIX}_GGVCFs_unfiltered_INSNP.tsv"
-   echo "${READER} ${INPUTVCF} | ${SCRIPTDIR}/VCFtoUnfilteredINSNP_skipInsertions_GGVCFs.awk -v \"prefix=${PREFIX}\" > ${INSNP}"
-   ${READER} ${INPUTVCF} | ${SCRIPTDIR}/VCFtoUnfilteredINSNP_skipInsertions_GGVCFs.awk -v "prefix=${PREFIX}" > ${INSNP}
-   INSNPCODE=$?
-   if [[ $INSNPCODE -ne 0 ]]; then
-      echo "awk script to make unfiltered INSNP from ${INPUTVCF} failed with exit code ${INSNPCODE}!"
-      exit 5
-   fi
-elif [[ $CALLER =~ "MPILEUP" ]]; then
-   #Generate unfiltered INSNP from BCFtools bgzipped VCF:
-   INSNP="${INTPREFIX}_unfiltered_INSNP.tsv"
-   echo "${READER} ${INPUTVCF} | ${SCRIPTDIR}/VCFtoUnfilteredINSNP_skipInsertions_samtools.awk -v \"prefix=${PREFIX}\" > ${INSNP}"
-   ${READER} ${INPUTVCF} | ${SCRIPTDIR}/VCFtoUnfilteredINSNP_skipInsertions_samtools.awk -v "prefix=${PREFIX}" > ${INSNP}
-   INSNPCODE=$?
-   if [[ $INSNPCODE -ne 0 ]]; then
-      echo "awk script to make unfiltered INSNP from ${INPUTVCF} failed with exit code ${INSNPCODE}!"
-      exit 5
-   fi
-else
-   echo "Unknown variant caller ${CALLER}, making pseudoref not yet supported"
-   exit 4
-fi
-
 OUTFN="${INTPREFIX}_FNs.tsv"
 OUTFP="${INTPREFIX}_FPs.tsv"
 OUTTP="${INTPREFIX}_TPs.tsv"
 OUTER="${INTPREFIX}_ERs.tsv"
+OUTSITES="${INTPREFIX}_sites.bin"
 
-echo "Classifying sites for ${PREFIX} caller ${CALLER}"
-echo "${SCRIPTDIR}/compareSNPlogs -i ${REF}.fai -e ${GROUNDTRUTH} -o ${INSNP} -n ${OUTFN} -p ${OUTFP} -t ${OUTTP} -r ${OUTER} 1>&2"
-${SCRIPTDIR}/compareSNPlogs -i ${REF}.fai -e ${GROUNDTRUTH} -o ${INSNP} -n ${OUTFN} -p ${OUTFP} -t ${OUTTP} -r ${OUTER} 1>&2
+#The JOINTCLASSIFY task already converted and classified all samples of the
+# joint VCF in one pass, so only the error rates remain:
+if [[ $SPECIAL =~ "jointgeno" && "${INTPREFIX}_compareSNPlogs.txt" -nt "${INPUTVCF}" ]]; then
+   echo "Using classification of ${PREFIX} caller ${CALLER} from JOINTCLASSIFY task"
+   cat ${INTPREFIX}_compareSNPlogs.txt 1>&2
+else
+   echo "Converting VCF to unfiltered INSNP for ${PREFIX} caller ${CALLER}"
+   INSNP=""
+   if [[ $CALLER =~ "HC" ]]; then
+      #Generate unfiltered INSNP from all-sites VCF generated by
+      # GenotypeGVCFs:
+      INSNP="${INTPREFIX}_GGVCFs_unfiltered_INSNP.tsv"
+      echo "${READER} ${INPUTVCF} | ${SCRIPTDIR}/VCFtoUnfilteredINSNP_skipInsertions_GGVCFs.awk -v \"prefix=${PREFIX}\" > ${INSNP}"
+      ${READER} ${INPUTVCF} | ${SCRIPTDIR}/VCFtoUnfilteredINSNP_skipInsertions_GGVCFs.awk -v "prefix=${PREFIX}" > ${INSNP}
+      INSNPCODE=$?
+      if [[ $INSNPCODE -ne 0 ]]; then
+         echo "awk script to make unfiltered INSNP from ${INPUTVCF} failed with exit code ${INSNPCODE}!"
+         exit 5
+      fi
+   elif [[ $CALLER =~ "MPILEUP" ]]; then
+      #Generate unfiltered INSNP from BCFtools bgzipped VCF:
+      INSNP="${INTPREFIX}_unfiltered_INSNP.tsv"
+      echo "${READER} ${INPUTVCF} | ${SCRIPTDIR}/VCFtoUnfilteredINSNP_skipInsertions_samtools.awk -v \"prefix=${PREFIX}\" > ${INSNP}"
+      ${READER} ${INPUTVCF} | ${SCRIPTDIR}/VCFtoUnfilteredINSNP_skipInsertions_samtools.awk -v "prefix=${PREFIX}" > ${INSNP}
+      INSNPCODE=$?
+      if [[ $INSNPCODE -ne 0 ]]; then
+         echo "awk script to make unfiltered INSNP from ${INPUTVCF} failed with exit code ${INSNPCODE}!"
+         exit 5
+      fi
+   else
+      echo "Unknown variant caller ${CALLER}, making pseudoref not yet supported"
+      exit 4
+   fi
 
-echo "Converting classified TSVs to BEDs for ${PREFIX} caller ${CALLER}"
-for class in "ER" "FN" "FP" "TP"
-   do
-   echo "awk 'BEGIN{FS="\t";OFS="\t";}{print $1, $2-1, $2;}' ${INTPREFIX}_${class}s.tsv | sort -k1,1 -k2,2n -k3,3n | ${BEDTOOLS} merge -i - > ${INTPREFIX}_${class}s.bed"
-   awk 'BEGIN{FS="\t";OFS="\t";}{print $1, $2-1, $2;}' ${INTPREFIX}_${class}s.tsv | sort -k1,1 -k2,2n -k3,3n | ${BEDTOOLS} merge -i - > ${INTPREFIX}_${class}s.bed
-   AWKCODE=$?
-   if [[ ${AWKCODE} -ne 0 ]]; then
-      echo "Conversion from classified TSV to BED of ${class}s for ${PREFIX} failed with exit code ${AWKCODE}"
-      exit 6
+   #The indeldist special option annotates the distance to the closest indel
+   # in the VCF during classification, so the INDELDIST task doesn't need to
+   # read the VCF again:
+   INDELDISTOPTS=""
+   if [[ $SPECIAL =~ "indeldist" ]]; then
+      INDELDISTOPTS="-x ${INPUTVCF} -D ${INTPREFIX}_indel_dists_all.tsv"
    fi
-done
 
-echo "Identifying TN sites for ${PREFIX} caller ${CALLER}"
-#One key thing to keep an eye out for is FNs in the expected log but outside
-# of the genome (due to indels).
-#To compensate, we intersect the union of ERs, FNs, FPs, and TPs with the
-# total genome, forcing the resulting BED to be inside these bounds.
-echo "cat ${INTPREFIX}_{ER,FN,FP,TP}s.bed | sort -k1,1 -k2,2n -k3,3n | ${BEDTOOLS} merge -i - | ${BEDTOOLS} intersect -a - -b <(awk 'BEGIN{OFS="\t";}{print $1, 0, $2;}' ${REF}.fai | sort -k1,1 -k2,2n -k3,3n) | ${BEDTOOLS} complement -i - -g <(cut -f1,2 ${REF}.fai | sort -k1,1 -k2,2n -k3,3n) > ${INTPREFIX}_TNs.bed"
-cat ${INTPREFIX}_{ER,FN,FP,TP}s.bed | sort -k1,1 -k2,2n -k3,3n | ${BEDTOOLS} merge -i - | ${BEDTOOLS} intersect -a - -b <(awk 'BEGIN{OFS="\t";}{print $1, 0, $2;}' ${REF}.fai | sort -k1,1 -k2,2n -k3,3n) | ${BEDTOOLS} complement -i - -g <(cut -f1,2 ${REF}.fai | sort -k1,1 -k2,2n -k3,3n) > ${INTPREFIX}_TNs.bed
-COMPLEMENTCODE=$?
-if [[ ${COMPLEMENTCODE} -ne 0 ]]; then
-   echo "Identification of TN sites for ${PREFIX} failed with exit code ${COMPLEMENTCODE}"
-   exit 7
-fi
+   #Use the binary index of the ground truth made by indexSNPlog if present,
+   # so concurrent CLASSIFY jobs share one memory-mapped copy of it:
+   if [[ -e "${GROUNDTRUTH}.bin" ]]; then
+      echo "Using binary index ${GROUNDTRUTH}.bin of ground truth ${GROUNDTRUTH}"
+      GROUNDTRUTH="${GROUNDTRUTH}.bin"
+   fi
 
-echo "Calculating site class counts for ${PREFIX} caller ${CALLER}"
+   echo "Classifying sites for ${PREFIX} caller ${CALLER}"
+   echo "${SCRIPTDIR}/compareSNPlogs -i ${REF}.fai -e ${GROUNDTRUTH} -o ${INSNP} -n ${OUTFN} -p ${OUTFP} -t ${OUTTP} -r ${OUTER} -A ${OUTSITES} ${INDELDISTOPTS} 1>&2"
+   ${SCRIPTDIR}/compareSNPlogs -i ${REF}.fai -e ${GROUNDTRUTH} -o ${INSNP} -n ${OUTFN} -p ${OUTFP} -t ${OUTTP} -r ${OUTER} -A ${OUTSITES} ${INDELDISTOPTS} 1>&2
+fi
 
 declare -A siteclasses
-for class in "ER" "FN" "FP" "TN" "TP"
-   do
+declare -A maskedsiteclasses
+if [[ -x "${SCRIPTDIR}/bedAlgebra" ]]; then
+   #Make the class BEDs and the TN BED, and count the sites of each class that
+   # are callable, before and after masking, in one pass with bedAlgebra:
+   echo "Converting classified TSVs to BEDs, identifying TN sites, and calculating site class counts for ${PREFIX} caller ${CALLER}"
+   ALGEBRAOPTS=(-g ${REF}.fai)
+   for class in "ER" "FN" "FP" "TP"
+      do
+      ALGEBRAOPTS+=(-e "${class}=sites:${INTPREFIX}_${class}s.tsv" -o "${class}=${INTPREFIX}_${class}s.bed")
+   done
+   #Complementing against the .fai keeps FNs outside of the genome (due to
+   # indels) from affecting the TNs:
+   ALGEBRAOPTS+=(-e "TN=~(ER | FN | FP | TP)" -o "TN=${INTPREFIX}_TNs.bed")
    if [[ "${CALLABLEEXT}" == "bed" ]]; then
-      siteclasses[${class}]=`${BEDTOOLS} intersect -a ${INTPREFIX}_${class}s.bed -b <(sort -k1,1 -k2,2n -k3,3n < ${CALLABLEBED}) | awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}'`
+      ALGEBRAOPTS+=(-e "callable=${CALLABLEBED}")
    else
-      siteclasses[${class}]=`${BEDTOOLS} intersect -a ${INTPREFIX}_${class}s.bed -b <(awk 'BEGIN{FS="\t";OFS="\t";}{print $1, 0, $2;}' ${REF}.fai | sort -k1,1 -k2,2n -k3,3n) | awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}'`
+      ALGEBRAOPTS+=(-e "callable=genome")
+   fi
+   SUMS="callable"
+   for class in "ER" "FN" "FP" "TN" "TP"
+      do
+      ALGEBRAOPTS+=(-e "${class}_callable=${class} & callable")
+      SUMS="${SUMS},${class}_callable"
+   done
+   if [[ -n "${MASKINGBED}" ]]; then
+      ALGEBRAOPTS+=(-e "masked=${MASKINGBED} & callable")
+      SUMS="${SUMS},masked"
+      for class in "ER" "FN" "FP" "TN" "TP"
+         do
+         ALGEBRAOPTS+=(-e "${class}_masked=(${class} - ${MASKINGBED}) & callable")
+         SUMS="${SUMS},${class}_masked"
+      done
    fi
-done
+   echo "${SCRIPTDIR}/bedAlgebra ${ALGEBRAOPTS[@]} -s ${SUMS} 2> ${LOGPREFIX}_bedAlgebra.stderr"
+   CLASSCOUNTS=`${SCRIPTDIR}/bedAlgebra "${ALGEBRAOPTS[@]}" -s ${SUMS} 2> ${LOGPREFIX}_bedAlgebra.stderr`
+   ALGEBRACODE=$?
+   if [[ ${ALGEBRACODE} -ne 0 ]]; then
+      echo "bedAlgebra of site classes for ${PREFIX} failed with exit code ${ALGEBRACODE}"
+      exit 7
+   fi
+   while IFS="=" read name count;
+      do
+      case ${name} in
+         callable) totalsites=${count};;
+         masked) maskedsites=${count};;
+         *_callable) siteclasses[${name%_callable}]=${count};;
+         *_masked) maskedsiteclasses[${name%_masked}]=${count};;
+      esac
+   done <<< "${CLASSCOUNTS}"
+else
+   echo "Converting classified TSVs to BEDs for ${PREFIX} caller ${CALLER}"
+   for class in "ER" "FN" "FP" "TP"
+      do
+      echo "awk 'BEGIN{FS="\t";OFS="\t";}{print $1, $2-1, $2;}' ${INTPREFIX}_${class}s.tsv | sort -k1,1 -k2,2n -k3,3n | ${BEDTOOLS} merge -i - > ${INTPREFIX}_${class}s.bed"
+      awk 'BEGIN{FS="\t";OFS="\t";}{print $1, $2-1, $2;}' ${INTPREFIX}_${class}s.tsv | sort -k1,1 -k2,2n -k3,3n | ${BEDTOOLS} merge -i - > ${INTPREFIX}_${class}s.bed
+      AWKCODE=$?
+      if [[ ${AWKCODE} -ne 0 ]]; then
+         echo "Conversion from classified TSV to BED of ${class}s for ${PREFIX} failed with exit code ${AWKCODE}"
+         exit 6
+      fi
+   done
+
+   echo "Identifying TN sites for ${PREFIX} caller ${CALLER}"
+   #One key thing to keep an eye out for is FNs in the expected log but outside
+   # of the genome (due to indels).
+   #To compensate, we intersect the union of ERs, FNs, FPs, and TPs with the
+   # total genome, forcing the resulting BED to be inside these bounds.
+   echo "cat ${INTPREFIX}_{ER,FN,FP,TP}s.bed | sort -k1,1 -k2,2n -k3,3n | ${BEDTOOLS} merge -i - | ${BEDTOOLS} intersect -a - -b <(awk 'BEGIN{OFS="\t";}{print $1, 0, $2;}' ${REF}.fai | sort -k1,1 -k2,2n -k3,3n) | ${BEDTOOLS} complement -i - -g <(cut -f1,2 ${REF}.fai | sort -k1,1 -k2,2n -k3,3n) > ${INTPREFIX}_TNs.bed"
+   cat ${INTPREFIX}_{ER,FN,FP,TP}s.bed | sort -k1,1 -k2,2n -k3,3n | ${BEDTOOLS} merge -i - | ${BEDTOOLS} intersect -a - -b <(awk 'BEGIN{OFS="\t";}{print $1, 0, $2;}' ${REF}.fai | sort -k1,1 -k2,2n -k3,3n) | ${BEDTOOLS} complement -i - -g <(cut -f1,2 ${REF}.fai | sort -k1,1 -k2,2n -k3,3n) > ${INTPREFIX}_TNs.bed
+   COMPLEMENTCODE=$?
+   if [[ ${COMPLEMENTCODE} -ne 0 ]]; then
+      echo "Identification of TN sites for ${PREFIX} failed with exit code ${COMPLEMENTCODE}"
+      exit 7
+   fi
+
+   echo "Calculating site class counts for ${PREFIX} caller ${CALLER}"
+
+   for class in "ER" "FN" "FP" "TN" "TP"
+      do
+      if [[ "${CALLABLEEXT}" == "bed" ]]; then
+         siteclasses[${class}]=`${BEDTOOLS} intersect -a ${INTPREFIX}_${class}s.bed -b <(sort -k1,1 -k2,2n -k3,3n < ${CALLABLEBED}) | awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}'`
+      else
+         siteclasses[${class}]=`${BEDTOOLS} intersect -a ${INTPREFIX}_${class}s.bed -b <(awk 'BEGIN{FS="\t";OFS="\t";}{print $1, 0, $2;}' ${REF}.fai | sort -k1,1 -k2,2n -k3,3n) | awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}'`
+      fi
+   done
+fi
 
 FPR="NA"
 if [[ "${siteclasses['FP']}" -ne "0" || "${siteclasses['ER']}" -ne "0" || "${siteclasses['TN']}" -ne "0" ]]; then
@@ -237,22 +312,24 @@ echo "FDR=${FDR}"
 echo "FNR=${FNR}"
 
 if [[ -n "${MASKINGBED}" ]]; then
-   echo "Calculating site class counts after masking for ${PREFIX}"
-   declare -A maskedsiteclasses
-   for class in "ER" "FN" "FP" "TN" "TP"
-      do
+   #bedAlgebra already counted the sites after masking:
+   if [[ ! -x "${SCRIPTDIR}/bedAlgebra" ]]; then
+      echo "Calculating site class counts after masking for ${PREFIX}"
+      for class in "ER" "FN" "FP" "TN" "TP"
+         do
+         if [[ "${CALLABLEEXT}" == "bed" ]]; then
+            maskedsiteclasses[${class}]=`${BEDTOOLS} subtract -a ${INTPREFIX}_${class}s.bed -b ${MASKINGBED} | ${BEDTOOLS} intersect -a - -b <(sort -k1,1 -k2,2n -k3,3n < ${CALLABLEBED}) | awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}'`
+         else
+            maskedsiteclasses[${class}]=`${BEDTOOLS} subtract -a ${INTPREFIX}_${class}s.bed -b ${MASKINGBED} | ${BEDTOOLS} intersect -a - -b <(awk 'BEGIN{FS="\t";OFS="\t";}{print $1, 0, $2;}' ${REF}.fai | sort -k1,1 -k2,2n -k3,3n) | awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}'`
+         fi
+      done
       if [[ "${CALLABLEEXT}" == "bed" ]]; then
-         maskedsiteclasses[${class}]=`${BEDTOOLS} subtract -a ${INTPREFIX}_${class}s.bed -b ${MASKINGBED} | ${BEDTOOLS} intersect -a - -b <(sort -k1,1 -k2,2n -k3,3n < ${CALLABLEBED}) | awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}'`
+         maskedsites=`bedtools intersect -a ${MASKINGBED} -b <(sort -k1,1 -k2,2n -k3,3n < ${CALLABLEBED}) | awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}'`
+         totalsites=`awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}' ${CALLABLEBED}`
       else
-         maskedsiteclasses[${class}]=`${BEDTOOLS} subtract -a ${INTPREFIX}_${class}s.bed -b ${MASKINGBED} | ${BEDTOOLS} intersect -a - -b <(awk 'BEGIN{FS="\t";OFS="\t";}{print $1, 0, $2;}' ${REF}.fai | sort -k1,1 -k2,2n -k3,3n) | awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}'`
+         maskedsites=`awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}' ${MASKINGBED}`
+         totalsites=`awk 'BEGIN{FS="\t";sum=0;}{sum+=$2;}END{print sum;}' ${REF}.fai`
       fi
-   done
-   if [[ "${CALLABLEEXT}" == "bed" ]]; then
-      maskedsites=`bedtools intersect -a ${MASKINGBED} -b <(sort -k1,1 -k2,2n -k3,3n < ${CALLABLEBED}) | awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}'`
-      totalsites=`awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}' ${CALLABLEBED}`
-   else
-      maskedsites=`awk 'BEGIN{FS="\t";sum=0;}{sum+=$3-$2;}END{print sum;}' ${MASKINGBED}`
-      totalsites=`awk 'BEGIN{FS="\t";sum=0;}{sum+=$2;}END{print sum;}' ${REF}.fai`
    fi
    
    FPRm="NA"
@@ -6,11 +6,39 @@
  * Version 1.2 written 2017/03/02                                                 *
  * Version 1.3 written 2017/09/21                                                 *
  * Version 1.4 written 2018/05/03                                                 *
+ * Version 1.5 written 2026/10/18 Closest indel distance annotation               *
+ * Version 1.6 written 2026/10/18 Memory-mapped binary SNP log index for -e       *
+ * Version 1.7 written 2026/10/18 Depth-stratified site class counts              *
+ * Version 1.8 written 2026/10/18 Direct comparison of pseudoreference FASTAs     *
+ * Version 1.9 written 2026/10/18 One-pass classification of joint VCF samples    *
+ * Version 1.10 written 2026/10/18 Concordance of multiple callsets               *
+ * Version 1.11 written 2026/10/18 Block bootstrap confidence intervals of rates  *
+ * Version 1.12 written 2026/10/18 Indel TP/FN/FP against a diploid indel log     *
+ * Version 1.13 written 2026/10/18 Interned scaffold IDs and columnar records      *
+ * Version 1.14 written 2026/10/18 Pipelined reading, comparison, and writing     *
+ * Version 1.15 written 2026/10/18 Columnar binary table of classified sites      *
+ * Version 1.16 written 2026/10/18 Estimated rates from sampled genomic blocks    *
+ * Version 1.17 written 2026/10/18 Switch and flip errors of phased calls         *
+ * Version 1.18 written 2026/10/18 Site classes by reference sequence context     *
  * Description:                                                                   *
  *                                                                                *
  * Syntax: compareSNPlogs -i [.fai] -e [expected SNP log] -o [in.snp file]        *
  *         -n [output false negatives to this file] -p [output false positives]   *
  *         -t [output true positives] -r [erroneous sites]                        *
+ *         -x [VCF for indel distances] -D [output indel distances of in.snp]     *
+ *         -c [samtools depth or bedGraph] -B [output depth-binned site classes]  *
+ *         -w [bootstrap block size] -N [replicates] -S [seed] -T [threads]       *
+ *         -I [diploid indel log] -R [reference FASTA] -G [output indel classes]  *
+ *         -P [pipeline inputs in .fai scaffold order]                            *
+ *         -A [output columnar binary table of classified sites]                  *
+ *         -F [fraction of genomic blocks to sample for estimated rates]          *
+ *         -H [haplotype 1 SNP log] -J [haplotype 2 SNP log] (phasing of -x)      *
+ *         -X [output site classes by sequence context of -R]                     *
+ *   or:  compareSNPlogs -i [.fai] -R [reference FASTA] -f [pseudoreference FASTA]*
+ *         -e [expected SNP log] or -1 [haplotype 1 FASTA] -2 [haplotype 2 FASTA] *
+ *   or:  compareSNPlogs -i [.fai] -j [joint VCF] -s [sample sheet] -C [HC|MPILEUP]*
+ *   or:  compareSNPlogs -i [.fai] -e [expected SNP log] -o [in.snp] -o [in.snp]  *
+ *         ... -L [callset labels] -K [output per-site concordance]               *
  **********************************************************************************/
 
 #include <iostream>
@@ -24,6 +52,21 @@
 #include <sstream>
 #include <array>
 #include <unordered_set>
+#include <algorithm>
+#include <cstdlib>
+#include <cmath>
+#include <random>
+#include <thread>
+#include <atomic>
+#include <chrono>
+#include <memory>
+#include <zlib.h>
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#endif
+#include "binarySNPlog.h"
+#include "snpLogStore.h"
+#include "binarySiteTable.h"
 
 //Define constants for getopt:
 #define no_argument 0
@@ -31,10 +74,23 @@
 #define optional_argument 2
 
 //Version:
-#define VERSION "1.4"
+#define VERSION "1.18"
 
 //Usage/help:
-#define USAGE "compareSNPlogs\nUsage:\n compareSNPlogs -i [FASTA .fai] -e [expected SNP log] -o [observed in.snp]\n\t-n [output false negative in.snp] -p [output false positive in.snp]\n\t-t [output true positive in.snp] -r [output erroneous call in.snp]\n\t--min_depth [minimum callable depth]\n"
+#define USAGE "compareSNPlogs\nUsage:\n compareSNPlogs -i [FASTA .fai] -e [expected SNP log or indexSNPlog index] -o [observed in.snp]\n\t-n [output false negative in.snp] -p [output false positive in.snp]\n\t-t [output true positive in.snp] -r [output erroneous call in.snp]\n\t--min_depth [minimum callable depth]\n\t-x [VCF to annotate distance to closest indel]\n\t-D [output closest indel distance for all in.snp sites]\n\t-c [samtools depth output or bedGraph of depth] -B [output site classes by depth]\n\t-b [comma-separated depth bin lower bounds]\n\t-w [bootstrap block size in bp] -N [bootstrap replicates, default 1000]\n\t-S [PRNG seed, default 42] -T [threads, default 1]\n\t-I [true indel log] -R [reference FASTA] (compares indels in the -x VCF)\n\t-G [output class of each true and called indel]\n\t-P (overlap reading, comparison, and writing of inputs in .fai scaffold order)\n\t-A [output columnar table of classified sites, see binarySiteTable.h]\n\t-F [fraction of -w blocks (default 100 kbp) to sample for estimated rates]\n\t-H [haplotype 1 merged SNP log] -J [haplotype 2 merged SNP log] (scores phasing of the -x VCF)\n\t-X [output site classes by homopolymer, GC, and STR context of the -R reference]\n or, to score a pseudoreference FASTA directly:\n compareSNPlogs -i [FASTA .fai] -R [reference FASTA] -f [pseudoreference FASTA]\n\t-e [expected SNP log] or -1 [haplotype 1 FASTA] -2 [haplotype 2 FASTA]\n\t(plus any of the outputs above)\n or, to classify every sample of a jointly genotyped VCF in one pass:\n compareSNPlogs -i [FASTA .fai] -j [joint VCF] -C [HC or MPILEUP]\n\t-s [sample sheet: VCF sample, expected SNP log, output prefix, optional in.snp output]\n\t(plus --min_depth and -x)\n or, to compare several callsets with the truth and each other:\n compareSNPlogs -i [FASTA .fai] -e [expected SNP log] -o [in.snp 1] -o [in.snp 2] ...\n\t-L [comma-separated callset labels] -K [output classes of each site in each callset]\n\t(plus --min_depth)\n"
+
+//Number of records in a batch passed from a reader thread to the comparison:
+#define PIPELINE_BATCH_RECORDS 16384
+//Maximum number of batches waiting on the comparison:
+#define PIPELINE_QUEUED_BATCHES 8
+//Size of a chunk of output handed to the writer thread:
+#define PIPELINE_CHUNK_SIZE 1048576
+//Maximum number of chunks waiting on the writer thread:
+#define PIPELINE_QUEUED_CHUNKS 16
+//Old allele marking an uncallable site in a batch of expected SNP log records:
+#define UNCALLABLE_ALLELE 255
+//Width of sampled blocks if not set by -w:
+#define SAMPLE_BLOCK_SIZE 100000
 
 using namespace std;
 
@@ -48,8 +104,8 @@ vector<string> splitString(string line_to_split, char delimiter) {
    return line_vector;
 }
 
-long baseToLong(string &base) {
-   switch(base[0]) {
+long baseToLong(char base) {
+   switch(base) {
       case 'A':
       case 'a':
          return 0;
@@ -85,6 +141,10 @@ long baseToLong(string &base) {
    }
 }
 
+long baseToLong(string &base) {
+   return baseToLong(base[0]);
+}
+
 void splitBase(long base_value, vector<long> &output) {
    switch(base_value) {
       case 0:
@@ -136,14 +196,3378 @@ void splitBase(long base_value, vector<long> &output) {
          output.push_back(4);
          break;
    }
-   return;
-}
+   return;
+}
+
+long degenerateBases(long a, long b) {
+   if (a == b) { //Homozygous
+      return a;
+   } else if (a > 3 || b > 3) { //Either is an N
+      return 4;
+   } else if ((a == 0 && b == 1) || (a == 1 && b == 0)) { //Het A/C
+      return 5; //M
+   } else if ((a == 0 && b == 2) || (a == 2 && b == 0)) { //Het A/G
+      return 6; //R
+   } else if ((a == 0 && b == 3) || (a == 3 && b == 0)) { //Het A/T
+      return 7; //W
+   } else if ((a == 1 && b == 2) || (a == 2 && b == 1)) { //Het C/G
+      return 8; //S
+   } else if ((a == 1 && b == 3) || (a == 3 && b == 1)) { //Het C/T
+      return 9; //Y
+   } else if ((a == 2 && b == 3) || (a == 3 && b == 2)) { //Het G/T
+      return 10; //K
+   } else {
+      return 4;
+   }
+}
+
+//Split allele counts of an erroneous call between TP, FN, and wrong call:
+void countErrorAlleles(long expected_allele, long observed_allele, long ref_base, unsigned long &tps, unsigned long &fns, unsigned long &wrong_calls) {
+   //Split the expected and observed bases into two:
+   vector<long> x, y;
+   splitBase(expected_allele, x);
+   splitBase(observed_allele, y);
+   if (y[0] == x[0] || y[0] == x[1] || y[1] == x[0] || y[1] == x[1]) { //At least one match, so add a tp
+      tps++;
+      if (y[0] == x[0] || y[0] == x[1]) { //Condition on y0 being the base that matched
+         if (y[1] == ref_base) {
+            fns++;
+         } else {
+            wrong_calls++;
+         }
+      } else { //Condition on y1 being the base that matched
+         if (y[1] == ref_base) {
+            fns++;
+         } else {
+            wrong_calls++;
+         }
+      }
+   } else if (y[0] == ref_base || y[1] == ref_base) {
+      fns++;
+      wrong_calls++;
+   } else {
+      wrong_calls += 2;
+   }
+}
+
+//Index of the first base at or after start where either the call or the truth
+// differs from the reference (length if none), so identical stretches of whole
+// scaffolds are skipped a vector at a time:
+size_t nextDifferenceScalar(const char *call, const char *truth, const char *ref, size_t start, size_t length) {
+   for (size_t i = start; i < length; i++) {
+      if (call[i] != ref[i] || truth[i] != ref[i]) {
+         return i;
+      }
+   }
+   return length;
+}
+
+#ifdef __SSE2__
+size_t nextDifferenceSSE2(const char *call, const char *truth, const char *ref, size_t start, size_t length) {
+   size_t i = start;
+   for (; i + 16 <= length; i += 16) {
+      __m128i ref_bases = _mm_loadu_si128((const __m128i *)(ref + i));
+      __m128i same = _mm_and_si128(_mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(call + i)), ref_bases), _mm_cmpeq_epi8(_mm_loadu_si128((const __m128i *)(truth + i)), ref_bases));
+      unsigned int differences = ~(unsigned int)_mm_movemask_epi8(same) & 0xFFFF;
+      if (differences != 0) {
+         return i + __builtin_ctz(differences);
+      }
+   }
+   return nextDifferenceScalar(call, truth, ref, i, length);
+}
+#endif
+
+#if defined(__x86_64__) || defined(__i386__)
+//Built for AVX2 regardless of -march, and only called if the CPU has it:
+__attribute__((target("avx2")))
+size_t nextDifferenceAVX2(const char *call, const char *truth, const char *ref, size_t start, size_t length) {
+   size_t i = start;
+   for (; i + 32 <= length; i += 32) {
+      __m256i ref_bases = _mm256_loadu_si256((const __m256i *)(ref + i));
+      __m256i same = _mm256_and_si256(_mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(call + i)), ref_bases), _mm256_cmpeq_epi8(_mm256_loadu_si256((const __m256i *)(truth + i)), ref_bases));
+      unsigned int differences = ~(unsigned int)_mm256_movemask_epi8(same);
+      if (differences != 0) {
+         return i + __builtin_ctz(differences);
+      }
+   }
+   return nextDifferenceScalar(call, truth, ref, i, length);
+}
+#endif
+
+size_t nextDifference(const char *call, const char *truth, const char *ref, size_t start, size_t length) {
+#if defined(__x86_64__) || defined(__i386__)
+   static const bool has_avx2 = __builtin_cpu_supports("avx2");
+   if (has_avx2) {
+      return nextDifferenceAVX2(call, truth, ref, start, length);
+   }
+#endif
+#ifdef __SSE2__
+   return nextDifferenceSSE2(call, truth, ref, start, length);
+#else
+   return nextDifferenceScalar(call, truth, ref, start, length);
+#endif
+}
+
+//Read a line from a gzipped or plain file of arbitrary length:
+bool gzGetline(gzFile input_file, string &line) {
+   char buffer[65536];
+   line.clear();
+   while (gzgets(input_file, buffer, sizeof(buffer)) != NULL) {
+      line.append(buffer);
+      if (!line.empty() && line.back() == '\n') {
+         line.pop_back();
+         return 1;
+      }
+   }
+   return !line.empty();
+}
+
+//Scaffolds of a (possibly gzipped) FASTA read sequentially by name and uppercased,
+// holding on to any scaffolds passed over so that FASTAs in a different order
+// than the .fai still work:
+class fastaScaffolds {
+   public:
+      bool open(const string &fasta_path);
+      bool get(const string &scaffold, string &sequence);
+      void close();
+   private:
+      gzFile fasta = NULL;
+      string next_header;
+      map<string, string> skipped;
+      bool readRecord(string &name, string &sequence);
+};
+
+bool fastaScaffolds::open(const string &fasta_path) {
+   fasta = gzopen(fasta_path.c_str(), "rb");
+   if (fasta == NULL) {
+      return 1;
+   }
+   gzbuffer(fasta, 1048576);
+   return 0;
+}
+
+//Read the next record, naming it by its header up to the first whitespace:
+bool fastaScaffolds::readRecord(string &name, string &sequence) {
+   string fastaline;
+   sequence.clear();
+   if (next_header.empty()) { //Find the first header
+      while (gzGetline(fasta, fastaline) && (fastaline.empty() || fastaline[0] != '>')) {}
+      if (fastaline.empty() || fastaline[0] != '>') {
+         return 1;
+      }
+      next_header = fastaline;
+   }
+   name = next_header.substr(1, next_header.find_first_of(" \t\r") - 1);
+   next_header.clear();
+   while (gzGetline(fasta, fastaline)) {
+      if (!fastaline.empty() && fastaline[0] == '>') {
+         next_header = fastaline;
+         break;
+      }
+      if (!fastaline.empty() && fastaline.back() == '\r') {
+         fastaline.pop_back();
+      }
+      for (auto base_iterator = fastaline.begin(); base_iterator != fastaline.end(); ++base_iterator) {
+         if (*base_iterator >= 'a' && *base_iterator <= 'z') {
+            *base_iterator -= 'a' - 'A';
+         }
+      }
+      sequence.append(fastaline);
+   }
+   return 0;
+}
+
+bool fastaScaffolds::get(const string &scaffold, string &sequence) {
+   auto skipped_iterator = skipped.find(scaffold);
+   if (skipped_iterator != skipped.end()) {
+      sequence.swap(skipped_iterator->second);
+      skipped.erase(skipped_iterator);
+      return 0;
+   }
+   string name;
+   while (!readRecord(name, sequence)) {
+      if (name == scaffold) {
+         return 0;
+      }
+      skipped[name].swap(sequence);
+   }
+   return 1;
+}
+
+void fastaScaffolds::close() {
+   if (fasta != NULL) {
+      gzclose(fasta);
+   }
+   fasta = NULL;
+   skipped.clear();
+}
+
+//Indel in the reference coordinate space, where deleted bases start at the position,
+// and inserted bases precede it:
+struct indelRecord {
+   long position;
+   bool insertion;
+   string sequence; //Inserted bases, or deleted bases once normalized
+   long length;
+   bool homozygous;
+};
+
+//Indel calls from a VCF matched against the true indels of a diploid indel log a scaffold at a time,
+// with both left-normalized against the reference so that equivalent representations match:
+class indelComparison {
+   public:
+      bool enabled = 0;
+      //Number of insertions (0) and deletions (1) of each class, and TPs with the wrong zygosity:
+      array<unsigned long, 2> tps = {{0, 0}}, fns = {{0, 0}}, fps = {{0, 0}}, genotype_mismatches = {{0, 0}};
+      //Calls where both REF and ALT remain after trimming, which can't be matched as a simple indel:
+      unsigned long complex_calls = 0;
+      //Output path for the class of every true and called indel:
+      string classes_path = "";
+      indelComparison(const scaffoldIDs &scaffold_ids) : scaffold_ids(scaffold_ids), calls(scaffold_ids.size()) {}
+      bool readTruth(const string &truth_path);
+      void addRecord(const string &vcfline);
+      void openOutput();
+      void compareScaffold(uint32_t scaffold_id, const string &ref_sequence);
+      void finish();
+      void report(ostream &output);
+   private:
+      const scaffoldIDs &scaffold_ids;
+      indelLogStore truth;
+      vector<vector<indelRecord>> calls;
+      ofstream classes_file;
+      void normalize(vector<indelRecord> &indels, const string &ref_sequence);
+      void writeClass(const string &scaffold, const indelRecord &indel, const string &truth_zygosity, const string &call_zygosity, const char *indel_class);
+};
+
+//Read the true indels from a diploid indel log (pos, ins/del, length, sequence, zygosity),
+// skipping those on scaffolds missing from the .fai:
+bool indelComparison::readTruth(const string &truth_path) {
+   ifstream truth_log;
+   truth_log.open(truth_path);
+   if (!truth_log) {
+      return 1;
+   }
+   cerr << "Reading true indels from " << truth_path << endl;
+   truth.read(truth_log, scaffold_ids);
+   truth_log.close();
+   cerr << "Done reading true indels" << endl;
+   enabled = 1;
+   return 0;
+}
+
+//Add the indel alleles of the first sample's genotype in a VCF record (or all ALT alleles if there are no samples).
+//Filtered records are skipped, as are SNPs and MNPs:
+void indelComparison::addRecord(const string &vcfline) {
+   if (vcfline.empty() || vcfline[0] == '#') {
+      return;
+   }
+   vector<string> line_vector = splitString(vcfline, '\t');
+   if (line_vector.size() < 5 || (line_vector.size() > 6 && line_vector[6] != "PASS" && line_vector[6] != ".")) {
+      return;
+   }
+   uint32_t scaffold_id = scaffold_ids.find(line_vector[0]);
+   if (scaffold_id == scaffoldIDs::missing) {
+      return;
+   }
+   vector<string> alt_alleles = splitString(line_vector[4], ',');
+   //Called ALT alleles, and whether the genotype is homozygous:
+   vector<size_t> called_alleles;
+   bool homozygous = 0;
+   if (line_vector.size() > 9) {
+      vector<string> format_keys = splitString(line_vector[8], ':');
+      vector<string> sample_values = splitString(line_vector[9], ':');
+      size_t gt_index = find(format_keys.begin(), format_keys.end(), "GT") - format_keys.begin();
+      if (gt_index >= format_keys.size() || gt_index >= sample_values.size()) {
+         return;
+      }
+      string genotype = sample_values[gt_index];
+      replace(genotype.begin(), genotype.end(), '|', '/');
+      vector<string> gt_alleles = splitString(genotype, '/');
+      homozygous = !gt_alleles.empty();
+      for (auto gt_iterator = gt_alleles.begin(); gt_iterator != gt_alleles.end(); ++gt_iterator) {
+         if (*gt_iterator != gt_alleles[0] || *gt_iterator == ".") {
+            homozygous = 0;
+         }
+         if (*gt_iterator == "." || *gt_iterator == "0") {
+            continue;
+         }
+         size_t allele = stoul(*gt_iterator);
+         if (allele <= alt_alleles.size() && find(called_alleles.begin(), called_alleles.end(), allele) == called_alleles.end()) {
+            called_alleles.push_back(allele);
+         }
+      }
+   } else {
+      for (size_t allele = 1; allele <= alt_alleles.size(); allele++) {
+         called_alleles.push_back(allele);
+      }
+   }
+   long vcf_position = stol(line_vector[1]);
+   for (auto allele_iterator = called_alleles.begin(); allele_iterator != called_alleles.end(); ++allele_iterator) {
+      string ref_allele = line_vector[3];
+      string alt_allele = alt_alleles[*allele_iterator - 1];
+      if (alt_allele.empty() || alt_allele[0] == '<' || alt_allele == "*" || ref_allele.length() == alt_allele.length()) {
+         continue;
+      }
+      //Trim the bases shared by REF and ALT, leaving the inserted or deleted bases:
+      while (!ref_allele.empty() && !alt_allele.empty() && toupper(ref_allele.back()) == toupper(alt_allele.back())) {
+         ref_allele.pop_back();
+         alt_allele.pop_back();
+      }
+      size_t prefix_length = 0;
+      while (prefix_length < ref_allele.length() && prefix_length < alt_allele.length() && toupper(ref_allele[prefix_length]) == toupper(alt_allele[prefix_length])) {
+         prefix_length++;
+      }
+      ref_allele.erase(0, prefix_length);
+      alt_allele.erase(0, prefix_length);
+      if (!ref_allele.empty() && !alt_allele.empty()) {
+         complex_calls++;
+         continue;
+      }
+      indelRecord indel;
+      indel.position = vcf_position + prefix_length;
+      indel.insertion = ref_allele.empty();
+      indel.sequence = indel.insertion ? alt_allele : ref_allele;
+      indel.length = indel.sequence.length();
+      indel.homozygous = homozygous;
+      calls[scaffold_id].push_back(indel);
+   }
+}
+
+void indelComparison::openOutput() {
+   if (!classes_path.empty()) {
+      classes_file.open(classes_path);
+      if (!classes_file) {
+         cerr << "Unable to open indel class output file, so ignoring that function." << endl;
+         classes_path = "";
+         return;
+      }
+      classes_file << "Scaffold\tPosition\tType\tLength\tSequence\tTruth\tCall\tClass" << endl;
+   }
+}
+
+//Shift each indel left as far as the reference allows, take deleted bases from the reference,
+// then sort and combine copies of the same indel (e.g. two heterozygous copies are homozygous):
+void indelComparison::normalize(vector<indelRecord> &indels, const string &ref_sequence) {
+   long ref_length = ref_sequence.length();
+   for (auto indel_iterator = indels.begin(); indel_iterator != indels.end(); ++indel_iterator) {
+      long &position = indel_iterator->position;
+      if (indel_iterator->insertion) {
+         string &sequence = indel_iterator->sequence;
+         for (auto base_iterator = sequence.begin(); base_iterator != sequence.end(); ++base_iterator) {
+            *base_iterator = toupper(*base_iterator);
+         }
+         position = min(position, ref_length + 1);
+         while (position > 1 && ref_sequence[position-2] == sequence.back()) {
+            sequence.pop_back();
+            sequence.insert(sequence.begin(), ref_sequence[position-2]);
+            position--;
+         }
+      } else {
+         long &length = indel_iterator->length;
+         if (position + length - 1 > ref_length) {
+            length = max(ref_length - position + 1, 0L);
+         }
+         while (position > 1 && length > 0 && ref_sequence[position-2] == ref_sequence[position+length-2]) {
+            position--;
+         }
+         indel_iterator->sequence = length > 0 ? ref_sequence.substr(position-1, length) : "";
+      }
+   }
+   sort(indels.begin(), indels.end(), [](const indelRecord &a, const indelRecord &b) {
+      return a.position < b.position || (a.position == b.position && (a.insertion < b.insertion || (a.insertion == b.insertion && a.sequence < b.sequence)));
+   });
+   size_t unique_indels = 0;
+   for (size_t i = 0; i < indels.size(); i++) {
+      if (indels[i].length == 0) {
+         continue;
+      }
+      if (unique_indels > 0 && indels[unique_indels-1].position == indels[i].position && indels[unique_indels-1].insertion == indels[i].insertion && indels[unique_indels-1].sequence == indels[i].sequence) {
+         indels[unique_indels-1].homozygous = 1;
+      } else {
+         indels[unique_indels++] = indels[i];
+      }
+   }
+   indels.resize(unique_indels);
+}
+
+//Output in indel log coordinates, so inserted bases follow the position:
+void indelComparison::writeClass(const string &scaffold, const indelRecord &indel, const string &truth_zygosity, const string &call_zygosity, const char *indel_class) {
+   classes_file << scaffold << '\t' << indel.position - (indel.insertion ? 1 : 0) << '\t' << (indel.insertion ? "ins" : "del") << '\t' << indel.length << '\t' << indel.sequence << '\t' << truth_zygosity << '\t' << call_zygosity << '\t' << indel_class << '\n';
+}
+
+//Merge-join the normalized true and called indels of a scaffold:
+void indelComparison::compareScaffold(uint32_t scaffold_id, const string &ref_sequence) {
+   const string &scaffold = scaffold_ids.name(scaffold_id);
+   vector<indelRecord> true_indels;
+   for (auto log_iterator = truth.scaffolds[scaffold_id].begin(); log_iterator != truth.scaffolds[scaffold_id].end(); ++log_iterator) {
+      if (log_iterator->size <= 0) {
+         continue;
+      }
+      indelRecord indel;
+      //Inserted bases follow the logged position:
+      indel.position = log_iterator->position + (log_iterator->insertion ? 1 : 0);
+      indel.insertion = log_iterator->insertion;
+      indel.sequence = log_iterator->sequence;
+      indel.length = log_iterator->size;
+      indel.homozygous = log_iterator->homozygous;
+      true_indels.push_back(indel);
+   }
+   vector<indelRecord> &called_indels = calls[scaffold_id];
+   normalize(true_indels, ref_sequence);
+   normalize(called_indels, ref_sequence);
+   size_t i = 0, j = 0;
+   while (i < true_indels.size() || j < called_indels.size()) {
+      int order = 0;
+      if (i == true_indels.size()) {
+         order = 1;
+      } else if (j == called_indels.size()) {
+         order = -1;
+      } else {
+         const indelRecord &a = true_indels[i], &b = called_indels[j];
+         if (a.position != b.position) {
+            order = a.position < b.position ? -1 : 1;
+         } else if (a.insertion != b.insertion) {
+            order = a.insertion < b.insertion ? -1 : 1;
+         } else if (a.sequence != b.sequence) {
+            order = a.sequence < b.sequence ? -1 : 1;
+         }
+      }
+      if (order < 0) {
+         fns[true_indels[i].insertion ? 0 : 1]++;
+         if (!classes_path.empty()) {
+            writeClass(scaffold, true_indels[i], true_indels[i].homozygous ? "hom" : "het", "NA", "FN");
+         }
+         i++;
+      } else if (order > 0) {
+         fps[called_indels[j].insertion ? 0 : 1]++;
+         if (!classes_path.empty()) {
+            writeClass(scaffold, called_indels[j], "NA", called_indels[j].homozygous ? "hom" : "het", "FP");
+         }
+         j++;
+      } else {
+         tps[true_indels[i].insertion ? 0 : 1]++;
+         if (true_indels[i].homozygous != called_indels[j].homozygous) {
+            genotype_mismatches[true_indels[i].insertion ? 0 : 1]++;
+         }
+         if (!classes_path.empty()) {
+            writeClass(scaffold, true_indels[i], true_indels[i].homozygous ? "hom" : "het", called_indels[j].homozygous ? "hom" : "het", "TP");
+         }
+         i++;
+         j++;
+      }
+   }
+   //Free the scaffold's indels once they're classified:
+   vector<indelLogRecord>().swap(truth.scaffolds[scaffold_id]);
+   vector<indelRecord>().swap(called_indels);
+}
+
+void indelComparison::finish() {
+   if (!classes_path.empty()) {
+      classes_file.close();
+   }
+}
+
+void indelComparison::report(ostream &output) {
+   const char *type_names[] = {"Insertions", "Deletions"};
+   output << endl;
+   output << "Indels:" << endl;
+   output << "Type\tTP\tFN\tFP\tGenotype mismatches\tSensitivity\tFDR" << endl;
+   for (unsigned int type = 0; type < 3; type++) {
+      unsigned long type_tps = type < 2 ? tps[type] : tps[0] + tps[1];
+      unsigned long type_fns = type < 2 ? fns[type] : fns[0] + fns[1];
+      unsigned long type_fps = type < 2 ? fps[type] : fps[0] + fps[1];
+      unsigned long type_mismatches = type < 2 ? genotype_mismatches[type] : genotype_mismatches[0] + genotype_mismatches[1];
+      output << (type < 2 ? type_names[type] : "All") << '\t' << type_tps << '\t' << type_fns << '\t' << type_fps << '\t' << type_mismatches << '\t' << (double)type_tps/(double)(type_tps+type_fns) << '\t' << (double)type_fps/(double)(type_tps+type_fps) << endl;
+   }
+   output << "Complex calls\t" << complex_calls << endl;
+}
+
+//Phased heterozygous SNP call, with the allele on each haplotype of the call:
+struct phasedCall {
+   uint32_t position;
+   //Phase set (PS) of the call, or 0 if the VCF has none, so all of a scaffold is one block:
+   unsigned long phase_set;
+   array<char, 2> alleles;
+};
+
+//Phasing of the heterozygous SNP calls of a VCF scored against the two haplotypes of the
+// truth (the merged SNP logs of the haploids) a scaffold at a time:
+class phaseComparison {
+   public:
+      bool enabled = 0;
+      //Heterozygous sites of the truth, and phased and unphased heterozygous SNP calls:
+      unsigned long true_hets = 0, phased_calls = 0, unphased_calls = 0;
+      //Phased calls at true heterozygous sites with both true alleles, and adjacent pairs of them in a phase block:
+      unsigned long assessed_sites = 0, assessed_pairs = 0;
+      //Switches of the phase between adjacent assessed sites, not counting flip errors
+      // (single sites phased opposite to both of their neighbours):
+      unsigned long switch_errors = 0, flip_errors = 0;
+      phaseComparison(const scaffoldIDs &scaffold_ids) : scaffold_ids(scaffold_ids) {}
+      bool readTruth(const string &hap1_path, const string &hap2_path);
+      void addRecord(const string &vcfline);
+      void compareScaffold(uint32_t scaffold_id);
+      void report(ostream &output);
+   private:
+      const scaffoldIDs &scaffold_ids;
+      //SNPs of each haplotype of the truth (position, ref, alt) per scaffold:
+      array<vector<vector<array<uint32_t, 3>>>, 2> truth;
+      vector<vector<phasedCall>> calls;
+      //Span in bp of each phase block with at least two phased calls:
+      vector<unsigned long> block_spans;
+};
+
+//Read the SNPs of each haplotype from its merged SNP log (scaffold, position, ref, alt):
+bool phaseComparison::readTruth(const string &hap1_path, const string &hap2_path) {
+   const string *paths[] = {&hap1_path, &hap2_path};
+   calls.assign(scaffold_ids.size(), vector<phasedCall>());
+   for (unsigned int haplotype = 0; haplotype < 2; haplotype++) {
+      ifstream hap_log;
+      hap_log.open(*paths[haplotype]);
+      if (!hap_log) {
+         return 1;
+      }
+      cerr << "Reading SNPs of haplotype " << haplotype + 1 << " from " << *paths[haplotype] << endl;
+      truth[haplotype].assign(scaffold_ids.size(), vector<array<uint32_t, 3>>());
+      string logline;
+      while (getline(hap_log, logline)) {
+         size_t starts[4], ends[4];
+         if (fieldBounds(logline, starts, ends, 4) < 4) {
+            continue;
+         }
+         uint32_t scaffold_id = scaffold_ids.find(logline, ends[0]);
+         if (scaffold_id == scaffoldIDs::missing) {
+            continue;
+         }
+         truth[haplotype][scaffold_id].push_back({{(uint32_t)strtoul(logline.c_str() + starts[1], NULL, 10), (uint32_t)toupper(logline[starts[2]]), (uint32_t)toupper(logline[starts[3]])}});
+      }
+      hap_log.close();
+   }
+   cerr << "Done reading SNPs of the haplotypes" << endl;
+   enabled = 1;
+   return 0;
+}
+
+//Add the first sample's genotype of a VCF record if it's a heterozygous SNP, skipping filtered records:
+void phaseComparison::addRecord(const string &vcfline) {
+   if (vcfline.empty() || vcfline[0] == '#') {
+      return;
+   }
+   vector<string> line_vector = splitString(vcfline, '\t');
+   if (line_vector.size() < 10 || line_vector[3].length() != 1 || (line_vector[6] != "PASS" && line_vector[6] != ".")) {
+      return;
+   }
+   uint32_t scaffold_id = scaffold_ids.find(line_vector[0]);
+   if (scaffold_id == scaffoldIDs::missing) {
+      return;
+   }
+   vector<string> format_keys = splitString(line_vector[8], ':');
+   vector<string> sample_values = splitString(line_vector[9], ':');
+   size_t gt_index = find(format_keys.begin(), format_keys.end(), "GT") - format_keys.begin();
+   size_t ps_index = find(format_keys.begin(), format_keys.end(), "PS") - format_keys.begin();
+   if (gt_index >= sample_values.size()) {
+      return;
+   }
+   const string &genotype = sample_values[gt_index];
+   size_t separator = genotype.find_first_of("/|");
+   if (separator == string::npos || genotype.find_first_of("/|", separator + 1) != string::npos || genotype[0] == '.' || genotype[separator+1] == '.') {
+      return;
+   }
+   vector<string> alleles = splitString(line_vector[4], ',');
+   alleles.insert(alleles.begin(), line_vector[3]);
+   size_t allele_indices[2] = {strtoul(genotype.c_str(), NULL, 10), strtoul(genotype.c_str() + separator + 1, NULL, 10)};
+   if (allele_indices[0] == allele_indices[1] || allele_indices[0] >= alleles.size() || allele_indices[1] >= alleles.size() || alleles[allele_indices[0]].length() != 1 || alleles[allele_indices[1]].length() != 1) {
+      return;
+   }
+   if (genotype[separator] == '/') {
+      unphased_calls++;
+      return;
+   }
+   phasedCall call;
+   call.position = stoul(line_vector[1]);
+   call.phase_set = ps_index < sample_values.size() ? strtoul(sample_values[ps_index].c_str(), NULL, 10) : 0;
+   call.alleles = {{(char)toupper(alleles[allele_indices[0]][0]), (char)toupper(alleles[allele_indices[1]][0])}};
+   calls[scaffold_id].push_back(call);
+   phased_calls++;
+}
+
+//Find the orientation of each phased call at a true heterozygous site in each phase block,
+// and count the switches of orientation between adjacent sites:
+void phaseComparison::compareScaffold(uint32_t scaffold_id) {
+   //Alleles of both haplotypes of the truth at each site where either differs from the reference:
+   map<uint32_t, array<char, 2>> true_sites;
+   for (unsigned int haplotype = 0; haplotype < 2; haplotype++) {
+      for (auto snp_iterator = truth[haplotype][scaffold_id].begin(); snp_iterator != truth[haplotype][scaffold_id].end(); ++snp_iterator) {
+         auto site_iterator = true_sites.find((*snp_iterator)[0]);
+         if (site_iterator == true_sites.end()) {
+            site_iterator = true_sites.insert(make_pair((*snp_iterator)[0], array<char, 2>{{(char)(*snp_iterator)[1], (char)(*snp_iterator)[1]}})).first;
+         }
+         site_iterator->second[haplotype] = (*snp_iterator)[2];
+      }
+   }
+   for (auto site_iterator = true_sites.begin(); site_iterator != true_sites.end(); ++site_iterator) {
+      if (site_iterator->second[0] != site_iterator->second[1]) {
+         true_hets++;
+      }
+   }
+   //Calls of each phase block in order of position:
+   map<unsigned long, vector<const phasedCall *>> phase_blocks;
+   for (auto call_iterator = calls[scaffold_id].begin(); call_iterator != calls[scaffold_id].end(); ++call_iterator) {
+      phase_blocks[call_iterator->phase_set].push_back(&*call_iterator);
+   }
+   for (auto block_iterator = phase_blocks.begin(); block_iterator != phase_blocks.end(); ++block_iterator) {
+      vector<const phasedCall *> &block_calls = block_iterator->second;
+      stable_sort(block_calls.begin(), block_calls.end(), [](const phasedCall *a, const phasedCall *b) {
+         return a->position < b->position;
+      });
+      if (block_calls.size() > 1) {
+         block_spans.push_back(block_calls.back()->position - block_calls.front()->position + 1);
+      }
+      //Whether the first haplotype of the call is the second of the truth at each assessed site:
+      vector<bool> flipped;
+      for (auto call_iterator = block_calls.begin(); call_iterator != block_calls.end(); ++call_iterator) {
+         auto site_iterator = true_sites.find((*call_iterator)->position);
+         if (site_iterator == true_sites.end() || site_iterator->second[0] == site_iterator->second[1]) {
+            continue;
+         }
+         const array<char, 2> &true_alleles = site_iterator->second, &call_alleles = (*call_iterator)->alleles;
+         if (call_alleles[0] == true_alleles[0] && call_alleles[1] == true_alleles[1]) {
+            flipped.push_back(0);
+         } else if (call_alleles[0] == true_alleles[1] && call_alleles[1] == true_alleles[0]) {
+            flipped.push_back(1);
+         }
+      }
+      assessed_sites += flipped.size();
+      for (size_t i = 1; i < flipped.size(); i++) {
+         assessed_pairs++;
+         if (flipped[i] == flipped[i-1]) {
+            continue;
+         }
+         if (i + 1 < flipped.size() && flipped[i+1] == flipped[i-1]) { //Switch and switch back is a flip of one site
+            flip_errors++;
+            assessed_pairs++;
+            i++;
+         } else {
+            switch_errors++;
+         }
+      }
+   }
+   //Free the scaffold's truth and calls once they're compared:
+   vector<array<uint32_t, 3>>().swap(truth[0][scaffold_id]);
+   vector<array<uint32_t, 3>>().swap(truth[1][scaffold_id]);
+   vector<phasedCall>().swap(calls[scaffold_id]);
+}
+
+void phaseComparison::report(ostream &output) {
+   //Phase block N50 is the span of the block that brings the blocks at least as long up to half of the total span:
+   sort(block_spans.begin(), block_spans.end(), greater<unsigned long>());
+   unsigned long total_span = 0, cumulative_span = 0, block_n50 = 0;
+   for (auto span_iterator = block_spans.begin(); span_iterator != block_spans.end(); ++span_iterator) {
+      total_span += *span_iterator;
+   }
+   for (auto span_iterator = block_spans.begin(); span_iterator != block_spans.end(); ++span_iterator) {
+      cumulative_span += *span_iterator;
+      if (2*cumulative_span >= total_span) {
+         block_n50 = *span_iterator;
+         break;
+      }
+   }
+   output << endl;
+   output << "Phasing:" << endl;
+   output << "True heterozygous sites\t" << true_hets << endl;
+   output << "Phased heterozygous calls\t" << phased_calls << endl;
+   output << "Unphased heterozygous calls\t" << unphased_calls << endl;
+   output << "Assessed sites\t" << assessed_sites << endl;
+   output << "Phase blocks\t" << block_spans.size() << endl;
+   output << "Phase block N50\t" << block_n50 << endl;
+   output << "Switch errors\t" << switch_errors << endl;
+   output << "Flip errors\t" << flip_errors << endl;
+   output << "Switch error rate\t" << (double)switch_errors/(double)assessed_pairs << endl;
+   output << "Flip error rate\t" << (double)flip_errors/(double)assessed_sites << endl;
+}
+
+//Positions of indels per scaffold from a VCF, with a cursor per scaffold
+// so that distances for sites visited in increasing order along a
+// scaffold are found with a two-pointer sweep:
+class indelDistances {
+   public:
+      bool enabled = 0;
+      //Indel comparison that gets the calls from the same pass over the VCF:
+      indelComparison *indel_calls = nullptr;
+      //Phase comparison that gets the phased genotypes from the same pass:
+      phaseComparison *phased_calls = nullptr;
+      indelDistances(const scaffoldIDs &scaffold_ids) : scaffold_ids(scaffold_ids), indel_positions(scaffold_ids.size()), cursors(scaffold_ids.size(), 0) {}
+      bool readVCF(string vcf_path);
+      void addRecord(const string &vcfline);
+      void sortPositions(uint32_t scaffold_id);
+      string column(uint32_t scaffold_id, long position);
+   private:
+      //Indels on scaffolds missing from the .fai are never looked up, so they're skipped:
+      const scaffoldIDs &scaffold_ids;
+      vector<vector<long>> indel_positions;
+      vector<size_t> cursors;
+};
+
+//Extract indel positions from a (possibly gzipped) VCF in a single streaming pass:
+bool indelDistances::readVCF(string vcf_path) {
+   gzFile vcf = gzopen(vcf_path.c_str(), "rb");
+   if (vcf == NULL) {
+      return 1;
+   }
+   string vcfline;
+   while (gzGetline(vcf, vcfline)) {
+      addRecord(vcfline);
+      if (indel_calls != nullptr) {
+         indel_calls->addRecord(vcfline);
+      }
+      if (phased_calls != nullptr) {
+         phased_calls->addRecord(vcfline);
+      }
+   }
+   gzclose(vcf);
+   for (uint32_t scaffold_id = 0; scaffold_id < indel_positions.size(); scaffold_id++) {
+      sortPositions(scaffold_id);
+   }
+   enabled = 1;
+   return 0;
+}
+
+//Add the position of a VCF record if it's an indel:
+void indelDistances::addRecord(const string &vcfline) {
+   if (vcfline.empty() || vcfline[0] == '#') { //Skip header and comment lines
+      return;
+   }
+   //Only the first 5 columns matter, so find their boundaries without splitting the whole line:
+   size_t field_starts[6];
+   field_starts[0] = 0;
+   for (unsigned int i = 1; i < 6; i++) {
+      size_t tab = vcfline.find('\t', field_starts[i-1]);
+      if (tab == string::npos) {
+         if (i < 5) {
+            return;
+         }
+         tab = vcfline.length();
+      }
+      field_starts[i] = tab + 1;
+   }
+   bool indel = field_starts[4] - field_starts[3] - 1 != 1; //Deletions have multi-base REF
+   size_t alt_start = field_starts[4];
+   size_t alt_end = field_starts[5] - 1;
+   while (!indel && alt_start < alt_end) { //Insertions have a multi-base ALT
+      size_t comma = vcfline.find(',', alt_start);
+      if (comma == string::npos || comma > alt_end) {
+         comma = alt_end;
+      }
+      //Symbolic alleles like <NON_REF> or <*> are not indels:
+      if (comma - alt_start != 1 && vcfline[alt_start] != '<') {
+         indel = 1;
+      }
+      alt_start = comma + 1;
+   }
+   if (indel) {
+      uint32_t scaffold_id = scaffold_ids.find(vcfline, field_starts[1] - 1);
+      if (scaffold_id != scaffoldIDs::missing) {
+         indel_positions[scaffold_id].push_back(atol(vcfline.c_str() + field_starts[1]));
+      }
+   }
+}
+
+//Sort the indel positions of a scaffold once all of its records are added:
+void indelDistances::sortPositions(uint32_t scaffold_id) {
+   vector<long> &positions = indel_positions[scaffold_id];
+   if (!is_sorted(positions.begin(), positions.end())) {
+      sort(positions.begin(), positions.end());
+   }
+}
+
+//Tab-prefixed distance to the closest indel (1 if at the indel, as in closestIndelDistance.pl),
+// or NA if there are no indels on the scaffold, or empty if not enabled:
+string indelDistances::column(uint32_t scaffold_id, long position) {
+   if (!enabled) {
+      return "";
+   }
+   const vector<long> &positions = indel_positions[scaffold_id];
+   if (positions.empty()) {
+      return "\tNA";
+   }
+   size_t &cursor = cursors[scaffold_id];
+   //Sites are visited in increasing order, but rewind just in case they aren't:
+   while (cursor > 0 && positions[cursor-1] >= position) {
+      cursor--;
+   }
+   while (cursor < positions.size() - 1 && positions[cursor] < position) {
+      cursor++;
+   }
+   long distance = labs(positions[cursor] - position) + 1;
+   if (cursor > 0) {
+      distance = min(distance, labs(positions[cursor-1] - position) + 1);
+   }
+   return "\t" + to_string(distance);
+}
+
+//Site classes counted by depth:
+#define DEPTH_TP 0
+#define DEPTH_FN 1
+#define DEPTH_FP 2
+#define DEPTH_ER 3
+
+//Sites of each class per scaffold, binned by raw depth after classification by
+// a merge-join against a sorted per-base depth track:
+class depthProfile {
+   public:
+      bool enabled = 0;
+      vector<long> bin_starts;
+      void add(uint32_t scaffold_id, long position, unsigned char site_class);
+      int readDepths(string track_path, const scaffoldIDs &scaffold_ids, unsigned long genome_size);
+      void write(ostream &output);
+   private:
+      //Classified sites indexed by scaffold ID:
+      vector<vector<pair<long, unsigned char>>> sites;
+      //Counts of sites in the track, then TP, FN, FP, ER per depth bin:
+      map<long, array<unsigned long, 5>> counts;
+      long bin(long depth);
+};
+
+void depthProfile::add(uint32_t scaffold_id, long position, unsigned char site_class) {
+   if (enabled) {
+      if (scaffold_id >= sites.size()) {
+         sites.resize(scaffold_id + 1);
+      }
+      sites[scaffold_id].push_back(make_pair(position, site_class));
+   }
+}
+
+//Lower bound of the bin a depth falls in (the depth itself without bins):
+long depthProfile::bin(long depth) {
+   if (bin_starts.empty()) {
+      return depth;
+   }
+   auto bin_iterator = upper_bound(bin_starts.begin(), bin_starts.end(), depth);
+   return bin_iterator == bin_starts.begin() ? bin_starts.front() : *(bin_iterator - 1);
+}
+
+//Stream a (possibly gzipped) samtools depth output (summing depths of multiple BAMs)
+// or a bedGraph (.bedGraph, .bedgraph, or .bg), with sites missing from it at depth 0.
+//Each scaffold must be contiguous in the track and sorted by position, since the sites
+// of a scaffold are counted as it's passed, so a scaffold that reappears or a position
+// that goes backwards is an error (2) rather than silently putting sites at depth 0:
+int depthProfile::readDepths(string track_path, const scaffoldIDs &scaffold_ids, unsigned long genome_size) {
+   string track_name = track_path;
+   if (track_name.length() > 3 && track_name.substr(track_name.length()-3) == ".gz") {
+      track_name = track_name.substr(0, track_name.length()-3);
+   }
+   size_t extension_start = track_name.find_last_of('.');
+   string extension = extension_start == string::npos ? "" : track_name.substr(extension_start);
+   bool is_bedgraph = extension == ".bedGraph" || extension == ".bedgraph" || extension == ".bg";
+   gzFile track = track_path == "-" ? gzdopen(0, "rb") : gzopen(track_path.c_str(), "rb");
+   if (track == NULL) {
+      return 1;
+   }
+   gzbuffer(track, 1048576);
+   for (auto scaffold_iterator = sites.begin(); scaffold_iterator != sites.end(); ++scaffold_iterator) {
+      stable_sort(scaffold_iterator->begin(), scaffold_iterator->end(), [](const pair<long, unsigned char> &a, const pair<long, unsigned char> &b) {
+         return a.first < b.first;
+      });
+   }
+   string trackline, prev_scaffold = "";
+   vector<pair<long, unsigned char>> *scaffold_sites = nullptr;
+   bool scaffold_in_genome = 0;
+   vector<bool> scaffolds_seen(scaffold_ids.size(), 0);
+   long prev_end = 0;
+   size_t cursor = 0;
+   unsigned long covered_sites = 0;
+   vector<pair<long, unsigned char>> uncovered_sites;
+   while (gzGetline(track, trackline)) {
+      if (trackline.empty() || trackline[0] == '#' || trackline.compare(0, 5, "track") == 0) {
+         continue;
+      }
+      size_t first_tab = trackline.find('\t');
+      if (first_tab == string::npos) {
+         continue;
+      }
+      //Sites of the previous scaffold beyond the end of its track are at depth 0:
+      if (trackline.compare(0, first_tab, prev_scaffold) != 0 || prev_scaffold.length() != first_tab) {
+         if (scaffold_sites != nullptr) {
+            for (; cursor < scaffold_sites->size(); cursor++) {
+               counts[bin(0)][1+(*scaffold_sites)[cursor].second]++;
+            }
+            scaffold_sites->clear();
+         }
+         prev_scaffold = trackline.substr(0, first_tab);
+         uint32_t scaffold_id = scaffold_ids.find(prev_scaffold);
+         scaffold_sites = scaffold_id < sites.size() ? &sites[scaffold_id] : nullptr;
+         scaffold_in_genome = scaffold_id != scaffoldIDs::missing;
+         if (scaffold_in_genome && scaffolds_seen[scaffold_id]) {
+            cerr << "Scaffold " << prev_scaffold << " is not contiguous in depth track " << track_path << ".  Quitting." << endl;
+            gzclose(track);
+            return 2;
+         }
+         if (scaffold_in_genome) {
+            scaffolds_seen[scaffold_id] = 1;
+         }
+         prev_end = 0;
+         cursor = 0;
+      }
+      //Interval of the track record (1-based, inclusive) and its depth:
+      char *field_end;
+      long start = strtol(trackline.c_str() + first_tab + 1, &field_end, 10);
+      long end = start;
+      if (is_bedgraph) {
+         start++;
+         end = strtol(field_end, &field_end, 10);
+      }
+      long depth = 0;
+      while (*field_end != '\0') {
+         depth += strtol(field_end, &field_end, 10);
+         while (*field_end != '\0' && *field_end != '\t') {
+            field_end++;
+         }
+      }
+      if (!scaffold_in_genome || end < start) {
+         continue;
+      }
+      if (start <= prev_end) {
+         cerr << "Depth track " << track_path << " is not sorted by position on scaffold " << prev_scaffold << " at position " << start << ".  Quitting." << endl;
+         gzclose(track);
+         return 2;
+      }
+      prev_end = end;
+      covered_sites += end - start + 1;
+      counts[bin(depth)][0] += end - start + 1;
+      if (scaffold_sites == nullptr) {
+         continue;
+      }
+      for (; cursor < scaffold_sites->size() && (*scaffold_sites)[cursor].first <= end; cursor++) {
+         long site_depth = (*scaffold_sites)[cursor].first >= start ? depth : 0;
+         counts[bin(site_depth)][1+(*scaffold_sites)[cursor].second]++;
+      }
+   }
+   gzclose(track);
+   if (scaffold_sites != nullptr) {
+      for (; cursor < scaffold_sites->size(); cursor++) {
+         counts[bin(0)][1+(*scaffold_sites)[cursor].second]++;
+      }
+      scaffold_sites->clear();
+   }
+   //Sites on scaffolds without any track records, and sites missing from the track, are at depth 0:
+   for (auto scaffold_iterator = sites.begin(); scaffold_iterator != sites.end(); ++scaffold_iterator) {
+      for (auto site_iterator = scaffold_iterator->begin(); site_iterator != scaffold_iterator->end(); ++site_iterator) {
+         counts[bin(0)][1+site_iterator->second]++;
+      }
+   }
+   counts[bin(0)][0] += covered_sites < genome_size ? genome_size - covered_sites : 0;
+   return 0;
+}
+
+void depthProfile::write(ostream &output) {
+   output << "Depth\tSites\tTP\tFN\tFP\tER" << endl;
+   for (auto bin_iterator = counts.begin(); bin_iterator != counts.end(); ++bin_iterator) {
+      output << bin_iterator->first;
+      if (!bin_starts.empty()) {
+         auto next_bin = upper_bound(bin_starts.begin(), bin_starts.end(), bin_iterator->first);
+         output << (next_bin == bin_starts.end() ? "+" : "-" + to_string(*next_bin - 1));
+      }
+      for (auto count_iterator = bin_iterator->second.begin(); count_iterator != bin_iterator->second.end(); ++count_iterator) {
+         output << '\t' << *count_iterator;
+      }
+      output << endl;
+   }
+}
+
+//Sequence context features of sites:
+#define CONTEXT_HOMOPOLYMER 0
+#define CONTEXT_GC 1
+#define CONTEXT_STR 2
+//Longest homopolymer binned separately (longer ones share its bin):
+#define CONTEXT_MAX_HOMOPOLYMER 10
+//Width of the window centered on a site that its GC fraction is taken over:
+#define CONTEXT_GC_WINDOW 100
+//Longest period of short tandem repeats, and the copies and length a tract needs:
+#define CONTEXT_MAX_STR_PERIOD 6
+#define CONTEXT_STR_MIN_COPIES 3
+#define CONTEXT_STR_MIN_LENGTH 10
+
+//Sites of each class per scaffold, binned by the sequence context of the reference
+// around them (homopolymer length, GC fraction, and tandem repeat period), which is
+// computed in a single sweep of each scaffold with rolling windows:
+class contextProfile {
+   public:
+      bool enabled = 0;
+      void add(uint32_t scaffold_id, long position, unsigned char site_class);
+      void countScaffold(uint32_t scaffold_id, const string &sequence);
+      void write(ostream &output);
+   private:
+      //Classified sites indexed by scaffold ID:
+      vector<vector<pair<long, unsigned char>>> sites;
+      //Counts of sites in the genome, then TP, FN, FP, ER per bin of each feature,
+      // with a last bin for sites past the end of their scaffold:
+      array<vector<array<unsigned long, 5>>, 3> counts {{vector<array<unsigned long, 5>>(CONTEXT_MAX_HOMOPOLYMER + 2, {{0, 0, 0, 0, 0}}), vector<array<unsigned long, 5>>(11, {{0, 0, 0, 0, 0}}), vector<array<unsigned long, 5>>(CONTEXT_MAX_STR_PERIOD + 2, {{0, 0, 0, 0, 0}})}};
+};
+
+void contextProfile::add(uint32_t scaffold_id, long position, unsigned char site_class) {
+   if (enabled) {
+      if (scaffold_id >= sites.size()) {
+         sites.resize(scaffold_id + 1);
+      }
+      sites[scaffold_id].push_back(make_pair(position, site_class));
+   }
+}
+
+//Bin every base of a scaffold, and the classified sites on it, by their context:
+void contextProfile::countScaffold(uint32_t scaffold_id, const string &sequence) {
+   vector<pair<long, unsigned char>> no_sites;
+   vector<pair<long, unsigned char>> &scaffold_sites = scaffold_id < sites.size() ? sites[scaffold_id] : no_sites;
+   stable_sort(scaffold_sites.begin(), scaffold_sites.end(), [](const pair<long, unsigned char> &a, const pair<long, unsigned char> &b) {
+      return a.first < b.first;
+   });
+   long length = sequence.length();
+   //Tandem repeat tracts (0-based, inclusive) of each period, from runs of bases matching the base a period before,
+   // skipping homopolymers and N runs:
+   vector<vector<pair<long, long>>> tracts(CONTEXT_MAX_STR_PERIOD + 1);
+   for (long period = 2; period <= CONTEXT_MAX_STR_PERIOD; period++) {
+      long run_start = period;
+      for (long i = period; i <= length; i++) {
+         if (i < length && sequence[i] == sequence[i-period] && sequence[i] != 'N') {
+            continue;
+         }
+         long tract_start = run_start - period, tract_length = i - tract_start;
+         if (i > run_start && tract_length >= max((long)CONTEXT_STR_MIN_LENGTH, CONTEXT_STR_MIN_COPIES*period) && sequence.find_first_not_of(sequence[tract_start], tract_start) < (size_t)(tract_start + period)) {
+            tracts[period].push_back(make_pair(tract_start, i - 1));
+         }
+         run_start = i + 1;
+      }
+   }
+   vector<size_t> tract_cursors(CONTEXT_MAX_STR_PERIOD + 1, 0);
+   //End of the homopolymer run containing the base, and its length:
+   long run_end = 0, run_length = 0;
+   //Window [window_start, window_end) of the GC fraction, and its GC and ACGT bases:
+   long window_start = 0, window_end = 0, gc_bases = 0, acgt_bases = 0;
+   size_t site_cursor = 0;
+   for (long i = 0; i < length; i++) {
+      if (i >= run_end) {
+         run_end = i + 1;
+         while (run_end < length && sequence[run_end] == sequence[i]) {
+            run_end++;
+         }
+         run_length = run_end - i;
+      }
+      for (; window_end < min(length, i - CONTEXT_GC_WINDOW/2 + CONTEXT_GC_WINDOW); window_end++) {
+         gc_bases += sequence[window_end] == 'G' || sequence[window_end] == 'C';
+         acgt_bases += sequence[window_end] == 'A' || sequence[window_end] == 'C' || sequence[window_end] == 'G' || sequence[window_end] == 'T';
+      }
+      for (; window_start < i - CONTEXT_GC_WINDOW/2; window_start++) {
+         gc_bases -= sequence[window_start] == 'G' || sequence[window_start] == 'C';
+         acgt_bases -= sequence[window_start] == 'A' || sequence[window_start] == 'C' || sequence[window_start] == 'G' || sequence[window_start] == 'T';
+      }
+      //Shortest period of the tandem repeats covering the base (0 if none):
+      size_t str_period = 0;
+      for (long period = 2; period <= CONTEXT_MAX_STR_PERIOD && str_period == 0; period++) {
+         size_t &cursor = tract_cursors[period];
+         while (cursor < tracts[period].size() && tracts[period][cursor].second < i) {
+            cursor++;
+         }
+         if (cursor < tracts[period].size() && tracts[period][cursor].first <= i) {
+            str_period = period;
+         }
+      }
+      //GC fraction in tenths, or the last bin if the window is all N:
+      size_t bins[3] = {(size_t)min(run_length, (long)CONTEXT_MAX_HOMOPOLYMER), acgt_bases == 0 ? 10 : (size_t)min(9L, 10*gc_bases/acgt_bases), str_period};
+      for (unsigned int feature = 0; feature < 3; feature++) {
+         counts[feature][bins[feature]][0]++;
+      }
+      for (; site_cursor < scaffold_sites.size() && scaffold_sites[site_cursor].first <= i + 1; site_cursor++) {
+         for (unsigned int feature = 0; feature < 3; feature++) {
+            counts[feature][bins[feature]][1+scaffold_sites[site_cursor].second]++;
+         }
+      }
+   }
+   for (; site_cursor < scaffold_sites.size(); site_cursor++) {
+      for (unsigned int feature = 0; feature < 3; feature++) {
+         counts[feature].back()[1+scaffold_sites[site_cursor].second]++;
+      }
+   }
+   vector<pair<long, unsigned char>>().swap(scaffold_sites);
+}
+
+void contextProfile::write(ostream &output) {
+   const char *feature_names[] = {"Homopolymer", "GC", "STR period"};
+   output << "Feature\tBin\tSites\tTP\tFN\tFP\tER" << endl;
+   for (unsigned int feature = 0; feature < 3; feature++) {
+      for (size_t bin = 0; bin < counts[feature].size(); bin++) {
+         const array<unsigned long, 5> &bin_counts = counts[feature][bin];
+         if (bin_counts[0] + bin_counts[1] + bin_counts[2] + bin_counts[3] + bin_counts[4] == 0) {
+            continue;
+         }
+         output << feature_names[feature] << '\t';
+         if (bin == counts[feature].size() - 1) {
+            output << "NA";
+         } else if (feature == CONTEXT_HOMOPOLYMER) {
+            output << bin << (bin == CONTEXT_MAX_HOMOPOLYMER ? "+" : "");
+         } else if (feature == CONTEXT_GC) {
+            output << bin*10 << "-" << (bin+1)*10 << "%";
+         } else {
+            output << (bin == 0 ? "none" : to_string(bin));
+         }
+         for (auto count_iterator = bin_counts.begin(); count_iterator != bin_counts.end(); ++count_iterator) {
+            output << '\t' << *count_iterator;
+         }
+         output << endl;
+      }
+   }
+}
+
+//Expected SNP log records of a scaffold as packed positions and alleles
+// ((oldallele << 4) | newallele), either owned or in an mmapped binary SNP log:
+class expectedScaffold {
+   public:
+      class const_iterator {
+         public:
+            const_iterator(const uint32_t *position, const uint8_t *alleles) : position(position), alleles(alleles) {}
+            //Same (pos, oldallele, newallele) as the records parsed from text:
+            array<long, 3> operator*() const {
+               return {{(long)*position, (long)(*alleles >> 4), (long)(*alleles & 15)}};
+            }
+            const_iterator &operator++() {
+               ++position;
+               ++alleles;
+               return *this;
+            }
+            bool operator!=(const const_iterator &other) const {
+               return position != other.position;
+            }
+         private:
+            const uint32_t *position;
+            const uint8_t *alleles;
+      };
+      const uint32_t *positions = nullptr;
+      const uint8_t *alleles = nullptr;
+      size_t num_records = 0;
+      const_iterator begin() const {
+         return const_iterator(positions, alleles);
+      }
+      const_iterator end() const {
+         return const_iterator(positions + num_records, alleles + num_records);
+      }
+};
+
+//A line of a text expected SNP log:
+struct expectedLine {
+   uint32_t scaffold_id;
+   uint32_t position;
+   long oldallele, newallele;
+   //Whether the site is below the minimum callable depth:
+   bool uncallable;
+   //Length of the scaffold and position fields, identifying sites on scaffolds missing from the .fai:
+   size_t site_length;
+};
+
+//Parse a line of a text expected SNP log, returning 1 if it has too few fields, 2 if an allele
+// isn't a single base (skipped, as indexSNPlog does), or 7 if it lacks a needed depth:
+int parseExpectedLine(const string &eline, const scaffoldIDs &scaffold_ids, unsigned long min_depth, bool debug, expectedLine &record) {
+   size_t starts[5], ends[5];
+   size_t num_fields = fieldBounds(eline, starts, ends, 5);
+   if (num_fields < 4) {
+      return 1;
+   }
+   if (ends[2] - starts[2] != 1 || ends[3] - starts[3] != 1) {
+      return 2;
+   }
+   record.oldallele = baseToLong(eline[starts[2]]);
+   record.newallele = baseToLong(eline[starts[3]]);
+   if (debug && (record.oldallele > 3 || record.newallele > 3)) {
+      cerr << "Found non-ACGT base in branch 1 SNP log at " << eline.substr(0, ends[0]) << " position " << eline.substr(starts[1], ends[1] - starts[1]) << endl;
+   }
+   record.scaffold_id = scaffold_ids.find(eline, ends[0]);
+   record.position = strtoul(eline.c_str() + starts[1], NULL, 10);
+   record.site_length = ends[1];
+   record.uncallable = 0;
+   if (min_depth > 0) {
+      if (num_fields < 5) {
+         cerr << "Error: Used non-zero minimum callable depth, but no depths provided in expected log." << endl;
+         return 7;
+      }
+      unsigned long curdepth = strtoul(eline.c_str() + starts[4], NULL, 10);
+      record.uncallable = curdepth < min_depth;
+   }
+   return 0;
+}
+
+//Stratified random sample of fixed-width genomic blocks, drawn without replacement
+// from strata of consecutive blocks along the genome in .fai order:
+class blockSample {
+   public:
+      unsigned long block_size = 0, seed = 0;
+      //Number of blocks in the genome, and the number in and sampled from each stratum:
+      size_t num_blocks = 0;
+      vector<pair<size_t, size_t>> strata;
+      //Sampled blocks as (scaffold ID, block of the scaffold) in genome order, and the stratum of each:
+      vector<pair<uint32_t, size_t>> blocks;
+      vector<size_t> block_strata;
+      //Merged 1-based position ranges of the sampled blocks of each scaffold, where the
+      // last block of a scaffold also takes sites past its end (as in the bootstrap blocks):
+      vector<vector<pair<uint32_t, uint32_t>>> ranges;
+      //Bases in the sampled blocks, in all and on each scaffold:
+      unsigned long sampled_bases = 0;
+      vector<unsigned long> scaffold_bases;
+      void draw(const vector<unsigned long> &scaffold_lengths, double fraction, unsigned long block_width, unsigned long prng_seed);
+};
+
+void blockSample::draw(const vector<unsigned long> &scaffold_lengths, double fraction, unsigned long block_width, unsigned long prng_seed) {
+   block_size = block_width;
+   seed = prng_seed;
+   //Index of the first block of each scaffold among all blocks of the genome:
+   vector<size_t> first_blocks;
+   num_blocks = 0;
+   for (auto length_iterator = scaffold_lengths.begin(); length_iterator != scaffold_lengths.end(); ++length_iterator) {
+      first_blocks.push_back(num_blocks);
+      num_blocks += (*length_iterator + block_size - 1) / block_size;
+   }
+   //Strata of about 2/fraction blocks, so each contributes at least two blocks to its variance:
+   size_t stratum_width = max((size_t)2, (size_t)llround(2.0/fraction));
+   size_t num_strata = max((size_t)1, num_blocks / stratum_width);
+   seed_seq sample_seed {(unsigned int)(seed & 0xFFFFFFFF), (unsigned int)(seed >> 32)};
+   mt19937_64 prng(sample_seed);
+   uniform_real_distribution<double> unit_distribution(0.0, 1.0);
+   vector<size_t> sampled;
+   strata.clear();
+   block_strata.clear();
+   for (size_t stratum = 0; stratum < num_strata; stratum++) {
+      size_t stratum_start = stratum * num_blocks / num_strata;
+      size_t stratum_end = (stratum + 1) * num_blocks / num_strata;
+      size_t stratum_blocks = stratum_end - stratum_start;
+      size_t needed = min(stratum_blocks, max((size_t)2, (size_t)llround(fraction * stratum_blocks)));
+      strata.push_back(make_pair(stratum_blocks, needed));
+      //Selection sampling, which keeps the sampled blocks in genome order:
+      for (size_t block = stratum_start; block < stratum_end && needed > 0; block++) {
+         if ((double)(stratum_end - block) * unit_distribution(prng) < (double)needed) {
+            sampled.push_back(block);
+            block_strata.push_back(stratum);
+            needed--;
+         }
+      }
+   }
+   ranges.assign(scaffold_lengths.size(), vector<pair<uint32_t, uint32_t>>());
+   blocks.clear();
+   sampled_bases = 0;
+   scaffold_bases.assign(scaffold_lengths.size(), 0);
+   for (auto block_iterator = sampled.begin(); block_iterator != sampled.end(); ++block_iterator) {
+      //Empty scaffolds share their first block with the next scaffold, so take the last match:
+      uint32_t scaffold_id = upper_bound(first_blocks.begin(), first_blocks.end(), *block_iterator) - first_blocks.begin() - 1;
+      size_t block = *block_iterator - first_blocks[scaffold_id];
+      blocks.push_back(make_pair(scaffold_id, block));
+      unsigned long block_start = block * block_size;
+      unsigned long block_end = min(block_start + block_size, scaffold_lengths[scaffold_id]);
+      sampled_bases += block_end - block_start;
+      scaffold_bases[scaffold_id] += block_end - block_start;
+      uint32_t range_start = block == 0 ? 0 : block_start + 1;
+      uint32_t range_end = block_end == scaffold_lengths[scaffold_id] ? UINT32_MAX : block_end;
+      vector<pair<uint32_t, uint32_t>> &scaffold_ranges = ranges[scaffold_id];
+      if (!scaffold_ranges.empty() && scaffold_ranges.back().second + 1 == range_start) {
+         scaffold_ranges.back().second = range_end;
+      } else {
+         scaffold_ranges.push_back(make_pair(range_start, range_end));
+      }
+   }
+}
+
+//Text log (expected SNP log or in.snp) sorted by scaffold in .fai order and then by
+// position, where the lines in a range of positions are found by bisecting byte offsets:
+class sortedTextLog {
+   public:
+      sortedTextLog(const scaffoldIDs &scaffold_ids) : scaffold_ids(scaffold_ids) {}
+      //Returns 1 if the log can't be opened or seeked (e.g. a pipe):
+      bool open(const string &path) {
+         log.open(path);
+         if (!log) {
+            return 1;
+         }
+         log.seekg(0, ios::end);
+         size = log.tellg();
+         return !log || size < 0;
+      }
+      void close() {
+         log.close();
+      }
+      //Call add on each line of the scaffold with a position in [start, end], returning 1
+      // if the lines there turn out to be out of order:
+      template <typename T> bool readRange(uint32_t scaffold_id, uint32_t start, uint32_t end, T add) {
+         uint64_t first_key = ((uint64_t)scaffold_id << 32) | start, last_key = ((uint64_t)scaffold_id << 32) | end;
+         //Lowest offset where the next line on a scaffold of the .fai is at or after the range start:
+         streamoff low = 0, high = size;
+         while (low < high) {
+            streamoff middle = low + (high - low) / 2;
+            uint64_t key;
+            if (!nextKey(middle, key) || key >= first_key) {
+               high = middle;
+            } else {
+               low = middle + 1;
+            }
+         }
+         seekLine(low);
+         uint64_t previous_key = first_key, key;
+         while (getline(log, line)) {
+            if (!lineKey(key)) {
+               continue;
+            }
+            if (key < previous_key) {
+               return 1;
+            }
+            if (key > last_key) {
+               break;
+            }
+            previous_key = key;
+            add(line);
+         }
+         return 0;
+      }
+   private:
+      const scaffoldIDs &scaffold_ids;
+      ifstream log;
+      streamoff size = 0;
+      string line;
+      //Key (scaffold ID, position) of the current line, or 0 if it's on a scaffold
+      // missing from the .fai or has too few fields:
+      bool lineKey(uint64_t &key) {
+         size_t starts[2], ends[2];
+         if (fieldBounds(line, starts, ends, 2) < 2) {
+            return 0;
+         }
+         uint32_t scaffold_id = scaffold_ids.find(line, ends[0]);
+         if (scaffold_id == scaffoldIDs::missing) {
+            return 0;
+         }
+         key = ((uint64_t)scaffold_id << 32) | strtoul(line.c_str() + starts[1], NULL, 10);
+         return 1;
+      }
+      //Move to the first line starting at or after the offset:
+      void seekLine(streamoff offset) {
+         log.clear();
+         log.seekg(offset == 0 ? 0 : offset - 1);
+         if (offset > 0) {
+            getline(log, line);
+         }
+      }
+      //Key of the first line with one at or after the offset, or 0 at the end of the log:
+      bool nextKey(streamoff offset, uint64_t &key) {
+         seekLine(offset);
+         while (getline(log, line)) {
+            if (lineKey(key)) {
+               return 1;
+            }
+         }
+         return 0;
+      }
+};
+
+//Expected SNP log of a sample as views per scaffold (indexed by scaffold ID), parsed from
+// text or mapped from a binary index, along with the sites skipped as uncallable:
+class expectedLog {
+   public:
+      vector<expectedScaffold> scaffolds;
+      //Number of uncallable sites, including any on scaffolds missing from the .fai:
+      unsigned long num_uncallable = 0;
+      //Number of text records skipped for alleles that aren't a single base:
+      unsigned long num_skipped = 0;
+      int read(const string &expected_path, const scaffoldIDs &scaffold_ids, unsigned long min_depth, bool debug);
+      int readSampled(const string &expected_path, const scaffoldIDs &scaffold_ids, unsigned long min_depth, bool debug, const blockSample &sample);
+      //Records streamed in one scaffold at a time instead of read up front:
+      void startStream(size_t num_scaffolds);
+      void setScaffold(uint32_t scaffold_id, vector<uint32_t> &positions, vector<uint8_t> &alleles, vector<uint32_t> &uncallable);
+      void clearScaffold(uint32_t scaffold_id);
+      void finishStream(const unordered_set<string> &other_uncallable_sites);
+      const vector<uint32_t> &uncallableSites(uint32_t scaffold_id) const {
+         return uncallable_sites[scaffold_id];
+      }
+      bool isUncallable(uint32_t scaffold_id, long position) const {
+         return num_uncallable > 0 && binary_search(uncallable_sites[scaffold_id].begin(), uncallable_sites[scaffold_id].end(), position);
+      }
+   private:
+      binarySNPlogReader index;
+      vector<pair<vector<uint32_t>, vector<uint8_t>>> records;
+      //Sorted positions of the uncallable sites of each scaffold:
+      vector<vector<uint32_t>> uncallable_sites;
+      void indexRecords(const unordered_set<string> &other_uncallable_sites);
+};
+
+//Open the expected SNP log, or map its binary index (from indexSNPlog) so that
+// concurrent processes share one copy in the page cache:
+int expectedLog::read(const string &expected_path, const scaffoldIDs &scaffold_ids, unsigned long min_depth, bool debug) {
+   bool expected_is_binary = binarySNPlogReader::isBinarySNPlog(expected_path);
+   ifstream expected;
+   if (expected_is_binary) {
+      if (index.open(expected_path)) {
+         cerr << "Error mapping expected SNP log index " << expected_path << ".  Quitting." << endl;
+         return 5;
+      }
+   } else {
+      expected.open(expected_path);
+      if (!expected) {
+         cerr << "Error opening expected SNP log " << expected_path << ".  Quitting." << endl;
+         return 5;
+      }
+   }
+
+   //Read expected SNP log into packed positions and alleles of each scaffold of the .fai:
+   cerr << "Reading expected SNP log " << expected_path << endl;
+   scaffolds.assign(scaffold_ids.size(), expectedScaffold());
+   records.assign(scaffold_ids.size(), pair<vector<uint32_t>, vector<uint8_t>>());
+   uncallable_sites.assign(scaffold_ids.size(), vector<uint32_t>());
+   //Uncallable sites of scaffolds missing from the .fai still aren't counted as TNs:
+   unordered_set<string> other_uncallable_sites;
+   if (expected_is_binary) {
+      if (min_depth > 0 && index.depths == nullptr) {
+         cerr << "Error: Used non-zero minimum callable depth, but no depths provided in expected log." << endl;
+         return 7;
+      }
+      for (size_t i = 0; i < index.header->num_scaffolds; i++) {
+         const binarySNPlogScaffold &scaffold = index.scaffolds[i];
+         if (scaffold.num_records == 0) {
+            continue;
+         }
+         string scaffold_name = index.scaffoldName(i);
+         uint32_t scaffold_id = scaffold_ids.find(scaffold_name);
+         if (min_depth == 0) { //Use the mapped records directly
+            if (scaffold_id != scaffoldIDs::missing) {
+               expectedScaffold &scaffold_records = scaffolds[scaffold_id];
+               scaffold_records.positions = index.positions + scaffold.first_record;
+               scaffold_records.alleles = index.alleles + scaffold.first_record;
+               scaffold_records.num_records = scaffold.num_records;
+            }
+            continue;
+         }
+         for (uint64_t j = scaffold.first_record; j < scaffold.first_record + scaffold.num_records; j++) {
+            if (index.depths[j] < min_depth) { //Skip sites that wouldn't be callable based on the raw sequencing depth
+               if (scaffold_id == scaffoldIDs::missing) {
+                  other_uncallable_sites.insert(scaffold_name + ":" + to_string(index.positions[j]));
+               } else {
+                  uncallable_sites[scaffold_id].push_back(index.positions[j]);
+               }
+               continue;
+            }
+            if (scaffold_id != scaffoldIDs::missing) {
+               records[scaffold_id].first.push_back(index.positions[j]);
+               records[scaffold_id].second.push_back(index.alleles[j]);
+            }
+         }
+      }
+   } else {
+      string eline;
+      expectedLine record;
+      while (getline(expected, eline)) {
+         int parse_status = parseExpectedLine(eline, scaffold_ids, min_depth, debug, record);
+         if (parse_status == 7) {
+            expected.close();
+            return 7;
+         } else if (parse_status != 0) {
+            num_skipped += parse_status == 2;
+            continue;
+         }
+         if (record.uncallable) { //Skip sites that wouldn't be callable based on the raw sequencing depth
+            if (record.scaffold_id == scaffoldIDs::missing) {
+               other_uncallable_sites.insert(eline.substr(0, record.site_length));
+            } else {
+               uncallable_sites[record.scaffold_id].push_back(record.position);
+            }
+            continue;
+         }
+         if (record.scaffold_id != scaffoldIDs::missing) {
+            pair<vector<uint32_t>, vector<uint8_t>> &scaffold_records = records[record.scaffold_id];
+            scaffold_records.first.push_back(record.position);
+            scaffold_records.second.push_back((record.oldallele << 4) | record.newallele);
+         }
+      }
+      expected.close();
+   }
+   indexRecords(other_uncallable_sites);
+
+   if (num_skipped > 0) {
+      cerr << "Skipped " << num_skipped << " expected records with alleles that aren't a single base" << endl;
+   }
+   cerr << "Done reading expected SNP log" << endl;
+   return 0;
+}
+
+//Read only the expected records in the sampled blocks, searching the positions of the
+// binary index or bisecting the sorted text log:
+int expectedLog::readSampled(const string &expected_path, const scaffoldIDs &scaffold_ids, unsigned long min_depth, bool debug, const blockSample &sample) {
+   bool expected_is_binary = binarySNPlogReader::isBinarySNPlog(expected_path);
+   sortedTextLog expected(scaffold_ids);
+   if (expected_is_binary) {
+      if (index.open(expected_path)) {
+         cerr << "Error mapping expected SNP log index " << expected_path << ".  Quitting." << endl;
+         return 5;
+      }
+   } else if (expected.open(expected_path)) {
+      cerr << "Error opening expected SNP log " << expected_path << " (sampling blocks needs a seekable file).  Quitting." << endl;
+      return 5;
+   }
+
+   cerr << "Reading sampled blocks of expected SNP log " << expected_path << endl;
+   scaffolds.assign(scaffold_ids.size(), expectedScaffold());
+   records.assign(scaffold_ids.size(), pair<vector<uint32_t>, vector<uint8_t>>());
+   uncallable_sites.assign(scaffold_ids.size(), vector<uint32_t>());
+   if (expected_is_binary) {
+      if (min_depth > 0 && index.depths == nullptr) {
+         cerr << "Error: Used non-zero minimum callable depth, but no depths provided in expected log." << endl;
+         return 7;
+      }
+      for (size_t i = 0; i < index.header->num_scaffolds; i++) {
+         const binarySNPlogScaffold &scaffold = index.scaffolds[i];
+         uint32_t scaffold_id = scaffold.num_records == 0 ? scaffoldIDs::missing : scaffold_ids.find(index.scaffoldName(i));
+         if (scaffold_id == scaffoldIDs::missing) {
+            continue;
+         }
+         const uint32_t *scaffold_begin = index.positions + scaffold.first_record;
+         const uint32_t *scaffold_end = scaffold_begin + scaffold.num_records;
+         const vector<pair<uint32_t, uint32_t>> &scaffold_ranges = sample.ranges[scaffold_id];
+         for (auto range_iterator = scaffold_ranges.begin(); range_iterator != scaffold_ranges.end(); ++range_iterator) {
+            for (const uint32_t *position = lower_bound(scaffold_begin, scaffold_end, range_iterator->first); position != scaffold_end && *position <= range_iterator->second; ++position) {
+               uint64_t j = position - index.positions;
+               if (min_depth > 0 && index.depths[j] < min_depth) {
+                  uncallable_sites[scaffold_id].push_back(*position);
+                  continue;
+               }
+               records[scaffold_id].first.push_back(*position);
+               records[scaffold_id].second.push_back(index.alleles[j]);
+            }
+         }
+      }
+   } else {
+      expectedLine record;
+      int parse_status = 0;
+      auto add_record = [&](const string &eline) {
+         int line_status = parseExpectedLine(eline, scaffold_ids, min_depth, debug, record);
+         if (line_status == 7) {
+            parse_status = 7;
+         } else if (line_status == 2) {
+            num_skipped++;
+         } else if (line_status == 0 && record.uncallable) {
+            uncallable_sites[record.scaffold_id].push_back(record.position);
+         } else if (line_status == 0) {
+            records[record.scaffold_id].first.push_back(record.position);
+            records[record.scaffold_id].second.push_back((record.oldallele << 4) | record.newallele);
+         }
+      };
+      for (uint32_t scaffold_id = 0; scaffold_id < sample.ranges.size() && parse_status == 0; scaffold_id++) {
+         for (auto range_iterator = sample.ranges[scaffold_id].begin(); range_iterator != sample.ranges[scaffold_id].end() && parse_status == 0; ++range_iterator) {
+            if (expected.readRange(scaffold_id, range_iterator->first, range_iterator->second, add_record)) {
+               cerr << "Expected SNP log " << expected_path << " is not sorted in .fai scaffold order and by position, as sampling blocks requires.  Quitting." << endl;
+               expected.close();
+               return 17;
+            }
+         }
+      }
+      expected.close();
+      if (parse_status != 0) {
+         return parse_status;
+      }
+   }
+   indexRecords(unordered_set<string>());
+
+   if (num_skipped > 0) {
+      cerr << "Skipped " << num_skipped << " expected records with alleles that aren't a single base" << endl;
+   }
+   cerr << "Done reading expected SNP log" << endl;
+   return 0;
+}
+
+//Point the views at the parsed records, and count each uncallable site once:
+void expectedLog::indexRecords(const unordered_set<string> &other_uncallable_sites) {
+   for (uint32_t scaffold_id = 0; scaffold_id < records.size(); scaffold_id++) {
+      if (!records[scaffold_id].first.empty()) {
+         expectedScaffold &scaffold_records = scaffolds[scaffold_id];
+         scaffold_records.positions = records[scaffold_id].first.data();
+         scaffold_records.alleles = records[scaffold_id].second.data();
+         scaffold_records.num_records = records[scaffold_id].first.size();
+      }
+   }
+   num_uncallable = other_uncallable_sites.size();
+   for (auto sites_iterator = uncallable_sites.begin(); sites_iterator != uncallable_sites.end(); ++sites_iterator) {
+      sort(sites_iterator->begin(), sites_iterator->end());
+      sites_iterator->erase(unique(sites_iterator->begin(), sites_iterator->end()), sites_iterator->end());
+      num_uncallable += sites_iterator->size();
+   }
+}
+
+void expectedLog::startStream(size_t num_scaffolds) {
+   scaffolds.assign(num_scaffolds, expectedScaffold());
+   records.assign(num_scaffolds, pair<vector<uint32_t>, vector<uint8_t>>());
+   uncallable_sites.assign(num_scaffolds, vector<uint32_t>());
+   num_uncallable = 0;
+}
+
+//Take over the records and uncallable sites of a scaffold, leaving the inputs empty:
+void expectedLog::setScaffold(uint32_t scaffold_id, vector<uint32_t> &positions, vector<uint8_t> &alleles, vector<uint32_t> &uncallable) {
+   records[scaffold_id].first.swap(positions);
+   records[scaffold_id].second.swap(alleles);
+   positions.clear();
+   alleles.clear();
+   expectedScaffold &scaffold_records = scaffolds[scaffold_id];
+   scaffold_records.positions = records[scaffold_id].first.data();
+   scaffold_records.alleles = records[scaffold_id].second.data();
+   scaffold_records.num_records = records[scaffold_id].first.size();
+   sort(uncallable.begin(), uncallable.end());
+   uncallable.erase(unique(uncallable.begin(), uncallable.end()), uncallable.end());
+   num_uncallable += uncallable.size();
+   uncallable_sites[scaffold_id].swap(uncallable);
+   uncallable.clear();
+}
+
+//Free the records of a compared scaffold, keeping its uncallable sites for the blocks:
+void expectedLog::clearScaffold(uint32_t scaffold_id) {
+   scaffolds[scaffold_id] = expectedScaffold();
+   vector<uint32_t>().swap(records[scaffold_id].first);
+   vector<uint8_t>().swap(records[scaffold_id].second);
+}
+
+void expectedLog::finishStream(const unordered_set<string> &other_uncallable_sites) {
+   num_uncallable += other_uncallable_sites.size();
+   if (num_skipped > 0) {
+      cerr << "Skipped " << num_skipped << " expected records with alleles that aren't a single base" << endl;
+   }
+}
+
+//Time spent by a stage of the pipelined comparison working and waiting on its neighbours:
+struct stageMetrics {
+   string name;
+   double wall = 0, input_wait = 0, output_wait = 0;
+   unsigned long batches = 0;
+};
+
+double secondsSince(chrono::steady_clock::time_point start) {
+   return chrono::duration<double>(chrono::steady_clock::now() - start).count();
+}
+
+//Bounded lock-free queue between one producer thread and one consumer thread, where
+// a full queue makes the producer wait (backpressure) and an empty one the consumer:
+template <typename T> class spscQueue {
+   public:
+      spscQueue(size_t capacity, const atomic<bool> &cancelled) : slots(capacity + 1), cancelled(cancelled) {}
+      //Both return 0 without moving the item if the pipeline is cancelled while waiting:
+      bool push(T &item, double &wait_seconds) {
+         size_t tail = tail_index.load(memory_order_relaxed);
+         size_t next_tail = (tail + 1) % slots.size();
+         if (next_tail == head_index.load(memory_order_acquire)) {
+            chrono::steady_clock::time_point wait_start = chrono::steady_clock::now();
+            unsigned long spins = 0;
+            while (next_tail == head_index.load(memory_order_acquire)) {
+               if (cancelled.load(memory_order_relaxed)) {
+                  return 0;
+               }
+               backoff(spins);
+            }
+            wait_seconds += secondsSince(wait_start);
+         }
+         slots[tail] = move(item);
+         tail_index.store(next_tail, memory_order_release);
+         return 1;
+      }
+      bool pop(T &item, double &wait_seconds) {
+         size_t head = head_index.load(memory_order_relaxed);
+         if (head == tail_index.load(memory_order_acquire)) {
+            chrono::steady_clock::time_point wait_start = chrono::steady_clock::now();
+            unsigned long spins = 0;
+            while (head == tail_index.load(memory_order_acquire)) {
+               if (cancelled.load(memory_order_relaxed)) {
+                  return 0;
+               }
+               backoff(spins);
+            }
+            wait_seconds += secondsSince(wait_start);
+         }
+         item = move(slots[head]);
+         head_index.store((head + 1) % slots.size(), memory_order_release);
+         return 1;
+      }
+   private:
+      //One slot is always empty, to tell a full queue from an empty one:
+      vector<T> slots;
+      alignas(64) atomic<size_t> head_index {0};
+      alignas(64) atomic<size_t> tail_index {0};
+      const atomic<bool> &cancelled;
+      //Yield while the other stage is likely to be quick, then sleep so a stalled stage doesn't burn a core:
+      static void backoff(unsigned long &spins) {
+         if (++spins < 1024) {
+            this_thread::yield();
+         } else {
+            this_thread::sleep_for(chrono::microseconds(50));
+         }
+      }
+};
+
+//Writer thread for the outputs of the pipelined comparison, which redirects each
+// output stream into chunks that it writes to the stream's file in order:
+class pipelineWriter {
+   public:
+      stageMetrics metrics;
+      //Time the comparison spent waiting for the writer to take a chunk:
+      double producer_wait = 0;
+      pipelineWriter(const atomic<bool> &cancelled) : chunks(PIPELINE_QUEUED_CHUNKS, cancelled) {
+         metrics.name = "writer";
+      }
+      void start();
+      void redirect(ostream &output);
+      void finish();
+   private:
+      struct outputChunk {
+         streambuf *file;
+         string data;
+      };
+      //Put area of an output stream that hands each full chunk to the writer thread,
+      // ignoring flushes (e.g. endl) since only the writer thread touches the file:
+      class chunkBuffer : public streambuf {
+         public:
+            chunkBuffer(pipelineWriter &writer, streambuf *file) : writer(writer), file(file), buffer(PIPELINE_CHUNK_SIZE) {
+               setp(buffer.data(), buffer.data() + buffer.size());
+            }
+            void handOff() {
+               if (pptr() > pbase()) {
+                  outputChunk chunk {file, string(pbase(), pptr())};
+                  writer.chunks.push(chunk, writer.producer_wait);
+               }
+               setp(buffer.data(), buffer.data() + buffer.size());
+            }
+         protected:
+            int_type overflow(int_type c) {
+               handOff();
+               if (!traits_type::eq_int_type(c, traits_type::eof())) {
+                  *pptr() = traits_type::to_char_type(c);
+                  pbump(1);
+               }
+               return traits_type::not_eof(c);
+            }
+            int sync() {
+               return 0;
+            }
+         private:
+            pipelineWriter &writer;
+            streambuf *file;
+            vector<char> buffer;
+      };
+      spscQueue<outputChunk> chunks;
+      vector<unique_ptr<chunkBuffer>> buffers;
+      //Redirected streams and their original (file) buffers:
+      vector<pair<ostream *, streambuf *>> redirected;
+      thread writer_thread;
+};
+
+void pipelineWriter::start() {
+   writer_thread = thread([this]() {
+      chrono::steady_clock::time_point stage_start = chrono::steady_clock::now();
+      outputChunk chunk;
+      //A chunk without a file marks the end of the outputs:
+      while (chunks.pop(chunk, metrics.input_wait) && chunk.file != nullptr) {
+         chunk.file->sputn(chunk.data.data(), chunk.data.size());
+         metrics.batches++;
+      }
+      metrics.wall = secondsSince(stage_start);
+   });
+}
+
+void pipelineWriter::redirect(ostream &output) {
+   buffers.push_back(unique_ptr<chunkBuffer>(new chunkBuffer(*this, output.rdbuf())));
+   redirected.push_back(make_pair(&output, output.rdbuf(buffers.back().get())));
+}
+
+//Hand off what's left of each output, then wait for the writer and restore the original buffers:
+void pipelineWriter::finish() {
+   for (auto buffer_iterator = buffers.begin(); buffer_iterator != buffers.end(); ++buffer_iterator) {
+      (*buffer_iterator)->handOff();
+   }
+   outputChunk end_chunk {nullptr, ""};
+   chunks.push(end_chunk, producer_wait);
+   if (writer_thread.joinable()) {
+      writer_thread.join();
+   }
+   for (auto redirect_iterator = redirected.begin(); redirect_iterator != redirected.end(); ++redirect_iterator) {
+      redirect_iterator->first->rdbuf(redirect_iterator->second);
+   }
+   redirected.clear();
+   buffers.clear();
+}
+
+//Classification of a sample's sites against its expected SNP log, fed one scaffold
+// of observed in.snp records (or of pseudoreference FASTA) at a time, so several
+// samples can be classified side by side:
+class siteComparison {
+   public:
+      //Allele counts (two per site) of each class:
+      unsigned long tps = 0, fps = 0, tns = 0, fns = 0, wrong_calls = 0;
+      //Further categorize into match and mismatch types (first letter is call, second is truth, R=ref, H=het, A=alt):
+      unsigned long masked_bases = 0, indel_sites = 0;
+      unsigned long RR_match = 0, RH_mismatch = 0, RA_mismatch = 0;
+      unsigned long HR_mismatch = 0, HH_match = 0, HH_mismatch = 0, HA_mismatch = 0;
+      unsigned long AR_mismatch = 0, AH_mismatch = 0, AA_match = 0, AA_mismatch = 0;
+      unsigned long NR_masked = 0, NH_masked = 0, NA_masked = 0;
+      unsigned long IR_masked = 0, IH_masked = 0, IA_masked = 0;
+      //False negative, false positive, true positive, erroneous call, and indel distance output file paths:
+      string fn_path = "", fp_path = "", tp_path = "", error_path = "", indel_dist_path = "";
+      //Output path for the columnar table of every classified site:
+      string site_table_path = "";
+      bool debug = 0;
+      //Width of the genomic blocks resampled for bootstrap confidence intervals (0 to skip):
+      unsigned long block_size = 0;
+      //Classified sites are also binned by their sequence context if set:
+      contextProfile *context_profile = nullptr;
+      siteComparison(const scaffoldIDs &scaffold_ids, const expectedLog &expected, indelDistances &indel_distances, indelDistances &all_indel_distances, depthProfile &depth_profile) : scaffold_ids(scaffold_ids), expected(expected), indel_distances(indel_distances), all_indel_distances(all_indel_distances), depth_profile(depth_profile) {}
+      void openOutputs();
+      void pipeOutputs(pipelineWriter &writer);
+      void compareScaffold(uint32_t scaffold_id, unsigned long scaffold_length, const snpRecordStore &observed, size_t observed_begin, size_t observed_end);
+      int comparePseudorefScaffold(uint32_t scaffold_id, unsigned long scaffold_length, const string &ref_sequence, const string &call_sequence, string &truth_sequence, const string &hap2_sequence, bool hap_truth);
+      void finish(unsigned long genome_size);
+      void bootstrap(unsigned long replicates, unsigned long seed, unsigned int num_threads);
+      //Compare only the sampled blocks, and estimate the genome-wide rates from them:
+      void sampleBlocks(const blockSample &sample) {
+         block_sample = &sample;
+      }
+      void estimate();
+      void report(ostream &output);
+   private:
+      const scaffoldIDs &scaffold_ids;
+      const expectedLog &expected;
+      indelDistances &indel_distances, &all_indel_distances;
+      depthProfile &depth_profile;
+      ofstream fn_file, fp_file, tp_file, error_file, indel_dist_file;
+      binarySiteTableWriter site_table;
+      //Allele counts (TP, FN, FP, wrong call, TN) of each block of each scaffold, by scaffold ID:
+      vector<vector<array<unsigned long, 5>>> blocks;
+      vector<array<unsigned long, 5>> *scaffold_blocks = nullptr;
+      //Percentile confidence intervals of each rate in the report:
+      unsigned long bootstrap_replicates = 0;
+      vector<pair<double, double>> rate_intervals;
+      //Estimated genome-wide counts and rates from a sample of blocks, and standard errors of the rates:
+      const blockSample *block_sample = nullptr;
+      bool estimated = 0;
+      array<double, 5> estimated_counts;
+      array<double, 7> estimated_rates, rate_standard_errors;
+      void startScaffold(uint32_t scaffold_id, unsigned long scaffold_length);
+      void writeSiteTable(unsigned long genome_size);
+      void countSite(uint32_t scaffold_id, long position, unsigned char site_class, long ref_allele, long truth_allele, long observed_allele, unsigned long site_tps, unsigned long site_fns, unsigned long site_fps, unsigned long site_wrong_calls);
+};
+
+//An observed in.snp record is an indel if either allele is longer than a base:
+bool observedIndel(const snpRecordStore &observed, size_t i) {
+   return observed.isLong(i) && (observed.longAlleles(i)[0].length() > 1 || observed.longAlleles(i)[1].length() > 1);
+}
+
+//Reference allele of an observed in.snp record, from its first base:
+long observedRef(const snpRecordStore &observed, size_t i) {
+   return baseToLong(observed.old_alleles[i] != 0 ? (char)observed.old_alleles[i] : observed.longAlleles(i)[0].c_str()[0]);
+}
+
+//Allele of the call of an observed in.snp record, from its first base:
+long observedAllele(const snpRecordStore &observed, size_t i) {
+   return baseToLong(observed.new_alleles[i] != 0 ? (char)observed.new_alleles[i] : observed.longAlleles(i)[1].c_str()[0]);
+}
+
+//Numerator and denominator of each rate in the report from allele counts (TP, FN, FP, wrong call, TN):
+array<pair<double, double>, 7> rateTerms(const array<double, 5> &counts) {
+   double tps = counts[0], fns = counts[1], fps = counts[2], wrong_calls = counts[3], tns = counts[4];
+   return {{make_pair(fps, fps+tns), make_pair(fns, fns+tps), make_pair(fns+wrong_calls, fns+wrong_calls+tps), make_pair(wrong_calls, wrong_calls+tps+fps), make_pair(tps, tps+fns), make_pair(tns, tns+fps), make_pair(fps, tps+fps)}};
+}
+
+//Rates in the report from allele counts (TP, FN, FP, wrong call, TN):
+array<double, 7> errorRates(const array<unsigned long, 5> &counts) {
+   array<pair<double, double>, 7> terms = rateTerms({{(double)counts[0], (double)counts[1], (double)counts[2], (double)counts[3], (double)counts[4]}});
+   array<double, 7> rates;
+   for (unsigned int j = 0; j < 7; j++) {
+      rates[j] = terms[j].first/terms[j].second;
+   }
+   return rates;
+}
+
+//All sites of a scaffold (or of its sampled blocks) start out as TNs:
+void siteComparison::startScaffold(uint32_t scaffold_id, unsigned long scaffold_length) {
+   tns += 2*(block_sample != nullptr ? block_sample->scaffold_bases[scaffold_id] : scaffold_length);
+   if (block_size > 0) {
+      if (blocks.size() < scaffold_ids.size()) {
+         blocks.resize(scaffold_ids.size());
+      }
+      scaffold_blocks = &blocks[scaffold_id];
+      for (unsigned long block_start = 0; block_start < scaffold_length; block_start += block_size) {
+         scaffold_blocks->push_back({{0, 0, 0, 0, 2*min(block_size, scaffold_length - block_start)}});
+      }
+   }
+}
+
+//Count the alleles of a classified site towards the totals, its depth, and its block,
+// and add it to the per-site table:
+void siteComparison::countSite(uint32_t scaffold_id, long position, unsigned char site_class, long ref_allele, long truth_allele, long observed_allele, unsigned long site_tps, unsigned long site_fns, unsigned long site_fps, unsigned long site_wrong_calls) {
+   tps += site_tps;
+   fns += site_fns;
+   fps += site_fps;
+   wrong_calls += site_wrong_calls;
+   tns -= site_tps + site_fns + site_fps + site_wrong_calls;
+   depth_profile.add(scaffold_id, position, site_class);
+   if (context_profile != nullptr) {
+      context_profile->add(scaffold_id, position, site_class);
+   }
+   if (!site_table_path.empty()) {
+      site_table.add(scaffold_id, position, ref_allele, truth_allele, observed_allele, site_class);
+   }
+   if (block_size > 0 && !scaffold_blocks->empty()) {
+      //Sites past the end of the scaffold (e.g. expected SNPs shifted by indels) go in its last block:
+      size_t block = min((size_t)(position > 0 ? (position - 1) / block_size : 0), scaffold_blocks->size() - 1);
+      array<unsigned long, 5> &block_counts = (*scaffold_blocks)[block];
+      block_counts[0] += site_tps;
+      block_counts[1] += site_fns;
+      block_counts[2] += site_fps;
+      block_counts[3] += site_wrong_calls;
+      block_counts[4] -= site_tps + site_fns + site_fps + site_wrong_calls;
+   }
+}
+
+
+void siteComparison::openOutputs() {
+   //If the false negative output file path was input, open that up:
+   if (!fn_path.empty()) {
+      fn_file.open(fn_path);
+      if (!fn_file) {
+         cerr << "Unable to open false negative output file, so ignoring that function." << endl;
+         fn_path = "";
+      }
+   }
+
+   //If the false positive output file path was input, open that up:
+   if (!fp_path.empty()) {
+      fp_file.open(fp_path);
+      if (!fp_file) {
+         cerr << "Unable to open false positive output file, so ignoring that function." << endl;
+         fp_path = "";
+      }
+   }
+
+   //If the true positive output file path was input, open that up:
+   if (!tp_path.empty()) {
+      tp_file.open(tp_path);
+      if (!tp_file) {
+         cerr << "Unable to open true positive output file, so ignoring that function." << endl;
+         tp_path = "";
+      }
+   }
+
+   //If the erroneous call output file path was input, open that up:
+   if (!error_path.empty()) {
+      error_file.open(error_path);
+      if (!error_file) {
+         cerr << "Unable to open erroneous call output file, so ignoring that function." << endl;
+         error_path = "";
+      }
+   }
+
+   //If the indel distance output file path was input, open that up:
+   if (!indel_dist_path.empty()) {
+      indel_dist_file.open(indel_dist_path);
+      if (!indel_dist_file) {
+         cerr << "Unable to open indel distance output file, so ignoring that function." << endl;
+         indel_dist_path = "";
+      }
+   }
+
+   //If the per-site table output path was input, make sure it can be written, and set up its dictionaries:
+   if (!site_table_path.empty()) {
+      ofstream site_table_file;
+      site_table_file.open(site_table_path, ios::binary);
+      if (!site_table_file) {
+         cerr << "Unable to open per-site table output file, so ignoring that function." << endl;
+         site_table_path = "";
+      } else {
+         site_table_file.close();
+         const char int2bases[] = {'A', 'C', 'G', 'T', 'N', 'M', 'R', 'W', 'S', 'Y', 'K'};
+         for (uint32_t scaffold_id = 0; scaffold_id < scaffold_ids.size(); scaffold_id++) {
+            site_table.scaffold_names.push_back(scaffold_ids.name(scaffold_id));
+         }
+         for (unsigned int i = 0; i < 11; i++) {
+            site_table.allele_labels.push_back(string(1, int2bases[i]));
+         }
+         site_table.class_labels = {"TP", "FN", "FP", "ER"};
+      }
+   }
+}
+
+//Hand the open outputs to the writer thread of the pipelined comparison:
+void siteComparison::pipeOutputs(pipelineWriter &writer) {
+   if (!fn_path.empty()) {
+      writer.redirect(fn_file);
+   }
+   if (!fp_path.empty()) {
+      writer.redirect(fp_file);
+   }
+   if (!tp_path.empty()) {
+      writer.redirect(tp_file);
+   }
+   if (!error_path.empty()) {
+      writer.redirect(error_file);
+   }
+   if (!indel_dist_path.empty()) {
+      writer.redirect(indel_dist_file);
+   }
+}
+
+//Count FP and FN variant calls of a scaffold, ignoring masking and indels in in.snp:
+void siteComparison::compareScaffold(uint32_t scaffold_id, unsigned long scaffold_length, const snpRecordStore &observed, size_t observed_begin, size_t observed_end) {
+   //Numbers to bases map:
+   const char int2bases[] = {'A', 'C', 'G', 'T', 'N', 'M', 'R', 'W', 'S', 'Y', 'K'};
+   const string &scaffold = scaffold_ids.name(scaffold_id);
+   startScaffold(scaffold_id, scaffold_length);
+   const expectedScaffold &expected_records = expected.scaffolds[scaffold_id];
+   const vector<uint32_t> &positions = observed.positions;
+   if (expected_records.num_records == 0) {
+      if (observed_begin != observed_end) { //Scaffold is only represented in observed in.snp file
+         //Count false positives:
+         for (size_t o = observed_begin; o != observed_end; ++o) {
+            if (!indel_dist_path.empty()) { //Record closest indel distance of every in.snp site if requested
+               indel_dist_file << scaffold << '\t' << positions[o] << all_indel_distances.column(scaffold_id, positions[o]) << '\n';
+            }
+            //Skip indels or masked bases:
+            if (observedIndel(observed, o)) {
+               indel_sites += 1; //Directly at indel site, guaranteed to be ref since scaffold not in expected in.snp
+               IR_masked += 1;
+               continue;
+            } else if (observed.new_alleles[o] == 'N') { //Not indel site, but masked (possibly in window around indel)
+               masked_bases += 1;
+               NR_masked += 1;
+               continue;
+            }
+            if (observedAllele(observed, o) > 4) { //Het call, truth is hom ref
+               HR_mismatch += 1;
+            } else { //Hom alt call, truth is hom ref
+               AR_mismatch += 1;
+            }
+            countSite(scaffold_id, positions[o], DEPTH_FP, observedRef(observed, o), observedRef(observed, o), observedAllele(observed, o), 0, 0, 2, 0); //Every non-N, non-indel record in observed in.snp not in the expected SNP log is an FP
+            if (!fp_path.empty()) { //Record false positive site to log if requested
+               fp_file << scaffold << '\t' << positions[o] << '\t' << observed.oldAllele(o) << '\t' << observed.newAllele(o) << indel_distances.column(scaffold_id, positions[o]) << '\n';
+            }
+         }
+      }
+   } else if (observed_begin == observed_end) { //Scaffold must be represented in expected SNP log
+      //Count false negatives:
+      for (auto e_iterator = expected_records.begin(); e_iterator != expected_records.end(); ++e_iterator) {
+         if ((*e_iterator)[2] > 4) { //Hom ref call, truth is het
+            RH_mismatch += 1;
+         } else { //Hom ref call, truth is hom alt
+            RA_mismatch += 1;
+         }
+         countSite(scaffold_id, (*e_iterator)[0], DEPTH_FN, (*e_iterator)[1], (*e_iterator)[2], (*e_iterator)[1], 0, 2, 0, 0); //Every record in the expected SNP log not in the observed in.snp file is a false negative
+         if (!fn_path.empty()) { //Record false negative site to log if requested
+            fn_file << scaffold << '\t' << (*e_iterator)[0] << '\t' << int2bases[(*e_iterator)[1]] << '\t' << int2bases[(*e_iterator)[2]] << indel_distances.column(scaffold_id, (*e_iterator)[0]) << '\n';
+         }
+      }
+   } else { //Scaffold is represented in both logs, so compare contents:
+      auto e_iterator = expected_records.begin();
+      size_t o = observed_begin;
+      while (e_iterator != expected_records.end() && o != observed_end) {
+         long observed_position = positions[o];
+         if ((*e_iterator)[0] < observed_position) { //Observed in.snp file is missing this SNP
+            if ((*e_iterator)[2] > 4) { //Hom ref call, truth is het
+               RH_mismatch += 1;
+            } else { //Hom ref call, truth is hom alt
+               RA_mismatch += 1;
+            }
+            //Count false negative:
+            countSite(scaffold_id, (*e_iterator)[0], DEPTH_FN, (*e_iterator)[1], (*e_iterator)[2], (*e_iterator)[1], 0, 2, 0, 0);
+            if (!fn_path.empty()) { //Record false negative site to log if requested
+               fn_file << scaffold << '\t' << (*e_iterator)[0] << '\t' << int2bases[(*e_iterator)[1]] << '\t' << int2bases[(*e_iterator)[2]] << indel_distances.column(scaffold_id, (*e_iterator)[0]) << '\n';
+            }
+            ++e_iterator;
+         } else if ((*e_iterator)[0] > observed_position) { //Expected SNP log does not contain this SNP
+            if (!indel_dist_path.empty()) { //Record closest indel distance of every in.snp site if requested
+               indel_dist_file << scaffold << '\t' << observed_position << all_indel_distances.column(scaffold_id, observed_position) << '\n';
+            }
+            bool indel = observedIndel(observed, o);
+            if (indel) { //Indel getting masked
+               IR_masked += 1;
+               indel_sites += 1;
+            } else if (observed.new_alleles[o] == 'N') { //Masked base
+               NR_masked += 1;
+               masked_bases += 1;
+            } else if (observedAllele(observed, o) > 4) { //Het call, truth is hom ref
+               HR_mismatch += 1;
+            } else { //Hom alt call, truth is hom ref
+               AR_mismatch += 1;
+            }
+            if (!expected.isUncallable(scaffold_id, observed_position)) { //This is a callable site
+               //Count false positive if non-indel and not masked:
+               if (!observed.isLong(o) && observed.new_alleles[o] != 'N') {
+                  countSite(scaffold_id, observed_position, DEPTH_FP, observedRef(observed, o), observedRef(observed, o), observedAllele(observed, o), 0, 0, 2, 0);
+                  if (!fp_path.empty()) { //Record false positive site to log if requested
+                     fp_file << scaffold << '\t' << observed_position << '\t' << observed.old_alleles[o] << '\t' << observed.new_alleles[o] << indel_distances.column(scaffold_id, observed_position) << '\n';
+                  }
+               }
+            }
+            ++o;
+         } else { //Both files have this record, so compare the values
+            if (!indel_dist_path.empty()) { //Record closest indel distance of every in.snp site if requested
+               indel_dist_file << scaffold << '\t' << observed_position << all_indel_distances.column(scaffold_id, observed_position) << '\n';
+            }
+            //Check that ref alleles match:
+            if (debug && to_string(int2bases[(*e_iterator)[1]]) != observed.oldAllele(o)) {
+               cerr << "Ref alleles for site " << (*e_iterator)[0] << " on scaffold " << scaffold << " do not match between SNP logs." << endl;
+               cerr << "Expected SNP log says " << int2bases[(*e_iterator)[1]] << " while observed in.snp says " << observed.oldAllele(o) << endl;
+            }
+            //Compare the values:
+            long observed_allele = observedAllele(observed, o);
+            if ((*e_iterator)[2] == observed_allele) { //True positive
+               if ((*e_iterator)[2] > 4) { //Matching het call
+                  HH_match += 1;
+               } else { //Matching hom alt call
+                  AA_match += 1;
+               }
+               countSite(scaffold_id, (*e_iterator)[0], DEPTH_TP, (*e_iterator)[1], (*e_iterator)[2], observed_allele, 2, 0, 0, 0);
+               if (!tp_path.empty()) { //Record true positive site to log if requested
+                  tp_file << scaffold << '\t' << (*e_iterator)[0] << '\t' << int2bases[(*e_iterator)[2]] << '\t' << observed.newAllele(o) << indel_distances.column(scaffold_id, (*e_iterator)[0]) << '\n';
+               }
+            } else if (observed_allele == 4) { //Masked base => false negative
+               if (observedIndel(observed, o)) { //Indel masking
+                  if ((*e_iterator)[2] > 4) { //Indel masked het site
+                     IH_masked += 1;
+                  } else { //Indel masked hom alt site
+                     IA_masked += 1;
+                  }
+                  indel_sites += 1;
+               } else {
+                  if ((*e_iterator)[2] > 4) { //Masked het site
+                     NH_masked += 1;
+                  } else { //Masked hom alt site
+                     NA_masked += 1;
+                  }
+                  masked_bases += 1;
+               }
+               countSite(scaffold_id, (*e_iterator)[0], DEPTH_FN, (*e_iterator)[1], (*e_iterator)[2], observed_allele, 0, 2, 0, 0);
+               if (!fn_path.empty()) { //Record false negative site to log if requested
+                  fn_file << scaffold << '\t' << (*e_iterator)[0] << '\t' << int2bases[(*e_iterator)[1]] << '\t' << int2bases[(*e_iterator)[2]] << indel_distances.column(scaffold_id, (*e_iterator)[0]) << '\n';
+               }
+            } else { //Error (Does this count as FP or FN?)
+               if ((*e_iterator)[2] > 4) { //Truth is het
+                  if (observed_allele > 4) { //Wrong het
+                     HH_mismatch += 1;
+                  } else { //Called hom alt, truth is het
+                     AH_mismatch += 1;
+                  }
+               } else { //Truth is hom alt
+                  if (observed_allele > 4) { //Called het, truth is hom alt
+                     HA_mismatch += 1;
+                  } else { //Wrong hom alt
+                     AA_mismatch += 1;
+                  }
+               }
+               unsigned long site_tps = 0, site_fns = 0, site_wrong_calls = 0;
+               countErrorAlleles((*e_iterator)[2], observed_allele, (*e_iterator)[1], site_tps, site_fns, site_wrong_calls);
+               countSite(scaffold_id, (*e_iterator)[0], DEPTH_ER, (*e_iterator)[1], (*e_iterator)[2], observed_allele, site_tps, site_fns, 0, site_wrong_calls);
+               if (!error_path.empty()) { //Record erroneous call site to log if requested
+                  error_file << scaffold << '\t' << (*e_iterator)[0] << '\t' << int2bases[(*e_iterator)[2]] << '\t' << observed.newAllele(o) << indel_distances.column(scaffold_id, (*e_iterator)[0]) << '\n';
+               }
+            }
+            ++e_iterator;
+            ++o;
+         }
+      }
+      //Count the remainder of the scaffold from whichever log still hasn't reached its end:
+      while (e_iterator != expected_records.end()) {
+         if ((*e_iterator)[2] > 4) { //Called hom ref, truth is het
+            RH_mismatch += 1;
+         } else { //Called hom ref, truth is hom alt
+            RA_mismatch += 1;
+         }
+         //Count false negatives:
+         countSite(scaffold_id, (*e_iterator)[0], DEPTH_FN, (*e_iterator)[1], (*e_iterator)[2], (*e_iterator)[1], 0, 2, 0, 0);
+         if (!fn_path.empty()) { //Record false negative site to log if requested
+            fn_file << scaffold << '\t' << (*e_iterator)[0] << '\t' << int2bases[(*e_iterator)[1]] << '\t' << int2bases[(*e_iterator)[2]] << indel_distances.column(scaffold_id, (*e_iterator)[0]) << '\n';
+         }
+         ++e_iterator;
+      }
+      for (; o != observed_end; ++o) {
+         if (!indel_dist_path.empty()) { //Record closest indel distance of every in.snp site if requested
+            indel_dist_file << scaffold << '\t' << positions[o] << all_indel_distances.column(scaffold_id, positions[o]) << '\n';
+         }
+         if (observedIndel(observed, o)) { //Indel masked hom ref
+            IR_masked += 1;
+            indel_sites += 1;
+         } else if (observed.new_alleles[o] == 'N') { //Masked hom ref
+            NR_masked += 1;
+            masked_bases += 1;
+         } else if (observedAllele(observed, o) > 4) { //Called het, truth is hom ref
+            HR_mismatch += 1;
+         } else { //Called hom alt, truth is hom ref
+            AR_mismatch += 1;
+         }
+         //Count false positive if non-indel and not masked:
+         if (!expected.isUncallable(scaffold_id, positions[o])) { //This is a callable site
+            if (!observed.isLong(o) && observed.new_alleles[o] != 'N') {
+               countSite(scaffold_id, positions[o], DEPTH_FP, observedRef(observed, o), observedRef(observed, o), observedAllele(observed, o), 0, 0, 2, 0);
+               if (!fp_path.empty()) { //Record false positive site to log if requested
+                  fp_file << scaffold << '\t' << positions[o] << '\t' << observed.old_alleles[o] << '\t' << observed.new_alleles[o] << indel_distances.column(scaffold_id, positions[o]) << '\n';
+               }
+            }
+         }
+      }
+   }
+}
+
+//Classify every base of a scaffold of a pseudoreference, treating bases that differ
+// from the reference as the in.snp, with the truth either the reference with the
+// expected SNPs applied or the degenerate bases of two haplotypes:
+int siteComparison::comparePseudorefScaffold(uint32_t scaffold_id, unsigned long scaffold_length, const string &ref_sequence, const string &call_sequence, string &truth_sequence, const string &hap2_sequence, bool hap_truth) {
+   //Numbers to bases map:
+   const char int2bases[] = {'A', 'C', 'G', 'T', 'N', 'M', 'R', 'W', 'S', 'Y', 'K'};
+   const string &scaffold = scaffold_ids.name(scaffold_id);
+   startScaffold(scaffold_id, scaffold_length);
+   if (hap_truth) { //Truth is the degenerate base of the two haplotypes wherever they differ
+      if (hap2_sequence.length() != truth_sequence.length()) {
+         cerr << "Haplotype FASTAs differ in length on scaffold " << scaffold << ", but only SNPs are supported.  Quitting." << endl;
+         return 11;
+      }
+      const char *hap1 = truth_sequence.data(), *hap2 = hap2_sequence.data();
+      for (size_t i = nextDifference(hap1, hap1, hap2, 0, truth_sequence.length()); i < truth_sequence.length(); i = nextDifference(hap1, hap1, hap2, i+1, truth_sequence.length())) {
+         truth_sequence[i] = int2bases[degenerateBases(baseToLong(hap1[i]), baseToLong(hap2[i]))];
+      }
+   } else { //Truth is the reference with the expected SNPs applied
+      truth_sequence = ref_sequence;
+      const expectedScaffold &expected_records = expected.scaffolds[scaffold_id];
+      for (auto e_iterator = expected_records.begin(); e_iterator != expected_records.end(); ++e_iterator) {
+         if ((*e_iterator)[0] >= 1 && (unsigned long)(*e_iterator)[0] <= truth_sequence.length()) {
+            truth_sequence[(*e_iterator)[0]-1] = int2bases[(*e_iterator)[2]];
+         }
+      }
+   }
+   if (ref_sequence.length() != scaffold_length || call_sequence.length() != scaffold_length || truth_sequence.length() != scaffold_length) {
+      cerr << "FASTAs differ in length from the .fai on scaffold " << scaffold << ", but only SNPs are supported.  Quitting." << endl;
+      return 11;
+   }
+   const char *ref = ref_sequence.data(), *call = call_sequence.data(), *truth = truth_sequence.data();
+   for (size_t i = nextDifference(call, truth, ref, 0, scaffold_length); i < scaffold_length; i = nextDifference(call, truth, ref, i+1, scaffold_length)) {
+      long position = i + 1;
+      long call_allele = baseToLong(call[i]), truth_allele = baseToLong(truth[i]), ref_allele = baseToLong(ref[i]);
+      if (call[i] != ref[i] && !indel_dist_path.empty()) { //Record closest indel distance of every in.snp site if requested
+         indel_dist_file << scaffold << '\t' << position << all_indel_distances.column(scaffold_id, position) << '\n';
+      }
+      if (truth[i] == ref[i]) { //Truth is hom ref, so the call differs
+         if (call[i] == 'N') { //Masked base
+            NR_masked += 1;
+            masked_bases += 1;
+            continue;
+         } else if (call_allele > 4) { //Het call, truth is hom ref
+            HR_mismatch += 1;
+         } else { //Hom alt call, truth is hom ref
+            AR_mismatch += 1;
+         }
+         if (!expected.isUncallable(scaffold_id, position)) { //This is a callable site
+            countSite(scaffold_id, position, DEPTH_FP, ref_allele, truth_allele, call_allele, 0, 0, 2, 0);
+            if (!fp_path.empty()) { //Record false positive site to log if requested
+               fp_file << scaffold << '\t' << position << '\t' << ref[i] << '\t' << call[i] << indel_distances.column(scaffold_id, position) << '\n';
+            }
+         }
+      } else if (call[i] == ref[i]) { //Missing this SNP
+         if (truth_allele > 4) { //Hom ref call, truth is het
+            RH_mismatch += 1;
+         } else { //Hom ref call, truth is hom alt
+            RA_mismatch += 1;
+         }
+         countSite(scaffold_id, position, DEPTH_FN, ref_allele, truth_allele, call_allele, 0, 2, 0, 0);
+         if (!fn_path.empty()) { //Record false negative site to log if requested
+            fn_file << scaffold << '\t' << position << '\t' << ref[i] << '\t' << truth[i] << indel_distances.column(scaffold_id, position) << '\n';
+         }
+      } else if (truth_allele == call_allele) { //True positive
+         if (truth_allele > 4) { //Matching het call
+            HH_match += 1;
+         } else { //Matching hom alt call
+            AA_match += 1;
+         }
+         countSite(scaffold_id, position, DEPTH_TP, ref_allele, truth_allele, call_allele, 2, 0, 0, 0);
+         if (!tp_path.empty()) { //Record true positive site to log if requested
+            tp_file << scaffold << '\t' << position << '\t' << truth[i] << '\t' << call[i] << indel_distances.column(scaffold_id, position) << '\n';
+         }
+      } else if (call_allele == 4) { //Masked base => false negative (indels are masked too, so can't be told apart)
+         if (truth_allele > 4) { //Masked het site
+            NH_masked += 1;
+         } else { //Masked hom alt site
+            NA_masked += 1;
+         }
+         masked_bases += 1;
+         countSite(scaffold_id, position, DEPTH_FN, ref_allele, truth_allele, call_allele, 0, 2, 0, 0);
+         if (!fn_path.empty()) { //Record false negative site to log if requested
+            fn_file << scaffold << '\t' << position << '\t' << ref[i] << '\t' << truth[i] << indel_distances.column(scaffold_id, position) << '\n';
+         }
+      } else { //Error
+         if (truth_allele > 4) { //Truth is het
+            if (call_allele > 4) { //Wrong het
+               HH_mismatch += 1;
+            } else { //Called hom alt, truth is het
+               AH_mismatch += 1;
+            }
+         } else { //Truth is hom alt
+            if (call_allele > 4) { //Called het, truth is hom alt
+               HA_mismatch += 1;
+            } else { //Wrong hom alt
+               AA_mismatch += 1;
+            }
+         }
+         unsigned long site_tps = 0, site_fns = 0, site_wrong_calls = 0;
+         countErrorAlleles(truth_allele, call_allele, ref_allele, site_tps, site_fns, site_wrong_calls);
+         countSite(scaffold_id, position, DEPTH_ER, ref_allele, truth_allele, call_allele, site_tps, site_fns, 0, site_wrong_calls);
+         if (!error_path.empty()) { //Record erroneous call site to log if requested
+            error_file << scaffold << '\t' << position << '\t' << truth[i] << '\t' << call[i] << indel_distances.column(scaffold_id, position) << '\n';
+         }
+      }
+   }
+   return 0;
+}
+
+//Close the outputs and fill in the counts that depend on the whole genome:
+void siteComparison::finish(unsigned long genome_size) {
+   tns -= 2*expected.num_uncallable; //Don't count uncallable sites as anything, including TN.
+   if (block_size > 0 && expected.num_uncallable > 0) {
+      for (uint32_t scaffold_id = 0; scaffold_id < scaffold_ids.size(); scaffold_id++) {
+         const vector<uint32_t> &uncallable_sites = expected.uncallableSites(scaffold_id);
+         if (uncallable_sites.empty() || scaffold_id >= blocks.size() || blocks[scaffold_id].empty()) {
+            continue;
+         }
+         vector<array<unsigned long, 5>> &scaffold_block_counts = blocks[scaffold_id];
+         for (auto site_iterator = uncallable_sites.begin(); site_iterator != uncallable_sites.end(); ++site_iterator) {
+            long position = *site_iterator;
+            scaffold_block_counts[min((size_t)(position > 0 ? (position - 1) / block_size : 0), scaffold_block_counts.size() - 1)][4] -= 2;
+         }
+      }
+   }
+   unsigned long mismatches = RH_mismatch + RA_mismatch + HR_mismatch + HH_mismatch + HA_mismatch + AR_mismatch + AH_mismatch + AA_mismatch;
+   RR_match = genome_size - indel_sites - masked_bases - mismatches - HH_match - AA_match;
+   if (!site_table_path.empty()) {
+      writeSiteTable(genome_size);
+   }
+   if (!fn_path.empty()) {
+      fn_file.close();
+   }
+   if (!fp_path.empty()) {
+      fp_file.close();
+   }
+   if (!tp_path.empty()) {
+      tp_file.close();
+   }
+   if (!error_path.empty()) {
+      error_file.close();
+   }
+   if (!indel_dist_path.empty()) {
+      indel_dist_file.close();
+   }
+}
+
+//Write the per-site table with the counts of the report as its summary:
+void siteComparison::writeSiteTable(unsigned long genome_size) {
+   site_table.addSummary("genome_size", genome_size);
+   site_table.addSummary("uncallable_sites", expected.num_uncallable);
+   site_table.addSummary("TP_alleles", tps);
+   site_table.addSummary("FN_alleles", fns);
+   site_table.addSummary("FP_alleles", fps);
+   site_table.addSummary("ER_alleles", wrong_calls);
+   site_table.addSummary("TN_alleles", tns);
+   site_table.addSummary("masked_bases", masked_bases);
+   site_table.addSummary("indel_sites", indel_sites);
+   site_table.addSummary("RR_match", RR_match);
+   site_table.addSummary("RH_mismatch", RH_mismatch);
+   site_table.addSummary("RA_mismatch", RA_mismatch);
+   site_table.addSummary("HR_mismatch", HR_mismatch);
+   site_table.addSummary("HH_match", HH_match);
+   site_table.addSummary("HH_mismatch", HH_mismatch);
+   site_table.addSummary("HA_mismatch", HA_mismatch);
+   site_table.addSummary("AR_mismatch", AR_mismatch);
+   site_table.addSummary("AH_mismatch", AH_mismatch);
+   site_table.addSummary("AA_match", AA_match);
+   site_table.addSummary("AA_mismatch", AA_mismatch);
+   site_table.addSummary("NR_masked", NR_masked);
+   site_table.addSummary("NH_masked", NH_masked);
+   site_table.addSummary("NA_masked", NA_masked);
+   site_table.addSummary("IR_masked", IR_masked);
+   site_table.addSummary("IH_masked", IH_masked);
+   site_table.addSummary("IA_masked", IA_masked);
+   if (site_table.write(site_table_path)) {
+      cerr << "Error writing per-site table " << site_table_path << endl;
+   }
+}
+
+//Resample blocks with replacement to get 95% percentile intervals of each rate,
+// seeding each replicate separately so the intervals don't depend on the number of threads:
+void siteComparison::bootstrap(unsigned long replicates, unsigned long seed, unsigned int num_threads) {
+   vector<const array<unsigned long, 5> *> all_blocks;
+   for (auto blocks_iterator = blocks.begin(); blocks_iterator != blocks.end(); ++blocks_iterator) {
+      for (auto block_iterator = blocks_iterator->begin(); block_iterator != blocks_iterator->end(); ++block_iterator) {
+         all_blocks.push_back(&*block_iterator);
+      }
+   }
+   if (all_blocks.empty() || replicates == 0) {
+      return;
+   }
+   vector<array<double, 7>> replicate_rates(replicates);
+   atomic<unsigned long> next_replicate(0);
+   vector<thread> workers;
+   for (unsigned int t = 0; t < min((unsigned long)num_threads, replicates); t++) {
+      workers.push_back(thread([&]() {
+         unsigned long replicate;
+         while ((replicate = next_replicate++) < replicates) {
+            seed_seq replicate_seed {(unsigned int)(seed & 0xFFFFFFFF), (unsigned int)(seed >> 32), (unsigned int)replicate};
+            mt19937_64 prng(replicate_seed);
+            uniform_int_distribution<size_t> block_distribution(0, all_blocks.size() - 1);
+            array<unsigned long, 5> counts {{0, 0, 0, 0, 0}};
+            for (size_t i = 0; i < all_blocks.size(); i++) {
+               const array<unsigned long, 5> &block_counts = *all_blocks[block_distribution(prng)];
+               for (unsigned int j = 0; j < 5; j++) {
+                  counts[j] += block_counts[j];
+               }
+            }
+            replicate_rates[replicate] = errorRates(counts);
+         }
+      }));
+   }
+   for (auto worker_iterator = workers.begin(); worker_iterator != workers.end(); ++worker_iterator) {
+      worker_iterator->join();
+   }
+   //Replicates where a rate is undefined (e.g. no TPs or FNs drawn) don't count towards its interval:
+   rate_intervals.clear();
+   for (unsigned int j = 0; j < 7; j++) {
+      vector<double> rates;
+      for (auto replicate_iterator = replicate_rates.begin(); replicate_iterator != replicate_rates.end(); ++replicate_iterator) {
+         if (!std::isnan((*replicate_iterator)[j])) {
+            rates.push_back((*replicate_iterator)[j]);
+         }
+      }
+      if (rates.empty()) {
+         rate_intervals.push_back(make_pair(NAN, NAN));
+         continue;
+      }
+      sort(rates.begin(), rates.end());
+      rate_intervals.push_back(make_pair(rates[(size_t)floor(0.025*(rates.size()-1))], rates[(size_t)ceil(0.975*(rates.size()-1))]));
+   }
+   bootstrap_replicates = replicates;
+}
+
+//Ratio estimates of the genome-wide rates from the stratified sample of blocks (weighting
+// each block by the blocks of its stratum per sampled block), with standard errors from
+// the variance of the linearized ratio within strata, corrected for the finite population:
+void siteComparison::estimate() {
+   const blockSample &sample = *block_sample;
+   vector<array<double, 5>> block_counts;
+   vector<double> block_weights;
+   estimated_counts.fill(0);
+   for (size_t i = 0; i < sample.blocks.size(); i++) {
+      array<double, 5> counts {{0, 0, 0, 0, 0}};
+      uint32_t scaffold_id = sample.blocks[i].first;
+      if (scaffold_id < blocks.size() && sample.blocks[i].second < blocks[scaffold_id].size()) {
+         for (unsigned int k = 0; k < 5; k++) {
+            counts[k] = blocks[scaffold_id][sample.blocks[i].second][k];
+         }
+      }
+      const pair<size_t, size_t> &stratum = sample.strata[sample.block_strata[i]];
+      double weight = (double)stratum.first/(double)stratum.second;
+      for (unsigned int k = 0; k < 5; k++) {
+         estimated_counts[k] += weight*counts[k];
+      }
+      block_counts.push_back(counts);
+      block_weights.push_back(weight);
+   }
+   array<pair<double, double>, 7> totals = rateTerms(estimated_counts);
+   for (unsigned int j = 0; j < 7; j++) {
+      double ratio = totals[j].first/totals[j].second;
+      estimated_rates[j] = ratio;
+      vector<double> residual_sums(sample.strata.size(), 0), residual_squares(sample.strata.size(), 0);
+      for (size_t i = 0; i < block_counts.size(); i++) {
+         pair<double, double> terms = rateTerms(block_counts[i])[j];
+         double residual = terms.first - ratio*terms.second;
+         residual_sums[sample.block_strata[i]] += residual;
+         residual_squares[sample.block_strata[i]] += residual*residual;
+      }
+      double variance = 0;
+      for (size_t stratum = 0; stratum < sample.strata.size(); stratum++) {
+         double stratum_blocks = sample.strata[stratum].first, sampled_blocks = sample.strata[stratum].second;
+         if (sampled_blocks < 2) {
+            continue;
+         }
+         double residual_variance = max(0.0, (residual_squares[stratum] - residual_sums[stratum]*residual_sums[stratum]/sampled_blocks)/(sampled_blocks - 1));
+         variance += stratum_blocks*stratum_blocks*(1.0 - sampled_blocks/stratum_blocks)*residual_variance/sampled_blocks;
+      }
+      rate_standard_errors[j] = sqrt(variance)/totals[j].second;
+   }
+   estimated = 1;
+}
+
+void siteComparison::report(ostream &output) {
+   unsigned long R_mismatches = RH_mismatch + RA_mismatch;
+   unsigned long H_mismatches = HR_mismatch + HH_mismatch + HA_mismatch;
+   unsigned long A_mismatches = AR_mismatch + AH_mismatch + AA_mismatch;
+   const char *rate_names[] = {"FPR", "FNR", "FNR+wrong", "Wrong call rate (wrong calls out of all calls)", "Sensitivity", "Specificity", "FDR"};
+   output << setprecision(15);
+   if (estimated) { //Genome-wide estimates from the sampled blocks
+      output << "True positives\t" << estimated_counts[0]/2.0 << endl;
+      output << "False positives\t" << estimated_counts[2]/2.0 << endl;
+      output << "True negatives\t" << estimated_counts[4]/2.0 << endl;
+      output << "False negatives\t" << estimated_counts[1]/2.0 << endl;
+      output << "Wrong calls\t" << estimated_counts[3]/2.0 << endl;
+      for (unsigned int j = 0; j < 7; j++) {
+         output << rate_names[j] << '\t' << estimated_rates[j] << endl;
+      }
+   } else {
+      output << "True positives\t" << (double)tps/2.0 << endl;
+      output << "False positives\t" << (double)fps/2.0 << endl;
+      output << "True negatives\t" << (double)tns/2.0 << endl;
+      output << "False negatives\t" << (double)fns/2.0 << endl;
+      output << "Wrong calls\t" << (double)wrong_calls/2.0 << endl;
+      output << "FPR\t" << (double)fps/(double)(fps+tns) << endl;
+      output << "FNR\t" << (double)fns/(double)(fns+tps) << endl;
+      output << "FNR+wrong\t" << (double)(fns+wrong_calls)/(double)(fns+wrong_calls+tps) << endl;
+      output << "Wrong call rate (wrong calls out of all calls)\t" << (double)(wrong_calls)/(double)(wrong_calls+tps+fps) << endl;
+      output << "Sensitivity\t" << (double)tps/(double)(tps+fns) << endl;
+      output << "Specificity\t" << (double)tns/(double)(tns+fps) << endl;
+      output << "FDR\t" << (double)fps/(double)(tps+fps) << endl;
+   }
+   output << endl;
+   output << "Call types:" << endl;
+   output << "Masked\t" << (double)masked_bases << endl;
+   output << "Indel site\t" << (double)indel_sites << endl;
+   output << "Homozygous ref\t" << (double)(RR_match + R_mismatches) << endl;
+   output << "Heterozygous\t" << (double)(HH_match + H_mismatches) << endl;
+   output << "Homozygous alt\t" << (double)(AA_match + A_mismatches) << endl;
+   output << endl;
+   output << "Matches:" << endl;
+   output << "Homozygous ref\t" << (double)RR_match << endl;
+   output << "Heterozygous\t" << (double)HH_match << endl;
+   output << "Homozygous alt\t" << (double)AA_match << endl;
+   output << endl;
+   output << "Mismatches:" << endl;
+   output << "Het->RR\t" << (double)RH_mismatch << endl;
+   output << "Alt->RR\t" << (double)RA_mismatch << endl;
+   output << "RR->Het\t" << (double)HR_mismatch << endl;
+   output << "Het->Other Het\t" << (double)HH_mismatch << endl;
+   output << "Alt->Het\t" << (double)HA_mismatch << endl;
+   output << "RR->Alt\t" << (double)AR_mismatch << endl;
+   output << "Het->Alt\t" << (double)AH_mismatch << endl;
+   output << "Alt->Other Alt\t" << (double)AA_mismatch << endl;
+   output << endl;
+   output << "Masking:" << endl;
+   output << "RR->N\t" << (double)NR_masked << endl;
+   output << "Het->N\t" << (double)NH_masked << endl;
+   output << "Alt->N\t" << (double)NA_masked << endl;
+   output << endl;
+   output << "Indel Sites:" << endl;
+   output << "RR->Indel\t" << (double)IR_masked << endl;
+   output << "Het->Indel\t" << (double)IH_masked << endl;
+   output << "Alt->Indel\t" << (double)IA_masked << endl;
+   if (!rate_intervals.empty()) {
+      output << endl;
+      output << "Bootstrap 95% CIs (" << bootstrap_replicates << " replicates of " << block_size << " bp blocks):" << endl;
+      for (unsigned int j = 0; j < 7; j++) {
+         output << rate_names[j] << '\t' << rate_intervals[j].first << '\t' << rate_intervals[j].second << endl;
+      }
+   }
+   if (estimated) {
+      output << endl;
+      output << "Block sample standard errors (" << block_sample->blocks.size() << " of " << block_sample->num_blocks << " blocks of " << block_sample->block_size << " bp in " << block_sample->strata.size() << " strata, seed " << block_sample->seed << "):" << endl;
+      output << "Sampled bases\t" << (double)block_sample->sampled_bases << endl;
+      for (unsigned int j = 0; j < 7; j++) {
+         output << rate_names[j] << '\t' << rate_standard_errors[j] << endl;
+      }
+   }
+}
+
+//Add the record (pos, oldallele, newallele) of a line of an observed in.snp,
+// skipping scaffolds missing from the .fai since they're never compared:
+void parseObservedLine(const string &oline, const scaffoldIDs &scaffold_ids, snpRecordStore &observed_log) {
+   size_t starts[4], ends[4];
+   size_t num_fields = fieldBounds(oline, starts, ends, 4);
+   if (num_fields < 3) {
+      return;
+   }
+   uint32_t scaffold_id = scaffold_ids.find(oline, ends[0]);
+   if (scaffold_id == scaffoldIDs::missing) {
+      return;
+   }
+   //No-calls from the VCFtoUnfilteredINSNP awk scripts have no allele, so count them as masked:
+   bool no_call = num_fields < 4 || starts[3] == oline.length();
+   observed_log.addAlleles(scaffold_id, strtoul(oline.c_str() + starts[1], NULL, 10), oline.c_str() + starts[2], ends[2] - starts[2], no_call ? "N" : oline.c_str() + starts[3], no_call ? 1 : ends[3] - starts[3]);
+}
+
+//Read an observed in.snp into records grouped by scaffold ID:
+bool readObservedLog(const string &observed_path, const scaffoldIDs &scaffold_ids, snpRecordStore &observed_log) {
+   ifstream observed;
+   observed.open(observed_path);
+   if (!observed) {
+      return 1;
+   }
+   cerr << "Reading observed in.snp file " << observed_path << endl;
+   string oline;
+   while (getline(observed, oline)) {
+      parseObservedLine(oline, scaffold_ids, observed_log);
+   }
+   observed.close();
+   observed_log.group(scaffold_ids.size());
+   cerr << "Done reading observed in.snp file" << endl;
+   return 0;
+}
+
+//Read only the observed records in the sampled blocks of an in.snp sorted like the .fai:
+int readObservedSampled(const string &observed_path, const scaffoldIDs &scaffold_ids, const blockSample &sample, snpRecordStore &observed_log) {
+   sortedTextLog observed(scaffold_ids);
+   if (observed.open(observed_path)) {
+      cerr << "Error opening observed in.snp " << observed_path << " (sampling blocks needs a seekable file).  Quitting." << endl;
+      return 6;
+   }
+   cerr << "Reading sampled blocks of observed in.snp file " << observed_path << endl;
+   auto add_record = [&](const string &oline) {
+      parseObservedLine(oline, scaffold_ids, observed_log);
+   };
+   for (uint32_t scaffold_id = 0; scaffold_id < sample.ranges.size(); scaffold_id++) {
+      for (auto range_iterator = sample.ranges[scaffold_id].begin(); range_iterator != sample.ranges[scaffold_id].end(); ++range_iterator) {
+         if (observed.readRange(scaffold_id, range_iterator->first, range_iterator->second, add_record)) {
+            cerr << "Observed in.snp " << observed_path << " is not sorted in .fai scaffold order and by position, as sampling blocks requires.  Quitting." << endl;
+            observed.close();
+            return 17;
+         }
+      }
+   }
+   observed.close();
+   observed_log.group(scaffold_ids.size());
+   cerr << "Done reading observed in.snp file" << endl;
+   return 0;
+}
+
+//Records coming through a queue of batches from a reader thread, with a cursor
+// into the current batch, ending at a null batch:
+class batchStream {
+   public:
+      size_t cursor = 0;
+      batchStream(spscQueue<unique_ptr<snpRecordStore>> &queue, stageMetrics &metrics) : queue(queue), metrics(metrics) {}
+      //Scaffold ID of the record at the cursor, or missing at the end of the input:
+      uint32_t next() {
+         while (!finished && (!batch || cursor >= batch->size())) {
+            if (!queue.pop(batch, metrics.input_wait) || !batch) {
+               finished = 1;
+            } else {
+               metrics.batches++;
+            }
+            cursor = 0;
+         }
+         return finished ? scaffoldIDs::missing : batch->scaffoldID(cursor);
+      }
+      const snpRecordStore &records() const {
+         return *batch;
+      }
+   private:
+      spscQueue<unique_ptr<snpRecordStore>> &queue;
+      stageMetrics &metrics;
+      unique_ptr<snpRecordStore> batch;
+      bool finished = 0;
+};
+
+void reportStageMetrics(const vector<stageMetrics> &stages, ostream &output) {
+   ostringstream metrics_table;
+   metrics_table << fixed << setprecision(3);
+   metrics_table << "Pipeline stage\tWall (s)\tBusy (s)\tBusy (%)\tInput wait (s)\tOutput wait (s)\tBatches" << endl;
+   for (auto stage_iterator = stages.begin(); stage_iterator != stages.end(); ++stage_iterator) {
+      double busy = max(0.0, stage_iterator->wall - stage_iterator->input_wait - stage_iterator->output_wait);
+      metrics_table << stage_iterator->name << '\t' << stage_iterator->wall << '\t' << busy << '\t' << (stage_iterator->wall > 0 ? 100.0*busy/stage_iterator->wall : 0.0) << '\t' << stage_iterator->input_wait << '\t' << stage_iterator->output_wait << '\t' << stage_iterator->batches << endl;
+   }
+   output << metrics_table.str();
+}
+
+//Compare the observed in.snp with the expected SNP log with reading, comparison, and
+// writing overlapped: a reader thread per text log parses batches of records into a
+// bounded queue, this thread compares each scaffold as soon as both logs move past it,
+// and a writer thread writes the outputs, so both logs must be in .fai scaffold order:
+int comparePipelined(const string &expected_path, const string &observed_path, bool stream_expected, const scaffoldIDs &scaffold_ids, const vector<unsigned long> &scaffold_lengths, unsigned long min_depth, bool debug, expectedLog &expected_log, siteComparison &comparison, indelComparison &indel_comparison, phaseComparison &phase_comparison, contextProfile &context_profile, fastaScaffolds &reference_fasta) {
+   ifstream expected, observed;
+   if (stream_expected) {
+      expected.open(expected_path);
+      if (!expected) {
+         cerr << "Error opening expected SNP log " << expected_path << ".  Quitting." << endl;
+         return 5;
+      }
+      expected_log.startStream(scaffold_ids.size());
+   }
+   observed.open(observed_path);
+   if (!observed) {
+      cerr << "Error opening observed in.snp " << observed_path << ".  Quitting." << endl;
+      return 6;
+   }
+   cerr << "Comparing SNP logs pipelined as they're read" << endl;
+
+   atomic<bool> cancelled(0);
+   spscQueue<unique_ptr<snpRecordStore>> expected_queue(PIPELINE_QUEUED_BATCHES, cancelled), observed_queue(PIPELINE_QUEUED_BATCHES, cancelled);
+   stageMetrics expected_metrics, observed_metrics, comparison_metrics;
+   expected_metrics.name = "expected reader";
+   observed_metrics.name = "observed reader";
+   comparison_metrics.name = "comparison";
+   chrono::steady_clock::time_point pipeline_start = chrono::steady_clock::now();
+
+   //Uncallable sites of scaffolds missing from the .fai still aren't counted as TNs:
+   unordered_set<string> other_uncallable_sites;
+   int expected_status = 0;
+   thread expected_reader;
+   if (stream_expected) {
+      expected_reader = thread([&]() {
+         string eline;
+         expectedLine record;
+         unique_ptr<snpRecordStore> batch(new snpRecordStore());
+         bool stopped = 0;
+         while (!stopped && getline(expected, eline)) {
+            int parse_status = parseExpectedLine(eline, scaffold_ids, min_depth, debug, record);
+            if (parse_status == 7) {
+               expected_status = 7;
+               cancelled = 1;
+               break;
+            } else if (parse_status != 0) {
+               expected_log.num_skipped += parse_status == 2;
+               continue;
+            }
+            if (record.scaffold_id == scaffoldIDs::missing) {
+               if (record.uncallable) {
+                  other_uncallable_sites.insert(eline.substr(0, record.site_length));
+               }
+               continue;
+            }
+            batch->add(record.scaffold_id, record.position, record.uncallable ? UNCALLABLE_ALLELE : record.oldallele, record.newallele);
+            if (batch->size() >= PIPELINE_BATCH_RECORDS) {
+               stopped = !expected_queue.push(batch, expected_metrics.output_wait);
+               expected_metrics.batches++;
+               batch.reset(new snpRecordStore());
+            }
+         }
+         if (!stopped && batch->size() > 0) {
+            stopped = !expected_queue.push(batch, expected_metrics.output_wait);
+            expected_metrics.batches++;
+         }
+         batch.reset();
+         if (!stopped) {
+            expected_queue.push(batch, expected_metrics.output_wait);
+         }
+         expected_metrics.wall = secondsSince(pipeline_start);
+      });
+   }
+   thread observed_reader([&]() {
+      string oline;
+      unique_ptr<snpRecordStore> batch(new snpRecordStore());
+      bool stopped = 0;
+      while (!stopped && getline(observed, oline)) {
+         parseObservedLine(oline, scaffold_ids, *batch);
+         if (batch->size() >= PIPELINE_BATCH_RECORDS) {
+            stopped = !observed_queue.push(batch, observed_metrics.output_wait);
+            observed_metrics.batches++;
+            batch.reset(new snpRecordStore());
+         }
+      }
+      if (!stopped && batch->size() > 0) {
+         stopped = !observed_queue.push(batch, observed_metrics.output_wait);
+         observed_metrics.batches++;
+      }
+      batch.reset();
+      if (!stopped) {
+         observed_queue.push(batch, observed_metrics.output_wait);
+      }
+      observed_metrics.wall = secondsSince(pipeline_start);
+   });
+   pipelineWriter writer(cancelled);
+   comparison.pipeOutputs(writer);
+   writer.start();
+
+   //Gather the records of each scaffold from the batches, then compare it:
+   batchStream expected_stream(expected_queue, comparison_metrics), observed_stream(observed_queue, comparison_metrics);
+   vector<uint32_t> expected_positions, uncallable_positions;
+   vector<uint8_t> expected_alleles;
+   snpRecordStore observed_records;
+   string unsorted_log = "";
+   int status = 0;
+   for (uint32_t scaffold_id = 0; scaffold_id < scaffold_ids.size() && !cancelled; scaffold_id++) {
+      const string &scaffold = scaffold_ids.name(scaffold_id);
+      if (stream_expected) {
+         uint32_t next_id;
+         while ((next_id = expected_stream.next()) == scaffold_id) {
+            const snpRecordStore &records = expected_stream.records();
+            size_t i = expected_stream.cursor++;
+            if (records.old_alleles[i] == UNCALLABLE_ALLELE) { //Skip sites that wouldn't be callable based on the raw sequencing depth
+               uncallable_positions.push_back(records.positions[i]);
+            } else {
+               expected_positions.push_back(records.positions[i]);
+               expected_alleles.push_back((records.old_alleles[i] << 4) | records.new_alleles[i]);
+            }
+         }
+         if (next_id < scaffold_id) {
+            unsorted_log = "Expected SNP log";
+            break;
+         }
+         expected_log.setScaffold(scaffold_id, expected_positions, expected_alleles, uncallable_positions);
+      }
+      uint32_t next_id;
+      while ((next_id = observed_stream.next()) == scaffold_id) {
+         const snpRecordStore &records = observed_stream.records();
+         size_t i = observed_stream.cursor++;
+         if (records.isLong(i)) {
+            const array<string, 2> &alleles = records.longAlleles(i);
+            observed_records.addAlleles(scaffold_id, records.positions[i], alleles[0].data(), alleles[0].length(), alleles[1].data(), alleles[1].length());
+         } else {
+            observed_records.add(scaffold_id, records.positions[i], records.old_alleles[i], records.new_alleles[i]);
+         }
+      }
+      if (next_id < scaffold_id) {
+         unsorted_log = "Observed in.snp";
+         break;
+      }
+      comparison.compareScaffold(scaffold_id, scaffold_lengths[scaffold_id], observed_records, 0, observed_records.size());
+      if (indel_comparison.enabled || context_profile.enabled) {
+         string ref_sequence;
+         if (reference_fasta.get(scaffold, ref_sequence)) {
+            cerr << "Scaffold " << scaffold << " is missing from the reference FASTA.  Quitting." << endl;
+            status = 10;
+            break;
+         }
+         context_profile.countScaffold(scaffold_id, ref_sequence);
+         if (indel_comparison.enabled) {
+            indel_comparison.compareScaffold(scaffold_id, ref_sequence);
+         }
+      }
+      if (phase_comparison.enabled) {
+         phase_comparison.compareScaffold(scaffold_id);
+      }
+      observed_records.clear();
+      if (stream_expected) {
+         expected_log.clearScaffold(scaffold_id);
+      }
+   }
+   //Records left over after the last scaffold of the .fai came before the scaffold they're on:
+   if (status == 0 && unsorted_log.empty() && !cancelled) {
+      if (stream_expected && expected_stream.next() != scaffoldIDs::missing) {
+         unsorted_log = "Expected SNP log";
+      } else if (observed_stream.next() != scaffoldIDs::missing) {
+         unsorted_log = "Observed in.snp";
+      }
+   }
+   comparison_metrics.wall = secondsSince(pipeline_start);
+   if (status != 0 || !unsorted_log.empty()) {
+      cancelled = 1;
+   }
+   if (stream_expected) {
+      expected_reader.join();
+   }
+   observed_reader.join();
+   writer.finish();
+   comparison_metrics.output_wait = writer.producer_wait;
+   expected.close();
+   observed.close();
+   if (expected_status != 0) {
+      return expected_status;
+   }
+   if (!unsorted_log.empty()) {
+      cerr << unsorted_log << " is not sorted in .fai scaffold order, so it can't be compared pipelined.  Quitting." << endl;
+      return 14;
+   }
+   if (status != 0) {
+      return status;
+   }
+   if (stream_expected) {
+      expected_log.finishStream(other_uncallable_sites);
+   }
+
+   //How busy each stage was shows which one limits the pipeline:
+   vector<stageMetrics> stages;
+   if (stream_expected) {
+      stages.push_back(expected_metrics);
+   }
+   stages.push_back(observed_metrics);
+   stages.push_back(comparison_metrics);
+   stages.push_back(writer.metrics);
+   reportStageMetrics(stages, cerr);
+   return 0;
+}
+
+//Site classes of each callset in concordance mode (MK is masked or indel):
+#define CONCORDANCE_TP 0
+#define CONCORDANCE_FN 1
+#define CONCORDANCE_FP 2
+#define CONCORDANCE_ER 3
+#define CONCORDANCE_TN 4
+#define CONCORDANCE_MK 5
+
+//Agreement of several callsets (observed in.snps) with the truth and with each other,
+// found by a k-way merge of the truth and all callsets a scaffold at a time:
+class callsetConcordance {
+   public:
+      vector<string> labels;
+      //Output path for the class of every site in any callset or the truth in each callset:
+      string sites_path = "";
+      callsetConcordance(const scaffoldIDs &scaffold_ids, const expectedLog &expected, const vector<snpRecordStore> &observed_logs) : scaffold_ids(scaffold_ids), expected(expected), observed_logs(observed_logs), class_counts(observed_logs.size(), array<unsigned long, 6>()), shared_calls(observed_logs.size() + 1, vector<unsigned long>(observed_logs.size() + 1, 0)) {}
+      void openOutput();
+      void compareScaffold(uint32_t scaffold_id);
+      void finish(unsigned long genome_size);
+      void report(ostream &output);
+   private:
+      const scaffoldIDs &scaffold_ids;
+      const expectedLog &expected;
+      const vector<snpRecordStore> &observed_logs;
+      ofstream sites_file;
+      //Number of sites with each combination of classes across callsets:
+      map<string, unsigned long> patterns;
+      //Number of sites of each class per callset:
+      vector<array<unsigned long, 6>> class_counts;
+      //Number of sites where a pair of callsets (the truth first) make the same non-reference call:
+      vector<vector<unsigned long>> shared_calls;
+      unsigned long merged_sites = 0;
+};
+
+void callsetConcordance::openOutput() {
+   if (!sites_path.empty()) {
+      sites_file.open(sites_path);
+      if (!sites_file) {
+         cerr << "Unable to open per-site concordance output file, so ignoring that function." << endl;
+         sites_path = "";
+         return;
+      }
+      sites_file << "Scaffold\tPosition\tRef\tTruth";
+      for (auto label_iterator = labels.begin(); label_iterator != labels.end(); ++label_iterator) {
+         sites_file << '\t' << *label_iterator << '\t' << *label_iterator << "_class";
+      }
+      sites_file << endl;
+   }
+}
+
+void callsetConcordance::compareScaffold(uint32_t scaffold_id) {
+   //Numbers to bases map:
+   const char int2bases[] = {'A', 'C', 'G', 'T', 'N', 'M', 'R', 'W', 'S', 'Y', 'K'};
+   const char *class_names[] = {"TP", "FN", "FP", "ER", "TN", "MK"};
+   const string &scaffold = scaffold_ids.name(scaffold_id);
+   size_t num_callsets = observed_logs.size();
+   const expectedScaffold &truth = expected.scaffolds[scaffold_id];
+   auto e_iterator = truth.begin();
+   vector<size_t> cursors(num_callsets), ends(num_callsets);
+   for (size_t i = 0; i < num_callsets; i++) {
+      cursors[i] = observed_logs[i].begin(scaffold_id);
+      ends[i] = observed_logs[i].end(scaffold_id);
+   }
+   vector<string> calls(num_callsets);
+   vector<long> call_alleles(num_callsets);
+   vector<unsigned char> classes(num_callsets);
+   while (true) {
+      //Next site in any of the inputs:
+      long position = -1;
+      if (e_iterator != truth.end()) {
+         position = (*e_iterator)[0];
+      }
+      for (size_t i = 0; i < num_callsets; i++) {
+         if (cursors[i] < ends[i]) {
+            long observed_position = observed_logs[i].positions[cursors[i]];
+            if (position < 0 || observed_position < position) {
+               position = observed_position;
+            }
+         }
+      }
+      if (position < 0) {
+         break;
+      }
+      string ref_base = "", truth_base = "";
+      long truth_allele = 4;
+      bool truth_variant = e_iterator != truth.end() && (*e_iterator)[0] == position;
+      if (truth_variant) {
+         ref_base = int2bases[(*e_iterator)[1]];
+         truth_base = int2bases[(*e_iterator)[2]];
+         truth_allele = (*e_iterator)[2];
+         ++e_iterator;
+      }
+      //Take the first record of each callset at this site:
+      for (size_t i = 0; i < num_callsets; i++) {
+         calls[i] = "";
+         classes[i] = truth_variant ? CONCORDANCE_FN : CONCORDANCE_TN;
+         call_alleles[i] = 4;
+         const snpRecordStore &observed = observed_logs[i];
+         while (cursors[i] < ends[i] && (long)observed.positions[cursors[i]] == position) {
+            size_t record = cursors[i];
+            if (calls[i].empty()) {
+               calls[i] = observed.newAllele(record);
+               if (ref_base.empty()) {
+                  ref_base = observed.oldAllele(record);
+               }
+               //Same classification as for a single in.snp:
+               call_alleles[i] = observedAllele(observed, record);
+               if (truth_variant) {
+                  classes[i] = call_alleles[i] == truth_allele ? CONCORDANCE_TP : (call_alleles[i] == 4 ? CONCORDANCE_MK : CONCORDANCE_ER);
+               } else if (observedIndel(observed, record) || observed.new_alleles[record] == 'N') { //Masked or indel
+                  classes[i] = CONCORDANCE_MK;
+                  call_alleles[i] = 4;
+               } else {
+                  classes[i] = CONCORDANCE_FP;
+               }
+            }
+            ++cursors[i];
+         }
+      }
+      //Skip sites that wouldn't be callable based on the raw sequencing depth:
+      if (expected.isUncallable(scaffold_id, position)) {
+         continue;
+      }
+      merged_sites++;
+      string pattern = "";
+      for (size_t i = 0; i < num_callsets; i++) {
+         pattern += (i > 0 ? "," : "") + string(class_names[classes[i]]);
+         class_counts[i][classes[i]]++;
+      }
+      patterns[pattern]++;
+      //Count shared non-reference calls, with the truth as callset 0:
+      for (size_t i = 0; i <= num_callsets; i++) {
+         long allele_i = i == 0 ? (truth_variant ? truth_allele : 4) : call_alleles[i-1];
+         if (allele_i == 4) {
+            continue;
+         }
+         for (size_t j = 0; j <= num_callsets; j++) {
+            long allele_j = j == 0 ? (truth_variant ? truth_allele : 4) : call_alleles[j-1];
+            if (allele_i == allele_j) {
+               shared_calls[i][j]++;
+            }
+         }
+      }
+      if (!sites_path.empty()) {
+         sites_file << scaffold << '\t' << position << '\t' << ref_base << '\t' << (truth_variant ? truth_base : ref_base);
+         for (size_t i = 0; i < num_callsets; i++) {
+            sites_file << '\t' << (calls[i].empty() ? ref_base : calls[i]) << '\t' << class_names[classes[i]];
+         }
+         sites_file << '\n';
+      }
+   }
+}
+
+//Sites in none of the inputs are TN in every callset:
+void callsetConcordance::finish(unsigned long genome_size) {
+   unsigned long all_tns = genome_size - merged_sites - expected.num_uncallable;
+   string pattern = "";
+   for (size_t i = 0; i < observed_logs.size(); i++) {
+      pattern += (i > 0 ? "," : "") + string("TN");
+      class_counts[i][CONCORDANCE_TN] += all_tns;
+   }
+   patterns[pattern] += all_tns;
+   if (!sites_path.empty()) {
+      sites_file.close();
+   }
+}
+
+void callsetConcordance::report(ostream &output) {
+   const char *class_names[] = {"TP", "FN", "FP", "ER", "TN", "MK"};
+   output << "Site classes:" << endl;
+   output << "Class";
+   for (auto label_iterator = labels.begin(); label_iterator != labels.end(); ++label_iterator) {
+      output << '\t' << *label_iterator;
+   }
+   output << endl;
+   for (unsigned int site_class = 0; site_class < 6; site_class++) {
+      output << class_names[site_class];
+      for (size_t i = 0; i < class_counts.size(); i++) {
+         output << '\t' << class_counts[i][site_class];
+      }
+      output << endl;
+   }
+   output << endl;
+   output << "Agreement patterns (";
+   for (size_t i = 0; i < labels.size(); i++) {
+      output << (i > 0 ? "," : "") << labels[i];
+   }
+   output << "):" << endl;
+   for (auto pattern_iterator = patterns.begin(); pattern_iterator != patterns.end(); ++pattern_iterator) {
+      output << pattern_iterator->first << '\t' << pattern_iterator->second << endl;
+   }
+   output << endl;
+   output << "Shared non-reference calls:" << endl;
+   output << "Callset\tTruth";
+   for (auto label_iterator = labels.begin(); label_iterator != labels.end(); ++label_iterator) {
+      output << '\t' << *label_iterator;
+   }
+   output << endl;
+   for (size_t i = 0; i < shared_calls.size(); i++) {
+      output << (i == 0 ? "Truth" : labels[i-1]);
+      for (size_t j = 0; j < shared_calls[i].size(); j++) {
+         output << '\t' << shared_calls[i][j];
+      }
+      output << endl;
+   }
+}
+
+//Degenerate IUPAC base of a genotype as in the VCFtoUnfilteredINSNP awk scripts,
+// empty unless both alleles are A, C, G, or T:
+string degenerateGenotype(const string &allele1, const string &allele2) {
+   const char int2bases[] = {'A', 'C', 'G', 'T', 'N', 'M', 'R', 'W', 'S', 'Y', 'K'};
+   if (allele1.length() != 1 || allele2.length() != 1 || string("ACGT").find(allele1[0]) == string::npos || string("ACGT").find(allele2[0]) == string::npos) {
+      return "";
+   }
+   string base1 = allele1, base2 = allele2;
+   return string(1, int2bases[degenerateBases(baseToLong(base1), baseToLong(base2))]);
+}
+
+//Allele of a record for a GT allele index (REF for 0), empty if there's no such allele:
+string genotypeAllele(const vector<string> &alleles, const string &allele_index) {
+   if (allele_index.empty() || (allele_index[0] == '0' && allele_index.length() > 1) || allele_index.find_first_not_of("0123456789") != string::npos || allele_index.length() > 9) {
+      return "";
+   }
+   size_t index = stoul(allele_index);
+   return index < alleles.size() ? alleles[index] : "";
+}
+
+//One sample of a jointly genotyped VCF, with its demultiplexed in.snp records
+// of the current scaffold (its comparison is owned by compareJointVCF):
+struct jointSample {
+   string name, expected_path, output_prefix, insnp_path;
+   size_t column = 0;
+   ofstream insnp_file;
+   snpRecordStore records;
+   siteComparison *comparison = nullptr;
+};
+
+//Classify the sites of each sample in a jointly genotyped VCF against its own
+// expected SNP log, scaffold by scaffold as the VCF moves past them:
+int compareJointVCF(const string &joint_vcf_path, const string &sample_sheet_path, const string &joint_caller, const string &indel_vcf_path, scaffoldIDs &scaffold_ids, const vector<unsigned long> &scaffold_lengths, unsigned long genome_size, unsigned long min_depth, unsigned long block_size, unsigned long bootstrap_replicates, unsigned long seed, unsigned int num_threads, bool debug) {
+   //Read the sample sheet: VCF sample name, expected SNP log, output prefix, and optionally a path to save its in.snp to
+   ifstream sample_sheet;
+   sample_sheet.open(sample_sheet_path);
+   if (!sample_sheet) {
+      cerr << "Error opening sample sheet " << sample_sheet_path << ".  Quitting." << endl;
+      return 12;
+   }
+   vector<jointSample> samples;
+   string sampleline;
+   while (getline(sample_sheet, sampleline)) {
+      vector<string> line_vector = splitString(sampleline, '\t');
+      if (line_vector.empty() || line_vector[0].empty() || line_vector[0][0] == '#') {
+         continue;
+      }
+      if (line_vector.size() < 3) {
+         cerr << "Sample sheet line does not have a sample name, expected SNP log, and output prefix: " << sampleline << endl;
+         return 12;
+      }
+      samples.emplace_back();
+      samples.back().name = line_vector[0];
+      samples.back().expected_path = line_vector[1];
+      samples.back().output_prefix = line_vector[2];
+      samples.back().insnp_path = line_vector.size() > 3 ? line_vector[3] : "";
+   }
+   sample_sheet.close();
+
+   //Samples sharing an expected SNP log share one copy of it:
+   map<string, expectedLog> expected_logs;
+   for (auto sample_iterator = samples.begin(); sample_iterator != samples.end(); ++sample_iterator) {
+      if (expected_logs.count(sample_iterator->expected_path) == 0) {
+         int expected_status = expected_logs[sample_iterator->expected_path].read(sample_iterator->expected_path, scaffold_ids, min_depth, debug);
+         if (expected_status != 0) {
+            return expected_status;
+         }
+      }
+   }
+
+   //Indel positions come from the same pass as the genotypes if the VCFs are the same:
+   indelDistances indel_distances(scaffold_ids);
+   bool indels_from_joint_vcf = indel_vcf_path == joint_vcf_path;
+   if (indels_from_joint_vcf) {
+      indel_distances.enabled = 1;
+   } else if (!indel_vcf_path.empty()) {
+      cerr << "Reading indel positions from VCF " << indel_vcf_path << endl;
+      if (indel_distances.readVCF(indel_vcf_path)) {
+         cerr << "Error opening VCF " << indel_vcf_path << " for indel distances.  Quitting." << endl;
+         return 8;
+      }
+      cerr << "Done reading indel positions from VCF" << endl;
+   }
+   //Samples are compared one after the other within a scaffold, so they can
+   // share cursors (which rewind between samples):
+   indelDistances &all_indel_distances = indel_distances;
+   depthProfile depth_profile;
+
+   vector<unique_ptr<siteComparison>> comparisons;
+   for (auto sample_iterator = samples.begin(); sample_iterator != samples.end(); ++sample_iterator) {
+      comparisons.emplace_back(new siteComparison(scaffold_ids, expected_logs[sample_iterator->expected_path], indel_distances, all_indel_distances, depth_profile));
+      siteComparison *comparison = comparisons.back().get();
+      comparison->debug = debug;
+      comparison->fn_path = sample_iterator->output_prefix + "_FNs.tsv";
+      comparison->fp_path = sample_iterator->output_prefix + "_FPs.tsv";
+      comparison->tp_path = sample_iterator->output_prefix + "_TPs.tsv";
+      comparison->error_path = sample_iterator->output_prefix + "_ERs.tsv";
+      if (!indel_vcf_path.empty()) {
+         comparison->indel_dist_path = sample_iterator->output_prefix + "_indel_dists_all.tsv";
+      }
+      comparison->block_size = block_size;
+      comparison->openOutputs();
+      sample_iterator->comparison = comparison;
+      if (!sample_iterator->insnp_path.empty()) {
+         sample_iterator->insnp_file.open(sample_iterator->insnp_path);
+         if (!sample_iterator->insnp_file) {
+            cerr << "Unable to open in.snp output file " << sample_iterator->insnp_path << ", so not saving in.snp of sample " << sample_iterator->name << endl;
+            sample_iterator->insnp_path = "";
+         }
+      }
+   }
+
+   gzFile joint_vcf = joint_vcf_path == "-" ? gzdopen(0, "rb") : gzopen(joint_vcf_path.c_str(), "rb");
+   if (joint_vcf == NULL) {
+      cerr << "Error opening jointly genotyped VCF " << joint_vcf_path << ".  Quitting." << endl;
+      return 13;
+   }
+   gzbuffer(joint_vcf, 1048576);
+
+   //Scaffolds are compared as soon as the VCF moves past them, along with any
+   // preceding scaffolds (in .fai order, so by scaffold ID) without records:
+   vector<bool> compared(scaffold_ids.size(), 0);
+   uint32_t next_scaffold = 0;
+   const snpRecordStore no_records;
+   auto compareUpTo = [&](uint32_t scaffold_id) {
+      for (; next_scaffold < scaffold_id; next_scaffold++) {
+         if (compared[next_scaffold]) {
+            continue;
+         }
+         for (auto sample_iterator = samples.begin(); sample_iterator != samples.end(); ++sample_iterator) {
+            sample_iterator->comparison->compareScaffold(next_scaffold, scaffold_lengths[next_scaffold], no_records, 0, 0);
+         }
+         compared[next_scaffold] = 1;
+      }
+   };
+
+   cerr << "Classifying sites of all samples in jointly genotyped VCF " << joint_vcf_path << endl;
+   bool gatk_vcf = joint_caller.find("HC") != string::npos;
+   string vcfline, prev_scaffold = "";
+   uint32_t prev_scaffold_id = scaffoldIDs::missing;
+   bool header_seen = 0;
+   long gt_index = -1; //Like the awk scripts, keep the last GT index if a record lacks GT
+   vector<size_t> field_starts;
+   vector<string> alleles;
+   unsigned long num_records = 0;
+   while (true) {
+      bool more_lines = gzGetline(joint_vcf, vcfline);
+      size_t first_tab = more_lines ? vcfline.find('\t') : string::npos;
+      bool is_record = more_lines && !vcfline.empty() && vcfline[0] != '#' && first_tab != string::npos;
+      //Classify the previous scaffold once the VCF has moved past it:
+      if (!more_lines || (is_record && (vcfline.compare(0, first_tab, prev_scaffold) != 0 || prev_scaffold.length() != first_tab))) {
+         if (!prev_scaffold.empty()) {
+            if (prev_scaffold_id != scaffoldIDs::missing) {
+               if (indels_from_joint_vcf) {
+                  indel_distances.sortPositions(prev_scaffold_id);
+               }
+               if (compared[prev_scaffold_id]) {
+                  cerr << "Jointly genotyped VCF is not sorted in .fai scaffold order at scaffold " << prev_scaffold << ".  Quitting." << endl;
+                  gzclose(joint_vcf);
+                  return 14;
+               }
+               compareUpTo(prev_scaffold_id);
+               for (auto sample_iterator = samples.begin(); sample_iterator != samples.end(); ++sample_iterator) {
+                  sample_iterator->comparison->compareScaffold(prev_scaffold_id, scaffold_lengths[prev_scaffold_id], sample_iterator->records, 0, sample_iterator->records.size());
+               }
+               compared[prev_scaffold_id] = 1;
+            }
+            for (auto sample_iterator = samples.begin(); sample_iterator != samples.end(); ++sample_iterator) {
+               sample_iterator->records.clear();
+            }
+         }
+         if (!more_lines) {
+            break;
+         }
+         prev_scaffold = vcfline.substr(0, first_tab);
+         prev_scaffold_id = scaffold_ids.find(prev_scaffold);
+      }
+      if (!is_record) {
+         //Identify the column corresponding to each sample:
+         if (vcfline.compare(0, 6, "#CHROM") == 0) {
+            vector<string> header_vector = splitString(vcfline, '\t');
+            for (auto sample_iterator = samples.begin(); sample_iterator != samples.end(); ++sample_iterator) {
+               for (size_t i = 9; i < header_vector.size(); i++) {
+                  if (header_vector[i] == sample_iterator->name) {
+                     sample_iterator->column = i;
+                  }
+               }
+               if (sample_iterator->column == 0) {
+                  cerr << "Sample " << sample_iterator->name << " is not in jointly genotyped VCF " << joint_vcf_path << ".  Quitting." << endl;
+                  gzclose(joint_vcf);
+                  return 15;
+               }
+            }
+            header_seen = 1;
+         }
+         continue;
+      }
+      if (!header_seen) {
+         cerr << "Jointly genotyped VCF " << joint_vcf_path << " is missing its #CHROM header line.  Quitting." << endl;
+         gzclose(joint_vcf);
+         return 15;
+      }
+      num_records++;
+      if (indels_from_joint_vcf) {
+         indel_distances.addRecord(vcfline);
+      }
+      //Find the field boundaries once for all samples:
+      field_starts.clear();
+      field_starts.push_back(0);
+      for (size_t tab = vcfline.find('\t'); tab != string::npos; tab = vcfline.find('\t', tab + 1)) {
+         field_starts.push_back(tab + 1);
+      }
+      field_starts.push_back(vcfline.length() + 1);
+      if (field_starts.size() < 7) {
+         continue;
+      }
+      auto field = [&](size_t i) {
+         return i + 1 < field_starts.size() ? vcfline.substr(field_starts[i], field_starts[i+1] - field_starts[i] - 1) : string("");
+      };
+      string ref = field(3), alt = field(4);
+      //Only SNPs without insertion alleles, as in the VCFtoUnfilteredINSNP awk scripts:
+      alleles = splitString(alt, ',');
+      alleles.insert(alleles.begin(), ref);
+      bool has_insertion = 0;
+      for (auto allele_iterator = alleles.begin(); allele_iterator != alleles.end(); ++allele_iterator) {
+         if ((!gatk_vcf || *allele_iterator != "<NON_REF>") && *allele_iterator != "." && allele_iterator->length() > 1) {
+            has_insertion = 1;
+         }
+      }
+      if ((gatk_vcf && alt == "<NON_REF>") || alt == "." || ref.length() != 1 || alleles.size() < 2 || alleles[1].length() != 1 || has_insertion) {
+         continue;
+      }
+      //Identify the position of the genotype (GT) in the sample field:
+      vector<string> format = splitString(field(8), ':');
+      for (size_t i = 0; i < format.size(); i++) {
+         if (format[i] == "GT") {
+            gt_index = i;
+         }
+      }
+      string scaffold = field(0), position = field(1);
+      for (auto sample_iterator = samples.begin(); sample_iterator != samples.end(); ++sample_iterator) {
+         //Extract the genotype, and degenerate it into an IUPAC base:
+         vector<string> sample_field = splitString(field(sample_iterator->column), ':');
+         string genotype = gt_index >= 0 && (size_t)gt_index < sample_field.size() ? sample_field[gt_index] : "";
+         size_t separator = genotype.find_first_of("/|");
+         string allele1 = genotype.substr(0, separator);
+         string allele2 = separator == string::npos ? "" : genotype.substr(separator + 1, genotype.find_first_of("/|", separator + 1) - separator - 1);
+         string called_base = degenerateGenotype(genotypeAllele(alleles, allele1), genotypeAllele(alleles, allele2));
+         //Only keep variants:
+         if (called_base != ref) {
+            if (!sample_iterator->insnp_path.empty()) {
+               sample_iterator->insnp_file << scaffold << '\t' << position << '\t' << ref << '\t' << called_base << '\n';
+            }
+            if (called_base.empty()) {
+               called_base = "N";
+            }
+            sample_iterator->records.addAlleles(prev_scaffold_id, strtoul(position.c_str(), NULL, 10), ref.data(), ref.length(), called_base.data(), called_base.length());
+         }
+      }
+   }
+   gzclose(joint_vcf);
+   //Scaffolds after the last one in the VCF have no records:
+   compareUpTo(scaffold_ids.size());
+   cerr << "Done classifying " << num_records << " records of jointly genotyped VCF" << endl;
 
+   for (auto sample_iterator = samples.begin(); sample_iterator != samples.end(); ++sample_iterator) {
+      if (!sample_iterator->insnp_path.empty()) {
+         sample_iterator->insnp_file.close();
+      }
+      sample_iterator->comparison->finish(genome_size);
+      if (block_size > 0) {
+         sample_iterator->comparison->bootstrap(bootstrap_replicates, seed, num_threads);
+      }
+      ofstream report_file;
+      report_file.open(sample_iterator->output_prefix + "_compareSNPlogs.txt");
+      if (!report_file) {
+         cerr << "Unable to open comparison report for sample " << sample_iterator->name << ", so writing it to STDOUT." << endl;
+         cout << "Sample\t" << sample_iterator->name << endl;
+         sample_iterator->comparison->report(cout);
+      } else {
+         sample_iterator->comparison->report(report_file);
+         report_file.close();
+      }
+   }
+   return 0;
+}
 
 int main(int argc, char **argv) {
-   //Numbers to bases map:
-   char int2bases[] = {'A', 'C', 'G', 'T', 'N', 'M', 'R', 'W', 'S', 'Y', 'K'};
-   
    //Log file paths:
    string expected_path, observed_path, fai_path;
 
@@ -153,13 +3577,44 @@ int main(int argc, char **argv) {
    string tp_path = "";
    //Erroneous call output file path:
    string error_path = "";
-   
+   //VCF to find indel positions in, and output for indel distances of all in.snp sites:
+   string indel_vcf_path = "", indel_dist_path = "";
+   //Depth track, and output for site classes binned by depth:
+   string depth_track_path = "", depth_profile_path = "";
+   //Lower bounds of depth bins (each depth separately if empty):
+   vector<long> depth_bin_starts;
+   //Pseudoreference FASTA to score instead of an in.snp, the reference it was made from,
+   // and haplotype FASTAs to use as truth instead of the expected SNP log:
+   string pseudoref_path = "", reference_path = "", hap1_path = "", hap2_path = "";
+   //Jointly genotyped VCF to classify all samples of in one pass, the sample sheet,
+   // and the caller that made the VCF:
+   string joint_vcf_path = "", sample_sheet_path = "", joint_caller = "";
+   //All observed in.snps (compared to the truth and each other if there are several),
+   // their labels, and output for the classes of each site in each:
+   vector<string> observed_paths, callset_labels;
+   string concordance_sites_path = "";
+   //True (diploid) indel log to compare the indels of the VCF against, and output for the class of each indel:
+   string truth_indels_path = "", indel_classes_path = "";
+   //Merged SNP logs of the two haplotypes to score the phasing of the -x VCF against:
+   string hap1_log_path = "", hap2_log_path = "";
+   //Output for site classes binned by the sequence context of the reference:
+   string context_profile_path = "";
+   //Block width, number of replicates, PRNG seed, and threads for bootstrap confidence intervals:
+   unsigned long block_size = 0, bootstrap_replicates = 1000, seed = 42;
+   unsigned int num_threads = 1;
+   //Overlap reading, comparison, and writing of logs in .fai scaffold order:
+   bool pipeline_mode = 0;
+   //Output for the columnar table of every classified site:
+   string site_table_path = "";
+   //Fraction of genomic blocks to sample for estimated rates (0 compares everything):
+   double sample_fraction = 0;
+
    //Minimum depth to consider a SNP callable:
    unsigned long min_depth = 0;
-      
+
    //Option for debugging:
    bool debug = 0;
-   
+
    //Variables for getopt_long:
    int optchar;
    int structindex = 0;
@@ -174,12 +3629,38 @@ int main(int argc, char **argv) {
       {"output_tps", required_argument, 0, 't'},
       {"output_errors", required_argument, 0, 'r'},
       {"min_depth", required_argument, 0, 'm'},
+      {"indel_vcf", required_argument, 0, 'x'},
+      {"output_indel_dists", required_argument, 0, 'D'},
+      {"depth_track", required_argument, 0, 'c'},
+      {"output_depth_profile", required_argument, 0, 'B'},
+      {"depth_bins", required_argument, 0, 'b'},
+      {"pseudoref_fasta", required_argument, 0, 'f'},
+      {"reference_fasta", required_argument, 0, 'R'},
+      {"hap1_fasta", required_argument, 0, '1'},
+      {"hap2_fasta", required_argument, 0, '2'},
+      {"joint_vcf", required_argument, 0, 'j'},
+      {"sample_sheet", required_argument, 0, 's'},
+      {"joint_caller", required_argument, 0, 'C'},
+      {"callset_labels", required_argument, 0, 'L'},
+      {"output_concordance_sites", required_argument, 0, 'K'},
+      {"bootstrap_block", required_argument, 0, 'w'},
+      {"bootstrap_replicates", required_argument, 0, 'N'},
+      {"prng_seed", required_argument, 0, 'S'},
+      {"threads", required_argument, 0, 'T'},
+      {"truth_indels", required_argument, 0, 'I'},
+      {"output_indel_classes", required_argument, 0, 'G'},
+      {"pipeline", no_argument, 0, 'P'},
+      {"output_site_table", required_argument, 0, 'A'},
+      {"sample_fraction", required_argument, 0, 'F'},
+      {"hap1_snp_log", required_argument, 0, 'H'},
+      {"hap2_snp_log", required_argument, 0, 'J'},
+      {"output_context_profile", required_argument, 0, 'X'},
       {"debug", no_argument, 0, 'd'},
       {"version", no_argument, 0, 'v'},
       {"help", no_argument, 0, 'h'}
    };
    //Read in the options:
-   while ((optchar = getopt_long(argc, argv, "i:e:o:n:p:t:r:m:dvh", longoptions, &structindex)) > -1) {
+   while ((optchar = getopt_long(argc, argv, "i:e:o:n:p:t:r:m:x:D:c:B:b:f:R:1:2:j:s:C:L:K:w:N:S:T:I:G:PA:F:H:J:X:dvh", longoptions, &structindex)) > -1) {
       switch(optchar) {
          case 'i':
             cerr << "Using FASTA .fai index: " << optarg << endl;
@@ -191,7 +3672,8 @@ int main(int argc, char **argv) {
             break;
          case 'o':
             cerr << "Using observed in.snp: " << optarg << endl;
-            observed_path = optarg;
+            observed_paths.push_back(optarg);
+            observed_path = observed_paths.front();
             break;
          case 'n':
             cerr << "Outputting false negative sites to: " << optarg << endl;
@@ -213,6 +3695,116 @@ int main(int argc, char **argv) {
             cerr << "Ignoring true SNPs with raw depth less than " << optarg << endl;
             min_depth = stoul(optarg);
             break;
+         case 'x':
+            cerr << "Annotating distance to closest indel in VCF: " << optarg << endl;
+            indel_vcf_path = optarg;
+            break;
+         case 'D':
+            cerr << "Outputting closest indel distances of in.snp sites to: " << optarg << endl;
+            indel_dist_path = optarg;
+            break;
+         case 'c':
+            cerr << "Using depth track: " << optarg << endl;
+            depth_track_path = optarg;
+            break;
+         case 'B':
+            cerr << "Outputting site classes by depth to: " << optarg << endl;
+            depth_profile_path = optarg;
+            break;
+         case 'b':
+            cerr << "Using depth bins starting at: " << optarg << endl;
+            {
+               vector<string> bin_vector = splitString(optarg, ',');
+               for (auto bin_iterator = bin_vector.begin(); bin_iterator != bin_vector.end(); ++bin_iterator) {
+                  depth_bin_starts.push_back(stol(*bin_iterator));
+               }
+               sort(depth_bin_starts.begin(), depth_bin_starts.end());
+            }
+            break;
+         case 'f':
+            cerr << "Using pseudoreference FASTA: " << optarg << endl;
+            pseudoref_path = optarg;
+            break;
+         case 'R':
+            cerr << "Using reference FASTA: " << optarg << endl;
+            reference_path = optarg;
+            break;
+         case '1':
+            cerr << "Using haplotype 1 FASTA: " << optarg << endl;
+            hap1_path = optarg;
+            break;
+         case '2':
+            cerr << "Using haplotype 2 FASTA: " << optarg << endl;
+            hap2_path = optarg;
+            break;
+         case 'j':
+            cerr << "Using jointly genotyped VCF: " << optarg << endl;
+            joint_vcf_path = optarg;
+            break;
+         case 's':
+            cerr << "Using sample sheet: " << optarg << endl;
+            sample_sheet_path = optarg;
+            break;
+         case 'C':
+            cerr << "Jointly genotyped VCF is from caller: " << optarg << endl;
+            joint_caller = optarg;
+            break;
+         case 'L':
+            cerr << "Using callset labels: " << optarg << endl;
+            callset_labels = splitString(optarg, ',');
+            break;
+         case 'K':
+            cerr << "Outputting per-site concordance of callsets to: " << optarg << endl;
+            concordance_sites_path = optarg;
+            break;
+         case 'w':
+            cerr << "Bootstrapping error rates with blocks of " << optarg << " bp" << endl;
+            block_size = stoul(optarg);
+            break;
+         case 'N':
+            cerr << "Using " << optarg << " bootstrap replicates" << endl;
+            bootstrap_replicates = stoul(optarg);
+            break;
+         case 'S':
+            cerr << "Using PRNG seed " << optarg << endl;
+            seed = stoul(optarg);
+            break;
+         case 'T':
+            cerr << "Using " << optarg << " threads" << endl;
+            num_threads = stoul(optarg);
+            break;
+         case 'I':
+            cerr << "Comparing indels against true indel log: " << optarg << endl;
+            truth_indels_path = optarg;
+            break;
+         case 'G':
+            cerr << "Outputting classes of indels to: " << optarg << endl;
+            indel_classes_path = optarg;
+            break;
+         case 'P':
+            cerr << "Pipelining reading, comparison, and writing" << endl;
+            pipeline_mode = 1;
+            break;
+         case 'A':
+            cerr << "Outputting columnar table of classified sites to: " << optarg << endl;
+            site_table_path = optarg;
+            break;
+         case 'F':
+            cerr << "Sampling a fraction " << optarg << " of genomic blocks" << endl;
+            sample_fraction = stod(optarg);
+            break;
+         case 'H':
+            cerr << "Scoring phasing against haplotype 1 SNP log: " << optarg << endl;
+            hap1_log_path = optarg;
+            break;
+         case 'J':
+            cerr << "Scoring phasing against haplotype 2 SNP log: " << optarg << endl;
+            hap2_log_path = optarg;
+            break;
+         case 'X':
+            cerr << "Outputting site classes by sequence context to: " << optarg << endl;
+            context_profile_path = optarg;
+            break;
          case 'd':
             cerr << "Debugging mode enabled." << endl;
             debug = 1;
@@ -232,18 +3824,144 @@ int main(int argc, char **argv) {
             break;
       }
    }
-   
+
    //Ignore positional arguments
    if (optind < argc) {
       cerr << "Ignoring extra positional arguments starting at " << argv[optind++] << endl;
    }
-   
+
    //Check that log paths are set:
-   if (expected_path.empty() || observed_path.empty() || fai_path.empty()) {
+   bool joint_mode = !joint_vcf_path.empty();
+   bool pseudoref_mode = !pseudoref_path.empty();
+   bool hap_truth = !hap1_path.empty() || !hap2_path.empty();
+   bool concordance_mode = observed_paths.size() > 1;
+   if (num_threads == 0) {
+      num_threads = 1;
+   }
+   if (concordance_mode && (joint_mode || pseudoref_mode)) {
+      cerr << "Multiple observed in.snps can't be combined with a joint VCF or pseudoreference FASTA.  Quitting." << endl;
+      return 2;
+   }
+   if (concordance_mode) {
+      if (!fn_path.empty() || !fp_path.empty() || !tp_path.empty() || !error_path.empty() || !indel_dist_path.empty() || !depth_profile_path.empty()) {
+         cerr << "Comparing multiple callsets, so ignoring -n, -p, -t, -r, -D, and -B." << endl;
+      }
+      if (block_size > 0) {
+         cerr << "Bootstrap confidence intervals are not available when comparing multiple callsets, so ignoring -w." << endl;
+      }
+      if (!callset_labels.empty() && callset_labels.size() != observed_paths.size()) {
+         cerr << "Number of callset labels does not match the number of observed in.snps, so using the in.snp paths as labels." << endl;
+         callset_labels.clear();
+      }
+      if (callset_labels.empty()) {
+         callset_labels = observed_paths;
+      }
+   }
+   if (joint_mode) {
+      if (sample_sheet_path.empty() || fai_path.empty() || (joint_caller.find("HC") == string::npos && joint_caller.find("MPILEUP") == string::npos)) {
+         cerr << "Joint classification requires the .fai, the sample sheet, and the caller (HC or MPILEUP).  Quitting." << endl;
+         return 2;
+      }
+      if (pseudoref_mode) {
+         cerr << "Pseudoreference comparison is not available for jointly genotyped VCFs.  Quitting." << endl;
+         return 2;
+      }
+      if (!expected_path.empty() || !observed_path.empty() || !fn_path.empty() || !fp_path.empty() || !tp_path.empty() || !error_path.empty() || !indel_dist_path.empty()) {
+         cerr << "Inputs and outputs of each sample come from the sample sheet, so ignoring -e, -o, -n, -p, -t, -r, and -D." << endl;
+      }
+      if (!depth_track_path.empty() || !depth_profile_path.empty()) {
+         cerr << "Depth profiles are per-sample, so ignoring -c and -B for the jointly genotyped VCF." << endl;
+         depth_track_path = "";
+         depth_profile_path = "";
+      }
+   } else if (pseudoref_mode) {
+      if (!observed_path.empty()) {
+         cerr << "Scoring the pseudoreference FASTA, so ignoring the observed in.snp." << endl;
+         observed_path = "";
+      }
+      if (reference_path.empty() || fai_path.empty() || (hap_truth && (hap1_path.empty() || hap2_path.empty())) || hap_truth == !expected_path.empty()) {
+         cerr << "Pseudoreference comparison requires the .fai, the reference FASTA, and either the expected SNP log or both haplotype FASTAs.  Quitting." << endl;
+         return 2;
+      }
+      if (hap_truth && min_depth > 0) {
+         cerr << "No depths are available for haplotype FASTA truth, so ignoring the minimum callable depth." << endl;
+         min_depth = 0;
+      }
+   } else if (expected_path.empty() || observed_path.empty() || fai_path.empty()) {
       cerr << "Missing one of the input logs.  Quitting." << endl;
       return 2;
    }
-   
+   if (!truth_indels_path.empty()) {
+      if (joint_mode || concordance_mode) {
+         cerr << "Indels are only compared for a single callset, so ignoring -I." << endl;
+         truth_indels_path = "";
+      } else if (indel_vcf_path.empty() || reference_path.empty()) {
+         cerr << "Indel comparison requires the VCF of calls (-x) and the reference FASTA (-R), so ignoring -I." << endl;
+         truth_indels_path = "";
+      }
+   }
+   if (!site_table_path.empty() && (joint_mode || concordance_mode)) {
+      cerr << "The per-site table is only written for a single callset, so ignoring -A." << endl;
+      site_table_path = "";
+   }
+   bool sample_mode = sample_fraction > 0;
+   if (sample_mode && (joint_mode || pseudoref_mode || concordance_mode)) {
+      cerr << "Block sampling is only available for a single observed in.snp, so ignoring -F." << endl;
+      sample_mode = 0;
+   } else if (sample_mode && sample_fraction >= 1) {
+      cerr << "Sampling every block is a full comparison, so ignoring -F." << endl;
+      sample_mode = 0;
+   }
+   if (sample_mode) {
+      if (block_size > 0) {
+         cerr << "Using the -w block size for sampling instead of bootstrapping." << endl;
+      } else {
+         block_size = SAMPLE_BLOCK_SIZE;
+      }
+      if (pipeline_mode) {
+         cerr << "Sampled blocks are read by seeking, so ignoring -P." << endl;
+         pipeline_mode = 0;
+      }
+      if (!depth_track_path.empty() || !depth_profile_path.empty() || !context_profile_path.empty() || !truth_indels_path.empty() || !indel_classes_path.empty() || !hap1_log_path.empty() || !hap2_log_path.empty()) {
+         cerr << "Depth and sequence context profiles, indel comparison, and phasing cover the whole genome, so ignoring -c, -B, -X, -I, -G, -H, and -J when sampling blocks." << endl;
+         depth_track_path = "";
+         depth_profile_path = "";
+         context_profile_path = "";
+         truth_indels_path = "";
+         indel_classes_path = "";
+         hap1_log_path = "";
+         hap2_log_path = "";
+      }
+   }
+   if (pipeline_mode && (joint_mode || pseudoref_mode || concordance_mode)) {
+      cerr << "Pipelining is only available for a single observed in.snp, so ignoring -P." << endl;
+      pipeline_mode = 0;
+   }
+   if (!hap1_log_path.empty() || !hap2_log_path.empty()) {
+      if (joint_mode || concordance_mode) {
+         cerr << "Phasing is only scored for a single callset, so ignoring -H and -J." << endl;
+         hap1_log_path = "";
+         hap2_log_path = "";
+      } else if (hap1_log_path.empty() || hap2_log_path.empty() || indel_vcf_path.empty()) {
+         cerr << "Phasing comparison requires both haplotype SNP logs (-H and -J) and the VCF of calls (-x), so ignoring -H and -J." << endl;
+         hap1_log_path = "";
+         hap2_log_path = "";
+      }
+   }
+   if (!context_profile_path.empty()) {
+      if (joint_mode || concordance_mode) {
+         cerr << "Sequence context profiles are only made for a single callset, so ignoring -X." << endl;
+         context_profile_path = "";
+      } else if (reference_path.empty()) {
+         cerr << "Sequence context profile requires the reference FASTA (-R), so ignoring -X." << endl;
+         context_profile_path = "";
+      }
+   }
+   if (truth_indels_path.empty() && !indel_classes_path.empty()) {
+      cerr << "Indel class output requested without an indel comparison, so ignoring -G." << endl;
+      indel_classes_path = "";
+   }
+
    //Open the FASTA .fai index:
    ifstream fasta_fai;
    fasta_fai.open(fai_path);
@@ -251,412 +3969,263 @@ int main(int argc, char **argv) {
       cerr << "Error opening FASTA .fai index file " << fai_path << ".  Quitting." << endl;
       return 3;
    }
-   
-   //Read in the scaffold order and scaffold lengths from the .fai file:
-   vector<string> scaffolds;
-   map<string, unsigned long> scaffold_lengths;
+
+   //Read in the scaffold order and scaffold lengths from the .fai file, with scaffold IDs in .fai order:
+   scaffoldIDs scaffold_ids;
+   vector<unsigned long> scaffold_lengths;
    unsigned long genome_size = 0;
    string failine;
    while (getline(fasta_fai, failine)) {
       vector<string> line_vector;
       line_vector = splitString(failine, '\t');
-      scaffolds.push_back(line_vector[0]);
+      uint32_t scaffold_id = scaffold_ids.add(line_vector[0]);
       unsigned long scaffold_length = stoul(line_vector[1]);
-      scaffold_lengths[line_vector[0]] = scaffold_length;
+      if (scaffold_id == scaffold_lengths.size()) {
+         scaffold_lengths.push_back(scaffold_length);
+      } else {
+         scaffold_lengths[scaffold_id] = scaffold_length;
+      }
       genome_size += scaffold_length;
    }
    fasta_fai.close();
-   
-   //Open the expected SNP log:
-   ifstream expected;
-   expected.open(expected_path);
-   if (!expected) {
-      cerr << "Error opening expected SNP log " << expected_path << ".  Quitting." << endl;
-      return 5;
+
+   if (joint_mode) {
+      return compareJointVCF(joint_vcf_path, sample_sheet_path, joint_caller, indel_vcf_path, scaffold_ids, scaffold_lengths, genome_size, min_depth, block_size, bootstrap_replicates, seed, num_threads, debug);
    }
-   
-   //Open the observed in.snp file:
-   ifstream observed;
-   observed.open(observed_path);
-   if (!observed) {
-      cerr << "Error opening observed in.snp " << observed_path << ".  Quitting." << endl;
-      observed.close();
-      return 6;
+
+   expectedLog expected_log;
+   //A text expected SNP log is read alongside the comparison when pipelined:
+   bool stream_expected = pipeline_mode && !binarySNPlogReader::isBinarySNPlog(expected_path);
+   //Or only its records in the sampled blocks:
+   blockSample block_sample;
+   if (sample_mode) {
+      block_sample.draw(scaffold_lengths, sample_fraction, block_size, seed);
+      cerr << "Sampled " << block_sample.blocks.size() << " of " << block_sample.num_blocks << " blocks of " << block_size << " bp in " << block_sample.strata.size() << " strata" << endl;
    }
-   
-   //Read expected SNP log into map (keyed by scaffold) of vectors of 3-element arrays (pos, oldallele, newallele):
-   cerr << "Reading expected SNP log " << expected_path << endl;
-   map<string, vector<array<long, 3>>> expected_log;
-   unordered_set<string> uncallable_sites;
-   string eline;
-   while (getline(expected, eline)) {
-      vector<string> line_vector;
-      line_vector = splitString(eline, '\t');
-      long oldallele = baseToLong(line_vector[2]);
-      long newallele = baseToLong(line_vector[3]);
-      if (debug && (oldallele > 3 || newallele > 3)) {
-         cerr << "Found non-ACGT base in branch 1 SNP log at " << line_vector[0] << " position " << line_vector[1] << endl;
-      }
-      if (min_depth > 0) {
-         if (line_vector.size() < 5) {
-            cerr << "Error: Used non-zero minimum callable depth, but no depths provided in expected log." << endl;
-            observed.close();
-            expected.close();
-            return 7;
-         }
-         unsigned long curdepth = stoul(line_vector[4]);
-         if (curdepth < min_depth) { //Skip sites that wouldn't be callable based on the raw sequencing depth
-            uncallable_sites.insert(line_vector[0] + ":" + line_vector[1]);
-            continue;
+   if (!expected_path.empty() && !stream_expected) {
+      int expected_status = sample_mode ? expected_log.readSampled(expected_path, scaffold_ids, min_depth, debug, block_sample) : expected_log.read(expected_path, scaffold_ids, min_depth, debug);
+      if (expected_status != 0) {
+         return expected_status;
+      }
+   }
+
+   //Merge all of the callsets with the truth site by site:
+   if (concordance_mode) {
+      vector<snpRecordStore> observed_logs(observed_paths.size());
+      for (size_t i = 0; i < observed_paths.size(); i++) {
+         if (readObservedLog(observed_paths[i], scaffold_ids, observed_logs[i])) {
+            cerr << "Error opening observed in.snp " << observed_paths[i] << ".  Quitting." << endl;
+            return 6;
          }
       }
-      array<long, 3> log_record;
-      log_record[0] = stol(line_vector[1]);
-      log_record[1] = oldallele;
-      log_record[2] = newallele;
-      expected_log[line_vector[0]].push_back(log_record);
+      callsetConcordance concordance(scaffold_ids, expected_log, observed_logs);
+      concordance.labels = callset_labels;
+      concordance.sites_path = concordance_sites_path;
+      concordance.openOutput();
+      cerr << "Comparing " << observed_paths.size() << " callsets" << endl;
+      for (uint32_t scaffold_id = 0; scaffold_id < scaffold_ids.size(); scaffold_id++) {
+         concordance.compareScaffold(scaffold_id);
+      }
+      concordance.finish(genome_size);
+      cerr << "Done comparing callsets" << endl;
+      concordance.report(cout);
+      return 0;
    }
-   
-   expected.close();
-   cerr << "Done reading expected SNP log" << endl;
-   
-   //Read observed in.snp into map (keyed by scaffold) of vectors of 3-element arrays of strings (pos, oldallele, newallele):
-   cerr << "Reading observed in.snp file " << observed_path << endl;
-   map<string, vector<array<string, 3>>> observed_log;
-   string oline;
-   while (getline(observed, oline)) {
-      vector<string> line_vector;
-      line_vector = splitString(oline, '\t');
-      array<string, 3> log_record;
-      log_record[0] = line_vector[1];
-      log_record[1] = line_vector[2];
-      log_record[2] = line_vector[3];
-      observed_log[line_vector[0]].push_back(log_record);
-   }
-   
-   observed.close();
-   cerr << "Done reading observed in.snp file" << endl;
-   
-   //If the false negative output file path was input, open that up:
-   ofstream fn_file;
-   if (!fn_path.empty()) {
-      fn_file.open(fn_path);
-      if (!fn_file) {
-         cerr << "Unable to open false negative output file, so ignoring that function." << endl;
-         fn_path = "";
+
+   //Read the observed in.snp file:
+   snpRecordStore observed_log;
+   if (sample_mode) {
+      int observed_status = readObservedSampled(observed_path, scaffold_ids, block_sample, observed_log);
+      if (observed_status != 0) {
+         return observed_status;
       }
+   } else if (!pseudoref_mode && !pipeline_mode && readObservedLog(observed_path, scaffold_ids, observed_log)) {
+      cerr << "Error opening observed in.snp " << observed_path << ".  Quitting." << endl;
+      return 6;
    }
 
-   //If the false positive output file path was input, open that up:
-   ofstream fp_file;
-   if (!fp_path.empty()) {
-      fp_file.open(fp_path);
-      if (!fp_file) {
-         cerr << "Unable to open false positive output file, so ignoring that function." << endl;
-         fp_path = "";
+   //Open the FASTAs for pseudoreference comparison:
+   fastaScaffolds reference_fasta, pseudoref_fasta, hap1_fasta, hap2_fasta;
+   if (pseudoref_mode) {
+      if (reference_fasta.open(reference_path) || pseudoref_fasta.open(pseudoref_path) || (hap_truth && (hap1_fasta.open(hap1_path) || hap2_fasta.open(hap2_path)))) {
+         cerr << "Error opening one of the FASTAs for pseudoreference comparison.  Quitting." << endl;
+         return 9;
       }
    }
-   
-   //If the true positive output file path was input, open that up:
-   ofstream tp_file;
-   if (!tp_path.empty()) {
-      tp_file.open(tp_path);
-      if (!tp_file) {
-         cerr << "Unable to open true positive output file, so ignoring that function." << endl;
-         tp_path = "";
+
+   //Read the true indels, and compare the VCF's indels against them during the same pass as indel distances:
+   indelComparison indel_comparison(scaffold_ids);
+   if (!truth_indels_path.empty()) {
+      if (indel_comparison.readTruth(truth_indels_path)) {
+         cerr << "Error opening true indel log " << truth_indels_path << ".  Quitting." << endl;
+         return 16;
+      }
+      indel_comparison.classes_path = indel_classes_path;
+      indel_comparison.openOutput();
+      if (!pseudoref_mode && reference_fasta.open(reference_path)) {
+         cerr << "Error opening reference FASTA " << reference_path << " for indel comparison.  Quitting." << endl;
+         return 9;
       }
    }
-   
-   //If the erroneous call output file path was input, open that up:
-   ofstream error_file;
-   if (!error_path.empty()) {
-      error_file.open(error_path);
-      if (!error_file) {
-         cerr << "Unable to open erroneous call output file, so ignoring that function." << endl;
-         error_path = "";
+   //Bin the classified sites by the sequence context of the reference as each scaffold is compared:
+   contextProfile context_profile;
+   if (!context_profile_path.empty()) {
+      if (!pseudoref_mode && !indel_comparison.enabled && reference_fasta.open(reference_path)) {
+         cerr << "Error opening reference FASTA " << reference_path << " for sequence contexts.  Quitting." << endl;
+         return 9;
+      }
+      context_profile.enabled = 1;
+   }
+
+   //Read the SNPs of the haplotypes, and score the phasing of the VCF's heterozygous SNP calls against them:
+   phaseComparison phase_comparison(scaffold_ids);
+   if (!hap1_log_path.empty() && phase_comparison.readTruth(hap1_log_path, hap2_log_path)) {
+      cerr << "Error opening haplotype SNP logs " << hap1_log_path << " and " << hap2_log_path << ".  Quitting." << endl;
+      return 18;
+   }
+
+   //Read indel positions from the VCF if indel distances were requested:
+   indelDistances indel_distances(scaffold_ids);
+   indel_distances.indel_calls = indel_comparison.enabled ? &indel_comparison : nullptr;
+   indel_distances.phased_calls = phase_comparison.enabled ? &phase_comparison : nullptr;
+   if (!indel_dist_path.empty() && indel_vcf_path.empty()) {
+      cerr << "Indel distance output requested without a VCF (-x), so ignoring that function." << endl;
+      indel_dist_path = "";
+   }
+   if (!indel_vcf_path.empty()) {
+      cerr << "Reading indel positions from VCF " << indel_vcf_path << endl;
+      if (indel_distances.readVCF(indel_vcf_path)) {
+         cerr << "Error opening VCF " << indel_vcf_path << " for indel distances.  Quitting." << endl;
+         return 8;
       }
+      cerr << "Done reading indel positions from VCF" << endl;
+   }
+   //Collect classified sites for binning by depth if requested:
+   depthProfile depth_profile;
+   if (depth_track_path.empty() != depth_profile_path.empty()) {
+      cerr << "Depth profile requires both a depth track (-c) and an output (-B), so ignoring that function." << endl;
+   } else if (!depth_track_path.empty()) {
+      depth_profile.enabled = 1;
+      depth_profile.bin_starts = depth_bin_starts;
+   }
+   //Distances for all in.snp sites get their own cursors, since they're output interleaved with the class logs:
+   indel_distances.indel_calls = nullptr;
+   indel_distances.phased_calls = nullptr;
+   indelDistances all_indel_distances = indel_distances;
+
+   siteComparison comparison(scaffold_ids, expected_log, indel_distances, all_indel_distances, depth_profile);
+   comparison.debug = debug;
+   comparison.context_profile = &context_profile;
+   comparison.fn_path = fn_path;
+   comparison.fp_path = fp_path;
+   comparison.tp_path = tp_path;
+   comparison.error_path = error_path;
+   comparison.indel_dist_path = indel_dist_path;
+   comparison.site_table_path = site_table_path;
+   comparison.block_size = block_size;
+   if (sample_mode) {
+      comparison.sampleBlocks(block_sample);
    }
-      
+   comparison.openOutputs();
+
    //Now iterate over scaffolds, counting FP and FN variant calls, ignoring masking and indels in in.snp:
-   cerr << "Comparing SNP logs" << endl;
-   unsigned long tps = 0, fps = 0, tns = 0, fns = 0, wrong_calls = 0;
-   //Further categorize into match and mismatch types (first letter is call, second is truth, R=ref, H=het, A=alt):
-   unsigned long masked_bases = 0, indel_sites = 0;
-   unsigned long RR_match = 0, RH_mismatch = 0, RA_mismatch = 0;
-   unsigned long HR_mismatch = 0, HH_match = 0, HH_mismatch = 0, HA_mismatch = 0;
-   unsigned long AR_mismatch = 0, AH_mismatch = 0, AA_match = 0, AA_mismatch = 0;
-   unsigned long NR_masked = 0, NH_masked = 0, NA_masked = 0;
-   unsigned long IR_masked = 0, IH_masked = 0, IA_masked = 0;
-   for (auto scaffold_iterator = scaffolds.begin(); scaffold_iterator != scaffolds.end(); ++scaffold_iterator) {
-      unsigned long scaffold_tps = 0, scaffold_tns = 0, scaffold_fps = 0, scaffold_fns = 0, scaffold_wrong_calls = 0;
-      if (expected_log.count(*scaffold_iterator) == 0) {
-         if (observed_log.count(*scaffold_iterator) > 0) { //Scaffold is only represented in observed in.snp file
-            //Count false positives:
-            for (auto o_iterator = observed_log[*scaffold_iterator].begin(); o_iterator != observed_log[*scaffold_iterator].end(); ++o_iterator) {
-               //Skip indels or masked bases:
-               if ((*o_iterator)[1].length() > 1 || (*o_iterator)[2].length() > 1) {
-                  indel_sites += 1; //Directly at indel site, guaranteed to be ref since scaffold not in expected in.snp
-                  IR_masked += 1;
-                  continue;
-               } else if ((*o_iterator)[2] == "N") { //Not indel site, but masked (possibly in window around indel)
-                  masked_bases += 1;
-                  NR_masked += 1;
-                  continue;
-               }
-               if (baseToLong((*o_iterator)[2]) > 4) { //Het call, truth is hom ref
-                  HR_mismatch += 1;
-               } else { //Hom alt call, truth is hom ref
-                  AR_mismatch += 1;
-               }
-               scaffold_fps += 2; //Every non-N, non-indel record in observed in.snp not in the expected SNP log is an FP
-               if (!fp_path.empty()) { //Record false positive site to log if requested
-                  fp_file << *scaffold_iterator << '\t' << (*o_iterator)[0] << '\t' << (*o_iterator)[1] << '\t' << (*o_iterator)[2] << endl;
-               }
-            }
+   cerr << (pseudoref_mode ? "Comparing pseudoreference FASTA" : "Comparing SNP logs") << endl;
+   if (pipeline_mode) {
+      int pipeline_status = comparePipelined(expected_path, observed_path, stream_expected, scaffold_ids, scaffold_lengths, min_depth, debug, expected_log, comparison, indel_comparison, phase_comparison, context_profile, reference_fasta);
+      if (pipeline_status != 0) {
+         return pipeline_status;
+      }
+   }
+   for (uint32_t scaffold_id = 0; !pipeline_mode && scaffold_id < scaffold_ids.size(); scaffold_id++) {
+      const string &scaffold = scaffold_ids.name(scaffold_id);
+      if (phase_comparison.enabled) {
+         phase_comparison.compareScaffold(scaffold_id);
+      }
+      if (pseudoref_mode) { //Classify every base of the scaffold
+         string ref_sequence, call_sequence, truth_sequence, hap2_sequence;
+         if (reference_fasta.get(scaffold, ref_sequence) || pseudoref_fasta.get(scaffold, call_sequence) || (hap_truth && (hap1_fasta.get(scaffold, truth_sequence) || hap2_fasta.get(scaffold, hap2_sequence)))) {
+            cerr << "Scaffold " << scaffold << " is missing from one of the FASTAs.  Quitting." << endl;
+            return 10;
          }
-      } else if (observed_log.count(*scaffold_iterator) == 0) { //Scaffold must be represented in expected SNP log
-         //Count false negatives:
-         for (auto e_iterator = expected_log[*scaffold_iterator].begin(); e_iterator != expected_log[*scaffold_iterator].end(); ++e_iterator) {
-            if ((*e_iterator)[2] > 4) { //Hom ref call, truth is het
-               RH_mismatch += 1;
-            } else { //Hom ref call, truth is hom alt
-               RA_mismatch += 1;
-            }
-            scaffold_fns += 2; //Every record in the expected SNP log not in the observed in.snp file is a false negative
-            if (!fn_path.empty()) { //Record false negative site to log if requested
-               fn_file << *scaffold_iterator << '\t' << (*e_iterator)[0] << '\t' << int2bases[(*e_iterator)[1]] << '\t' << int2bases[(*e_iterator)[2]] << endl;
-            }
-         }
-      } else { //Scaffold is represented in both logs, so compare contents:
-         auto e_iterator = expected_log[*scaffold_iterator].begin();
-         auto o_iterator = observed_log[*scaffold_iterator].begin();
-         while (e_iterator != expected_log[*scaffold_iterator].end() && o_iterator != observed_log[*scaffold_iterator].end()) {
-            if ((*e_iterator)[0] < stol((*o_iterator)[0])) { //Observed in.snp file is missing this SNP
-               if ((*e_iterator)[2] > 4) { //Hom ref call, truth is het
-                  RH_mismatch += 1;
-               } else { //Hom ref call, truth is hom alt
-                  RA_mismatch += 1;
-               }
-               //Count false negative:
-               scaffold_fns += 2;
-               if (!fn_path.empty()) { //Record false negative site to log if requested
-                  fn_file << *scaffold_iterator << '\t' << (*e_iterator)[0] << '\t' << int2bases[(*e_iterator)[1]] << '\t' << int2bases[(*e_iterator)[2]] << endl;
-               }
-               ++e_iterator;
-            } else if ((*e_iterator)[0] > stol((*o_iterator)[0])) { //Expected SNP log does not contain this SNP
-               if ((*o_iterator)[1].length() > 1 || (*o_iterator)[2].length() > 1) { //Indel getting masked
-                  IR_masked += 1;
-                  indel_sites += 1;
-               } else if ((*o_iterator)[2] == "N") { //Masked base
-                  NR_masked += 1;
-                  masked_bases += 1;
-               } else if (baseToLong((*o_iterator)[2]) > 4) { //Het call, truth is hom ref
-                  HR_mismatch += 1;
-               } else { //Hom alt call, truth is hom ref
-                  AR_mismatch += 1;
-               }
-               if (uncallable_sites.count(*scaffold_iterator + ":" + (*o_iterator)[0]) == 0) { //This is a callable site
-                  //Count false positive if non-indel and not masked:
-                  if ((*o_iterator)[1].length() == 1 && (*o_iterator)[2].length() == 1 && (*o_iterator)[2] != "N") {
-                     scaffold_fps += 2;
-                     if (!fp_path.empty()) { //Record false positive site to log if requested
-                        fp_file << *scaffold_iterator << '\t' << (*o_iterator)[0] << '\t' << (*o_iterator)[1] << '\t' << (*o_iterator)[2] << endl;
-                     }
-                  }
-               }
-               ++o_iterator;
-            } else { //Both files have this record, so compare the values
-               //Check that ref alleles match:
-               if (to_string(int2bases[(*e_iterator)[1]]) != (*o_iterator)[1] && debug) {
-                  cerr << "Ref alleles for site " << (*e_iterator)[0] << " on scaffold " << *scaffold_iterator << " do not match between SNP logs." << endl;
-                  cerr << "Expected SNP log says " << int2bases[(*e_iterator)[1]] << " while observed in.snp says " << (*o_iterator)[1] << endl;
-               }
-               //Compare the values:
-               if ((*e_iterator)[2] == baseToLong((*o_iterator)[2])) { //True positive
-                  if ((*e_iterator)[2] > 4) { //Matching het call
-                     HH_match += 1;
-                  } else { //Matching hom alt call
-                     AA_match += 1;
-                  }
-                  scaffold_tps += 2;
-                  if (!tp_path.empty()) { //Record true positive site to log if requested
-                     tp_file << *scaffold_iterator << '\t' << (*e_iterator)[0] << '\t' << int2bases[(*e_iterator)[2]] << '\t' << (*o_iterator)[2] << endl;
-                  }
-               } else if (baseToLong((*o_iterator)[2]) == 4) { //Masked base => false negative
-                  if ((*o_iterator)[1].length() > 1 || (*o_iterator)[2].length() > 1) { //Indel masking
-                     if ((*e_iterator)[2] > 4) { //Indel masked het site
-                        IH_masked += 1;
-                     } else { //Indel masked hom alt site
-                        IA_masked += 1;
-                     }
-                     indel_sites += 1;
-                  } else {
-                     if ((*e_iterator)[2] > 4) { //Masked het site
-                        NH_masked += 1;
-                     } else { //Masked hom alt site
-                        NA_masked += 1;
-                     }
-                     masked_bases += 1;
-                  }
-                  scaffold_fns += 2;
-                  if (!fn_path.empty()) { //Record false negative site to log if requested
-                     fn_file << *scaffold_iterator << '\t' << (*e_iterator)[0] << '\t' << int2bases[(*e_iterator)[1]] << '\t' << int2bases[(*e_iterator)[2]] << endl;
-                  }
-               } else { //Error (Does this count as FP or FN?)
-                  if ((*e_iterator)[2] > 4) { //Truth is het
-                     if (baseToLong((*o_iterator)[2]) > 4) { //Wrong het
-                        HH_mismatch += 1;
-                     } else { //Called hom alt, truth is het
-                        AH_mismatch += 1;
-                     }
-                  } else { //Truth is hom alt
-                     if (baseToLong((*o_iterator)[2]) > 4) { //Called het, truth is hom alt
-                        HA_mismatch += 1;
-                     } else { //Wrong hom alt
-                        AA_mismatch += 1;
-                     }
-                  }
-                  //Split the expected and observed bases into two:
-                  vector<long> x, y;
-                  splitBase((*e_iterator)[2], x);
-                  splitBase(baseToLong((*o_iterator)[2]), y);
-                  long ref_base = (*e_iterator)[1];
-                  if (y[0] == x[0] || y[0] == x[1] || y[1] == x[0] || y[1] == x[1]) { //At least one match, so add a tp
-                     scaffold_tps++;
-                     if (y[0] == x[0] || y[0] == x[1]) { //Condition on y0 being the base that matched
-                        if (y[1] == ref_base) {
-                           scaffold_fns++;
-                        } else {
-                           scaffold_wrong_calls++;
-                        }
-                     } else { //Condition on y1 being the base that matched
-                        if (y[1] == ref_base) {
-                           scaffold_fns++;
-                        } else {
-                           scaffold_wrong_calls++;
-                        }
-                     }
-                  } else if (y[0] == ref_base || y[1] == ref_base) {
-                     scaffold_fns++;
-                     scaffold_wrong_calls++;
-                  } else {
-                     scaffold_wrong_calls += 2;
-                  }
-                  if (!error_path.empty()) { //Record erroneous call site to log if requested
-                     error_file << *scaffold_iterator << '\t' << (*e_iterator)[0] << '\t' << int2bases[(*e_iterator)[2]] << '\t' << (*o_iterator)[2] << endl;
-                  }
-               }
-               ++e_iterator;
-               ++o_iterator;
-            }
+         int pseudoref_status = comparison.comparePseudorefScaffold(scaffold_id, scaffold_lengths[scaffold_id], ref_sequence, call_sequence, truth_sequence, hap2_sequence, hap_truth);
+         if (pseudoref_status != 0) {
+            return pseudoref_status;
          }
-         //Count the remainder of the scaffold from whichever log still hasn't reached its end:
-         while (e_iterator != expected_log[*scaffold_iterator].end()) {
-            if ((*e_iterator)[2] > 4) { //Called hom ref, truth is het
-               RH_mismatch += 1;
-            } else { //Called hom ref, truth is hom alt
-               RA_mismatch += 1;
-            }
-            //Count false negatives:
-            scaffold_fns += 2;
-            if (!fn_path.empty()) { //Record false negative site to log if requested
-               fn_file << *scaffold_iterator << '\t' << (*e_iterator)[0] << '\t' << int2bases[(*e_iterator)[1]] << '\t' << int2bases[(*e_iterator)[2]] << endl;
-            }
-            ++e_iterator;
+         if (context_profile.enabled) {
+            context_profile.countScaffold(scaffold_id, ref_sequence);
          }
-         while (o_iterator != observed_log[*scaffold_iterator].end()) {
-            if ((*o_iterator)[1].length() > 1 || (*o_iterator)[2].length() > 1) { //Indel masked hom ref
-               IR_masked += 1;
-               indel_sites += 1;
-            } else if ((*o_iterator)[2] == "N") { //Masked hom ref
-               NR_masked += 1;
-               masked_bases += 1;
-            } else if (baseToLong((*o_iterator)[2]) > 4) { //Called het, truth is hom ref
-               HR_mismatch += 1;
-            } else { //Called hom alt, truth is hom ref
-               AR_mismatch += 1;
+         if (indel_comparison.enabled) {
+            indel_comparison.compareScaffold(scaffold_id, ref_sequence);
+         }
+      } else if (!sample_mode || !block_sample.ranges[scaffold_id].empty()) {
+         comparison.compareScaffold(scaffold_id, scaffold_lengths[scaffold_id], observed_log, observed_log.begin(scaffold_id), observed_log.end(scaffold_id));
+         if (indel_comparison.enabled || context_profile.enabled) {
+            string ref_sequence;
+            if (reference_fasta.get(scaffold, ref_sequence)) {
+               cerr << "Scaffold " << scaffold << " is missing from the reference FASTA.  Quitting." << endl;
+               return 10;
             }
-            //Count false positive if non-indel and not masked:
-            if (uncallable_sites.count(*scaffold_iterator + ":" + (*o_iterator)[0]) == 0) { //This is a callable site
-               if ((*o_iterator)[1].length() == 1 && (*o_iterator)[2].length() == 1 && (*o_iterator)[2] != "N") {
-                  scaffold_fps += 2;
-                  if (!fp_path.empty()) { //Record false positive site to log if requested
-                     fp_file << *scaffold_iterator << '\t' << (*o_iterator)[0] << '\t' << (*o_iterator)[1] << '\t' << (*o_iterator)[2] << endl;
-                  }
-               }
+            context_profile.countScaffold(scaffold_id, ref_sequence);
+            if (indel_comparison.enabled) {
+               indel_comparison.compareScaffold(scaffold_id, ref_sequence);
             }
-            ++o_iterator;
          }
       }
-      tps += scaffold_tps;
-      fps += scaffold_fps;
-      fns += scaffold_fns;
-      wrong_calls += scaffold_wrong_calls;
-      scaffold_tns = 2*scaffold_lengths[*scaffold_iterator] - scaffold_tps - scaffold_fns - scaffold_wrong_calls - scaffold_fps;
-      tns += scaffold_tns;
    }
-   tns -= 2*uncallable_sites.size(); //Don't count uncallable sites as anything, including TN.
-   unsigned long R_mismatches = RH_mismatch + RA_mismatch;
-   unsigned long H_mismatches = HR_mismatch + HH_mismatch + HA_mismatch;
-   unsigned long A_mismatches = AR_mismatch + AH_mismatch + AA_mismatch;
-   unsigned long mismatches = R_mismatches + H_mismatches + A_mismatches;
-   RR_match = genome_size - indel_sites - masked_bases - mismatches - HH_match - AA_match;
-   if (!fn_path.empty()) {
-      fn_file.close();
+   //Counts below the rates in the report only cover the sampled blocks:
+   comparison.finish(sample_mode ? block_sample.sampled_bases : genome_size);
+   indel_comparison.finish();
+   if (sample_mode) {
+      comparison.estimate();
+   } else if (block_size > 0) {
+      cerr << "Bootstrapping error rates with " << bootstrap_replicates << " replicates" << endl;
+      comparison.bootstrap(bootstrap_replicates, seed, num_threads);
    }
-   if (!fp_path.empty()) {
-      fp_file.close();
+   reference_fasta.close();
+   if (pseudoref_mode) {
+      pseudoref_fasta.close();
+      hap1_fasta.close();
+      hap2_fasta.close();
    }
-   if (!tp_path.empty()) {
-      tp_file.close();
+   cerr << (pseudoref_mode ? "Done comparing pseudoreference FASTA" : "Done comparing SNP logs") << endl;
+
+   //Merge-join the classified sites with the depth track:
+   if (depth_profile.enabled) {
+      cerr << "Binning site classes by depth from depth track " << depth_track_path << endl;
+      int depth_status = depth_profile.readDepths(depth_track_path, scaffold_ids, genome_size);
+      if (depth_status == 2) {
+         return 19;
+      } else if (depth_status != 0) {
+         cerr << "Error opening depth track " << depth_track_path << ", so skipping depth profile." << endl;
+      } else {
+         ofstream depth_profile_file;
+         depth_profile_file.open(depth_profile_path);
+         if (!depth_profile_file) {
+            cerr << "Unable to open depth profile output file, so skipping depth profile." << endl;
+         } else {
+            depth_profile.write(depth_profile_file);
+            depth_profile_file.close();
+         }
+      }
+   }
+   if (context_profile.enabled) {
+      ofstream context_profile_file;
+      context_profile_file.open(context_profile_path);
+      if (!context_profile_file) {
+         cerr << "Unable to open sequence context profile output file, so skipping sequence context profile." << endl;
+      } else {
+         context_profile.write(context_profile_file);
+         context_profile_file.close();
+      }
    }
-   cerr << "Done comparing SNP logs" << endl;
-   
-   cout << setprecision(15);
-   cout << "True positives\t" << (double)tps/2.0 << endl;
-   cout << "False positives\t" << (double)fps/2.0 << endl;
-   cout << "True negatives\t" << (double)tns/2.0 << endl;
-   cout << "False negatives\t" << (double)fns/2.0 << endl;
-   cout << "Wrong calls\t" << (double)wrong_calls/2.0 << endl;
-   cout << "FPR\t" << (double)fps/(double)(fps+tns) << endl;
-   cout << "FNR\t" << (double)fns/(double)(fns+tps) << endl;
-   cout << "FNR+wrong\t" << (double)(fns+wrong_calls)/(double)(fns+wrong_calls+tps) << endl;
-   cout << "Wrong call rate (wrong calls out of all calls)\t" << (double)(wrong_calls)/(double)(wrong_calls+tps+fps) << endl;
-   cout << "Sensitivity\t" << (double)tps/(double)(tps+fns) << endl;
-   cout << "Specificity\t" << (double)tns/(double)(tns+fps) << endl;
-   cout << "FDR\t" << (double)fps/(double)(tps+fps) << endl;
-   cout << endl;
-   cout << "Call types:" << endl;
-   cout << "Masked\t" << (double)masked_bases << endl;
-   cout << "Indel site\t" << (double)indel_sites << endl;
-   cout << "Homozygous ref\t" << (double)(RR_match + R_mismatches) << endl;
-   cout << "Heterozygous\t" << (double)(HH_match + H_mismatches) << endl;
-   cout << "Homozygous alt\t" << (double)(AA_match + A_mismatches) << endl;
-   cout << endl;
-   cout << "Matches:" << endl;
-   cout << "Homozygous ref\t" << (double)RR_match << endl;
-   cout << "Heterozygous\t" << (double)HH_match << endl;
-   cout << "Homozygous alt\t" << (double)AA_match << endl;
-   cout << endl;
-   cout << "Mismatches:" << endl;
-   cout << "Het->RR\t" << (double)RH_mismatch << endl;
-   cout << "Alt->RR\t" << (double)RA_mismatch << endl;
-   cout << "RR->Het\t" << (double)HR_mismatch << endl;
-   cout << "Het->Other Het\t" << (double)HH_mismatch << endl;
-   cout << "Alt->Het\t" << (double)HA_mismatch << endl;
-   cout << "RR->Alt\t" << (double)AR_mismatch << endl;
-   cout << "Het->Alt\t" << (double)AH_mismatch << endl;
-   cout << "Alt->Other Alt\t" << (double)AA_mismatch << endl;
-   cout << endl;
-   cout << "Masking:" << endl;
-   cout << "RR->N\t" << (double)NR_masked << endl;
-   cout << "Het->N\t" << (double)NH_masked << endl;
-   cout << "Alt->N\t" << (double)NA_masked << endl;
-   cout << endl;
-   cout << "Indel Sites:" << endl;
-   cout << "RR->Indel\t" << (double)IR_masked << endl;
-   cout << "Het->Indel\t" << (double)IH_masked << endl;
-   cout << "Alt->Indel\t" << (double)IA_masked << endl;
-   
+
+   comparison.report(cout);
+   if (indel_comparison.enabled) {
+      indel_comparison.report(cout);
+   }
+   if (phase_comparison.enabled) {
+      phase_comparison.report(cout);
+   }
+
    return 0;
 }
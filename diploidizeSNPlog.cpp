@@ -2,9 +2,13 @@
  * diploidizeSNPlog.cpp                                                           *
  * Written by Patrick Reilly                                                      *
  * Version 1.0 written 2017/01/23                                                 *
+ * Version 1.1 written 2026/10/18 Diploid indel log with zygosity                 *
+ * Version 1.2 written 2026/10/18 Interned scaffold IDs and columnar SNP records   *
  * Description:                                                                   *
  *                                                                                *
  * Syntax: diploidizeSNPlog [haploid 1 merged SNP log] [haploid 2 merged SNP log] *
+ *         -A [haploid 1 merged indel log] -B [haploid 2 merged indel log]        *
+ *         -o [output diploid indel log]                                          *
  **********************************************************************************/
 
 #include <iostream>
@@ -13,9 +17,10 @@
 #include <getopt.h>
 #include <cctype>
 #include <vector>
-#include <map>
 #include <sstream>
-#include <array>
+#include <algorithm>
+#include <cstdlib>
+#include "snpLogStore.h"
 
 //Define constants for getopt:
 #define no_argument 0
@@ -23,10 +28,10 @@
 #define optional_argument 2
 
 //Version:
-#define VERSION "1.0"
+#define VERSION "1.2"
 
 //Usage/help:
-#define USAGE "diploidizeSNPlog\nUsage:\n diploidizeSNPlog -i [FASTA .fai] -a [haploid 1 merged SNP log] -b [haploid 2 merged SNP log]\n"
+#define USAGE "diploidizeSNPlog\nUsage:\n diploidizeSNPlog -i [FASTA .fai] -a [haploid 1 merged SNP log] -b [haploid 2 merged SNP log]\n\t-A [haploid 1 merged indel log] -B [haploid 2 merged indel log]\n\t-o [output diploid indel log]\n"
 
 using namespace std;
 
@@ -40,8 +45,8 @@ vector<string> splitString(string line_to_split, char delimiter) {
    return line_vector;
 }
 
-long baseToLong(string &base) {
-   switch(base[0]) {
+long baseToLong(char base) {
+   switch(base) {
       case 'A':
       case 'a':
          return 0;
@@ -81,12 +86,104 @@ long degenerateBases(long a, long b) {
    }
 }
 
+//Read a merged indel log into records grouped by the scaffold IDs of the .fai and sorted by
+// position, skipping scaffolds not in the .fai:
+bool readIndelLog(const string &indellog_path, scaffoldIDs &scaffold_ids, indelLogStore &indel_log) {
+   ifstream indellog;
+   indellog.open(indellog_path);
+   if (!indellog) {
+      return 1;
+   }
+   indel_log.read(indellog, scaffold_ids, 0);
+   indellog.close();
+   return 0;
+}
+
+//Output an indel record with a 6th column giving the zygosity:
+void outputIndel(const string &scaffold, const indelLogRecord &indel, const char *zygosity, ostream &diploid_indel_log) {
+   diploid_indel_log << scaffold << '\t' << indel.position << '\t' << (indel.insertion ? "ins" : "del") << '\t' << indel.length << '\t' << indel.sequence << '\t' << zygosity << '\n';
+}
+
+//Output the indels of both haploids in .fai scaffold order, with a 6th column giving the zygosity:
+//Indels identical in both haploids are homozygous, and all others are heterozygous.
+void diploidizeIndelLogs(const scaffoldIDs &scaffold_ids, const indelLogStore &hap1_indels, const indelLogStore &hap2_indels, ostream &diploid_indel_log) {
+   for (uint32_t scaffold_id = 0; scaffold_id < scaffold_ids.size(); scaffold_id++) {
+      const string &scaffold = scaffold_ids.name(scaffold_id);
+      const vector<indelLogRecord> &h1 = hap1_indels.scaffolds[scaffold_id];
+      const vector<indelLogRecord> &h2 = hap2_indels.scaffolds[scaffold_id];
+      size_t i = 0, j = 0;
+      while (i < h1.size() || j < h2.size()) {
+         //Gather the indels of both haploids at the next position:
+         uint32_t position = i < h1.size() ? h1[i].position : h2[j].position;
+         if (j < h2.size() && h2[j].position < position) {
+            position = h2[j].position;
+         }
+         size_t h1_end = i, h2_end = j;
+         while (h1_end < h1.size() && h1[h1_end].position == position) {
+            h1_end++;
+         }
+         while (h2_end < h2.size() && h2[h2_end].position == position) {
+            h2_end++;
+         }
+         size_t h2_start = j;
+         vector<bool> h2_paired(h2_end - h2_start, 0);
+         for (; i < h1_end; i++) {
+            const char *zygosity = "het";
+            for (size_t k = h2_start; k < h2_end; k++) {
+               if (!h2_paired[k-h2_start] && h1[i] == h2[k]) {
+                  h2_paired[k-h2_start] = 1;
+                  zygosity = "hom";
+                  break;
+               }
+            }
+            outputIndel(scaffold, h1[i], zygosity, diploid_indel_log);
+         }
+         for (; j < h2_end; j++) {
+            if (!h2_paired[j-h2_start]) {
+               outputIndel(scaffold, h2[j], "het", diploid_indel_log);
+            }
+         }
+      }
+   }
+}
+
+//Read a merged SNP log into a store of allele codes grouped by scaffold ID, skipping scaffolds not in the .fai:
+bool readSNPlog(const string &snplog_path, const string &label, const scaffoldIDs &scaffold_ids, snpRecordStore &snp_log, bool debug) {
+   ifstream snplog;
+   snplog.open(snplog_path);
+   if (!snplog) {
+      return 1;
+   }
+   string logline;
+   size_t starts[4], ends[4];
+   while (getline(snplog, logline)) {
+      if (fieldBounds(logline, starts, ends, 4) < 4) {
+         continue;
+      }
+      uint32_t scaffold_id = scaffold_ids.find(logline, ends[0]);
+      if (scaffold_id == scaffoldIDs::missing) {
+         continue;
+      }
+      long oldallele = baseToLong(logline[starts[2]]);
+      long newallele = baseToLong(logline[starts[3]]);
+      if (debug && (oldallele > 3 || newallele > 3)) {
+         cerr << "Found non-ACGT base in " << label << " SNP log at " << logline.substr(0, ends[0]) << " position " << logline.substr(starts[1], ends[1] - starts[1]) << endl;
+      }
+      snp_log.add(scaffold_id, strtoul(logline.c_str() + starts[1], NULL, 10), oldallele, newallele);
+   }
+   snplog.close();
+   snp_log.group(scaffold_ids.size());
+   return 0;
+}
+
 int main(int argc, char **argv) {
    //Numbers to bases map:
    char int2bases[] = {'A', 'C', 'G', 'T', 'N', 'M', 'R', 'W', 'S', 'Y', 'K'};
    
    //Log file paths:
    string branch1snplog_path, branch2snplog_path, fai_path;
+   //Merged indel logs of each haploid, and output path for the diploid indel log:
+   string hap1indellog_path = "", hap2indellog_path = "", diploid_indellog_path = "";
    
    //Option for debugging:
    bool debug = 0;
@@ -100,12 +197,15 @@ int main(int argc, char **argv) {
       {"input_fai", required_argument, 0, 'i'},
       {"hap1_snp_log", required_argument, 0, 'a'},
       {"hap2_snp_log", required_argument, 0, 'b'},
+      {"hap1_indel_log", required_argument, 0, 'A'},
+      {"hap2_indel_log", required_argument, 0, 'B'},
+      {"output_indel_log", required_argument, 0, 'o'},
       {"debug", no_argument, 0, 'd'},
       {"version", no_argument, 0, 'v'},
       {"help", no_argument, 0, 'h'}
    };
    //Read in the options:
-   while ((optchar = getopt_long(argc, argv, "i:a:b:dvh", longoptions, &structindex)) > -1) {
+   while ((optchar = getopt_long(argc, argv, "i:a:b:A:B:o:dvh", longoptions, &structindex)) > -1) {
       switch(optchar) {
          case 'i':
             cerr << "Using FASTA .fai index: " << optarg << endl;
@@ -119,6 +219,18 @@ int main(int argc, char **argv) {
             cerr << "Using haploid 2 merged SNP log: " << optarg << endl;
             branch2snplog_path = optarg;
             break;
+         case 'A':
+            cerr << "Using haploid 1 merged indel log: " << optarg << endl;
+            hap1indellog_path = optarg;
+            break;
+         case 'B':
+            cerr << "Using haploid 2 merged indel log: " << optarg << endl;
+            hap2indellog_path = optarg;
+            break;
+         case 'o':
+            cerr << "Outputting diploid indel log to: " << optarg << endl;
+            diploid_indellog_path = optarg;
+            break;
          case 'd':
             cerr << "Debugging mode enabled." << endl;
             debug = 1;
@@ -149,6 +261,10 @@ int main(int argc, char **argv) {
       cerr << "Missing one of the input logs.  Quitting." << endl;
       return 2;
    }
+   if (!diploid_indellog_path.empty() && (hap1indellog_path.empty() || hap2indellog_path.empty())) {
+      cerr << "Diploidizing indel logs requires both merged indel logs (-A and -B), so ignoring that function." << endl;
+      diploid_indellog_path = "";
+   }
    
    //Open the FASTA .fai index:
    ifstream fasta_fai;
@@ -158,128 +274,95 @@ int main(int argc, char **argv) {
       return 3;
    }
    
-   //Read in the scaffold order from the .fai file:
-   vector<string> scaffolds;
+   //Intern the scaffold names in .fai order, which is also the output order:
+   scaffoldIDs scaffold_ids;
    string failine;
    while (getline(fasta_fai, failine)) {
-      vector<string> line_vector;
-      line_vector = splitString(failine, '\t');
-      scaffolds.push_back(line_vector[0]);
+      scaffold_ids.add(failine.substr(0, failine.find('\t')));
    }
    fasta_fai.close();
    
-   //Open the haploid 1 merged SNP log:
-   ifstream branch1_snp_log;
-   branch1_snp_log.open(branch1snplog_path);
-   if (!branch1_snp_log) {
+   //Read the haploid 1 merged SNP log:
+   cerr << "Reading haploid 1 merged SNP log " << branch1snplog_path << endl;
+   snpRecordStore branch1_log;
+   if (readSNPlog(branch1snplog_path, "haploid 1", scaffold_ids, branch1_log, debug)) {
       cerr << "Error opening haploid 1 merged SNP log " << branch1snplog_path << ".  Quitting." << endl;
       return 5;
    }
-   
-   //Open the haploid 2 merged SNP log:
-   ifstream branch2_snp_log;
-   branch2_snp_log.open(branch2snplog_path);
-   if (!branch2_snp_log) {
-      cerr << "Error opening haploid 2 merged SNP log " << branch2snplog_path << ".  Quitting." << endl;
-      branch1_snp_log.close();
-      return 6;
-   }
-   
-   //Read branch 1 log into map (keyed by scaffold) of vectors of 3-element arrays (pos, oldallele, newallele):
-   cerr << "Reading haploid 1 merged SNP log " << branch1snplog_path << endl;
-   map<string, vector<array<long, 3>>> branch1_log;
-   string b1line;
-   while (getline(branch1_snp_log, b1line)) {
-      vector<string> line_vector;
-      line_vector = splitString(b1line, '\t');
-      long oldallele = baseToLong(line_vector[2]);
-      long newallele = baseToLong(line_vector[3]);
-      if (debug && (oldallele > 3 || newallele > 3)) {
-         cerr << "Found non-ACGT base in branch 1 SNP log at " << line_vector[0] << " position " << line_vector[1] << endl;
-      }
-      array<long, 3> log_record;
-      log_record[0] = stoul(line_vector[1]);
-      log_record[1] = oldallele;
-      log_record[2] = newallele;
-      branch1_log[line_vector[0]].push_back(log_record);
-   }
-   
-   branch1_snp_log.close();
    cerr << "Done reading haploid 1 merged SNP log" << endl;
    
-   //Read branch 2 log into map (keyed by scaffold) of vectors of 3-element arrays (pos, oldallele, newallele):
+   //Read the haploid 2 merged SNP log:
    cerr << "Reading haploid 2 merged SNP log " << branch2snplog_path << endl;
-   map<string, vector<array<long, 3>>> branch2_log;
-   string b2line;
-   while (getline(branch2_snp_log, b2line)) {
-      vector<string> line_vector;
-      line_vector = splitString(b2line, '\t');
-      long oldallele = baseToLong(line_vector[2]);
-      long newallele = baseToLong(line_vector[3]);
-      if (debug && (oldallele > 3 || newallele > 3)) {
-         cerr << "Found non-ACGT base in branch 1 SNP log at " << line_vector[0] << " position " << line_vector[1] << endl;
-      }
-      array<long, 3> log_record;
-      log_record[0] = stoul(line_vector[1]);
-      log_record[1] = oldallele;
-      log_record[2] = newallele;
-      branch2_log[line_vector[0]].push_back(log_record);
+   snpRecordStore branch2_log;
+   if (readSNPlog(branch2snplog_path, "haploid 2", scaffold_ids, branch2_log, debug)) {
+      cerr << "Error opening haploid 2 merged SNP log " << branch2snplog_path << ".  Quitting." << endl;
+      return 6;
    }
-   
-   branch2_snp_log.close();
    cerr << "Done reading haploid 2 merged SNP log" << endl;
    
    //Now iterate over scaffolds, outputting diploidized SNPs at any sites where either haploid deviates from ref:
    cerr << "Diploidizing SNP logs" << endl;
-   for (auto scaffold_iterator = scaffolds.begin(); scaffold_iterator != scaffolds.end(); ++scaffold_iterator) {
-      if (branch1_log.count(*scaffold_iterator) == 0) {
-         if (branch2_log.count(*scaffold_iterator) > 0) { //Scaffold is only represented in one of the two haploids
+   for (uint32_t scaffold_id = 0; scaffold_id < scaffold_ids.size(); scaffold_id++) {
+      const string &scaffold = scaffold_ids.name(scaffold_id);
+      auto outputRecord = [&](uint32_t position, uint8_t oldallele, long diploid_allele) {
+         cout << scaffold << '\t' << position << '\t' << int2bases[oldallele] << '\t' << int2bases[diploid_allele] << '\n';
+      };
+      size_t b1 = branch1_log.begin(scaffold_id), b1_end = branch1_log.end(scaffold_id);
+      size_t b2 = branch2_log.begin(scaffold_id), b2_end = branch2_log.end(scaffold_id);
+      while (b1 < b1_end && b2 < b2_end) {
+         if (branch1_log.positions[b1] < branch2_log.positions[b2]) {
+            //Output haploid 1/ref degenerate base:
+            outputRecord(branch1_log.positions[b1], branch1_log.old_alleles[b1], degenerateBases(branch1_log.new_alleles[b1], branch1_log.old_alleles[b1]));
+            b1++;
+         } else if (branch1_log.positions[b1] > branch2_log.positions[b2]) {
             //Output haploid 2/ref degenerate base:
-            for (auto b2_iterator = branch2_log[*scaffold_iterator].begin(); b2_iterator != branch2_log[*scaffold_iterator].end(); ++b2_iterator) {
-               cout << *scaffold_iterator << '\t' << (*b2_iterator)[0] << '\t' << int2bases[(*b2_iterator)[1]] << '\t' << int2bases[degenerateBases((*b2_iterator)[2], (*b2_iterator)[1])] << endl;
-            }
-         }
-      } else if (branch2_log.count(*scaffold_iterator) == 0) { //Scaffold must be represented in haploid 1
-         //Output haploid 1/ref degenerate base
-         for (auto b1_iterator = branch1_log[*scaffold_iterator].begin(); b1_iterator != branch1_log[*scaffold_iterator].end(); ++b1_iterator) {
-            cout << *scaffold_iterator << '\t' << (*b1_iterator)[0] << '\t' << int2bases[(*b1_iterator)[1]] << '\t' << int2bases[degenerateBases((*b1_iterator)[2], (*b1_iterator)[1])] << endl;
-         }
-      } else { //Scaffold is represented in both haploids, so diploidize the scaffold
-         auto b1_iterator = branch1_log[*scaffold_iterator].begin();
-         auto b2_iterator = branch2_log[*scaffold_iterator].begin();
-         while (b1_iterator != branch1_log[*scaffold_iterator].end() && b2_iterator != branch2_log[*scaffold_iterator].end()) {
-            if ((*b1_iterator)[0] < (*b2_iterator)[0]) {
-               //Output haploid 1/ref degenerate base:
-               cout << *scaffold_iterator << '\t' << (*b1_iterator)[0] << '\t' << int2bases[(*b1_iterator)[1]] << '\t' << int2bases[degenerateBases((*b1_iterator)[2], (*b1_iterator)[1])] << endl;
-               ++b1_iterator;
-            } else if ((*b1_iterator)[0] > (*b2_iterator)[0]) {
-               //Output haploid 2/ref degenerate base:
-               cout << *scaffold_iterator << '\t' << (*b2_iterator)[0] << '\t' << int2bases[(*b2_iterator)[1]] << '\t' << int2bases[degenerateBases((*b2_iterator)[2], (*b2_iterator)[1])] << endl;
-               ++b2_iterator;
-            } else {
-               //Check that ref alleles match:
-               if ((*b1_iterator)[1] != (*b2_iterator)[1]) {
-                  cerr << "Old alleles for site " << (*b1_iterator)[0] << " on scaffold " << *scaffold_iterator << " do not match between haploids." << endl;
-                  cerr << "Haploid 1 says " << int2bases[(*b1_iterator)[1]] << " while haploid 2 says " << int2bases[(*b2_iterator)[1]] << endl;
-               }
-               //Diploidize the SNP:
-               cout << *scaffold_iterator << '\t' << (*b1_iterator)[0] << '\t' << int2bases[(*b1_iterator)[1]] << '\t' << int2bases[degenerateBases((*b1_iterator)[2], (*b2_iterator)[2])] << endl;
-               ++b1_iterator;
-               ++b2_iterator;
+            outputRecord(branch2_log.positions[b2], branch2_log.old_alleles[b2], degenerateBases(branch2_log.new_alleles[b2], branch2_log.old_alleles[b2]));
+            b2++;
+         } else {
+            //Check that ref alleles match:
+            if (branch1_log.old_alleles[b1] != branch2_log.old_alleles[b2]) {
+               cerr << "Old alleles for site " << branch1_log.positions[b1] << " on scaffold " << scaffold << " do not match between haploids." << endl;
+               cerr << "Haploid 1 says " << int2bases[branch1_log.old_alleles[b1]] << " while haploid 2 says " << int2bases[branch2_log.old_alleles[b2]] << endl;
             }
-         }
-         //Output the remainder of the scaffold from whichever branch still hasn't reached its end:
-         while (b1_iterator != branch1_log[*scaffold_iterator].end()) {
-            cout << *scaffold_iterator << '\t' << (*b1_iterator)[0] << '\t' << int2bases[(*b1_iterator)[1]] << '\t' << int2bases[degenerateBases((*b1_iterator)[2], (*b1_iterator)[1])] << endl;
-            ++b1_iterator;
-         }
-         while (b2_iterator != branch2_log[*scaffold_iterator].end()) {
-            cout << *scaffold_iterator << '\t' << (*b2_iterator)[0] << '\t' << int2bases[(*b2_iterator)[1]] << '\t' << int2bases[degenerateBases((*b2_iterator)[2], (*b2_iterator)[1])] << endl;
-            ++b2_iterator;
+            //Diploidize the SNP:
+            outputRecord(branch1_log.positions[b1], branch1_log.old_alleles[b1], degenerateBases(branch1_log.new_alleles[b1], branch2_log.new_alleles[b2]));
+            b1++;
+            b2++;
          }
       }
+      //Output the remainder of the scaffold from whichever haploid still hasn't reached its end
+      // (all of it if the scaffold is only represented in one of the two haploids):
+      for (; b1 < b1_end; b1++) {
+         outputRecord(branch1_log.positions[b1], branch1_log.old_alleles[b1], degenerateBases(branch1_log.new_alleles[b1], branch1_log.old_alleles[b1]));
+      }
+      for (; b2 < b2_end; b2++) {
+         outputRecord(branch2_log.positions[b2], branch2_log.old_alleles[b2], degenerateBases(branch2_log.new_alleles[b2], branch2_log.old_alleles[b2]));
+      }
    }
    cerr << "Done diploidizing SNP logs" << endl;
    
+   //Diploidize the indel logs in the same scaffold order:
+   if (!diploid_indellog_path.empty()) {
+      indelLogStore hap1_indels, hap2_indels;
+      if (readIndelLog(hap1indellog_path, scaffold_ids, hap1_indels)) {
+         cerr << "Error opening haploid 1 merged indel log " << hap1indellog_path << ".  Quitting." << endl;
+         return 7;
+      }
+      if (readIndelLog(hap2indellog_path, scaffold_ids, hap2_indels)) {
+         cerr << "Error opening haploid 2 merged indel log " << hap2indellog_path << ".  Quitting." << endl;
+         return 8;
+      }
+      ofstream diploid_indel_log;
+      diploid_indel_log.open(diploid_indellog_path);
+      if (!diploid_indel_log) {
+         cerr << "Error opening diploid indel log " << diploid_indellog_path << ".  Quitting." << endl;
+         return 9;
+      }
+      cerr << "Diploidizing indel logs" << endl;
+      diploidizeIndelLogs(scaffold_ids, hap1_indels, hap2_indels, diploid_indel_log);
+      diploid_indel_log.close();
+      cerr << "Done diploidizing indel logs" << endl;
+   }
+   
    return 0;
 }
@@ -158,40 +158,60 @@ else
    exit 14;
 fi
 
-#Extract the header line into a separate file so we can later
-# delete the ALLSTATS file to save space:
-echo "Preserving header of stats file before parsing"
-echo "gzip -dc ${ALLSTATS} | head -n1 > ${INTPREFIX}_statHeader.tsv"
-gzip -dc ${ALLSTATS} | head -n1 > ${INTPREFIX}_statHeader.tsv
-
-#Subsetting VCF stats by site class:
-echo "Subsetting VCF stats by site class for ${INPUTVCF}"
-for i in "ER" "FN" "FP" "TN" "TP";
-   do
-   #Subset out only those ERs, FNs, FPs, TNs, and TPs in callable regions:
+#If partitionVCFstats was compiled, partition the stats by site class
+# in a single pass, also preserving the header:
+if [[ -x "${SCRIPTDIR}/partitionVCFstats" ]]; then
+   CALLABLEOPT=""
    if [[ -e "${CALLABLEBED}" ]]; then
-      echo "${SCRIPTDIR}/subsetVCFstats.pl -d -i <(gzip -dc ${ALLSTATS}) -b <(${BEDTOOLS} intersect -a ${CALLABLEBED} -b ${INTPREFIX}_${i}s.bed) 2> ${LOGPREFIX}_subsetVCFstats_${i}s.stderr | gzip -9 > ${INTPREFIX}_${i}_stats.tsv.gz"
-      ${SCRIPTDIR}/subsetVCFstats.pl -d -i <(gzip -dc ${ALLSTATS}) -b <(${BEDTOOLS} intersect -a ${CALLABLEBED} -b ${INTPREFIX}_${i}s.bed) 2> ${LOGPREFIX}_subsetVCFstats_${i}s.stderr | gzip -9 > ${INTPREFIX}_${i}_stats.tsv.gz
-      SUBSETCODE=$?
-      if [[ $SUBSETCODE -ne 0 ]]; then
-         echo "subsetVCFstats.pl of ${i}s failed for sample ${PREFIX} with exit code ${SUBSETCODE}"
-         exit 16;
-      fi
-   else
-      echo "${SCRIPTDIR}/subsetVCFstats.pl -d -i <(gzip -dc ${ALLSTATS}) -b ${INTPREFIX}_${i}s.bed 2> ${LOGPREFIX}_subsetVCFstats_${i}s.stderr | gzip -9 > ${INTPREFIX}_${i}_stats.tsv.gz"
-      ${SCRIPTDIR}/subsetVCFstats.pl -d -i <(gzip -dc ${ALLSTATS}) -b ${INTPREFIX}_${i}s.bed 2> ${LOGPREFIX}_subsetVCFstats_${i}s.stderr | gzip -9 > ${INTPREFIX}_${i}_stats.tsv.gz
-      SUBSETCODE=$?
-      if [[ $SUBSETCODE -ne 0 ]]; then
-         echo "subsetVCFstats.pl of ${i}s failed for sample ${PREFIX} with exit code ${SUBSETCODE}"
-         exit 16;
-      fi
+      CALLABLEOPT="-b ${CALLABLEBED}"
    fi
-done
+   echo "Partitioning VCF stats by site class for ${INPUTVCF}"
+   echo "${SCRIPTDIR}/partitionVCFstats -i ${ALLSTATS} -c ${INTPREFIX} ${CALLABLEOPT} -H ${INTPREFIX}_statHeader.tsv 2> ${LOGPREFIX}_partitionVCFstats.stderr"
+   ${SCRIPTDIR}/partitionVCFstats -i ${ALLSTATS} -c ${INTPREFIX} ${CALLABLEOPT} -H ${INTPREFIX}_statHeader.tsv 2> ${LOGPREFIX}_partitionVCFstats.stderr
+   PARTITIONCODE=$?
+   if [[ $PARTITIONCODE -ne 0 ]]; then
+      echo "partitionVCFstats failed for sample ${PREFIX} with exit code ${PARTITIONCODE}"
+      exit 16;
+   fi
+else
+   #Extract the header line into a separate file so we can later
+   # delete the ALLSTATS file to save space:
+   echo "Preserving header of stats file before parsing"
+   echo "gzip -dc ${ALLSTATS} | head -n1 > ${INTPREFIX}_statHeader.tsv"
+   gzip -dc ${ALLSTATS} | head -n1 > ${INTPREFIX}_statHeader.tsv
+
+   #Subsetting VCF stats by site class:
+   echo "Subsetting VCF stats by site class for ${INPUTVCF}"
+   for i in "ER" "FN" "FP" "TN" "TP";
+      do
+      #Subset out only those ERs, FNs, FPs, TNs, and TPs in callable regions:
+      if [[ -e "${CALLABLEBED}" ]]; then
+         echo "${SCRIPTDIR}/subsetVCFstats.pl -d -i <(gzip -dc ${ALLSTATS}) -b <(${BEDTOOLS} intersect -a ${CALLABLEBED} -b ${INTPREFIX}_${i}s.bed) 2> ${LOGPREFIX}_subsetVCFstats_${i}s.stderr | gzip -9 > ${INTPREFIX}_${i}_stats.tsv.gz"
+         ${SCRIPTDIR}/subsetVCFstats.pl -d -i <(gzip -dc ${ALLSTATS}) -b <(${BEDTOOLS} intersect -a ${CALLABLEBED} -b ${INTPREFIX}_${i}s.bed) 2> ${LOGPREFIX}_subsetVCFstats_${i}s.stderr | gzip -9 > ${INTPREFIX}_${i}_stats.tsv.gz
+         SUBSETCODE=$?
+         if [[ $SUBSETCODE -ne 0 ]]; then
+            echo "subsetVCFstats.pl of ${i}s failed for sample ${PREFIX} with exit code ${SUBSETCODE}"
+            exit 16;
+         fi
+      else
+         echo "${SCRIPTDIR}/subsetVCFstats.pl -d -i <(gzip -dc ${ALLSTATS}) -b ${INTPREFIX}_${i}s.bed 2> ${LOGPREFIX}_subsetVCFstats_${i}s.stderr | gzip -9 > ${INTPREFIX}_${i}_stats.tsv.gz"
+         ${SCRIPTDIR}/subsetVCFstats.pl -d -i <(gzip -dc ${ALLSTATS}) -b ${INTPREFIX}_${i}s.bed 2> ${LOGPREFIX}_subsetVCFstats_${i}s.stderr | gzip -9 > ${INTPREFIX}_${i}_stats.tsv.gz
+         SUBSETCODE=$?
+         if [[ $SUBSETCODE -ne 0 ]]; then
+            echo "subsetVCFstats.pl of ${i}s failed for sample ${PREFIX} with exit code ${SUBSETCODE}"
+            exit 16;
+         fi
+      fi
+   done
+fi
 
 #Give the user a note about how to construct histograms in Unix:
 echo "If you would like to construct a variable-size bin histogram, identify which column your statistic is in, and then use the following command:"
 echo "gzip -dc ${INTPREFIX}_[class]s_stats.tsv.gz | cut -f[stat_column_here] | sort | uniq -c > ${INTPREFIX}_[class]s.histo"
 echo 'Alternatively, run HC_histograms.awk or MPILEUP_histograms.awk with -v "stat=[stat_name_here]", and pipe the output to sort -k1,1g | uniq -c'
 echo 'Experimental alternative: stat_histograms.awk -v "stat=[stat_name_here]" -v "prefix=[basename of sample prefix]" [path to *_statHeader.tsv file] <(gzip -dc [path to *_allStats.tsv.gz file]) | sort -k1,1g | uniq -c'
+if [[ -x "${SCRIPTDIR}/statHistograms" ]]; then
+   echo "Or, for many statistics and all site classes at once: ${SCRIPTDIR}/statHistograms -H ${INTPREFIX}_statHeader.tsv -i ${INTPREFIX} -p ${PREFIX} -c ${CALLER} -s [comma-separated stat names] -o ${INTPREFIX}_stat_histograms.tsv"
+fi
 
 exit 0;
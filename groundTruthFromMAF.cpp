@@ -0,0 +1,512 @@
+/**********************************************************************************
+ * groundTruthFromMAF.cpp                                                         *
+ * Written by Patrick Reilly                                                      *
+ * Version 1.0 written 2026/10/18                                                 *
+ * Description:                                                                   *
+ *  Native replacement for groundTruthFromMAF.pl.  Extracts ground truth INSNPs   *
+ *  and aligned region BEDs in each species' coordinate space from a MAF of 1:1  *
+ *  alignments produced by LAST.  Alignment blocks are tokenized in place from   *
+ *  the mmapped MAF, and batches of blocks are processed by a pool of threads,   *
+ *  with output written in the original block order.                             *
+ *  With more than two species prefixes, an INSNP is written for each ordered    *
+ *  pair of species, in the first species' coordinate space.                      *
+ *                                                                                *
+ * Syntax: groundTruthFromMAF -i [MAF] -t [threads] [-b] <Species 1 prefix>       *
+ *         <Species 2 prefix> [Species 3 prefix ...]                              *
+ **********************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <getopt.h>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <sstream>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "binarySNPlog.h"
+
+//Define constants for getopt:
+#define no_argument 0
+#define required_argument 1
+#define optional_argument 2
+
+//Version:
+#define VERSION "1.0"
+
+//Usage/help:
+#define USAGE "groundTruthFromMAF\nUsage:\n groundTruthFromMAF [options] <Species 1 prefix> <Species 2 prefix> [Species 3 prefix ...]\n Options:\n  -i [MAF 1:1 alignment file, default STDIN]\n  -t [number of threads, default 1]\n  -b Output binary SNP logs (_INSNP.bin) instead of INSNP TSVs\n"
+
+//Number of alignment blocks processed as a unit by a thread:
+#define BATCH_BLOCKS 2048
+
+using namespace std;
+
+//A whitespace-delimited field of a MAF line, pointing into the MAF:
+struct token {
+   const char *start;
+   size_t length;
+   bool equals(const char *literal) const {
+      return length == strlen(literal) && memcmp(start, literal, length) == 0;
+   }
+};
+
+//An "s" line of an alignment block:
+struct aligned_seq {
+   size_t species;
+   token scaffold;
+   long start;
+   long size;
+   char strand;
+   token seq;
+};
+
+//A SNP destined for a binary SNP log:
+struct binary_record {
+   token scaffold;
+   uint32_t position;
+   char allele1;
+   char allele2;
+};
+
+//Output of a batch of alignment blocks:
+struct batch_result {
+   vector<string> insnps;
+   vector<string> beds;
+   vector<vector<binary_record>> binary_insnps;
+   unsigned long num_blocks = 0;
+   string error;
+   int error_code = 0;
+};
+
+char complementBase(char base) {
+   switch(base) {
+      case 'A':
+         return 'T';
+      case 'C':
+         return 'G';
+      case 'G':
+         return 'C';
+      case 'T':
+         return 'A';
+      default:
+         return base;
+   }
+}
+
+//Split a line into at most max_tokens whitespace-delimited tokens:
+size_t tokenizeLine(const char *line, const char *line_end, token *tokens, size_t max_tokens) {
+   size_t num_tokens = 0;
+   const char *c = line;
+   while (c < line_end && num_tokens < max_tokens) {
+      while (c < line_end && (*c == ' ' || *c == '\t' || *c == '\r')) {
+         c++;
+      }
+      if (c >= line_end) {
+         break;
+      }
+      const char *token_start = c;
+      while (c < line_end && *c != ' ' && *c != '\t' && *c != '\r') {
+         c++;
+      }
+      tokens[num_tokens].start = token_start;
+      tokens[num_tokens].length = c - token_start;
+      num_tokens++;
+   }
+   return num_tokens;
+}
+
+//Process a batch of alignment blocks, generating output for each block at its first p line:
+void processBatch(const char *batch_start, const char *batch_end, const vector<string> &prefixes, bool binary_output, batch_result &result) {
+   size_t num_species = prefixes.size();
+   result.insnps.assign(num_species * num_species, "");
+   result.beds.assign(num_species, "");
+   if (binary_output) {
+      result.binary_insnps.assign(num_species * num_species, vector<binary_record>());
+   }
+   vector<aligned_seq> aligned_seqs;
+   unsigned long num_p_lines = 0;
+   token tokens[7];
+   const char *line = batch_start;
+   while (line < batch_end) {
+      const char *line_end = (const char *)memchr(line, '\n', batch_end - line);
+      if (line_end == NULL) {
+         line_end = batch_end;
+      }
+      const char *next_line = line_end + 1;
+      //Skip header and empty lines:
+      if (line == line_end || *line == '#') {
+         line = next_line;
+         continue;
+      }
+      size_t num_tokens = tokenizeLine(line, line_end, tokens, 7);
+      if (num_tokens == 0) {
+         line = next_line;
+         continue;
+      }
+      if (tokens[0].equals("a")) { //Reset species on new alignment
+         aligned_seqs.clear();
+         num_p_lines = 0;
+         result.num_blocks++;
+      } else if (tokens[0].equals("s")) { //For aligned Sequence records, store the details
+         if (num_tokens < 7) {
+            result.error = "MAF s line does not have the appropriate number of fields: " + string(line, line_end - line);
+            result.error_code = 5;
+            return;
+         }
+         const char *separator = (const char *)memchr(tokens[1].start, '.', tokens[1].length);
+         size_t species_length = separator == NULL ? tokens[1].length : separator - tokens[1].start;
+         size_t species = num_species;
+         for (size_t i = 0; i < num_species; i++) {
+            if (prefixes[i].length() == species_length && memcmp(prefixes[i].data(), tokens[1].start, species_length) == 0) {
+               species = i;
+               break;
+            }
+         }
+         if (species == num_species) {
+            result.error = "Alignment has species not found in provided prefixes: " + string(line, line_end - line);
+            result.error_code = 5;
+            return;
+         }
+         aligned_seq record;
+         record.species = species;
+         record.scaffold.start = separator == NULL ? tokens[1].start + tokens[1].length : separator + 1;
+         record.scaffold.length = separator == NULL ? 0 : tokens[1].length - species_length - 1;
+         long maf_start = strtol(tokens[2].start, NULL, 10);
+         record.size = strtol(tokens[3].start, NULL, 10);
+         record.strand = tokens[4].start[0];
+         record.start = record.strand == '-' ? strtol(tokens[5].start, NULL, 10) - maf_start : maf_start + 1;
+         record.seq = tokens[6];
+         aligned_seqs.push_back(record);
+      } else if (tokens[0].equals("p")) { //Identify SNPs once we're in the Probability lines
+         num_p_lines++;
+         if (num_p_lines == 1 && !aligned_seqs.empty()) {
+            //Construct the BED line for this alignment for each species:
+            for (auto seq_iterator = aligned_seqs.begin(); seq_iterator != aligned_seqs.end(); ++seq_iterator) {
+               string &bed = result.beds[seq_iterator->species];
+               long bed_start = seq_iterator->strand == '-' ? seq_iterator->start - seq_iterator->size : seq_iterator->start - 1;
+               long bed_end = seq_iterator->strand == '-' ? seq_iterator->start : seq_iterator->start + seq_iterator->size - 1;
+               bed.append(seq_iterator->scaffold.start, seq_iterator->scaffold.length);
+               bed.push_back('\t');
+               bed.append(to_string(bed_start));
+               bed.push_back('\t');
+               bed.append(to_string(bed_end));
+               bed.push_back('\n');
+            }
+            //Find SNPs between each ordered pair of species in the alignment, output in
+            // the first species' coordinate space:
+            for (auto first = aligned_seqs.begin(); first != aligned_seqs.end(); ++first) {
+               for (auto second = aligned_seqs.begin(); second != aligned_seqs.end(); ++second) {
+                  if (first->species == second->species) {
+                     continue;
+                  }
+                  size_t output_index = first->species * num_species + second->species;
+                  string &insnp = result.insnps[output_index];
+                  size_t aln_length = min(first->seq.length, second->seq.length);
+                  long offset = 0;
+                  for (size_t i = 0; i < aln_length; i++) {
+                     char first_base = toupper(first->seq.start[i]);
+                     char second_base = toupper(second->seq.start[i]);
+                     if (first_base != second_base && first_base != '-' && second_base != '-') {
+                        long insnp_position = first->strand == '-' ? first->start - offset : first->start + offset;
+                        char first_allele = first->strand == '-' ? complementBase(first_base) : first_base;
+                        char second_allele = first->strand == '-' ? complementBase(second_base) : second_base;
+                        if (binary_output) {
+                           result.binary_insnps[output_index].push_back({first->scaffold, (uint32_t)insnp_position, first_allele, second_allele});
+                        } else {
+                           insnp.append(first->scaffold.start, first->scaffold.length);
+                           insnp.push_back('\t');
+                           insnp.append(to_string(insnp_position));
+                           insnp.push_back('\t');
+                           insnp.push_back(first_allele);
+                           insnp.push_back('\t');
+                           insnp.push_back(second_allele);
+                           insnp.push_back('\n');
+                        }
+                     }
+                     if (first_base != '-') {
+                        offset++;
+                     }
+                  }
+               }
+            }
+         }
+      }
+      line = next_line;
+   }
+}
+
+int main(int argc, char **argv) {
+   //Path to the MAF:
+   string maf_path = "-";
+   //Number of threads to process blocks with:
+   unsigned int num_threads = 1;
+   //Output binary SNP logs instead of INSNP TSVs:
+   bool binary_output = 0;
+
+   //Option for debugging:
+   bool debug = 0;
+
+   //Variables for getopt_long:
+   int optchar;
+   int structindex = 0;
+   extern int optind;
+   //Create the struct used for getopt:
+   const struct option longoptions[] {
+      {"input_maf", required_argument, 0, 'i'},
+      {"threads", required_argument, 0, 't'},
+      {"binary", no_argument, 0, 'b'},
+      {"debug", no_argument, 0, 'd'},
+      {"version", no_argument, 0, 'v'},
+      {"help", no_argument, 0, 'h'}
+   };
+   //Read in the options:
+   while ((optchar = getopt_long(argc, argv, "i:t:bdvh", longoptions, &structindex)) > -1) {
+      switch(optchar) {
+         case 'i':
+            cerr << "Using MAF: " << optarg << endl;
+            maf_path = optarg;
+            break;
+         case 't':
+            cerr << "Using " << optarg << " threads" << endl;
+            num_threads = stoul(optarg);
+            break;
+         case 'b':
+            cerr << "Outputting binary SNP logs" << endl;
+            binary_output = 1;
+            break;
+         case 'd':
+            cerr << "Debugging mode enabled." << endl;
+            debug = 1;
+            break;
+         case 'v':
+            cerr << "groundTruthFromMAF version " << VERSION << endl;
+            return 0;
+            break;
+         case 'h':
+            cerr << USAGE;
+            return 0;
+            break;
+         default:
+            cerr << "Unknown option " << (unsigned char)optchar << " supplied." << endl;
+            cerr << USAGE;
+            return 1;
+            break;
+      }
+   }
+   if (num_threads == 0) {
+      num_threads = 1;
+   }
+
+   //The positional arguments are the prefixes for the species:
+   vector<string> prefixes;
+   while (optind < argc) {
+      prefixes.push_back(argv[optind++]);
+   }
+   if (prefixes.size() < 2) {
+      cerr << "Please provide at least 2 species prefixes.  Quitting." << endl;
+      return 3;
+   }
+   size_t num_species = prefixes.size();
+
+   //Map the MAF into memory, or read it all from STDIN:
+   if (debug) {
+      cerr << "Opening MAF file" << endl;
+   }
+   const char *maf = nullptr;
+   size_t maf_length = 0;
+   string maf_from_stdin;
+   if (maf_path == "-" || maf_path == "STDIN") {
+      ostringstream stdin_stream;
+      stdin_stream << cin.rdbuf();
+      maf_from_stdin = stdin_stream.str();
+      maf = maf_from_stdin.data();
+      maf_length = maf_from_stdin.length();
+   } else {
+      int maf_fd = open(maf_path.c_str(), O_RDONLY);
+      struct stat maf_stats;
+      if (maf_fd < 0 || fstat(maf_fd, &maf_stats) != 0) {
+         cerr << "Error opening MAF file: " << maf_path << "." << endl;
+         return 2;
+      }
+      maf_length = maf_stats.st_size;
+      if (maf_length > 0) {
+         void *mapped_maf = mmap(NULL, maf_length, PROT_READ, MAP_PRIVATE, maf_fd, 0);
+         if (mapped_maf == MAP_FAILED) {
+            close(maf_fd);
+            cerr << "Error mapping MAF file: " << maf_path << "." << endl;
+            return 2;
+         }
+         madvise(mapped_maf, maf_length, MADV_SEQUENTIAL);
+         maf = (const char *)mapped_maf;
+      }
+      close(maf_fd);
+   }
+
+   //Establish the output INSNPs and BEDs for each prefix (or pair of prefixes):
+   if (debug) {
+      cerr << "Opening output INSNP and BED files" << endl;
+   }
+   vector<unique_ptr<ofstream>> insnp_files(num_species * num_species);
+   vector<unique_ptr<binarySNPlogWriter>> binary_insnps(num_species * num_species);
+   vector<string> insnp_paths(num_species * num_species);
+   vector<unique_ptr<ofstream>> bed_files(num_species);
+   for (size_t s = 0; s < num_species; s++) {
+      for (size_t t = 0; t < num_species; t++) {
+         if (s == t) {
+            continue;
+         }
+         size_t output_index = s * num_species + t;
+         insnp_paths[output_index] = num_species == 2 ? prefixes[s] : prefixes[s] + "_vs_" + prefixes[t];
+         insnp_paths[output_index] += binary_output ? "_INSNP.bin" : "_INSNP.tsv";
+         if (binary_output) {
+            binary_insnps[output_index].reset(new binarySNPlogWriter());
+            continue;
+         }
+         insnp_files[output_index].reset(new ofstream(insnp_paths[output_index]));
+         if (!*insnp_files[output_index]) {
+            cerr << "Could not open INSNP file " << insnp_paths[output_index] << " for writing." << endl;
+            return 4;
+         }
+      }
+      bed_files[s].reset(new ofstream(prefixes[s] + "_aligned_regions.bed"));
+      if (!*bed_files[s]) {
+         cerr << "Could not open BED file for prefix " << prefixes[s] << " for writing." << endl;
+         return 4;
+      }
+   }
+
+   //Divide the MAF into batches of alignment blocks, splitting just before "a" lines:
+   if (debug) {
+      cerr << "Dividing MAF " << maf_path << " into batches of alignments" << endl;
+   }
+   vector<size_t> batch_starts;
+   batch_starts.push_back(0);
+   unsigned long blocks_in_batch = 0;
+   for (size_t line_start = 0; line_start < maf_length;) {
+      if (maf[line_start] == 'a' && (line_start + 1 == maf_length || maf[line_start+1] == ' ' || maf[line_start+1] == '\t' || maf[line_start+1] == '\n')) {
+         if (++blocks_in_batch > BATCH_BLOCKS) {
+            batch_starts.push_back(line_start);
+            blocks_in_batch = 1;
+         }
+      }
+      const char *line_end = (const char *)memchr(maf + line_start, '\n', maf_length - line_start);
+      line_start = line_end == NULL ? maf_length : line_end - maf + 1;
+   }
+   batch_starts.push_back(maf_length);
+   size_t num_batches = batch_starts.size() - 1;
+
+   //Process batches on a pool of threads, keeping a bounded number of
+   // finished batches waiting to be written:
+   if (debug) {
+      cerr << "Parsing MAF " << maf_path << " in " << num_batches << " batches" << endl;
+   }
+   vector<unique_ptr<batch_result>> results(num_batches);
+   size_t next_batch = 0;
+   size_t batches_written = 0;
+   size_t max_pending = 4 * num_threads;
+   mutex batch_mutex;
+   condition_variable batch_done, batch_written;
+   vector<thread> workers;
+   for (unsigned int t = 0; t < num_threads; t++) {
+      workers.push_back(thread([&]() {
+         while (true) {
+            size_t batch;
+            {
+               unique_lock<mutex> lock(batch_mutex);
+               batch_written.wait(lock, [&]() { return next_batch >= num_batches || next_batch < batches_written + max_pending; });
+               if (next_batch >= num_batches) {
+                  return;
+               }
+               batch = next_batch++;
+            }
+            unique_ptr<batch_result> result(new batch_result());
+            processBatch(maf + batch_starts[batch], maf + batch_starts[batch+1], prefixes, binary_output, *result);
+            {
+               lock_guard<mutex> lock(batch_mutex);
+               results[batch] = move(result);
+            }
+            batch_done.notify_all();
+         }
+      }));
+   }
+
+   //Write the output of each batch in order:
+   int error_code = 0;
+   unsigned long num_a_lines = 0;
+   for (size_t batch = 0; batch < num_batches; batch++) {
+      unique_ptr<batch_result> result;
+      {
+         unique_lock<mutex> lock(batch_mutex);
+         batch_done.wait(lock, [&]() { return results[batch] != nullptr; });
+         result = move(results[batch]);
+      }
+      for (size_t s = 0; s < num_species; s++) {
+         *bed_files[s] << result->beds[s];
+         for (size_t t = 0; t < num_species; t++) {
+            size_t output_index = s * num_species + t;
+            if (s == t) {
+               continue;
+            } else if (binary_output) {
+               for (auto record_iterator = result->binary_insnps[output_index].begin(); record_iterator != result->binary_insnps[output_index].end(); ++record_iterator) {
+                  binary_insnps[output_index]->add(string(record_iterator->scaffold.start, record_iterator->scaffold.length), record_iterator->position, record_iterator->allele1, record_iterator->allele2);
+               }
+            } else {
+               *insnp_files[output_index] << result->insnps[output_index];
+            }
+         }
+      }
+      num_a_lines += result->num_blocks;
+      if (debug) {
+         cerr << "Parsed " << num_a_lines << " alignments" << endl;
+      }
+      {
+         lock_guard<mutex> lock(batch_mutex);
+         batches_written++;
+         if (result->error_code != 0) {
+            //Stop handing out batches:
+            next_batch = num_batches;
+         }
+      }
+      batch_written.notify_all();
+      if (result->error_code != 0) {
+         cerr << result->error << endl;
+         error_code = result->error_code;
+         break;
+      }
+   }
+   for (auto worker_iterator = workers.begin(); worker_iterator != workers.end(); ++worker_iterator) {
+      worker_iterator->join();
+   }
+   if (error_code == 0 && debug) {
+      cerr << "Done parsing all " << num_a_lines << " alignments from MAF file" << endl;
+   }
+
+   if (debug) {
+      cerr << "Closing INSNP and BED files" << endl;
+   }
+   for (size_t output_index = 0; output_index < num_species * num_species; output_index++) {
+      if (binary_insnps[output_index] != nullptr && binary_insnps[output_index]->write(insnp_paths[output_index])) {
+         cerr << "Could not write binary SNP log " << insnp_paths[output_index] << endl;
+         error_code = error_code == 0 ? 4 : error_code;
+      }
+      if (insnp_files[output_index] != nullptr) {
+         insnp_files[output_index]->close();
+      }
+   }
+   for (size_t s = 0; s < num_species; s++) {
+      bed_files[s]->close();
+   }
+   if (maf != nullptr && maf_from_stdin.empty()) {
+      munmap((void *)maf, maf_length);
+   }
+
+   return error_code;
+}
@@ -0,0 +1,545 @@
+/**********************************************************************************
+ * groundTruthFromVCF.cpp                                                         *
+ * Written by Patrick Reilly                                                      *
+ * Version 1.0 written 2026/10/18                                                 *
+ * Description:                                                                   *
+ *  Native replacement for running VCFtoUnfilteredINSNP_jackalope.awk once per   *
+ *  sample.  Streams a multi-sample simulator VCF (e.g. from jackalope, plain or *
+ *  gzipped) once, and writes the diploid ground truth INSNP of every sample,    *
+ *  degenerating heterozygous genotypes to IUPAC bases as degenerateBases() in   *
+ *  diploidizeSNPlog does.  Batches of VCF lines are split into fields once by   *
+ *  the reading thread, and each worker thread handles its own subset of the     *
+ *  samples for every batch, so the outputs are written in VCF order.            *
+ *                                                                                *
+ * Syntax: groundTruthFromVCF -i [VCF] -o [output prefix] -t [threads] [-b]       *
+ *         [-s sample1,sample2,...]                                               *
+ **********************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <getopt.h>
+#include <cstring>
+#include <cstdlib>
+#include <vector>
+#include <map>
+#include <deque>
+#include <sstream>
+#include <memory>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <zlib.h>
+#include "binarySNPlog.h"
+
+//Define constants for getopt:
+#define no_argument 0
+#define required_argument 1
+#define optional_argument 2
+
+//Version:
+#define VERSION "1.0"
+
+//Usage/help:
+#define USAGE "groundTruthFromVCF\nUsage:\n groundTruthFromVCF [options]\n Options:\n  -i [simulator VCF, plain or gzipped, default STDIN]\n  -o [output prefix, outputs are [prefix][sample]_INSNP.tsv]\n  -s [comma-separated samples, default all samples in the VCF]\n  -t [number of threads, default 1]\n  -b Output binary SNP logs (_INSNP.bin) instead of INSNP TSVs\n"
+
+//Number of VCF lines processed as a unit by the threads:
+#define BATCH_LINES 4096
+
+using namespace std;
+
+vector<string> splitString(string line_to_split, char delimiter) {
+   vector<string> line_vector;
+   string element;
+   istringstream line_to_split_stream(line_to_split);
+   while (getline(line_to_split_stream, element, delimiter)) {
+      line_vector.push_back(element);
+   }
+   return line_vector;
+}
+
+//Read a line from a gzipped or plain file of arbitrary length:
+bool gzGetline(gzFile input_file, string &line) {
+   char buffer[65536];
+   line.clear();
+   while (gzgets(input_file, buffer, sizeof(buffer)) != NULL) {
+      line.append(buffer);
+      if (!line.empty() && line.back() == '\n') {
+         line.pop_back();
+         return 1;
+      }
+   }
+   return !line.empty();
+}
+
+//Same degeneration as diploidizeSNPlog:
+long degenerateBases(long a, long b) {
+   if (a == b) { //Homozygous
+      return a;
+   } else if (a > 3 || b > 3) { //Either is an N
+      return 4;
+   } else if ((a == 0 && b == 1) || (a == 1 && b == 0)) { //Het A/C
+      return 5; //M
+   } else if ((a == 0 && b == 2) || (a == 2 && b == 0)) { //Het A/G
+      return 6; //R
+   } else if ((a == 0 && b == 3) || (a == 3 && b == 0)) { //Het A/T
+      return 7; //W
+   } else if ((a == 1 && b == 2) || (a == 2 && b == 1)) { //Het C/G
+      return 8; //S
+   } else if ((a == 1 && b == 3) || (a == 3 && b == 1)) { //Het C/T
+      return 9; //Y
+   } else if ((a == 2 && b == 3) || (a == 3 && b == 2)) { //Het G/T
+      return 10; //K
+   } else {
+      return 4;
+   }
+}
+
+//A batch of VCF lines, with the start of each field found once by the
+// reading thread:
+struct vcfBatch {
+   string text;
+   //Start of each field in text, plus one past the end of each line:
+   vector<uint32_t> field_starts;
+   //Index into field_starts of the first field of each line, plus a sentinel:
+   vector<size_t> line_starts;
+   unsigned int workers_done = 0;
+   void addLine(const string &line) {
+      line_starts.push_back(field_starts.size());
+      size_t base = text.size();
+      field_starts.push_back(base);
+      for (const char *tab = (const char *)memchr(line.data(), '\t', line.size()); tab != NULL; tab = (const char *)memchr(tab + 1, '\t', line.data() + line.size() - tab - 1)) {
+         field_starts.push_back(base + (tab - line.data()) + 1);
+      }
+      text += line;
+      text += '\n';
+      field_starts.push_back(text.size());
+   }
+   size_t numLines() const {
+      return line_starts.size() - 1;
+   }
+   size_t numFields(size_t line) const {
+      return line_starts[line+1] - line_starts[line] - 1;
+   }
+   const char *field(size_t line, size_t column, size_t &length) const {
+      size_t field_index = line_starts[line] + column;
+      length = field_starts[field_index+1] - field_starts[field_index] - 1;
+      return text.data() + field_starts[field_index];
+   }
+};
+
+//Output and count of ground truth SNPs of a sample:
+struct sampleTruth {
+   string name;
+   size_t column;
+   string path;
+   unique_ptr<ofstream> insnp_file;
+   unique_ptr<binarySNPlogWriter> binary_insnp;
+   unsigned long num_snps = 0;
+};
+
+//Find the index of the GT subfield in the FORMAT column:
+long findGTindex(const char *format, size_t format_length) {
+   long subfield = 0;
+   size_t subfield_start = 0;
+   for (size_t i = 0; i <= format_length; i++) {
+      if (i == format_length || format[i] == ':') {
+         if (i - subfield_start == 2 && format[subfield_start] == 'G' && format[subfield_start+1] == 'T') {
+            return subfield;
+         }
+         subfield++;
+         subfield_start = i+1;
+      }
+   }
+   return -1;
+}
+
+//Parse the first two allele indices of the genotype in a sample column,
+// returning 0 if the genotype is missing or not at least diploid:
+bool parseGenotype(const char *sample, size_t sample_length, long gt_index, long &allele1, long &allele2) {
+   //Find the GT subfield:
+   size_t gt_start = 0;
+   for (long subfield = 0; subfield < gt_index; subfield++) {
+      const char *colon = (const char *)memchr(sample + gt_start, ':', sample_length - gt_start);
+      if (colon == NULL) {
+         return 0;
+      }
+      gt_start = colon - sample + 1;
+   }
+   const char *colon = (const char *)memchr(sample + gt_start, ':', sample_length - gt_start);
+   size_t gt_end = colon == NULL ? sample_length : colon - sample;
+   //Handle phased or unphased genotypes:
+   long alleles[2];
+   size_t num_alleles = 0;
+   size_t i = gt_start;
+   while (num_alleles < 2 && i < gt_end) {
+      if (sample[i] < '0' || sample[i] > '9') {
+         return 0;
+      }
+      long allele = 0;
+      while (i < gt_end && sample[i] >= '0' && sample[i] <= '9') {
+         allele = allele * 10 + (sample[i] - '0');
+         i++;
+      }
+      alleles[num_alleles++] = allele;
+      if (i < gt_end) {
+         if (sample[i] != '/' && sample[i] != '|') {
+            return 0;
+         }
+         i++;
+      }
+   }
+   if (num_alleles < 2) {
+      return 0;
+   }
+   allele1 = alleles[0];
+   allele2 = alleles[1];
+   return 1;
+}
+
+//Find the ground truth SNPs of the samples handled by a worker in a batch,
+// returning the line of the batch with too few columns or a bad POS (described by problem), or 0:
+size_t processBatch(const vcfBatch &batch, const vector<size_t> &worker_samples, vector<sampleTruth> &samples, const char *&problem) {
+   //Numbers to bases map:
+   const char int2bases[] = {'A', 'C', 'G', 'T', 'N', 'M', 'R', 'W', 'S', 'Y', 'K'};
+   vector<uint8_t> allele_codes;
+   vector<size_t> allele_lengths;
+   for (size_t line = 0; line < batch.numLines(); line++) {
+      size_t num_fields = batch.numFields(line);
+      if (num_fields < 10) {
+         problem = "Too few columns";
+         return line+1;
+      }
+      //Check POS once for all samples (the field is followed by a tab, which stops strtoul):
+      size_t scaffold_length, position_length;
+      const char *scaffold = batch.field(line, 0, scaffold_length);
+      const char *position = batch.field(line, 1, position_length);
+      char *position_end;
+      unsigned long position_value = strtoul(position, &position_end, 10);
+      if (position_length == 0 || position[0] < '0' || position[0] > '9' || position_end != position + position_length || position_value == 0 || position_value > UINT32_MAX) {
+         problem = "Invalid POS";
+         return line+1;
+      }
+      size_t ref_length, alt_length, format_length;
+      const char *ref = batch.field(line, 3, ref_length);
+      const char *alt = batch.field(line, 4, alt_length);
+      //Only variant sites, and only SNPs, since the truth describes SNPs:
+      if ((alt_length == 1 && alt[0] == '.') || ref_length != 1) {
+         continue;
+      }
+      const char *format = batch.field(line, 8, format_length);
+      long gt_index = findGTindex(format, format_length);
+      if (gt_index < 0) {
+         continue;
+      }
+      //Allele codes indexed as in the genotype, the REF being allele 0:
+      allele_codes.assign(1, baseToCode(ref[0]));
+      allele_lengths.assign(1, 1);
+      size_t allele_start = 0;
+      for (size_t i = 0; i <= alt_length; i++) {
+         if (i == alt_length || alt[i] == ',') {
+            allele_codes.push_back(baseToCode(alt[allele_start]));
+            allele_lengths.push_back(i - allele_start);
+            allele_start = i+1;
+         }
+      }
+      for (auto sample_iterator = worker_samples.begin(); sample_iterator != worker_samples.end(); ++sample_iterator) {
+         sampleTruth &sample = samples[*sample_iterator];
+         if (sample.column >= num_fields) {
+            problem = "Too few columns";
+            return line+1;
+         }
+         size_t genotype_length;
+         const char *genotype = batch.field(line, sample.column, genotype_length);
+         long allele1, allele2;
+         if (!parseGenotype(genotype, genotype_length, gt_index, allele1, allele2)) {
+            continue;
+         }
+         //Exclude indels:
+         if ((size_t)allele1 >= allele_codes.size() || (size_t)allele2 >= allele_codes.size() || allele_lengths[allele1] != 1 || allele_lengths[allele2] != 1) {
+            continue;
+         }
+         //Degenerate the genotype, and only output variants:
+         long degenerate_allele = degenerateBases(allele_codes[allele1], allele_codes[allele2]);
+         if (degenerate_allele == allele_codes[0]) {
+            continue;
+         }
+         sample.num_snps++;
+         if (sample.binary_insnp) {
+            sample.binary_insnp->add(string(scaffold, scaffold_length), position_value, ref[0], int2bases[degenerate_allele]);
+         } else {
+            sample.insnp_file->write(scaffold, scaffold_length);
+            sample.insnp_file->put('\t');
+            sample.insnp_file->write(position, position_length);
+            sample.insnp_file->put('\t');
+            sample.insnp_file->put(ref[0]);
+            sample.insnp_file->put('\t');
+            sample.insnp_file->put(int2bases[degenerate_allele]);
+            sample.insnp_file->put('\n');
+         }
+      }
+   }
+   return 0;
+}
+
+int main(int argc, char **argv) {
+   //Path to the VCF:
+   string vcf_path = "-";
+   //Prefix of the output INSNPs:
+   string output_prefix = "";
+   //Samples to output, default all:
+   vector<string> sample_names;
+   //Number of threads to divide the samples among:
+   unsigned int num_threads = 1;
+   //Output binary SNP logs instead of INSNP TSVs:
+   bool binary_output = 0;
+
+   //Option for debugging:
+   bool debug = 0;
+
+   //Variables for getopt_long:
+   int optchar;
+   int structindex = 0;
+   extern int optind;
+   //Create the struct used for getopt:
+   const struct option longoptions[] {
+      {"input_vcf", required_argument, 0, 'i'},
+      {"output_prefix", required_argument, 0, 'o'},
+      {"samples", required_argument, 0, 's'},
+      {"threads", required_argument, 0, 't'},
+      {"binary", no_argument, 0, 'b'},
+      {"debug", no_argument, 0, 'd'},
+      {"version", no_argument, 0, 'v'},
+      {"help", no_argument, 0, 'h'}
+   };
+   //Read in the options:
+   while ((optchar = getopt_long(argc, argv, "i:o:s:t:bdvh", longoptions, &structindex)) > -1) {
+      switch(optchar) {
+         case 'i':
+            cerr << "Using VCF: " << optarg << endl;
+            vcf_path = optarg;
+            break;
+         case 'o':
+            cerr << "Using output prefix: " << optarg << endl;
+            output_prefix = optarg;
+            break;
+         case 's': {
+            cerr << "Outputting ground truth for samples: " << optarg << endl;
+            vector<string> option_samples = splitString(optarg, ',');
+            sample_names.insert(sample_names.end(), option_samples.begin(), option_samples.end());
+            break;
+         }
+         case 't':
+            cerr << "Using " << optarg << " threads" << endl;
+            num_threads = stoul(optarg);
+            break;
+         case 'b':
+            cerr << "Outputting binary SNP logs" << endl;
+            binary_output = 1;
+            break;
+         case 'd':
+            cerr << "Debugging mode enabled." << endl;
+            debug = 1;
+            break;
+         case 'v':
+            cerr << "groundTruthFromVCF version " << VERSION << endl;
+            return 0;
+            break;
+         case 'h':
+            cerr << USAGE;
+            return 0;
+            break;
+         default:
+            cerr << "Unknown option " << (unsigned char)optchar << " supplied." << endl;
+            cerr << USAGE;
+            return 1;
+            break;
+      }
+   }
+
+   //Ignore positional arguments
+   if (optind < argc) {
+      cerr << "Ignoring extra positional arguments starting at " << argv[optind++] << endl;
+   }
+   if (num_threads == 0) {
+      num_threads = 1;
+   }
+
+   //Open the VCF, gzipped or not:
+   gzFile vcf_file;
+   if (vcf_path == "-" || vcf_path == "STDIN") {
+      vcf_file = gzdopen(fileno(stdin), "rb");
+   } else {
+      vcf_file = gzopen(vcf_path.c_str(), "rb");
+   }
+   if (vcf_file == NULL) {
+      cerr << "Error opening VCF file: " << vcf_path << "." << endl;
+      return 2;
+   }
+   gzbuffer(vcf_file, 1048576);
+
+   //Find the columns of the samples in the header:
+   string vcfline;
+   vector<string> header_samples;
+   bool found_header = 0;
+   while (gzGetline(vcf_file, vcfline)) {
+      if (vcfline.compare(0, 6, "#CHROM") == 0) {
+         vector<string> header_vector = splitString(vcfline, '\t');
+         if (header_vector.size() > 9) {
+            header_samples.assign(header_vector.begin() + 9, header_vector.end());
+         }
+         found_header = 1;
+         break;
+      } else if (vcfline.empty() || vcfline[0] != '#') {
+         break;
+      }
+   }
+   if (!found_header || header_samples.empty()) {
+      cerr << "No #CHROM header line with samples found in VCF " << vcf_path << ".  Quitting." << endl;
+      gzclose(vcf_file);
+      return 3;
+   }
+   if (sample_names.empty()) {
+      sample_names = header_samples;
+   }
+   vector<sampleTruth> samples(sample_names.size());
+   for (size_t s = 0; s < sample_names.size(); s++) {
+      samples[s].name = sample_names[s];
+      samples[s].column = 0;
+      for (size_t i = 0; i < header_samples.size(); i++) {
+         if (header_samples[i] == sample_names[s]) {
+            samples[s].column = i + 9;
+            break;
+         }
+      }
+      if (samples[s].column == 0) {
+         cerr << "Sample " << sample_names[s] << " not found in the header of VCF " << vcf_path << ".  Quitting." << endl;
+         gzclose(vcf_file);
+         return 3;
+      }
+      samples[s].path = output_prefix + sample_names[s] + (binary_output ? "_INSNP.bin" : "_INSNP.tsv");
+      if (binary_output) {
+         samples[s].binary_insnp.reset(new binarySNPlogWriter());
+      } else {
+         samples[s].insnp_file.reset(new ofstream(samples[s].path));
+         if (!*samples[s].insnp_file) {
+            cerr << "Could not open INSNP file " << samples[s].path << " for writing." << endl;
+            gzclose(vcf_file);
+            return 4;
+         }
+      }
+   }
+   if (num_threads > samples.size()) {
+      num_threads = samples.size();
+   }
+
+   //Each worker handles every batch for its own samples, so a batch is
+   // dropped once all workers are done with it:
+   vector<vector<size_t>> worker_samples(num_threads);
+   for (size_t s = 0; s < samples.size(); s++) {
+      worker_samples[s % num_threads].push_back(s);
+   }
+   deque<shared_ptr<vcfBatch>> batches;
+   size_t first_batch = 0;
+   bool reading_done = 0;
+   atomic<bool> failed {0};
+   string error = "";
+   size_t max_pending = 4 * num_threads;
+   mutex batch_mutex;
+   condition_variable batch_ready, batch_finished;
+   vector<thread> workers;
+   for (unsigned int t = 0; t < num_threads; t++) {
+      workers.push_back(thread([&, t]() {
+         size_t next_batch = 0;
+         while (true) {
+            shared_ptr<vcfBatch> batch;
+            {
+               unique_lock<mutex> lock(batch_mutex);
+               batch_ready.wait(lock, [&]() { return next_batch < first_batch + batches.size() || reading_done; });
+               if (next_batch >= first_batch + batches.size()) {
+                  return;
+               }
+               batch = batches[next_batch - first_batch];
+            }
+            const char *problem = "";
+            size_t bad_line = failed ? 0 : processBatch(*batch, worker_samples[t], samples, problem);
+            {
+               lock_guard<mutex> lock(batch_mutex);
+               if (bad_line > 0 && !failed) {
+                  failed = 1;
+                  size_t line_length;
+                  const char *line = batch->field(bad_line-1, 0, line_length);
+                  error = string(problem) + " in VCF line starting with " + string(line, line_length) + ".  Quitting.";
+               }
+               batch->workers_done++;
+               while (!batches.empty() && batches.front()->workers_done == num_threads) {
+                  batches.pop_front();
+                  first_batch++;
+               }
+            }
+            batch_finished.notify_all();
+            next_batch++;
+         }
+      }));
+   }
+
+   //Read the VCF into batches of lines:
+   if (debug) {
+      cerr << "Reading VCF " << vcf_path << " in batches of " << BATCH_LINES << " lines" << endl;
+   }
+   unsigned long num_lines = 0;
+   shared_ptr<vcfBatch> batch(new vcfBatch());
+   while (!failed) {
+      bool more_lines = gzGetline(vcf_file, vcfline);
+      if (more_lines && (vcfline.empty() || vcfline[0] == '#')) {
+         continue;
+      }
+      if (more_lines) {
+         batch->addLine(vcfline);
+         num_lines++;
+      }
+      if (batch->line_starts.size() >= BATCH_LINES || (!more_lines && !batch->line_starts.empty())) {
+         batch->line_starts.push_back(batch->field_starts.size());
+         unique_lock<mutex> lock(batch_mutex);
+         batch_finished.wait(lock, [&]() { return batches.size() < max_pending; });
+         batches.push_back(batch);
+         lock.unlock();
+         batch_ready.notify_all();
+         batch.reset(new vcfBatch());
+         if (debug) {
+            cerr << "Read " << num_lines << " VCF lines" << endl;
+         }
+      }
+      if (!more_lines) {
+         break;
+      }
+   }
+   gzclose(vcf_file);
+   {
+      lock_guard<mutex> lock(batch_mutex);
+      reading_done = 1;
+   }
+   batch_ready.notify_all();
+   for (auto worker_iterator = workers.begin(); worker_iterator != workers.end(); ++worker_iterator) {
+      worker_iterator->join();
+   }
+   if (failed) {
+      cerr << error << endl;
+      return 5;
+   }
+
+   //Close the outputs, or write the binary SNP logs:
+   for (auto sample_iterator = samples.begin(); sample_iterator != samples.end(); ++sample_iterator) {
+      if (binary_output) {
+         if (sample_iterator->binary_insnp->write(sample_iterator->path)) {
+            cerr << "Could not write binary SNP log " << sample_iterator->path << "." << endl;
+            return 4;
+         }
+      } else {
+         sample_iterator->insnp_file->close();
+      }
+      cerr << "Wrote " << sample_iterator->num_snps << " ground truth SNPs for sample " << sample_iterator->name << " to " << sample_iterator->path << endl;
+   }
+   return 0;
+}
@@ -102,7 +102,7 @@ INDELDISTPREFIX="${INTPREFIX}_indel_dists"
 #SPECIAL options may indicate cleanup of intermediate files,
 # but not log files:
 if [[ $SPECIAL =~ "cleanup" ]]; then
-   rm -f ${INDELDISTPREFIX}_all.tsv ${INDELDISTPREFIX}_{ER,FN,FP,TN,TP}s.tsv ${INDELDISTPREFIX}_{ER,FN,FP,TN,TP}s_masked.tsv
+   rm -f ${INDELDISTPREFIX}_all.tsv ${INDELDISTPREFIX}_{ER,FN,FP,TN,TP}s.tsv ${INDELDISTPREFIX}_{ER,FN,FP,TN,TP}s_masked.tsv ${INDELDISTPREFIX}_{ER,FN,FP,TN,TP}s.bed ${INDELDISTPREFIX}_{ER,FN,FP,TN,TP}s_masked.bed
    echo "Cleanup complete for sample ${PREFIX}"
    exit 0
 fi
@@ -111,8 +111,9 @@ fi
 SCRIPTDIR=`dirname $0`
 source ${SCRIPTDIR}/pipeline_environment.sh
 
-#Check that the necessary scripts/tools exist:
-if [[ ! -x "$(command -v ${BEDTOOLS})" ]]; then
+#Check that the necessary scripts/tools exist (BEDtools is only needed if
+# bedAlgebra wasn't compiled):
+if [[ ! -x "${SCRIPTDIR}/bedAlgebra" && ! -x "$(command -v ${BEDTOOLS})" ]]; then
    echo "The path to BEDtools specified in your pipeline_environment.sh doesn't seem to exist."
    exit 4
 fi
@@ -140,21 +141,63 @@ for i in "ER" "FN" "FP" "TN" "TP";
    fi
 done
 
-#Compute distances to closest indel for all SNPs:
-echo "Computing distance to closest indel for SNPs in ${INPUTVCF}"
-echo "${SCRIPTDIR}/closestIndelDistance.pl -v <(${READER} ${INPUTVCF}) -i ${INSNP} > ${INDELDISTPREFIX}_all.tsv"
-${SCRIPTDIR}/closestIndelDistance.pl -v <(${READER} ${INPUTVCF}) -i ${INSNP} > ${INDELDISTPREFIX}_all.tsv
-CIDCODE=$?
-if [[ $CIDCODE -ne 0 ]]; then
-   echo "closestIndelDistance.pl failed for sample ${PREFIX} caller ${CALLER} with exit code ${CIDCODE}"
-   exit 9
+#Compute distances to closest indel for all SNPs, unless CLASSIFY already
+# did so with the indeldist special option:
+if [[ $SPECIAL =~ "indeldist" && -e "${INDELDISTPREFIX}_all.tsv" ]]; then
+   echo "Using distances to closest indel computed during CLASSIFY: ${INDELDISTPREFIX}_all.tsv"
+else
+   echo "Computing distance to closest indel for SNPs in ${INPUTVCF}"
+   echo "${SCRIPTDIR}/closestIndelDistance.pl -v <(${READER} ${INPUTVCF}) -i ${INSNP} > ${INDELDISTPREFIX}_all.tsv"
+   ${SCRIPTDIR}/closestIndelDistance.pl -v <(${READER} ${INPUTVCF}) -i ${INSNP} > ${INDELDISTPREFIX}_all.tsv
+   CIDCODE=$?
+   if [[ $CIDCODE -ne 0 ]]; then
+      echo "closestIndelDistance.pl failed for sample ${PREFIX} caller ${CALLER} with exit code ${CIDCODE}"
+      exit 9
+   fi
+fi
+
+#Make the callable sites of each class, before and after masking, in one pass
+# with bedAlgebra:
+if [[ -x "${SCRIPTDIR}/bedAlgebra" ]]; then
+   ALGEBRAOPTS=()
+   for i in "ER" "FN" "FP" "TN" "TP";
+      do
+      if [[ "${CALLABLEEXT}" == "bed" ]]; then
+         ALGEBRAOPTS+=(-e "${i}=${OUTPREFIX}_${i}s.bed & ${CALLABLEBED}")
+      else
+         ALGEBRAOPTS+=(-e "${i}=${OUTPREFIX}_${i}s.bed")
+      fi
+      ALGEBRAOPTS+=(-e "${i}_masked=${i} - ${OUTPREFIX}_sitesToMask.bed" -o "${i}=${INDELDISTPREFIX}_${i}s.bed" -o "${i}_masked=${INDELDISTPREFIX}_${i}s_masked.bed")
+   done
+   echo "${SCRIPTDIR}/bedAlgebra ${ALGEBRAOPTS[@]} 2> ${LOGPREFIX}_bedAlgebra_indel_dists.stderr"
+   ${SCRIPTDIR}/bedAlgebra "${ALGEBRAOPTS[@]}" 2> ${LOGPREFIX}_bedAlgebra_indel_dists.stderr
+   ALGEBRACODE=$?
+   if [[ $ALGEBRACODE -ne 0 ]]; then
+      echo "bedAlgebra of site classes failed for ${INPUTVCF} with exit code ${ALGEBRACODE}"
+      exit 12
+   fi
 fi
 
 #Subsetting indel distances by site class:
 echo "Subsetting indel distances by site class for ${INPUTVCF}"
 for i in "ER" "FN" "FP" "TN" "TP";
    do
-   if [[ "${CALLABLEEXT}" == "bed" ]]; then
+   if [[ -x "${SCRIPTDIR}/bedAlgebra" ]]; then
+      echo "${SCRIPTDIR}/subsetVCFstats.pl -d -i ${INDELDISTPREFIX}_all.tsv -b ${INDELDISTPREFIX}_${i}s.bed 2> ${LOGPREFIX}_subsetVCFstats_indel_dists_${i}s.stderr > ${INDELDISTPREFIX}_${i}s.tsv"
+      ${SCRIPTDIR}/subsetVCFstats.pl -d -i ${INDELDISTPREFIX}_all.tsv -b ${INDELDISTPREFIX}_${i}s.bed 2> ${LOGPREFIX}_subsetVCFstats_indel_dists_${i}s.stderr > ${INDELDISTPREFIX}_${i}s.tsv
+      SUBSETCODE=$?
+      if [[ $SUBSETCODE -ne 0 ]]; then
+         echo "subsetVCFstats.pl of ${i}s failed for ${INPUTVCF} with exit code ${SUBSETCODE}"
+         exit 10
+      fi
+      echo "${SCRIPTDIR}/subsetVCFstats.pl -d -i ${INDELDISTPREFIX}_all.tsv -b ${INDELDISTPREFIX}_${i}s_masked.bed 2> ${LOGPREFIX}_subsetVCFstats_indel_dists_${i}s.stderr > ${INDELDISTPREFIX}_${i}s_masked.tsv"
+      ${SCRIPTDIR}/subsetVCFstats.pl -d -i ${INDELDISTPREFIX}_all.tsv -b ${INDELDISTPREFIX}_${i}s_masked.bed 2> ${LOGPREFIX}_subsetVCFstats_indel_dists_${i}s.stderr > ${INDELDISTPREFIX}_${i}s_masked.tsv
+      MASKSUBSETCODE=$?
+      if [[ $MASKSUBSETCODE -ne 0 ]]; then
+         echo "subsetVCFstats.pl of ${i}s after masking failed for ${INPUTVCF} with exit code ${MASKSUBSETCODE}"
+         exit 11
+      fi
+   elif [[ "${CALLABLEEXT}" == "bed" ]]; then
       echo "${SCRIPTDIR}/subsetVCFstats.pl -d -i ${INDELDISTPREFIX}_all.tsv -b <(${BEDTOOLS} intersect -a ${OUTPREFIX}_${i}s.bed -b ${CALLABLEBED}) 2> ${LOGPREFIX}_subsetVCFstats_indel_dists_${i}s.stderr > ${INDELDISTPREFIX}_${i}s.tsv"
       ${SCRIPTDIR}/subsetVCFstats.pl -d -i ${INDELDISTPREFIX}_all.tsv -b <(${BEDTOOLS} intersect -a ${OUTPREFIX}_${i}s.bed -b ${CALLABLEBED}) 2> ${LOGPREFIX}_subsetVCFstats_indel_dists_${i}s.stderr > ${INDELDISTPREFIX}_${i}s.tsv
       SUBSETCODE=$?
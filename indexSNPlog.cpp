@@ -0,0 +1,181 @@
+/**********************************************************************************
+ * indexSNPlog.cpp                                                                *
+ * Written by Patrick Reilly                                                      *
+ * Version 1.0 written 2026/10/18                                                 *
+ * Description:                                                                   *
+ *  Converts a SNP log or INSNP (scaffold, position, old allele, new allele, and  *
+ *  with -D, depth) into the binary SNP log format of binarySNPlog.h, which       *
+ *  compareSNPlogs can mmap instead of parsing, so that concurrent CLASSIFY jobs *
+ *  against the same truth share one copy of it.                                  *
+ *                                                                                *
+ * Syntax: indexSNPlog -i [SNP log] -o [binary SNP log] [-D]                      *
+ **********************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <getopt.h>
+#include <vector>
+#include <sstream>
+#include <cstdio>
+#include "binarySNPlog.h"
+
+//Define constants for getopt:
+#define no_argument 0
+#define required_argument 1
+#define optional_argument 2
+
+//Version:
+#define VERSION "1.0"
+
+//Usage/help:
+#define USAGE "indexSNPlog\nUsage:\n indexSNPlog -i [SNP log, default STDIN] -o [output binary SNP log]\n Options:\n  -D Store depths from the 5th column (e.g. of an expected diploid SNP log)\n"
+
+using namespace std;
+
+vector<string> splitString(string line_to_split, char delimiter) {
+   vector<string> line_vector;
+   string element;
+   istringstream line_to_split_stream(line_to_split);
+   while (getline(line_to_split_stream, element, delimiter)) {
+      line_vector.push_back(element);
+   }
+   return line_vector;
+}
+
+int main(int argc, char **argv) {
+   //Input and output paths:
+   string input_path = "-", output_path;
+   //Store the depths in the 5th column:
+   bool with_depths = 0;
+
+   //Option for debugging:
+   bool debug = 0;
+
+   //Variables for getopt_long:
+   int optchar;
+   int structindex = 0;
+   extern int optind;
+   //Create the struct used for getopt:
+   const struct option longoptions[] {
+      {"input_log", required_argument, 0, 'i'},
+      {"output_index", required_argument, 0, 'o'},
+      {"depths", no_argument, 0, 'D'},
+      {"debug", no_argument, 0, 'd'},
+      {"version", no_argument, 0, 'v'},
+      {"help", no_argument, 0, 'h'}
+   };
+   //Read in the options:
+   while ((optchar = getopt_long(argc, argv, "i:o:Ddvh", longoptions, &structindex)) > -1) {
+      switch(optchar) {
+         case 'i':
+            cerr << "Using SNP log: " << optarg << endl;
+            input_path = optarg;
+            break;
+         case 'o':
+            cerr << "Outputting binary SNP log to: " << optarg << endl;
+            output_path = optarg;
+            break;
+         case 'D':
+            cerr << "Including depths in the index" << endl;
+            with_depths = 1;
+            break;
+         case 'd':
+            cerr << "Debugging mode enabled." << endl;
+            debug = 1;
+            break;
+         case 'v':
+            cerr << "indexSNPlog version " << VERSION << endl;
+            return 0;
+            break;
+         case 'h':
+            cerr << USAGE;
+            return 0;
+            break;
+         default:
+            cerr << "Unknown option " << (unsigned char)optchar << " supplied." << endl;
+            cerr << USAGE;
+            return 1;
+            break;
+      }
+   }
+
+   //Ignore positional arguments
+   if (optind < argc) {
+      cerr << "Ignoring extra positional arguments starting at " << argv[optind++] << endl;
+   }
+
+   if (output_path.empty()) {
+      cerr << "Missing the output path.  Quitting." << endl;
+      return 2;
+   }
+
+   ifstream input_file;
+   if (input_path != "-") {
+      input_file.open(input_path);
+      if (!input_file) {
+         cerr << "Error opening SNP log " << input_path << ".  Quitting." << endl;
+         return 3;
+      }
+   }
+   istream &input = input_path == "-" ? cin : input_file;
+
+   //Any columns after the alleles (e.g. the context class from the simulator) are
+   // ignored unless depths were requested:
+   binarySNPlogWriter index;
+   index.with_depths = with_depths;
+   string logline;
+   unsigned long num_records = 0;
+   unsigned long num_skipped = 0;
+   while (getline(input, logline)) {
+      vector<string> line_vector = splitString(logline, '\t');
+      if (line_vector.size() < 4) {
+         cerr << "SNP log line does not have the appropriate number of fields: " << logline << endl;
+         return 4;
+      }
+      if (with_depths && line_vector.size() < 5) {
+         cerr << "SNP log line is missing a depth: " << logline << ".  Quitting." << endl;
+         return 4;
+      }
+      //The binary format holds one base per allele, so skip indels and multi-base alleles:
+      if (line_vector[2].length() != 1 || line_vector[3].length() != 1) {
+         if (debug) {
+            cerr << "Skipping SNP log line with an allele that isn't a single base: " << logline << endl;
+         }
+         num_skipped++;
+         continue;
+      }
+      unsigned long position, depth = 0;
+      try {
+         position = stoul(line_vector[1]);
+         if (with_depths) {
+            depth = stoul(line_vector[4]);
+         }
+      } catch (const exception &e) {
+         cerr << "SNP log line has a non-numeric position or depth: " << logline << ".  Quitting." << endl;
+         return 4;
+      }
+      index.add(line_vector[0], position, line_vector[2][0], line_vector[3][0], depth);
+      num_records++;
+   }
+   if (num_skipped > 0) {
+      cerr << "Skipped " << num_skipped << " records with alleles that aren't a single base" << endl;
+   }
+   if (input_path != "-") {
+      input_file.close();
+   }
+   if (debug) {
+      cerr << "Read " << num_records << " records from SNP log " << input_path << endl;
+   }
+
+   //Write to a temporary file and rename it, so that concurrent jobs never map a partial index:
+   string temporary_path = output_path + ".tmp" + to_string(getpid());
+   if (index.write(temporary_path) || rename(temporary_path.c_str(), output_path.c_str()) != 0) {
+      cerr << "Error writing binary SNP log " << output_path << ".  Quitting." << endl;
+      remove(temporary_path.c_str());
+      return 5;
+   }
+   cerr << "Done indexing " << num_records << " records of SNP log " << input_path << endl;
+
+   return 0;
+}
@@ -0,0 +1,866 @@
+/**********************************************************************************
+ * liftoverFromMAF.cpp                                                            *
+ * Written by Patrick Reilly                                                      *
+ * Version 1.0 written 2026/10/18                                                 *
+ * Description:                                                                   *
+ *  Translates INSNP and BED records between the coordinate spaces of two         *
+ *  species in a MAF of 1:1 alignments produced by LAST, so calls made against    *
+ *  one assembly can be evaluated against truth in the other.  The alignment      *
+ *  blocks are reduced to a chain index of gapless segments (scaffold and         *
+ *  lowest position on each side, length, and relative strand), sorted on each    *
+ *  side for binary search.  A position translates only if exactly one segment    *
+ *  covers it and exactly one segment covers its image, so positions in gaps,     *
+ *  outside the aligned blocks, or in overlapping blocks are rejected.  Records   *
+ *  are streamed in batches translated by a set of threads, with output in the    *
+ *  original order.  The chain index can be saved and used in place of the MAF.   *
+ *                                                                                *
+ * Syntax: liftoverFromMAF -i [MAF or chain index] -c [output chain index]        *
+ *         -s [INSNP] -o [output INSNP] -b [BED] -B [output BED]                  *
+ *         -u [output untranslated records] -t [threads]                          *
+ *         <From species prefix> <To species prefix>                              *
+ **********************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <getopt.h>
+#include <cstring>
+#include <cstdlib>
+#include <cstdint>
+#include <vector>
+#include <array>
+#include <sstream>
+#include <algorithm>
+#include <thread>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include "snpLogStore.h"
+
+//Define constants for getopt:
+#define no_argument 0
+#define required_argument 1
+#define optional_argument 2
+
+//Version:
+#define VERSION "1.0"
+
+//Usage/help:
+#define USAGE "liftoverFromMAF\nUsage:\n liftoverFromMAF [options] <From species prefix> <To species prefix>\n Options:\n  -i [MAF 1:1 alignment file or chain index from -c, default STDIN]\n  -c [output chain index of the alignment, for reuse with -i]\n  -s [INSNP to translate]\n  -o [output translated INSNP, default STDOUT]\n  -b [BED to translate]\n  -B [output translated BED, default STDOUT]\n  -u [output untranslated INSNP records and BED intervals]\n  -t [number of threads, default 1]\n"
+
+//Number of records translated as a unit by the threads:
+#define BATCH_RECORDS 65536
+
+//Chain index file identification:
+#define CHAIN_INDEX_MAGIC "MAFCHAIN"
+#define CHAIN_INDEX_VERSION 1
+
+using namespace std;
+
+//A whitespace-delimited field of a MAF line, pointing into the MAF:
+struct token {
+   const char *start;
+   size_t length;
+   bool equals(const char *literal) const {
+      return length == strlen(literal) && memcmp(start, literal, length) == 0;
+   }
+};
+
+//The "s" line of one of the two species in an alignment block, with the forward
+// strand position of its first base and the step to the next base:
+struct aligned_row {
+   bool present;
+   uint32_t scaffold;
+   long start;
+   long step;
+   token seq;
+};
+
+//A gapless run of alignment columns, as the lowest (1-based) position of the run
+// on the scaffold of each species, and whether the species are on opposite strands:
+struct aligned_segment {
+   uint32_t scaffold[2];
+   uint32_t start[2];
+   uint32_t length;
+   uint32_t reverse;
+};
+
+//A piece of a range that translates 1:1, in the coordinates of both species:
+struct translated_piece {
+   uint32_t source_start;
+   uint32_t source_end;
+   uint32_t target_scaffold;
+   uint32_t target_start;
+   uint32_t target_end;
+   bool reverse;
+};
+
+//Output of a batch of records:
+struct batch_result {
+   string translated;
+   string untranslated;
+   unsigned long num_records = 0;
+   unsigned long num_translated = 0;
+   unsigned long bases = 0;
+   unsigned long bases_translated = 0;
+};
+
+//Split a line into at most max_tokens whitespace-delimited tokens:
+size_t tokenizeLine(const char *line, const char *line_end, token *tokens, size_t max_tokens) {
+   size_t num_tokens = 0;
+   const char *c = line;
+   while (c < line_end && num_tokens < max_tokens) {
+      while (c < line_end && (*c == ' ' || *c == '\t' || *c == '\r')) {
+         c++;
+      }
+      if (c >= line_end) {
+         break;
+      }
+      const char *token_start = c;
+      while (c < line_end && *c != ' ' && *c != '\t' && *c != '\r') {
+         c++;
+      }
+      tokens[num_tokens].start = token_start;
+      tokens[num_tokens].length = c - token_start;
+      num_tokens++;
+   }
+   return num_tokens;
+}
+
+char complementBase(char base) {
+   switch(base) {
+      case 'A':
+         return 'T';
+      case 'C':
+         return 'G';
+      case 'G':
+         return 'C';
+      case 'T':
+         return 'A';
+      case 'a':
+         return 't';
+      case 'c':
+         return 'g';
+      case 'g':
+         return 'c';
+      case 't':
+         return 'a';
+      case 'M':
+         return 'K';
+      case 'K':
+         return 'M';
+      case 'R':
+         return 'Y';
+      case 'Y':
+         return 'R';
+      default:
+         return base;
+   }
+}
+
+//Gapless segments of the alignment of two species, indexed by scaffold and
+// position on either side:
+class chainIndex {
+   public:
+      array<string, 2> prefixes;
+      array<scaffoldIDs, 2> scaffolds;
+      //Read the segments of the blocks of a MAF aligning the two prefixes (rows of
+      // any other species are ignored), returning an error message if malformed:
+      string readMAF(const char *maf, size_t maf_length) {
+         aligned_row rows[2];
+         rows[0].present = rows[1].present = 0;
+         token tokens[7];
+         const char *line = maf;
+         const char *maf_end = maf + maf_length;
+         while (line < maf_end) {
+            const char *line_end = (const char *)memchr(line, '\n', maf_end - line);
+            if (line_end == NULL) {
+               line_end = maf_end;
+            }
+            const char *next_line = line_end + 1;
+            //Skip header and empty lines:
+            if (line == line_end || *line == '#') {
+               line = next_line;
+               continue;
+            }
+            size_t num_tokens = tokenizeLine(line, line_end, tokens, 7);
+            if (num_tokens == 0) {
+               line = next_line;
+               continue;
+            }
+            if (tokens[0].equals("a")) { //Segment the previous block on a new alignment
+               addBlock(rows);
+               rows[0].present = rows[1].present = 0;
+            } else if (tokens[0].equals("s")) {
+               if (num_tokens < 7) {
+                  return "MAF s line does not have the appropriate number of fields: " + string(line, line_end - line);
+               }
+               const char *separator = (const char *)memchr(tokens[1].start, '.', tokens[1].length);
+               size_t species_length = separator == NULL ? tokens[1].length : separator - tokens[1].start;
+               size_t species = 2;
+               for (size_t i = 0; i < 2; i++) {
+                  if (prefixes[i].length() == species_length && memcmp(prefixes[i].data(), tokens[1].start, species_length) == 0) {
+                     species = i;
+                     break;
+                  }
+               }
+               if (species == 2) {
+                  line = next_line;
+                  continue;
+               }
+               if (rows[species].present) {
+                  return "Alignment block has more than one row of species " + prefixes[species] + ": " + string(line, line_end - line);
+               }
+               aligned_row &row = rows[species];
+               row.present = 1;
+               row.scaffold = separator == NULL ? scaffolds[species].add("") : scaffolds[species].add(string(separator + 1, tokens[1].length - species_length - 1));
+               long maf_start = strtol(tokens[2].start, NULL, 10);
+               bool minus_strand = tokens[4].start[0] == '-';
+               row.start = minus_strand ? strtol(tokens[5].start, NULL, 10) - maf_start : maf_start + 1;
+               row.step = minus_strand ? -1 : 1;
+               row.seq = tokens[6];
+            }
+            line = next_line;
+         }
+         addBlock(rows);
+         return "";
+      }
+      //Read a chain index written by write(), returning an error message if invalid:
+      string read(const string &path) {
+         ifstream index_file;
+         index_file.open(path, ios::binary);
+         char magic[8];
+         uint32_t version = 0, reserved = 0;
+         uint64_t num_segments = 0;
+         if (!index_file.read(magic, 8) || memcmp(magic, CHAIN_INDEX_MAGIC, 8) != 0) {
+            return "Chain index " + path + " is not a chain index.";
+         }
+         index_file.read((char *)&version, sizeof(version));
+         index_file.read((char *)&reserved, sizeof(reserved));
+         index_file.read((char *)&num_segments, sizeof(num_segments));
+         if (!index_file || version != CHAIN_INDEX_VERSION) {
+            return "Chain index " + path + " has an unsupported version.";
+         }
+         for (unsigned int side = 0; side < 2; side++) {
+            uint64_t blob_length = 0;
+            index_file.read((char *)&blob_length, sizeof(blob_length));
+            string blob(blob_length, '\0');
+            index_file.read(&blob[0], blob_length);
+            if (!index_file) {
+               return "Chain index " + path + " is truncated.";
+            }
+            //The first line is the species prefix, and the rest are scaffold names in ID order:
+            istringstream blob_stream(blob);
+            string name;
+            getline(blob_stream, prefixes[side]);
+            while (getline(blob_stream, name)) {
+               scaffolds[side].add(name);
+            }
+         }
+         segments.resize(num_segments);
+         index_file.read((char *)segments.data(), num_segments * sizeof(aligned_segment));
+         if (!index_file) {
+            return "Chain index " + path + " is truncated.";
+         }
+         return "";
+      }
+      bool write(const string &path) const {
+         ofstream index_file;
+         index_file.open(path, ios::binary);
+         if (!index_file) {
+            return 1;
+         }
+         uint32_t version = CHAIN_INDEX_VERSION, reserved = 0;
+         uint64_t num_segments = segments.size();
+         index_file.write(CHAIN_INDEX_MAGIC, 8);
+         index_file.write((const char *)&version, sizeof(version));
+         index_file.write((const char *)&reserved, sizeof(reserved));
+         index_file.write((const char *)&num_segments, sizeof(num_segments));
+         for (unsigned int side = 0; side < 2; side++) {
+            string blob = prefixes[side] + '\n';
+            for (uint32_t id = 0; id < scaffolds[side].size(); id++) {
+               blob += scaffolds[side].name(id);
+               blob += '\n';
+            }
+            uint64_t blob_length = blob.length();
+            index_file.write((const char *)&blob_length, sizeof(blob_length));
+            index_file.write(blob.data(), blob_length);
+         }
+         index_file.write((const char *)segments.data(), num_segments * sizeof(aligned_segment));
+         index_file.close();
+         return !index_file;
+      }
+      //Sort the segments on each side, and find how far the segments up to each one reach:
+      void build() {
+         for (unsigned int side = 0; side < 2; side++) {
+            vector<uint32_t> &order = orders[side];
+            order.resize(segments.size());
+            for (uint32_t i = 0; i < segments.size(); i++) {
+               order[i] = i;
+            }
+            sort(order.begin(), order.end(), [&](uint32_t a, uint32_t b) {
+               const aligned_segment &first = segments[a], &second = segments[b];
+               return first.scaffold[side] < second.scaffold[side] || (first.scaffold[side] == second.scaffold[side] && first.start[side] < second.start[side]);
+            });
+            vector<uint32_t> &reaches = reach[side];
+            reaches.resize(order.size());
+            for (size_t k = 0; k < order.size(); k++) {
+               const aligned_segment &segment = segments[order[k]];
+               uint32_t end = segment.start[side] + segment.length - 1;
+               reaches[k] = k > 0 && segments[order[k-1]].scaffold[side] == segment.scaffold[side] ? max(reaches[k-1], end) : end;
+            }
+         }
+      }
+      size_t size() const {
+         return segments.size();
+      }
+      //Append the pieces of positions first to last of a scaffold of a species that
+      // translate 1:1 to the other species, in order of source position:
+      void translate(unsigned int side, uint32_t scaffold_id, uint32_t first, uint32_t last, vector<translated_piece> &pieces) const {
+         unsigned int other = 1 - side;
+         vector<array<uint32_t, 3>> source_pieces, target_pieces;
+         uniquePieces(side, scaffold_id, first, last, source_pieces);
+         for (auto source_iterator = source_pieces.begin(); source_iterator != source_pieces.end(); ++source_iterator) {
+            const aligned_segment &segment = segments[(*source_iterator)[2]];
+            uint32_t target_first = mapPosition(segment, side, (*source_iterator)[0]);
+            uint32_t target_last = mapPosition(segment, side, (*source_iterator)[1]);
+            if (segment.reverse) {
+               swap(target_first, target_last);
+            }
+            //Keep only the parts whose image isn't also covered by another segment:
+            target_pieces.clear();
+            uniquePieces(other, segment.scaffold[other], target_first, target_last, target_pieces);
+            if (segment.reverse) {
+               reverse(target_pieces.begin(), target_pieces.end());
+            }
+            for (auto target_iterator = target_pieces.begin(); target_iterator != target_pieces.end(); ++target_iterator) {
+               if ((*target_iterator)[2] != (*source_iterator)[2]) {
+                  continue;
+               }
+               uint32_t source_start = mapPosition(segment, other, (*target_iterator)[0]);
+               uint32_t source_end = mapPosition(segment, other, (*target_iterator)[1]);
+               pieces.push_back({min(source_start, source_end), max(source_start, source_end), segment.scaffold[other], (*target_iterator)[0], (*target_iterator)[1], segment.reverse != 0});
+            }
+         }
+      }
+   private:
+      vector<aligned_segment> segments;
+      //Segments in order of scaffold and start on each side, and the furthest end of
+      // the segments up to each one in that order on the same scaffold:
+      array<vector<uint32_t>, 2> orders;
+      array<vector<uint32_t>, 2> reach;
+      //Split the last block's columns into gapless segments:
+      void addBlock(const aligned_row *rows) {
+         if (!rows[0].present || !rows[1].present) {
+            return;
+         }
+         size_t aln_length = min(rows[0].seq.length, rows[1].seq.length);
+         long positions[2] = {rows[0].start, rows[1].start};
+         long run_starts[2] = {0, 0};
+         long run_length = 0;
+         for (size_t i = 0; i <= aln_length; i++) {
+            bool gapless = i < aln_length && rows[0].seq.start[i] != '-' && rows[1].seq.start[i] != '-';
+            if (gapless) {
+               if (run_length == 0) {
+                  run_starts[0] = positions[0];
+                  run_starts[1] = positions[1];
+               }
+               run_length++;
+            } else if (run_length > 0) {
+               aligned_segment segment;
+               for (unsigned int side = 0; side < 2; side++) {
+                  segment.scaffold[side] = rows[side].scaffold;
+                  segment.start[side] = rows[side].step > 0 ? run_starts[side] : run_starts[side] - run_length + 1;
+               }
+               segment.length = run_length;
+               segment.reverse = rows[0].step != rows[1].step;
+               segments.push_back(segment);
+               run_length = 0;
+            }
+            if (i < aln_length) {
+               for (unsigned int side = 0; side < 2; side++) {
+                  if (rows[side].seq.start[i] != '-') {
+                     positions[side] += rows[side].step;
+                  }
+               }
+            }
+         }
+      }
+      //Position in the other species aligned to a position of a segment on one side:
+      static uint32_t mapPosition(const aligned_segment &segment, unsigned int side, uint32_t position) {
+         uint32_t offset = position - segment.start[side];
+         return segment.reverse ? segment.start[1-side] + segment.length - 1 - offset : segment.start[1-side] + offset;
+      }
+      //Append the maximal pieces of positions first to last of a scaffold covered by
+      // exactly one segment on a side, as first, last, and the segment:
+      void uniquePieces(unsigned int side, uint32_t scaffold_id, uint32_t first, uint32_t last, vector<array<uint32_t, 3>> &pieces) const {
+         const vector<uint32_t> &order = orders[side];
+         //Find the segments starting after the range, then walk back over those that
+         // may overlap it, stopping once none up to here reach it:
+         size_t k = upper_bound(order.begin(), order.end(), make_pair(scaffold_id, last), [&](const pair<uint32_t, uint32_t> &key, uint32_t index) {
+            const aligned_segment &segment = segments[index];
+            return key.first < segment.scaffold[side] || (key.first == segment.scaffold[side] && key.second < segment.start[side]);
+         }) - order.begin();
+         //Coverage changes as position, change, and segment:
+         vector<array<uint64_t, 3>> boundaries;
+         while (k > 0) {
+            k--;
+            const aligned_segment &segment = segments[order[k]];
+            if (segment.scaffold[side] != scaffold_id || reach[side][k] < first) {
+               break;
+            }
+            uint32_t end = segment.start[side] + segment.length - 1;
+            if (end < first) {
+               continue;
+            }
+            boundaries.push_back({max(first, segment.start[side]), 1, order[k]});
+            boundaries.push_back({(uint64_t)min(last, end) + 1, 0, order[k]});
+         }
+         sort(boundaries.begin(), boundaries.end());
+         //Sweep the boundaries, tracking the number of covering segments and the sum of
+         // their indices, which is the covering segment wherever there's only one:
+         long coverage = 0;
+         uint64_t index_sum = 0;
+         for (size_t i = 0; i < boundaries.size(); i++) {
+            if (boundaries[i][1]) {
+               coverage++;
+               index_sum += boundaries[i][2];
+            } else {
+               coverage--;
+               index_sum -= boundaries[i][2];
+            }
+            if (i + 1 < boundaries.size() && boundaries[i+1][0] == boundaries[i][0]) {
+               continue;
+            }
+            if (coverage == 1 && i + 1 < boundaries.size()) {
+               uint32_t piece_start = boundaries[i][0], piece_end = boundaries[i+1][0] - 1;
+               //Extend the previous piece if it's from the same segment and adjacent:
+               if (!pieces.empty() && pieces.back()[2] == index_sum && pieces.back()[1] + 1 == piece_start) {
+                  pieces.back()[1] = piece_end;
+               } else {
+                  pieces.push_back({piece_start, piece_end, (uint32_t)index_sum});
+               }
+            }
+         }
+      }
+};
+
+//Reverse complement an allele into a record:
+void appendAllele(const string &line, size_t start, size_t end, bool reverse, string &record) {
+   if (!reverse) {
+      record.append(line, start, end - start);
+      return;
+   }
+   for (size_t i = end; i > start; i--) {
+      record.push_back(complementBase(line[i-1]));
+   }
+}
+
+//Translate a batch of INSNP records (scaffold, position, and alleles, with any
+// other columns kept), complementing the alleles on the opposite strand:
+void translateINSNPs(const vector<string> &lines, size_t first_line, size_t last_line, const chainIndex &index, unsigned int side, batch_result &result) {
+   vector<translated_piece> pieces;
+   size_t starts[5], ends[5];
+   for (size_t i = first_line; i < last_line; i++) {
+      const string &line = lines[i];
+      if (line.empty() || line[0] == '#') {
+         result.translated += line;
+         result.translated += '\n';
+         continue;
+      }
+      result.num_records++;
+      size_t num_fields = fieldBounds(line, starts, ends, 5);
+      uint32_t scaffold_id = num_fields >= 2 ? index.scaffolds[side].find(line, ends[0]) : scaffoldIDs::missing;
+      pieces.clear();
+      if (scaffold_id != scaffoldIDs::missing) {
+         uint32_t position = strtoul(line.c_str() + starts[1], NULL, 10);
+         if (position > 0) {
+            index.translate(side, scaffold_id, position, position, pieces);
+         }
+      }
+      if (pieces.size() != 1) {
+         result.untranslated += line;
+         result.untranslated += '\n';
+         continue;
+      }
+      result.num_translated++;
+      string &record = result.translated;
+      record += index.scaffolds[1-side].name(pieces[0].target_scaffold);
+      record += '\t';
+      record += to_string(pieces[0].target_start);
+      for (size_t field = 2; field < num_fields; field++) {
+         record += '\t';
+         if (field == 4) {
+            record.append(line, starts[4], string::npos);
+         } else {
+            appendAllele(line, starts[field], ends[field], pieces[0].reverse, record);
+         }
+      }
+      record += '\n';
+   }
+}
+
+//Append a BED interval with any other columns of the original:
+void appendInterval(const string &scaffold, uint32_t start, uint32_t end, const string &rest, string &output) {
+   output += scaffold;
+   output += '\t';
+   output += to_string(start);
+   output += '\t';
+   output += to_string(end);
+   output += rest;
+   output += '\n';
+}
+
+//Translate a batch of BED intervals, splitting each into the pieces that translate
+// 1:1 (in source order) and keeping any other columns:
+void translateBEDs(const vector<string> &lines, size_t first_line, size_t last_line, const chainIndex &index, unsigned int side, batch_result &result) {
+   vector<translated_piece> pieces;
+   size_t starts[4], ends[4];
+   for (size_t i = first_line; i < last_line; i++) {
+      const string &line = lines[i];
+      if (line.empty() || line[0] == '#' || line.compare(0, 5, "track") == 0 || line.compare(0, 7, "browser") == 0) {
+         result.translated += line;
+         result.translated += '\n';
+         continue;
+      }
+      result.num_records++;
+      size_t num_fields = fieldBounds(line, starts, ends, 4);
+      uint32_t bed_start = num_fields >= 3 ? strtoul(line.c_str() + starts[1], NULL, 10) : 0;
+      uint32_t bed_end = num_fields >= 3 ? strtoul(line.c_str() + starts[2], NULL, 10) : 0;
+      if (bed_end <= bed_start) {
+         result.untranslated += line;
+         result.untranslated += '\n';
+         continue;
+      }
+      result.bases += bed_end - bed_start;
+      uint32_t scaffold_id = index.scaffolds[side].find(line, ends[0]);
+      pieces.clear();
+      if (scaffold_id != scaffoldIDs::missing) {
+         index.translate(side, scaffold_id, bed_start + 1, bed_end, pieces);
+      }
+      string rest = num_fields == 4 ? line.substr(ends[2]) : "";
+      //Untranslated parts of the interval are the gaps between the pieces:
+      uint32_t next_untranslated = bed_start + 1;
+      sort(pieces.begin(), pieces.end(), [](const translated_piece &a, const translated_piece &b) {
+         return a.source_start < b.source_start;
+      });
+      //Pieces adjacent in the target (e.g. across an insertion in the source) are
+      // written as one interval:
+      translated_piece pending;
+      bool has_pending = 0;
+      for (auto piece_iterator = pieces.begin(); piece_iterator != pieces.end(); ++piece_iterator) {
+         if (has_pending && pending.target_scaffold == piece_iterator->target_scaffold && (pending.target_end + 1 == piece_iterator->target_start || piece_iterator->target_end + 1 == pending.target_start)) {
+            pending.target_start = min(pending.target_start, piece_iterator->target_start);
+            pending.target_end = max(pending.target_end, piece_iterator->target_end);
+         } else {
+            if (has_pending) {
+               appendInterval(index.scaffolds[1-side].name(pending.target_scaffold), pending.target_start - 1, pending.target_end, rest, result.translated);
+            }
+            pending = *piece_iterator;
+            has_pending = 1;
+         }
+         result.bases_translated += piece_iterator->source_end - piece_iterator->source_start + 1;
+         if (piece_iterator->source_start > next_untranslated) {
+            appendInterval(line.substr(0, ends[0]), next_untranslated - 1, piece_iterator->source_start - 1, rest, result.untranslated);
+         }
+         next_untranslated = piece_iterator->source_end + 1;
+      }
+      if (has_pending) {
+         appendInterval(index.scaffolds[1-side].name(pending.target_scaffold), pending.target_start - 1, pending.target_end, rest, result.translated);
+      }
+      if (next_untranslated <= bed_end) {
+         appendInterval(line.substr(0, ends[0]), next_untranslated - 1, bed_end, rest, result.untranslated);
+      } else {
+         result.num_translated++;
+      }
+   }
+}
+
+//Stream records through a translator in batches divided among the threads,
+// writing the output of each batch in order:
+template <typename Translator>
+void translateRecords(istream &input, ostream &output, ostream *untranslated_output, const chainIndex &index, unsigned int side, unsigned int num_threads, Translator translator, batch_result &totals) {
+   vector<string> lines(BATCH_RECORDS);
+   vector<batch_result> results(num_threads);
+   while (input) {
+      size_t num_lines = 0;
+      while (num_lines < BATCH_RECORDS && getline(input, lines[num_lines])) {
+         num_lines++;
+      }
+      if (num_lines == 0) {
+         break;
+      }
+      size_t lines_per_thread = (num_lines + num_threads - 1) / num_threads;
+      vector<thread> workers;
+      for (unsigned int t = 0; t < num_threads; t++) {
+         results[t] = batch_result();
+         size_t first_line = min(num_lines, t * lines_per_thread);
+         size_t last_line = min(num_lines, first_line + lines_per_thread);
+         workers.push_back(thread(translator, cref(lines), first_line, last_line, cref(index), side, ref(results[t])));
+      }
+      for (unsigned int t = 0; t < num_threads; t++) {
+         workers[t].join();
+         output << results[t].translated;
+         if (untranslated_output != nullptr) {
+            *untranslated_output << results[t].untranslated;
+         }
+         totals.num_records += results[t].num_records;
+         totals.num_translated += results[t].num_translated;
+         totals.bases += results[t].bases;
+         totals.bases_translated += results[t].bases_translated;
+      }
+   }
+}
+
+int main(int argc, char **argv) {
+   //Path to the MAF or chain index:
+   string input_path = "-";
+   //Path to save the chain index to:
+   string chain_index_path = "";
+   //Paths to the records to translate and their outputs:
+   string insnp_path = "";
+   string insnp_output_path = "-";
+   string bed_path = "";
+   string bed_output_path = "-";
+   string untranslated_path = "";
+   //Number of threads to translate records with:
+   unsigned int num_threads = 1;
+
+   //Option for debugging:
+   bool debug = 0;
+
+   //Variables for getopt_long:
+   int optchar;
+   int structindex = 0;
+   extern int optind;
+   //Create the struct used for getopt:
+   const struct option longoptions[] {
+      {"input", required_argument, 0, 'i'},
+      {"chain_index", required_argument, 0, 'c'},
+      {"insnp", required_argument, 0, 's'},
+      {"output_insnp", required_argument, 0, 'o'},
+      {"bed", required_argument, 0, 'b'},
+      {"output_bed", required_argument, 0, 'B'},
+      {"untranslated", required_argument, 0, 'u'},
+      {"threads", required_argument, 0, 't'},
+      {"debug", no_argument, 0, 'd'},
+      {"version", no_argument, 0, 'v'},
+      {"help", no_argument, 0, 'h'}
+   };
+   //Read in the options:
+   while ((optchar = getopt_long(argc, argv, "i:c:s:o:b:B:u:t:dvh", longoptions, &structindex)) > -1) {
+      switch(optchar) {
+         case 'i':
+            cerr << "Using MAF or chain index: " << optarg << endl;
+            input_path = optarg;
+            break;
+         case 'c':
+            cerr << "Outputting chain index to: " << optarg << endl;
+            chain_index_path = optarg;
+            break;
+         case 's':
+            cerr << "Using INSNP: " << optarg << endl;
+            insnp_path = optarg;
+            break;
+         case 'o':
+            cerr << "Outputting translated INSNP to: " << optarg << endl;
+            insnp_output_path = optarg;
+            break;
+         case 'b':
+            cerr << "Using BED: " << optarg << endl;
+            bed_path = optarg;
+            break;
+         case 'B':
+            cerr << "Outputting translated BED to: " << optarg << endl;
+            bed_output_path = optarg;
+            break;
+         case 'u':
+            cerr << "Outputting untranslated records to: " << optarg << endl;
+            untranslated_path = optarg;
+            break;
+         case 't':
+            cerr << "Using " << optarg << " threads" << endl;
+            num_threads = stoul(optarg);
+            break;
+         case 'd':
+            cerr << "Debugging mode enabled." << endl;
+            debug = 1;
+            break;
+         case 'v':
+            cerr << "liftoverFromMAF version " << VERSION << endl;
+            return 0;
+            break;
+         case 'h':
+            cerr << USAGE;
+            return 0;
+            break;
+         default:
+            cerr << "Unknown option " << (unsigned char)optchar << " supplied." << endl;
+            cerr << USAGE;
+            return 1;
+            break;
+      }
+   }
+   if (num_threads == 0) {
+      num_threads = 1;
+   }
+
+   //The positional arguments are the prefixes of the species to translate from and to:
+   if (argc - optind != 2) {
+      cerr << "Please provide the prefixes of the species to translate from and to.  Quitting." << endl;
+      return 3;
+   }
+   string from_prefix = argv[optind];
+   string to_prefix = argv[optind+1];
+   if (from_prefix == to_prefix) {
+      cerr << "The species to translate from and to must differ.  Quitting." << endl;
+      return 3;
+   }
+   if (insnp_path.empty() && bed_path.empty() && chain_index_path.empty()) {
+      cerr << "Please provide an INSNP or BED to translate, or a path for the chain index.  Quitting." << endl;
+      return 3;
+   }
+
+   //Read the chain index, or build it from the MAF, which is mapped into memory
+   // or read all from STDIN:
+   chainIndex index;
+   char magic[8] = {0};
+   if (input_path != "-" && input_path != "STDIN") {
+      ifstream magic_file;
+      magic_file.open(input_path, ios::binary);
+      magic_file.read(magic, 8);
+   }
+   if (memcmp(magic, CHAIN_INDEX_MAGIC, 8) == 0) {
+      if (debug) {
+         cerr << "Reading chain index " << input_path << endl;
+      }
+      string error = index.read(input_path);
+      if (!error.empty()) {
+         cerr << error << "  Quitting." << endl;
+         return 6;
+      }
+      if (!(index.prefixes[0] == from_prefix && index.prefixes[1] == to_prefix) && !(index.prefixes[0] == to_prefix && index.prefixes[1] == from_prefix)) {
+         cerr << "Chain index " << input_path << " aligns " << index.prefixes[0] << " and " << index.prefixes[1] << ", not " << from_prefix << " and " << to_prefix << ".  Quitting." << endl;
+         return 6;
+      }
+   } else {
+      if (debug) {
+         cerr << "Opening MAF file" << endl;
+      }
+      const char *maf = nullptr;
+      size_t maf_length = 0;
+      string maf_from_stdin;
+      void *mapped_maf = MAP_FAILED;
+      if (input_path == "-" || input_path == "STDIN") {
+         ostringstream stdin_stream;
+         stdin_stream << cin.rdbuf();
+         maf_from_stdin = stdin_stream.str();
+         maf = maf_from_stdin.data();
+         maf_length = maf_from_stdin.length();
+      } else {
+         int maf_fd = open(input_path.c_str(), O_RDONLY);
+         struct stat maf_stats;
+         if (maf_fd < 0 || fstat(maf_fd, &maf_stats) != 0) {
+            cerr << "Error opening MAF file: " << input_path << "." << endl;
+            return 2;
+         }
+         maf_length = maf_stats.st_size;
+         if (maf_length > 0) {
+            mapped_maf = mmap(NULL, maf_length, PROT_READ, MAP_PRIVATE, maf_fd, 0);
+            if (mapped_maf == MAP_FAILED) {
+               close(maf_fd);
+               cerr << "Error mapping MAF file: " << input_path << "." << endl;
+               return 2;
+            }
+            madvise(mapped_maf, maf_length, MADV_SEQUENTIAL);
+            maf = (const char *)mapped_maf;
+         }
+         close(maf_fd);
+      }
+      if (debug) {
+         cerr << "Building chain index from MAF " << input_path << endl;
+      }
+      index.prefixes[0] = from_prefix;
+      index.prefixes[1] = to_prefix;
+      string error = index.readMAF(maf, maf_length);
+      if (mapped_maf != MAP_FAILED) {
+         munmap(mapped_maf, maf_length);
+      }
+      if (!error.empty()) {
+         cerr << error << endl;
+         cerr << "Quitting." << endl;
+         return 5;
+      }
+   }
+   unsigned int side = index.prefixes[0] == from_prefix ? 0 : 1;
+   if (debug) {
+      cerr << "Chain index has " << index.size() << " gapless segments" << endl;
+   }
+
+   if (!chain_index_path.empty() && index.write(chain_index_path)) {
+      cerr << "Error writing chain index " << chain_index_path << ".  Quitting." << endl;
+      return 4;
+   }
+   index.build();
+
+   //Open the output of untranslated records:
+   ofstream untranslated_file;
+   if (!untranslated_path.empty()) {
+      untranslated_file.open(untranslated_path);
+      if (!untranslated_file) {
+         cerr << "Error opening untranslated records output file " << untranslated_path << ".  Quitting." << endl;
+         return 4;
+      }
+   }
+   ostream *untranslated_output = untranslated_path.empty() ? nullptr : &untranslated_file;
+
+   //Translate the INSNP, then the BED:
+   for (unsigned int record_type = 0; record_type < 2; record_type++) {
+      const string &records_path = record_type == 0 ? insnp_path : bed_path;
+      const string &output_path = record_type == 0 ? insnp_output_path : bed_output_path;
+      const char *record_name = record_type == 0 ? "INSNP" : "BED";
+      if (records_path.empty()) {
+         continue;
+      }
+      ifstream records_file;
+      bool records_stdin = records_path == "-" || records_path == "STDIN";
+      if (!records_stdin) {
+         records_file.open(records_path);
+         if (!records_file) {
+            cerr << "Error opening " << record_name << " file " << records_path << ".  Quitting." << endl;
+            return 7;
+         }
+      }
+      istream &records = records_stdin ? cin : records_file;
+      ofstream output_file;
+      bool output_stdout = output_path == "-" || output_path == "STDOUT";
+      if (!output_stdout) {
+         output_file.open(output_path);
+         if (!output_file) {
+            cerr << "Error opening translated " << record_name << " output file " << output_path << ".  Quitting." << endl;
+            return 4;
+         }
+      }
+      ostream &output = output_stdout ? cout : output_file;
+      if (debug) {
+         cerr << "Translating " << record_name << " " << records_path << " from " << from_prefix << " to " << to_prefix << endl;
+      }
+      batch_result totals;
+      if (record_type == 0) {
+         translateRecords(records, output, untranslated_output, index, side, num_threads, translateINSNPs, totals);
+         cerr << "Translated " << totals.num_translated << " of " << totals.num_records << " INSNP records" << endl;
+      } else {
+         translateRecords(records, output, untranslated_output, index, side, num_threads, translateBEDs, totals);
+         cerr << "Translated " << totals.num_translated << " of " << totals.num_records << " BED intervals entirely, and " << totals.bases_translated << " of " << totals.bases << " bp" << endl;
+      }
+      if (!output_stdout) {
+         output_file.close();
+      }
+   }
+   if (!untranslated_path.empty()) {
+      untranslated_file.close();
+   }
+
+   return 0;
+}
@@ -5,7 +5,8 @@
 
 #The arguments are:
 #1) Task ID (line of the metadata file to use)
-#2) job type (i.e. CLASSIFY)
+#2) job type (i.e. CLASSIFY, or JOINTCLASSIFY to classify all samples of
+#   the task's joint VCF in one pass)
 #3) metadata file (TSV comprised of prefix, ref, caller, special)
 #4) ground truth file (INSNP file, where 3rd column is ancestral ref)
 #5) callable sites BED (optional, will default to all sites if omitted)
@@ -77,7 +78,22 @@ fi
 
 SCRIPTDIR=`dirname $0`
 
-if [[ $JOBTYPE =~ "CLASSIFY" ]]; then
+if [[ $JOBTYPE =~ "JOINTCLASSIFY" ]]; then
+   #Params: REF GROUNDTRUTH CALLER SPECIAL JOINTPREFIX SAMPLEPREFIXES
+   if [[ ! $SPECIAL =~ "jointgeno" || -z "${JOINTPREFIX}" ]]; then
+      echo "JOINTCLASSIFY requires the jointgeno special option and a joint VCF prefix"
+      exit 10
+   fi
+   #Collect all samples sharing the joint VCF, caller, and special options:
+   SAMPLEPREFIXES=""
+   while IFS=$'\a' read -r -a metadatafields
+      do
+      if [[ "${metadatafields[2]}" == "${CALLER}" && "${metadatafields[3]}" == "${SPECIAL}" && "${metadatafields[4]}" == "${JOINTPREFIX}" ]]; then
+         SAMPLEPREFIXES="${SAMPLEPREFIXES} ${metadatafields[0]}"
+      fi
+   done < <(tr "\t" "\a" < $METADATA)
+   CMD="${SCRIPTDIR}/classifyJointVCF.sh ${REF} ${GROUNDTRUTH} ${CALLER} ${SPECIAL} ${JOINTPREFIX}${SAMPLEPREFIXES}"
+elif [[ $JOBTYPE =~ "CLASSIFY" ]]; then
    #Params: PREFIX REF GROUNDTRUTH CALLABLEBED CALLER SPECIAL JOINTPREFIX
    if [[ "${CALLABLEBED}" == "all" ]]; then
       CMD="${SCRIPTDIR}/classifySites.sh ${PREFIX} ${REF} ${GROUNDTRUTH} ${REF}.fai ${CALLER} ${SPECIAL} ${JOINTPREFIX}"
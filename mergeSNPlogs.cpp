@@ -5,9 +5,12 @@
  * Version 1.1 written 2018/09/07 Variety of bug fixes                            *
  * Version 1.2 written 2018/10/18 Empty indelmap for scaffold bug fix             *
  * Version 1.3 written 2019/03/29 Double-output of transitive sites bug fix       *
+ * Version 1.4 written 2026/10/18 Merged indel log in reference coordinates       *
+ * Version 1.5 written 2026/10/18 Interned scaffold IDs and columnar SNP records   *
  * Description:                                                                   *
  *                                                                                *
  * Syntax: mergeSNPlogs [branch 1 indel log] [branch 1 SNP log] [branch 2 SNP log]*
+ *         -j [branch 2 indel log] -o [output merged indel log]                   *
  **********************************************************************************/
 
 #include <iostream>
@@ -19,6 +22,9 @@
 #include <map>
 #include <sstream>
 #include <array>
+#include <algorithm>
+#include <cstdlib>
+#include "snpLogStore.h"
 
 //Define constants for getopt:
 #define no_argument 0
@@ -26,10 +32,10 @@
 #define optional_argument 2
 
 //Version:
-#define VERSION "1.3"
+#define VERSION "1.5"
 
 //Usage/help:
-#define USAGE "mergeSNPlogs\nUsage:\n mergeSNPlogs -i [branch 1 indel log] -b [branch 1 SNP log] -c [branch 2 SNP log]\n"
+#define USAGE "mergeSNPlogs\nUsage:\n mergeSNPlogs -i [branch 1 indel log] -b [branch 1 SNP log] -c [branch 2 SNP log]\n\t-j [branch 2 indel log] -o [output merged indel log]\n"
 
 using namespace std;
 
@@ -43,33 +49,143 @@ vector<string> splitString(string line_to_split, char delimiter) {
    return line_vector;
 }
 
-bool constructIndelMap(ifstream &indel_log, map<string, vector<pair<long, long>>> &indel_map) {
+//Construct the indel map of each scaffold, indexed by scaffold ID (interning scaffolds as they appear):
+bool constructIndelMap(ifstream &indel_log, scaffoldIDs &scaffold_ids, vector<vector<pair<long, long>>> &indel_map) {
    bool readfail = 0;
    string logline;
    long cumulativechange = 0;
+   size_t starts[4], ends[4];
    while(getline(indel_log, logline)) {
-      vector<string> line_vector;
-      line_vector = splitString(logline, '\t');
-      if (indel_map.count(line_vector[0]) == 0) {
+      if (fieldBounds(logline, starts, ends, 4) < 4) {
+         continue;
+      }
+      uint32_t scaffold_id = scaffold_ids.add(logline, ends[0]);
+      if (scaffold_id >= indel_map.size()) {
+         indel_map.resize(scaffold_id + 1);
+      }
+      if (indel_map[scaffold_id].empty()) {
          cumulativechange = 0; //Make sure to reset the change on a new scaffold
-         indel_map[line_vector[0]].push_back(make_pair(0, 0)); //Every mapping starts with 0,0
+         indel_map[scaffold_id].push_back(make_pair(0, 0)); //Every mapping starts with 0,0
       }
-      long indel_size = stol(line_vector[3]);
+      long indel_size = strtol(logline.c_str() + starts[3], NULL, 10);
       if (indel_size == 0) { //Skip indels of size 0, they don't affect coordinate space mapping
          continue;
       }
-      long indel_change = line_vector[2] == "ins" ? indel_size : -indel_size;
+      long indel_change = logline.compare(starts[2], ends[2] - starts[2], "ins") == 0 ? indel_size : -indel_size;
       cumulativechange += indel_change;
-      long ref_position = stol(line_vector[1]) + 1;
+      long ref_position = strtol(logline.c_str() + starts[1], NULL, 10) + 1;
       long new_position = ref_position + cumulativechange;
-      indel_map[line_vector[0]].push_back(make_pair(ref_position, new_position));
+      indel_map[scaffold_id].push_back(make_pair(ref_position, new_position));
    }
    readfail = (indel_log.fail() || indel_log.bad()) && !indel_log.eof(); //Only signal failure if fail bit or bad bit are set, but EOF bit is not.
    return readfail;
 }
 
-long baseToLong(string &base) {
-   switch(base[0]) {
+//Read an indel log into records grouped by scaffold ID (interning scaffolds as they appear) and sorted by position:
+bool readIndelLog(const string &indellog_path, scaffoldIDs &scaffold_ids, indelLogStore &indel_log) {
+   ifstream indellog;
+   indellog.open(indellog_path);
+   if (!indellog) {
+      return 1;
+   }
+   indel_log.read(indellog, scaffold_ids, 1);
+   indellog.close();
+   return 0;
+}
+
+//Stretch of the branch 2 source coordinate space that maps linearly back onto the branch 1
+// source coordinate space, and the number of bases inserted along branch 1 just before it:
+struct indelSegment {
+   long new_start;
+   long ref_start;
+   long inserted;
+};
+
+//Segments of each scaffold of the branch 2 source, starting at an insertion or after a deletion along branch 1.
+//Unlike the indel map used for SNPs, the start of each segment is exact for both insertions and deletions,
+// so the bases at either end of an indel map to the right place:
+void constructSegments(const indelLogStore &indel_log, vector<vector<indelSegment>> &segments) {
+   segments.assign(indel_log.scaffolds.size(), vector<indelSegment>());
+   for (uint32_t scaffold_id = 0; scaffold_id < indel_log.scaffolds.size(); scaffold_id++) {
+      vector<indelSegment> &scaffold_segments = segments[scaffold_id];
+      scaffold_segments.push_back({1, 1, 0});
+      long cumulativechange = 0;
+      for (auto indel_iterator = indel_log.scaffolds[scaffold_id].begin(); indel_iterator != indel_log.scaffolds[scaffold_id].end(); ++indel_iterator) {
+         long indel_size = indel_iterator->size;
+         if (indel_size == 0) {
+            continue;
+         }
+         long position = indel_iterator->position;
+         if (indel_iterator->insertion) { //Inserted bases follow the logged position
+            cumulativechange += indel_size;
+            scaffold_segments.push_back({position + 1 + cumulativechange, position + 1, indel_size});
+         } else { //Deleted bases start at the logged position
+            cumulativechange -= indel_size;
+            scaffold_segments.push_back({position + indel_size + cumulativechange, position + indel_size, 0});
+         }
+      }
+   }
+}
+
+//Adjust a position in the branch 2 source back into the branch 1 source coordinate space,
+// or return 0 if it is within an insertion along branch 1:
+long adjustPosition(const vector<indelSegment> &scaffold_segments, long newref_position) {
+   auto right_iterator = upper_bound(scaffold_segments.begin(), scaffold_segments.end(), newref_position, [](long position, const indelSegment &segment) { return position < segment.new_start; });
+   if (right_iterator == scaffold_segments.begin()) {
+      return 0;
+   }
+   if (right_iterator != scaffold_segments.end() && newref_position >= right_iterator->new_start - right_iterator->inserted) {
+      return 0;
+   }
+   auto left_iterator = right_iterator - 1;
+   return left_iterator->ref_start + newref_position - left_iterator->new_start;
+}
+
+//Merge the branch 1 indels with the branch 2 indels adjusted into the branch 1 source coordinate space.
+//Branch 2 indels within (or, for deletions, spanning) a branch 1 indel have no single position there, so they're skipped:
+bool mergeIndelLogs(const scaffoldIDs &scaffold_ids, indelLogStore &branch1_indels, indelLogStore &branch2_indels, ofstream &merged_indel_log, bool debug) {
+   vector<vector<indelSegment>> segments;
+   constructSegments(branch1_indels, segments);
+   for (uint32_t scaffold_id = 0; scaffold_id < branch2_indels.scaffolds.size(); scaffold_id++) {
+      const vector<indelSegment> &scaffold_segments = segments[scaffold_id];
+      vector<indelLogRecord> &merged_indels = branch1_indels.scaffolds[scaffold_id];
+      for (auto indel_iterator = branch2_indels.scaffolds[scaffold_id].begin(); indel_iterator != branch2_indels.scaffolds[scaffold_id].end(); ++indel_iterator) {
+         long newref_position = indel_iterator->position;
+         long adjusted_position = adjustPosition(scaffold_segments, newref_position);
+         if (!indel_iterator->insertion && adjusted_position > 0) {
+            long indel_size = indel_iterator->size;
+            long adjusted_end = adjustPosition(scaffold_segments, newref_position + indel_size - 1);
+            if (adjusted_end - adjusted_position != indel_size - 1) {
+               adjusted_position = 0;
+            }
+         }
+         if (adjusted_position == 0) {
+            if (debug) {
+               cerr << "Indel along branch 2 overlaps indel on branch 1 at unadjusted position " << scaffold_ids.name(scaffold_id) << ":" << newref_position << endl;
+            }
+            continue;
+         }
+         indelLogRecord log_record = *indel_iterator;
+         log_record.position = adjusted_position;
+         merged_indels.push_back(log_record);
+      }
+   }
+   branch1_indels.sortByPosition();
+   for (uint32_t scaffold_id = 0; scaffold_id < branch1_indels.scaffolds.size(); scaffold_id++) {
+      const string &scaffold = scaffold_ids.name(scaffold_id);
+      for (auto indel_iterator = branch1_indels.scaffolds[scaffold_id].begin(); indel_iterator != branch1_indels.scaffolds[scaffold_id].end(); ++indel_iterator) {
+         merged_indel_log << scaffold << '\t' << indel_iterator->position << '\t' << (indel_iterator->insertion ? "ins" : "del") << '\t' << indel_iterator->length;
+         if (!indel_iterator->sequence.empty()) {
+            merged_indel_log << '\t' << indel_iterator->sequence;
+         }
+         merged_indel_log << '\n';
+      }
+   }
+   return merged_indel_log.fail();
+}
+
+long baseToLong(char base) {
+   switch(base) {
       case 'A':
       case 'a':
          return 0;
@@ -109,11 +225,15 @@ int main(int argc, char **argv) {
    //Numbers to bases map:
    char int2bases[] = {'A', 'C', 'G', 'T', 'N', 'M', 'R', 'W', 'S', 'Y', 'K'};
    
-   //Map for coordinate space change due to indels:
-   map<string, vector<pair<long, long>>> indelmap;
+   //Scaffold IDs, in order of first appearance in the logs:
+   scaffoldIDs scaffold_ids;
+   //Map for coordinate space change due to indels, indexed by scaffold ID:
+   vector<vector<pair<long, long>>> indelmap;
    
    //Log file paths:
    string branch1snplog_path, branch2snplog_path, indellog_path;
+   //Branch 2 indel log, and output path for the indel log merged into the branch 1 source coordinate space:
+   string branch2indellog_path = "", merged_indellog_path = "";
    
    //Option for debugging:
    bool debug = 0;
@@ -127,12 +247,14 @@ int main(int argc, char **argv) {
       {"indel_log", required_argument, 0, 'i'},
       {"branch1_snp_log", required_argument, 0, 'b'},
       {"branch2_snp_log", required_argument, 0, 'c'},
+      {"branch2_indel_log", required_argument, 0, 'j'},
+      {"output_indel_log", required_argument, 0, 'o'},
       {"debug", no_argument, 0, 'd'},
       {"version", no_argument, 0, 'v'},
       {"help", no_argument, 0, 'h'}
    };
    //Read in the options:
-   while ((optchar = getopt_long(argc, argv, "i:b:c:dvh", longoptions, &structindex)) > -1) {
+   while ((optchar = getopt_long(argc, argv, "i:b:c:j:o:dvh", longoptions, &structindex)) > -1) {
       switch(optchar) {
          case 'i':
             cerr << "Using branch 1 indel log: " << optarg << endl;
@@ -146,6 +268,14 @@ int main(int argc, char **argv) {
             cerr << "Using branch 2 SNP log: " << optarg << endl;
             branch2snplog_path = optarg;
             break;
+         case 'j':
+            cerr << "Using branch 2 indel log: " << optarg << endl;
+            branch2indellog_path = optarg;
+            break;
+         case 'o':
+            cerr << "Outputting merged indel log to: " << optarg << endl;
+            merged_indellog_path = optarg;
+            break;
          case 'd':
             cerr << "Debugging mode enabled." << endl;
             debug = 1;
@@ -176,6 +306,11 @@ int main(int argc, char **argv) {
       cerr << "Missing one of the input logs.  Quitting." << endl;
       return 2;
    }
+   if (branch2indellog_path.empty() != merged_indellog_path.empty()) {
+      cerr << "Merging indel logs requires both the branch 2 indel log (-j) and an output path (-o), so ignoring that function." << endl;
+      branch2indellog_path = "";
+      merged_indellog_path = "";
+   }
    
    //Open the branch 1 indel log:
    ifstream indellog;
@@ -185,15 +320,19 @@ int main(int argc, char **argv) {
       return 3;
    }
    
-   bool indelmapfail = constructIndelMap(indellog, indelmap);
+   bool indelmapfail = constructIndelMap(indellog, scaffold_ids, indelmap);
    if (indelmapfail) {
       cerr << "Failed to construct coordinate-space mapping.  Quitting." << endl;
       return 4;
    }
    indellog.close();
    if (debug) {
-      for (auto imprint_iterator = indelmap.begin(); imprint_iterator != indelmap.end(); ++imprint_iterator) {
-         for (auto indel_iterator = imprint_iterator->second.begin(); indel_iterator != imprint_iterator->second.end(); ++indel_iterator) {
+      map<string, uint32_t> sorted_ids;
+      for (uint32_t scaffold_id = 0; scaffold_id < scaffold_ids.size(); scaffold_id++) {
+         sorted_ids[scaffold_ids.name(scaffold_id)] = scaffold_id;
+      }
+      for (auto imprint_iterator = sorted_ids.begin(); imprint_iterator != sorted_ids.end(); ++imprint_iterator) {
+         for (auto indel_iterator = indelmap[imprint_iterator->second].begin(); indel_iterator != indelmap[imprint_iterator->second].end(); ++indel_iterator) {
             cerr << imprint_iterator->first << '\t' << indel_iterator->first << '\t' << indel_iterator->second << endl;
          }
       }
@@ -213,127 +352,139 @@ int main(int argc, char **argv) {
       return 6;
    }
    
-   //Read branch 1 log into map (keyed by scaffold) of vectors of 3-element arrays (pos, oldallele, newallele):
+   //Read branch 1 log into records (pos, oldallele, newallele) grouped by scaffold ID:
    cerr << "Reading branch 1 SNP log " << branch1snplog_path << endl;
-   string firstScaffold;
-   map<string, vector<array<long, 3>>> branch1_log;
+   snpRecordStore branch1_log;
    string b1line;
+   size_t starts[4], ends[4];
    while (getline(branch1_snp_log, b1line)) {
-      vector<string> line_vector;
-      line_vector = splitString(b1line, '\t');
-      if (firstScaffold.empty()) {
-         firstScaffold = line_vector[0];
+      if (fieldBounds(b1line, starts, ends, 4) < 4) {
+         continue;
       }
-      long oldallele = baseToLong(line_vector[2]);
-      long newallele = baseToLong(line_vector[3]);
+      uint32_t scaffold_id = scaffold_ids.add(b1line, ends[0]);
+      long oldallele = baseToLong(b1line[starts[2]]);
+      long newallele = baseToLong(b1line[starts[3]]);
       if (debug && (oldallele > 3 || newallele > 3)) {
-         cerr << "Found non-ACGT base in branch 1 SNP log at " << line_vector[0] << " position " << line_vector[1] << endl;
+         cerr << "Found non-ACGT base in branch 1 SNP log at " << b1line.substr(0, ends[0]) << " position " << b1line.substr(starts[1], ends[1] - starts[1]) << endl;
       }
-      array<long, 3> log_record;
-      log_record[0] = stoul(line_vector[1]);
-      log_record[1] = oldallele;
-      log_record[2] = newallele;
-      branch1_log[line_vector[0]].push_back(log_record);
+      branch1_log.add(scaffold_id, strtoul(b1line.c_str() + starts[1], NULL, 10), oldallele, newallele);
    }
+   branch1_log.group(scaffold_ids.size());
    
    branch1_snp_log.close();
    cerr << "Done reading branch 1 SNP log" << endl;
    
-   //Check if the entry in the indelmap exists for firstScaffold, if not, add (0,0) to it:
-   if (indelmap.count(firstScaffold) == 0) {
-      indelmap[firstScaffold].push_back(make_pair(0, 0));
-   }
-   
    //Now iterate over branch 2 log, adjusting new position back to old position using indel map, 
    //then comparing to branch 1 log to look for overlapping changes that need to be transitively reduced:
    cerr << "Reading branch 2 SNP log " << branch2snplog_path << endl;
    string b2line;
-   auto indelmap_iterator = indelmap[firstScaffold].begin();
-   auto left_iterator = indelmap[firstScaffold].begin();
-   auto b1log_iterator = branch1_log[firstScaffold].begin();
+   string scaffold;
+   uint32_t scaffold_id = scaffoldIDs::missing;
+   size_t indelmap_index = 0, left_index = 0;
+   size_t b1log_index = 0, b1log_end = 0;
    while (getline(branch2_snp_log, b2line)) {
-      vector<string> line_vector;
-      line_vector = splitString(b2line, '\t');
-      if (line_vector[0] != firstScaffold) {
+      if (fieldBounds(b2line, starts, ends, 4) < 4) {
+         continue;
+      }
+      if (scaffold_id == scaffoldIDs::missing || scaffold.length() != ends[0] || b2line.compare(0, ends[0], scaffold) != 0) {
+         scaffold_id = scaffold_ids.add(b2line, ends[0]);
+         scaffold = scaffold_ids.name(scaffold_id);
          //Ensure the scaffold exists in the indelmap:
-         if (indelmap.count(line_vector[0]) == 0) {
-            indelmap[line_vector[0]].push_back(make_pair(0, 0));
+         if (scaffold_id >= indelmap.size()) {
+            indelmap.resize(scaffold_id + 1);
+         }
+         if (indelmap[scaffold_id].empty()) {
+            indelmap[scaffold_id].push_back(make_pair(0, 0));
          }
-         indelmap_iterator = indelmap[line_vector[0]].begin();
-         left_iterator = indelmap[line_vector[0]].begin();
-         b1log_iterator = branch1_log[line_vector[0]].begin();
-         firstScaffold = line_vector[0];
+         indelmap_index = 0;
+         left_index = 0;
+         b1log_index = branch1_log.begin(scaffold_id);
+         b1log_end = branch1_log.end(scaffold_id);
       }
-      long oldallele = baseToLong(line_vector[2]);
-      long newallele = baseToLong(line_vector[3]);
+      const vector<pair<long, long>> &scaffold_indelmap = indelmap[scaffold_id];
+      long oldallele = baseToLong(b2line[starts[2]]);
+      long newallele = baseToLong(b2line[starts[3]]);
       if (debug && (oldallele > 3 || newallele > 3)) {
-         cerr << "Found non-ACGT base in branch 2 SNP log at " << line_vector[0] << " position " << line_vector[1] << endl;
+         cerr << "Found non-ACGT base in branch 2 SNP log at " << scaffold << " position " << b2line.substr(starts[1], ends[1] - starts[1]) << endl;
       }
       //Adjust the position back into the branch 1 source coordinate space:
-      long newref_position = stol(line_vector[1]);
-      while (newref_position > indelmap_iterator->second && indelmap_iterator != indelmap[line_vector[0]].end()) {
-         left_iterator = indelmap_iterator;
-         ++indelmap_iterator;
+      long newref_position = strtol(b2line.c_str() + starts[1], NULL, 10);
+      while (indelmap_index != scaffold_indelmap.size() && newref_position > scaffold_indelmap[indelmap_index].second) {
+         left_index = indelmap_index;
+         ++indelmap_index;
       }
-      auto right_iterator = indelmap_iterator;
-      if (right_iterator == indelmap[line_vector[0]].end()) {
-         --right_iterator;
+      size_t right_index = indelmap_index;
+      if (right_index == scaffold_indelmap.size()) {
+         --right_index;
       }
-      if (indelmap_iterator == indelmap[line_vector[0]].end() || (newref_position < indelmap_iterator->second && indelmap_iterator != indelmap[line_vector[0]].begin())) {
-         --indelmap_iterator;
+      if (indelmap_index == scaffold_indelmap.size() || (newref_position < scaffold_indelmap[indelmap_index].second && indelmap_index != 0)) {
+         --indelmap_index;
       }
-      long left_ins_flank = left_iterator->second + right_iterator->first - left_iterator->first;
-      long right_ins_flank = right_iterator->second;
+      const pair<long, long> &indelmap_entry = scaffold_indelmap[indelmap_index];
+      const pair<long, long> &left_entry = scaffold_indelmap[left_index];
+      const pair<long, long> &right_entry = scaffold_indelmap[right_index];
+      long left_ins_flank = left_entry.second + right_entry.first - left_entry.first;
+      long right_ins_flank = right_entry.second;
       if (debug) {
-         cerr << newref_position << '\t' << indelmap_iterator->first - indelmap_iterator->second << '\t' << left_iterator->first << '\t' << right_iterator->first << '\t' << left_iterator->second << '\t' << right_iterator->second << '\t' << left_ins_flank << '\t' << right_ins_flank << endl;
+         cerr << newref_position << '\t' << indelmap_entry.first - indelmap_entry.second << '\t' << left_entry.first << '\t' << right_entry.first << '\t' << left_entry.second << '\t' << right_entry.second << '\t' << left_ins_flank << '\t' << right_ins_flank << endl;
       }
       if (newref_position > left_ins_flank && newref_position < right_ins_flank) {
          //Mutation along branch 2 is within insertion on branch 1
          if (debug) {
-            cerr << "Mutation along branch 2 is within insertion on branch 1 at unadjusted position " << line_vector[0] << ":" << newref_position << endl;
+            cerr << "Mutation along branch 2 is within insertion on branch 1 at unadjusted position " << scaffold << ":" << newref_position << endl;
          }
          continue;
       }
-      long adjusted_position = newref_position + indelmap_iterator->first - indelmap_iterator->second;
-      //if (adjusted_position < indelmap_iterator->second && indelmap_iterator->second > 0) { // We went too far in the indel map
-      //   --indelmap_iterator;
-      //} else {
-      //   while (adjusted_position <= indelmap_iterator->second && indelmap_iterator != indelmap[line_vector[0]].end()) {
-      //      ++indelmap_iterator;
-      //   }
-      //   //Make sure to check the left boundary condition, drop back to last interval with start <= adjusted_position:
-      //   if (adjusted_position > indelmap_iterator->second && indelmap_iterator != indelmap[line_vector[0]].begin()) {
-      //      --indelmap_iterator;
-      //   }
-      //}
-      //adjusted_position += indelmap_iterator->first - indelmap_iterator->second;
-      //If this scaffold isn't present in the branch 1 SNP log, output the adjusted record:
-      if (branch1_log.count(line_vector[0]) == 0) {
-         cout << line_vector[0] << '\t' << adjusted_position << '\t' << int2bases[oldallele] << '\t' << int2bases[newallele] << endl;
-      } else {
-         while ((*b1log_iterator)[0] < adjusted_position && b1log_iterator != branch1_log[line_vector[0]].end()) { //Output branch 1-exclusive events
-            cout << line_vector[0] << '\t' << (*b1log_iterator)[0] << '\t' << int2bases[(*b1log_iterator)[1]] << '\t' << int2bases[(*b1log_iterator)[2]] << endl;
-            ++b1log_iterator;
-         }
-         if (b1log_iterator == branch1_log[line_vector[0]].end()) { //No more branch 1 records, so short-circuit outputting branch 2 records
-            cout << line_vector[0] << '\t' << adjusted_position << '\t' << int2bases[oldallele] << '\t' << int2bases[newallele] << endl;
-         } else if ((*b1log_iterator)[0] == adjusted_position) { //Transitively reduce this record
-            if (debug && (*b1log_iterator)[2] != oldallele) { //Transitive mismatch, output an error if debug mode is on
-               cerr << "Allele mismatch during transitive reduction at " << line_vector[0] << " position " << adjusted_position << endl;
-               cerr << "Branch 1 says " << int2bases[(*b1log_iterator)[1]] << "->" << int2bases[(*b1log_iterator)[2]] << endl;
-               cerr << "Branch 2 says " << int2bases[oldallele] << "->" << int2bases[newallele] << endl;
-            }
-            cout << line_vector[0] << '\t' << adjusted_position << '\t' << int2bases[(*b1log_iterator)[1]] << '\t' << int2bases[newallele] << endl;
-            ++b1log_iterator;
-         } else { //Only branch 2 record at this position, so output it
-            cout << line_vector[0] << '\t' << adjusted_position << '\t' << int2bases[oldallele] << '\t' << int2bases[newallele] << endl;
+      long adjusted_position = newref_position + indelmap_entry.first - indelmap_entry.second;
+      while (b1log_index != b1log_end && (long)branch1_log.positions[b1log_index] < adjusted_position) { //Output branch 1-exclusive events
+         cout << scaffold << '\t' << branch1_log.positions[b1log_index] << '\t' << int2bases[branch1_log.old_alleles[b1log_index]] << '\t' << int2bases[branch1_log.new_alleles[b1log_index]] << '\n';
+         ++b1log_index;
+      }
+      if (b1log_index == b1log_end) { //No more branch 1 records, so short-circuit outputting branch 2 records
+         cout << scaffold << '\t' << adjusted_position << '\t' << int2bases[oldallele] << '\t' << int2bases[newallele] << '\n';
+      } else if ((long)branch1_log.positions[b1log_index] == adjusted_position) { //Transitively reduce this record
+         if (debug && branch1_log.new_alleles[b1log_index] != oldallele) { //Transitive mismatch, output an error if debug mode is on
+            cerr << "Allele mismatch during transitive reduction at " << scaffold << " position " << adjusted_position << endl;
+            cerr << "Branch 1 says " << int2bases[branch1_log.old_alleles[b1log_index]] << "->" << int2bases[branch1_log.new_alleles[b1log_index]] << endl;
+            cerr << "Branch 2 says " << int2bases[oldallele] << "->" << int2bases[newallele] << endl;
          }
+         cout << scaffold << '\t' << adjusted_position << '\t' << int2bases[branch1_log.old_alleles[b1log_index]] << '\t' << int2bases[newallele] << '\n';
+         ++b1log_index;
+      } else { //Only branch 2 record at this position, so output it
+         cout << scaffold << '\t' << adjusted_position << '\t' << int2bases[oldallele] << '\t' << int2bases[newallele] << '\n';
       }
    }
    
    branch2_snp_log.close();
    cerr << "Done reading branch 2 SNP log" << endl;
-
+   
+   //Merge the indel logs into the branch 1 source coordinate space:
+   if (!merged_indellog_path.empty()) {
+      indelLogStore branch1_indels, branch2_indels;
+      if (readIndelLog(indellog_path, scaffold_ids, branch1_indels)) {
+         cerr << "Error opening branch 1 indel log " << indellog_path << ".  Quitting." << endl;
+         return 3;
+      }
+      if (readIndelLog(branch2indellog_path, scaffold_ids, branch2_indels)) {
+         cerr << "Error opening branch 2 indel log " << branch2indellog_path << ".  Quitting." << endl;
+         return 7;
+      }
+      ofstream merged_indel_log;
+      merged_indel_log.open(merged_indellog_path);
+      if (!merged_indel_log) {
+         cerr << "Error opening merged indel log " << merged_indellog_path << ".  Quitting." << endl;
+         return 8;
+      }
+      cerr << "Merging indel logs" << endl;
+      branch1_indels.scaffolds.resize(scaffold_ids.size());
+      branch2_indels.scaffolds.resize(scaffold_ids.size());
+      if (mergeIndelLogs(scaffold_ids, branch1_indels, branch2_indels, merged_indel_log, debug)) {
+         cerr << "Failed to write merged indel log.  Quitting." << endl;
+         return 8;
+      }
+      merged_indel_log.close();
+      cerr << "Done merging indel logs" << endl;
+   }
    
    return 0;
 }
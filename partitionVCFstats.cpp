@@ -0,0 +1,439 @@
+/**********************************************************************************
+ * partitionVCFstats.cpp                                                          *
+ * Written by Patrick Reilly                                                      *
+ * Version 1.0 written 2026/10/18                                                 *
+ * Description:                                                                   *
+ *  Partitions a TSV of per-site VCF statistics (first two columns are scaffold   *
+ *  and position) by site class in a single pass, replacing one run of           *
+ *  subsetVCFstats.pl (and bedtools intersect) per class.                         *
+ *                                                                                *
+ * Syntax: partitionVCFstats -i [stats TSV(.gz)] -c [class BED prefix]            *
+ *         -b [callable BED] -o [output prefix] -H [output header TSV]            *
+ **********************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <getopt.h>
+#include <cctype>
+#include <cstdlib>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <array>
+#include <algorithm>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <deque>
+#include <zlib.h>
+
+//Define constants for getopt:
+#define no_argument 0
+#define required_argument 1
+#define optional_argument 2
+
+//Version:
+#define VERSION "1.0"
+
+//Usage/help:
+#define USAGE "partitionVCFstats\nUsage:\n partitionVCFstats -i [stats TSV, optionally gzipped] -c [class BED prefix]\n\t-b [callable BED] -o [output prefix] -H [output header TSV]\n\t-l [comma-separated site classes] -z [gzip compression level]\n"
+
+//Size of a batch of lines handed to a compression thread:
+#define BATCH_SIZE 1048576
+//Maximum number of batches waiting on a compression thread:
+#define MAX_QUEUED_BATCHES 8
+
+using namespace std;
+
+vector<string> splitString(string line_to_split, char delimiter) {
+   vector<string> line_vector;
+   string element;
+   istringstream line_to_split_stream(line_to_split);
+   while (getline(line_to_split_stream, element, delimiter)) {
+      line_vector.push_back(element);
+   }
+   return line_vector;
+}
+
+//Read a line from a gzipped or plain file of arbitrary length:
+bool gzGetline(gzFile input_file, string &line) {
+   char buffer[65536];
+   line.clear();
+   while (gzgets(input_file, buffer, sizeof(buffer)) != NULL) {
+      line.append(buffer);
+      if (!line.empty() && line.back() == '\n') {
+         line.pop_back();
+         return 1;
+      }
+   }
+   return !line.empty();
+}
+
+//Read a BED into per-scaffold vectors of sorted, merged, 1-based closed intervals:
+bool readBED(string bed_path, map<string, vector<pair<long, long>>> &intervals) {
+   ifstream bed_file;
+   bed_file.open(bed_path);
+   if (!bed_file) {
+      cerr << "Failed to open input BED file " << bed_path << endl;
+      return 1;
+   }
+   string bedline;
+   while (getline(bed_file, bedline)) {
+      if (bedline.empty() || bedline[0] == '#') {
+         continue;
+      }
+      vector<string> line_vector = splitString(bedline, '\t');
+      if (line_vector.size() < 3) {
+         cerr << "BED file line does not have the appropriate number of fields: " << bedline << endl;
+         bed_file.close();
+         return 1;
+      }
+      intervals[line_vector[0]].push_back(make_pair(stol(line_vector[1])+1, stol(line_vector[2])));
+   }
+   bed_file.close();
+   for (auto scaffold_iterator = intervals.begin(); scaffold_iterator != intervals.end(); ++scaffold_iterator) {
+      vector<pair<long, long>> &scaffold_intervals = scaffold_iterator->second;
+      sort(scaffold_intervals.begin(), scaffold_intervals.end());
+      vector<pair<long, long>> merged;
+      for (auto interval_iterator = scaffold_intervals.begin(); interval_iterator != scaffold_intervals.end(); ++interval_iterator) {
+         if (!merged.empty() && interval_iterator->first <= merged.back().second + 1) {
+            merged.back().second = max(merged.back().second, interval_iterator->second);
+         } else {
+            merged.push_back(*interval_iterator);
+         }
+      }
+      scaffold_intervals.swap(merged);
+   }
+   return 0;
+}
+
+//Cursor over the intervals of the current scaffold:
+struct interval_cursor {
+   const vector<pair<long, long>> *intervals;
+   size_t index;
+};
+
+//Reset a cursor to the start of a scaffold's intervals (or none):
+void resetCursor(interval_cursor &cursor, map<string, vector<pair<long, long>>> &intervals, const string &scaffold) {
+   auto scaffold_iterator = intervals.find(scaffold);
+   cursor.intervals = scaffold_iterator == intervals.end() ? nullptr : &(scaffold_iterator->second);
+   cursor.index = 0;
+}
+
+//Advance a cursor to the first interval ending at or after pos, and check if pos is within it:
+bool cursorContains(interval_cursor &cursor, long pos) {
+   if (cursor.intervals == nullptr) {
+      return 0;
+   }
+   while (cursor.index < cursor.intervals->size() && (*cursor.intervals)[cursor.index].second < pos) {
+      cursor.index++;
+   }
+   return cursor.index < cursor.intervals->size() && (*cursor.intervals)[cursor.index].first <= pos;
+}
+
+//A compressed output fed batches of lines by the main thread, and compressed by its own thread:
+class compressedOutput {
+   public:
+      bool open(string path, int level);
+      void write(const string &line);
+      bool close();
+      unsigned long lines = 0;
+   private:
+      gzFile output_file;
+      string batch;
+      deque<string> queue;
+      bool finished = 0;
+      bool failed = 0;
+      mutex queue_mutex;
+      condition_variable queue_changed;
+      thread compressor;
+      void enqueue();
+      void compress();
+};
+
+bool compressedOutput::open(string path, int level) {
+   string mode = "wb" + to_string(level);
+   output_file = gzopen(path.c_str(), mode.c_str());
+   if (output_file == NULL) {
+      return 1;
+   }
+   gzbuffer(output_file, 262144);
+   batch.reserve(BATCH_SIZE + 65536);
+   compressor = thread(&compressedOutput::compress, this);
+   return 0;
+}
+
+void compressedOutput::write(const string &line) {
+   batch.append(line);
+   batch.push_back('\n');
+   lines++;
+   if (batch.size() >= BATCH_SIZE) {
+      enqueue();
+   }
+}
+
+void compressedOutput::enqueue() {
+   unique_lock<mutex> lock(queue_mutex);
+   queue_changed.wait(lock, [this]() { return queue.size() < MAX_QUEUED_BATCHES; });
+   queue.push_back(string());
+   queue.back().swap(batch);
+   batch.reserve(BATCH_SIZE + 65536);
+   lock.unlock();
+   queue_changed.notify_all();
+}
+
+void compressedOutput::compress() {
+   while (true) {
+      string current_batch;
+      {
+         unique_lock<mutex> lock(queue_mutex);
+         queue_changed.wait(lock, [this]() { return !queue.empty() || finished; });
+         if (queue.empty()) {
+            break;
+         }
+         current_batch.swap(queue.front());
+         queue.pop_front();
+      }
+      queue_changed.notify_all();
+      if (gzwrite(output_file, current_batch.data(), current_batch.size()) != (int)current_batch.size()) {
+         failed = 1;
+      }
+   }
+}
+
+bool compressedOutput::close() {
+   if (!batch.empty()) {
+      enqueue();
+   }
+   {
+      lock_guard<mutex> lock(queue_mutex);
+      finished = 1;
+   }
+   queue_changed.notify_all();
+   compressor.join();
+   if (gzclose(output_file) != Z_OK) {
+      failed = 1;
+   }
+   return failed;
+}
+
+int main(int argc, char **argv) {
+   //Input and output paths:
+   string stats_path = "-", class_prefix, callable_path, output_prefix, header_path;
+
+   //Site classes to partition into:
+   vector<string> site_classes = {"ER", "FN", "FP", "TN", "TP"};
+
+   //Compression level of the outputs, matching gzip -9 by default:
+   int compression_level = 9;
+
+   //Option for debugging:
+   bool debug = 0;
+
+   //Variables for getopt_long:
+   int optchar;
+   int structindex = 0;
+   extern int optind;
+   //Create the struct used for getopt:
+   const struct option longoptions[] {
+      {"vcf_stats", required_argument, 0, 'i'},
+      {"class_prefix", required_argument, 0, 'c'},
+      {"callable_bed", required_argument, 0, 'b'},
+      {"output_prefix", required_argument, 0, 'o'},
+      {"output_header", required_argument, 0, 'H'},
+      {"classes", required_argument, 0, 'l'},
+      {"compression_level", required_argument, 0, 'z'},
+      {"debug", no_argument, 0, 'd'},
+      {"version", no_argument, 0, 'v'},
+      {"help", no_argument, 0, 'h'}
+   };
+   //Read in the options:
+   while ((optchar = getopt_long(argc, argv, "i:c:b:o:H:l:z:dvh", longoptions, &structindex)) > -1) {
+      switch(optchar) {
+         case 'i':
+            cerr << "Using VCF stats TSV: " << optarg << endl;
+            stats_path = optarg;
+            break;
+         case 'c':
+            cerr << "Using site class BEDs with prefix: " << optarg << endl;
+            class_prefix = optarg;
+            break;
+         case 'b':
+            cerr << "Using callable sites BED: " << optarg << endl;
+            callable_path = optarg;
+            break;
+         case 'o':
+            cerr << "Outputting partitioned stats with prefix: " << optarg << endl;
+            output_prefix = optarg;
+            break;
+         case 'H':
+            cerr << "Outputting stats header to: " << optarg << endl;
+            header_path = optarg;
+            break;
+         case 'l':
+            cerr << "Partitioning into site classes: " << optarg << endl;
+            site_classes = splitString(optarg, ',');
+            break;
+         case 'z':
+            cerr << "Using compression level " << optarg << endl;
+            compression_level = stoi(optarg);
+            break;
+         case 'd':
+            cerr << "Debugging mode enabled." << endl;
+            debug = 1;
+            break;
+         case 'v':
+            cerr << "partitionVCFstats version " << VERSION << endl;
+            return 0;
+            break;
+         case 'h':
+            cerr << USAGE;
+            return 0;
+            break;
+         default:
+            cerr << "Unknown option " << (unsigned char)optchar << " supplied." << endl;
+            cerr << USAGE;
+            return 1;
+            break;
+      }
+   }
+
+   //Ignore positional arguments
+   if (optind < argc) {
+      cerr << "Ignoring extra positional arguments starting at " << argv[optind++] << endl;
+   }
+
+   //Check that the class BED prefix is set:
+   if (class_prefix.empty() || site_classes.empty()) {
+      cerr << "Missing the site class BED prefix or site classes.  Quitting." << endl;
+      return 2;
+   }
+   if (output_prefix.empty()) {
+      output_prefix = class_prefix;
+   }
+   if (callable_path == "all") {
+      callable_path = "";
+   }
+
+   //Read in the site class BEDs and callable BED:
+   vector<map<string, vector<pair<long, long>>>> class_intervals(site_classes.size());
+   for (size_t c = 0; c < site_classes.size(); c++) {
+      string bed_path = class_prefix + "_" + site_classes[c] + "s.bed";
+      if (debug) {
+         cerr << "Reading BED file " << bed_path << endl;
+      }
+      if (readBED(bed_path, class_intervals[c])) {
+         return 3;
+      }
+   }
+   map<string, vector<pair<long, long>>> callable_intervals;
+   if (!callable_path.empty()) {
+      if (debug) {
+         cerr << "Reading callable BED file " << callable_path << endl;
+      }
+      if (readBED(callable_path, callable_intervals)) {
+         return 3;
+      }
+   }
+
+   //Open the stats TSV:
+   gzFile stats_file = stats_path == "-" ? gzdopen(0, "rb") : gzopen(stats_path.c_str(), "rb");
+   if (stats_file == NULL) {
+      cerr << "Failed to open input VCF stats TSV file " << stats_path << endl;
+      return 2;
+   }
+   gzbuffer(stats_file, 1048576);
+
+   //Open the outputs, each compressed by its own thread:
+   vector<compressedOutput> outputs(site_classes.size());
+   for (size_t c = 0; c < site_classes.size(); c++) {
+      string output_path = output_prefix + "_" + site_classes[c] + "_stats.tsv.gz";
+      if (outputs[c].open(output_path, compression_level)) {
+         cerr << "Failed to open output file " << output_path << endl;
+         for (size_t o = 0; o < c; o++) {
+            outputs[o].close();
+         }
+         gzclose(stats_file);
+         return 5;
+      }
+   }
+
+   //Stream through the stats TSV once, walking a cursor over each class's intervals:
+   cerr << "Processing stats file " << stats_path << endl;
+   vector<interval_cursor> class_cursors(site_classes.size());
+   interval_cursor callable_cursor;
+   string prev_scaffold = "";
+   bool first_line = 1;
+   bool malformed = 0;
+   string statsline;
+   unsigned long num_lines = 0;
+   while (gzGetline(stats_file, statsline)) {
+      size_t first_tab = statsline.find('\t');
+      size_t second_tab = first_tab == string::npos ? string::npos : statsline.find('\t', first_tab + 1);
+      //The first line is the header if it's a comment or its position isn't numeric:
+      if (first_line) {
+         first_line = 0;
+         if (statsline[0] == '#' || first_tab == string::npos || !isdigit(statsline[first_tab+1])) {
+            if (!header_path.empty()) {
+               ofstream header_file;
+               header_file.open(header_path);
+               if (!header_file) {
+                  cerr << "Failed to open output header file " << header_path << endl;
+                  malformed = 1;
+                  break;
+               }
+               header_file << statsline << endl;
+               header_file.close();
+            }
+            continue;
+         }
+      }
+      if (statsline.empty() || statsline[0] == '#') { //Skip any comment lines
+         continue;
+      }
+      //Bail out of parsing if the line doesn't have the correct number of fields:
+      if (second_tab == string::npos) {
+         cerr << "Stats file line does not have the appropriate number of fields: " << statsline << endl;
+         malformed = 1;
+         break;
+      }
+      num_lines++;
+      //Reset the cursors for each new scaffold:
+      if (statsline.compare(0, first_tab, prev_scaffold) != 0 || prev_scaffold.length() != first_tab) {
+         prev_scaffold = statsline.substr(0, first_tab);
+         for (size_t c = 0; c < site_classes.size(); c++) {
+            resetCursor(class_cursors[c], class_intervals[c], prev_scaffold);
+         }
+         resetCursor(callable_cursor, callable_intervals, prev_scaffold);
+      }
+      long pos = atol(statsline.c_str() + first_tab + 1);
+      if (!callable_path.empty() && !cursorContains(callable_cursor, pos)) {
+         continue;
+      }
+      for (size_t c = 0; c < site_classes.size(); c++) {
+         if (cursorContains(class_cursors[c], pos)) {
+            outputs[c].write(statsline);
+         }
+      }
+   }
+   gzclose(stats_file);
+
+   bool write_failed = 0;
+   for (size_t c = 0; c < site_classes.size(); c++) {
+      write_failed |= outputs[c].close();
+      if (debug) {
+         cerr << "Output " << outputs[c].lines << " " << site_classes[c] << " sites" << endl;
+      }
+   }
+   if (malformed) {
+      return 4;
+   }
+   if (write_failed) {
+      cerr << "Error writing partitioned stats files" << endl;
+      return 6;
+   }
+   cerr << "Done partitioning " << num_lines << " sites from stats file " << stats_path << endl;
+
+   return 0;
+}
@@ -0,0 +1,934 @@
+/**********************************************************************************
+ * runTasks.cpp                                                                   *
+ * Written by Patrick Reilly                                                      *
+ * Version 1.0 written 2026/10/18                                                 *
+ * Description:                                                                   *
+ *  Runs the CLASSIFY, JOINTCLASSIFY, INDELDIST, and STATS tasks of a metadata   *
+ *  file via localArrayCall.sh, skipping the stages whose outputs are current.   *
+ *  Each stage is fingerprinted by the content of its inputs, the scripts and    *
+ *  tools it runs, and its metadata row, and the fingerprint and the hashes of   *
+ *  its outputs are stored in a stamp file next to the outputs.  A stage reruns  *
+ *  only if its fingerprint or outputs changed, so a stage whose upstream stage  *
+ *  reran but produced identical outputs is still skipped.  File hashes are      *
+ *  cached by size and modification time, so unchanged inputs aren't re-read.    *
+ *  Stages are scheduled in dependency order (JOINTCLASSIFY, then CLASSIFY,      *
+ *  then INDELDIST and STATS) on a work-stealing pool of threads.                *
+ *                                                                                *
+ * Syntax: runTasks -m [metadata TSV] -g [ground truth] [-b callable BED]         *
+ *         -j [job types] -t [threads]                                            *
+ **********************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <getopt.h>
+#include <cstdlib>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+#include <array>
+#include <map>
+#include <set>
+#include <deque>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <mutex>
+#include <condition_variable>
+#include <sys/stat.h>
+#include <sys/wait.h>
+
+//Define constants for getopt:
+#define no_argument 0
+#define required_argument 1
+#define optional_argument 2
+
+//Version:
+#define VERSION "1.0"
+
+//Usage/help:
+#define USAGE "runTasks\nUsage:\n runTasks -m [metadata TSV] -g [ground truth] [-b callable BED]\n\t-j [comma-separated job types, default CLASSIFY] -t [threads]\n\t-c [file hash cache, default metadata path + .hashes.tsv]\n\t-n (dry run) -f (force rerun of all stages)\n"
+
+//Size of the chunks files are hashed in:
+#define HASH_CHUNK_SIZE 1048576
+
+using namespace std;
+
+vector<string> splitString(string line_to_split, char delimiter) {
+   vector<string> line_vector;
+   string element;
+   istringstream line_to_split_stream(line_to_split);
+   while (getline(line_to_split_stream, element, delimiter)) {
+      line_vector.push_back(element);
+   }
+   return line_vector;
+}
+
+//Streaming 64-bit hash of file contents and stage fingerprints
+// (FNV-1a over 8-byte words, with a final avalanche):
+class contentHash {
+   public:
+      void update(const char *data, size_t length);
+      void update(const string &text) {
+         update(text.data(), text.length());
+      }
+      uint64_t digest();
+   private:
+      uint64_t state = 14695981039346656037ULL;
+      uint64_t total_length = 0;
+      char pending[8];
+      size_t num_pending = 0;
+      void mix(uint64_t word) {
+         state = (state ^ word) * 1099511628211ULL;
+         state ^= state >> 29;
+      }
+};
+
+void contentHash::update(const char *data, size_t length) {
+   total_length += length;
+   size_t i = 0;
+   //Finish the partial word left by the last update:
+   while (num_pending > 0 && num_pending < 8 && i < length) {
+      pending[num_pending++] = data[i++];
+   }
+   if (num_pending == 8) {
+      uint64_t word;
+      memcpy(&word, pending, 8);
+      mix(word);
+      num_pending = 0;
+   }
+   for (; i + 8 <= length; i += 8) {
+      uint64_t word;
+      memcpy(&word, data + i, 8);
+      mix(word);
+   }
+   for (; i < length; i++) {
+      pending[num_pending++] = data[i];
+   }
+}
+
+uint64_t contentHash::digest() {
+   uint64_t word = 0;
+   if (num_pending > 0) {
+      memcpy(&word, pending, num_pending);
+      mix(word);
+   }
+   mix(total_length);
+   //Finalizer of MurmurHash3:
+   uint64_t hash = state;
+   hash ^= hash >> 33;
+   hash *= 0xff51afd7ed558ccdULL;
+   hash ^= hash >> 33;
+   hash *= 0xc4ceb9fe1a85ec53ULL;
+   hash ^= hash >> 33;
+   return hash;
+}
+
+string hexHash(uint64_t hash) {
+   ostringstream hex_stream;
+   hex_stream << hex << setw(16) << setfill('0') << hash;
+   return hex_stream.str();
+}
+
+//Content hashes of files, cached by path, size, and modification time:
+class fileHashCache {
+   public:
+      bool read(const string &cache_path);
+      bool write(const string &cache_path);
+      //Hash of the file contents as hex, or "missing":
+      string hash(const string &path);
+   private:
+      struct cachedHash {
+         off_t size;
+         long mtime_sec;
+         long mtime_nsec;
+         string hash;
+      };
+      map<string, cachedHash> hashes;
+      mutex hashes_mutex;
+};
+
+bool fileHashCache::read(const string &cache_path) {
+   ifstream cache_file;
+   cache_file.open(cache_path);
+   if (!cache_file) {
+      return 1;
+   }
+   string cacheline;
+   while (getline(cache_file, cacheline)) {
+      vector<string> line_vector = splitString(cacheline, '\t');
+      if (line_vector.size() < 5) {
+         continue;
+      }
+      cachedHash cached;
+      cached.size = stoll(line_vector[1]);
+      cached.mtime_sec = stol(line_vector[2]);
+      cached.mtime_nsec = stol(line_vector[3]);
+      cached.hash = line_vector[4];
+      hashes[line_vector[0]] = cached;
+   }
+   cache_file.close();
+   return 0;
+}
+
+//Write to a temporary file and rename it into place, so an interrupted
+// run never leaves a truncated cache:
+bool fileHashCache::write(const string &cache_path) {
+   lock_guard<mutex> hashes_lock(hashes_mutex);
+   string temp_path = cache_path + ".tmp";
+   ofstream cache_file;
+   cache_file.open(temp_path);
+   if (!cache_file) {
+      return 1;
+   }
+   for (auto hash_iterator = hashes.begin(); hash_iterator != hashes.end(); ++hash_iterator) {
+      cache_file << hash_iterator->first << '\t' << hash_iterator->second.size << '\t' << hash_iterator->second.mtime_sec << '\t' << hash_iterator->second.mtime_nsec << '\t' << hash_iterator->second.hash << '\n';
+   }
+   cache_file.close();
+   if (!cache_file || rename(temp_path.c_str(), cache_path.c_str()) != 0) {
+      return 1;
+   }
+   return 0;
+}
+
+string fileHashCache::hash(const string &path) {
+   struct stat file_stat;
+   if (stat(path.c_str(), &file_stat) != 0 || !S_ISREG(file_stat.st_mode)) {
+      return "missing";
+   }
+   {
+      lock_guard<mutex> hashes_lock(hashes_mutex);
+      auto hash_iterator = hashes.find(path);
+      if (hash_iterator != hashes.end() && hash_iterator->second.size == file_stat.st_size && hash_iterator->second.mtime_sec == file_stat.st_mtim.tv_sec && hash_iterator->second.mtime_nsec == file_stat.st_mtim.tv_nsec) {
+         return hash_iterator->second.hash;
+      }
+   }
+   //Hash outside the lock, so other stages can look up other files:
+   ifstream input_file;
+   input_file.open(path, ios::binary);
+   if (!input_file) {
+      return "missing";
+   }
+   contentHash file_hash;
+   vector<char> buffer(HASH_CHUNK_SIZE);
+   while (input_file) {
+      input_file.read(buffer.data(), buffer.size());
+      file_hash.update(buffer.data(), input_file.gcount());
+   }
+   input_file.close();
+   cachedHash cached;
+   cached.size = file_stat.st_size;
+   cached.mtime_sec = file_stat.st_mtim.tv_sec;
+   cached.mtime_nsec = file_stat.st_mtim.tv_nsec;
+   cached.hash = hexHash(file_hash.digest());
+   lock_guard<mutex> hashes_lock(hashes_mutex);
+   hashes[path] = cached;
+   return cached.hash;
+}
+
+//Split a prefix into its directory (with trailing /) and basename, as
+// the task scripts do with dirname and basename:
+void splitPrefix(const string &path_prefix, string &directory, string &base) {
+   size_t last_slash = path_prefix.find_last_of('/');
+   if (last_slash == string::npos) {
+      directory = "";
+      base = path_prefix;
+   } else {
+      directory = last_slash == 0 ? "/" : path_prefix.substr(0, last_slash) + "/";
+      base = path_prefix.substr(last_slash+1);
+   }
+}
+
+//Quote an argument for the shell:
+string shellQuote(const string &argument) {
+   string quoted = "'";
+   for (auto char_iterator = argument.begin(); char_iterator != argument.end(); ++char_iterator) {
+      if (*char_iterator == '\'') {
+         quoted += "'\\''";
+      } else {
+         quoted += *char_iterator;
+      }
+   }
+   return quoted + "'";
+}
+
+//Paths of a metadata row for a job type, named as in classifySites.sh,
+// indelDist.sh, and extractStats.sh:
+struct taskPaths {
+   string prefix;
+   string ref;
+   string caller;
+   string special;
+   string joint_prefix;
+   bool joint;
+   //Joint VCF prefix with NOMARKDUP, REALIGNED, and caller, the key of JOINTCLASSIFY:
+   string joint_int_prefix;
+   //The VCF (and its .gz for HC, which the scripts fall back to):
+   vector<string> input_vcfs;
+   string out_prefix;
+   string int_prefix;
+   string log_prefix;
+   //Unfiltered INSNP made by CLASSIFY:
+   string insnp;
+};
+
+bool findTaskPaths(const vector<string> &metadata_row, const string &job_type, taskPaths &paths) {
+   paths.prefix = metadata_row[0];
+   paths.ref = metadata_row[1];
+   paths.caller = metadata_row[2];
+   paths.special = metadata_row[3];
+   size_t joint_column = job_type == "STATS" ? 5 : 4;
+   paths.joint_prefix = metadata_row.size() > joint_column ? metadata_row[joint_column] : "";
+   bool jointgeno = paths.special.find("jointgeno") != string::npos;
+   if (jointgeno && paths.joint_prefix.empty()) {
+      cerr << "Please specify a prefix for the jointly-genotyped VCF when using the jointgeno option for sample " << paths.prefix << endl;
+      return 1;
+   }
+   paths.joint = jointgeno;
+   string output_dir, base_prefix, joint_output_dir, joint_base_prefix;
+   splitPrefix(paths.prefix, output_dir, base_prefix);
+   splitPrefix(paths.joint_prefix, joint_output_dir, joint_base_prefix);
+   string marks = "";
+   if (paths.special.find("no_markdup") != string::npos) {
+      marks += "_nomarkdup";
+   }
+   if (paths.special.find("no_IR") == string::npos) {
+      marks += "_realigned";
+   }
+   string vcf_suffix, gzipped, insnp_suffix;
+   if (paths.caller.find("HC") != string::npos) {
+      vcf_suffix = "_HC_GGVCFs.vcf";
+      gzipped = "";
+      insnp_suffix = "_GGVCFs_unfiltered_INSNP.tsv";
+   } else if (paths.caller.find("MPILEUP") != string::npos) {
+      vcf_suffix = "_mpileupcall.vcf";
+      gzipped = ".gz";
+      insnp_suffix = "_unfiltered_INSNP.tsv";
+   } else {
+      cerr << "Unable to determine VCF suffix for variant caller " << paths.caller << " of sample " << paths.prefix << endl;
+      return 1;
+   }
+   if (paths.joint) {
+      paths.joint_int_prefix = joint_output_dir + joint_base_prefix + marks + "_" + paths.caller + "_joint";
+      paths.input_vcfs.push_back(paths.joint_int_prefix + ".vcf" + gzipped);
+      paths.out_prefix = base_prefix + marks + "_" + paths.caller + "_joint";
+   } else {
+      paths.input_vcfs.push_back(output_dir + base_prefix + marks + vcf_suffix + gzipped);
+      paths.out_prefix = base_prefix + marks + "_" + paths.caller;
+   }
+   if (gzipped.empty()) {
+      paths.input_vcfs.push_back(paths.input_vcfs[0] + ".gz");
+   }
+   paths.int_prefix = output_dir + paths.out_prefix;
+   paths.log_prefix = output_dir + "logs/" + paths.out_prefix;
+   paths.insnp = paths.int_prefix + insnp_suffix;
+   return 0;
+}
+
+//A stage of the task graph, run as one localArrayCall.sh call:
+struct taskStage {
+   string job_type;
+   //Line of the metadata file passed to localArrayCall.sh:
+   unsigned long task_id;
+   string description;
+   //Metadata rows and arguments the stage depends on:
+   string manifest;
+   vector<string> inputs;
+   //Scripts and tools the stage runs:
+   vector<string> tools;
+   vector<string> outputs;
+   string stamp_path;
+   string log_prefix;
+   vector<size_t> dependencies;
+   vector<size_t> dependents;
+   unsigned int pending_dependencies = 0;
+   //Stage state: 0 waiting, 1 skipped, 2 ran, 3 failed, 4 not run due to a failed upstream stage
+   unsigned char state = 0;
+};
+
+//Fingerprint of the inputs, tools, and metadata of a stage:
+string stageFingerprint(const taskStage &stage, fileHashCache &file_hashes) {
+   contentHash fingerprint;
+   fingerprint.update(stage.job_type + '\n' + stage.manifest + '\n');
+   for (auto input_iterator = stage.inputs.begin(); input_iterator != stage.inputs.end(); ++input_iterator) {
+      fingerprint.update("input\t" + *input_iterator + '\t' + file_hashes.hash(*input_iterator) + '\n');
+   }
+   for (auto tool_iterator = stage.tools.begin(); tool_iterator != stage.tools.end(); ++tool_iterator) {
+      fingerprint.update("tool\t" + *tool_iterator + '\t' + file_hashes.hash(*tool_iterator) + '\n');
+   }
+   return hexHash(fingerprint.digest());
+}
+
+//Check the stamp of a stage against its fingerprint and current outputs:
+bool stageIsCurrent(const taskStage &stage, const string &fingerprint, fileHashCache &file_hashes) {
+   ifstream stamp_file;
+   stamp_file.open(stage.stamp_path);
+   if (!stamp_file) {
+      return 0;
+   }
+   string stampline;
+   bool fingerprint_matches = 0;
+   size_t num_outputs = 0;
+   while (getline(stamp_file, stampline)) {
+      vector<string> line_vector = splitString(stampline, '\t');
+      if (line_vector.size() == 2 && line_vector[0] == "fingerprint") {
+         fingerprint_matches = line_vector[1] == fingerprint;
+      } else if (line_vector.size() == 3 && line_vector[0] == "output") {
+         if (num_outputs >= stage.outputs.size() || line_vector[1] != stage.outputs[num_outputs] || file_hashes.hash(line_vector[1]) != line_vector[2]) {
+            return 0;
+         }
+         num_outputs++;
+      }
+   }
+   stamp_file.close();
+   return fingerprint_matches && num_outputs == stage.outputs.size();
+}
+
+bool writeStamp(const taskStage &stage, const string &fingerprint, fileHashCache &file_hashes) {
+   ofstream stamp_file;
+   stamp_file.open(stage.stamp_path);
+   if (!stamp_file) {
+      return 1;
+   }
+   stamp_file << "#runTasks " << VERSION << " stamp of " << stage.description << endl;
+   stamp_file << "fingerprint\t" << fingerprint << endl;
+   for (auto output_iterator = stage.outputs.begin(); output_iterator != stage.outputs.end(); ++output_iterator) {
+      stamp_file << "output\t" << *output_iterator << '\t' << file_hashes.hash(*output_iterator) << endl;
+   }
+   stamp_file.close();
+   return !stamp_file;
+}
+
+//Work-stealing pool: each worker runs the stages that became ready on it
+// most recently first, and idle workers steal the oldest ready stages of
+// the other workers:
+class stagePool {
+   public:
+      stagePool(unsigned int num_workers) : ready(num_workers), ready_mutexes(num_workers) {}
+      void push(unsigned int worker, size_t stage_index);
+      //Returns 0 once no stages remain:
+      bool pop(unsigned int worker, size_t &stage_index);
+      //Record that a stage left the graph:
+      void retire(size_t num_stages);
+      void setRemaining(size_t num_stages) {
+         remaining = num_stages;
+      }
+   private:
+      vector<deque<size_t>> ready;
+      vector<mutex> ready_mutexes;
+      atomic<size_t> num_ready {0};
+      atomic<size_t> remaining {0};
+      mutex idle_mutex;
+      condition_variable idle_condition;
+};
+
+void stagePool::push(unsigned int worker, size_t stage_index) {
+   {
+      lock_guard<mutex> ready_lock(ready_mutexes[worker]);
+      ready[worker].push_back(stage_index);
+   }
+   num_ready++;
+   lock_guard<mutex> idle_lock(idle_mutex);
+   idle_condition.notify_all();
+}
+
+void stagePool::retire(size_t num_stages) {
+   remaining -= num_stages;
+   lock_guard<mutex> idle_lock(idle_mutex);
+   idle_condition.notify_all();
+}
+
+bool stagePool::pop(unsigned int worker, size_t &stage_index) {
+   size_t num_workers = ready.size();
+   while (true) {
+      for (size_t i = 0; i < num_workers; i++) {
+         size_t victim = (worker + i) % num_workers;
+         lock_guard<mutex> ready_lock(ready_mutexes[victim]);
+         if (!ready[victim].empty()) {
+            if (i == 0) {
+               stage_index = ready[victim].back();
+               ready[victim].pop_back();
+            } else {
+               stage_index = ready[victim].front();
+               ready[victim].pop_front();
+            }
+            num_ready--;
+            return 1;
+         }
+      }
+      unique_lock<mutex> idle_lock(idle_mutex);
+      idle_condition.wait(idle_lock, [&]() {
+         return num_ready > 0 || remaining == 0;
+      });
+      if (num_ready == 0 && remaining == 0) {
+         return 0;
+      }
+   }
+}
+
+int main(int argc, char **argv) {
+   //Path to the metadata TSV:
+   string metadata_path;
+   //Ground truth and callable sites BED passed to localArrayCall.sh:
+   string groundtruth_path;
+   string callable_path;
+   //Job types to run:
+   vector<string> job_types;
+   //Number of stages to run at once:
+   unsigned int num_threads = 1;
+   //Path to the cache of file hashes:
+   string cache_path;
+   //Only report which stages would run:
+   bool dry_run = 0;
+   //Rerun all stages regardless of their stamps:
+   bool force = 0;
+
+   //Option for debugging:
+   bool debug = 0;
+
+   //Variables for getopt_long:
+   int optchar;
+   int structindex = 0;
+   extern int optind;
+   //Create the struct used for getopt:
+   const struct option longoptions[] {
+      {"metadata", required_argument, 0, 'm'},
+      {"groundtruth", required_argument, 0, 'g'},
+      {"callable", required_argument, 0, 'b'},
+      {"job_types", required_argument, 0, 'j'},
+      {"threads", required_argument, 0, 't'},
+      {"hash_cache", required_argument, 0, 'c'},
+      {"dry_run", no_argument, 0, 'n'},
+      {"force", no_argument, 0, 'f'},
+      {"debug", no_argument, 0, 'd'},
+      {"version", no_argument, 0, 'v'},
+      {"help", no_argument, 0, 'h'}
+   };
+   //Read in the options:
+   while ((optchar = getopt_long(argc, argv, "m:g:b:j:t:c:nfdvh", longoptions, &structindex)) > -1) {
+      switch(optchar) {
+         case 'm':
+            cerr << "Using metadata file: " << optarg << endl;
+            metadata_path = optarg;
+            break;
+         case 'g':
+            cerr << "Using ground truth: " << optarg << endl;
+            groundtruth_path = optarg;
+            break;
+         case 'b':
+            cerr << "Using callable sites BED: " << optarg << endl;
+            callable_path = optarg;
+            break;
+         case 'j':
+            cerr << "Running job types: " << optarg << endl;
+            job_types = splitString(optarg, ',');
+            break;
+         case 't':
+            cerr << "Using " << optarg << " threads" << endl;
+            num_threads = stoul(optarg);
+            break;
+         case 'c':
+            cerr << "Using file hash cache: " << optarg << endl;
+            cache_path = optarg;
+            break;
+         case 'n':
+            cerr << "Dry run, only reporting stages that would run." << endl;
+            dry_run = 1;
+            break;
+         case 'f':
+            cerr << "Rerunning all stages regardless of stamps." << endl;
+            force = 1;
+            break;
+         case 'd':
+            cerr << "Debugging mode enabled." << endl;
+            debug = 1;
+            break;
+         case 'v':
+            cerr << "runTasks version " << VERSION << endl;
+            return 0;
+            break;
+         case 'h':
+            cerr << USAGE;
+            return 0;
+            break;
+         default:
+            cerr << "Unknown option " << (unsigned char)optchar << " supplied." << endl;
+            cerr << USAGE;
+            return 1;
+            break;
+      }
+   }
+
+   //Ignore positional arguments
+   if (optind < argc) {
+      cerr << "Ignoring extra positional arguments starting at " << argv[optind++] << endl;
+   }
+
+   if (metadata_path.empty() || groundtruth_path.empty()) {
+      cerr << "Missing one of the metadata file or ground truth.  Quitting." << endl;
+      return 2;
+   }
+   if (job_types.empty()) {
+      job_types.push_back("CLASSIFY");
+   }
+   set<string> requested_jobs;
+   for (auto job_iterator = job_types.begin(); job_iterator != job_types.end(); ++job_iterator) {
+      if (*job_iterator != "CLASSIFY" && *job_iterator != "JOINTCLASSIFY" && *job_iterator != "INDELDIST" && *job_iterator != "STATS") {
+         cerr << "Unintelligible job type " << *job_iterator << ".  Quitting." << endl;
+         return 2;
+      }
+      requested_jobs.insert(*job_iterator);
+   }
+   if (num_threads == 0) {
+      num_threads = 1;
+   }
+   if (cache_path.empty()) {
+      cache_path = metadata_path + ".hashes.tsv";
+   }
+
+   //The scripts live next to runTasks, as with SCRIPTDIR in the task scripts:
+   string script_dir, program_name;
+   splitPrefix(argv[0], script_dir, program_name);
+   if (script_dir.empty()) {
+      script_dir = "./";
+   }
+   string local_array_call = script_dir + "localArrayCall.sh";
+   string compare_snp_logs = script_dir + "compareSNPlogs";
+   string pipeline_environment = script_dir + "pipeline_environment.sh";
+
+   //Read the metadata rows, numbered as task IDs by localArrayCall.sh:
+   ifstream metadata_file;
+   metadata_file.open(metadata_path);
+   if (!metadata_file) {
+      cerr << "Failed to open metadata file " << metadata_path << ".  Quitting." << endl;
+      return 3;
+   }
+   vector<vector<string>> metadata_rows;
+   vector<string> metadata_lines;
+   string metadataline;
+   while (getline(metadata_file, metadataline)) {
+      metadata_lines.push_back(metadataline);
+      metadata_rows.push_back(splitString(metadataline, '\t'));
+      if (!metadataline.empty() && metadata_rows.back().size() < 4) {
+         cerr << "Too few columns (" << metadata_rows.back().size() << ") on line " << metadata_rows.size() << " of metadata file " << metadata_path << ", is it actually tab-separated?  Quitting." << endl;
+         return 3;
+      }
+   }
+   metadata_file.close();
+
+   fileHashCache file_hashes;
+   if (!file_hashes.read(cache_path) && debug) {
+      cerr << "Read file hash cache " << cache_path << endl;
+   }
+
+   string callable_or_fai;
+   const char *class_names[] = {"ER", "FN", "FP", "TN", "TP"};
+   vector<taskStage> stages;
+   //Index of the JOINTCLASSIFY stage of each joint VCF, caller, and special options:
+   map<string, size_t> joint_stages;
+   //Index of the CLASSIFY stage of each task ID:
+   map<unsigned long, size_t> classify_stages;
+
+   //JOINTCLASSIFY stages, one per set of samples localArrayCall.sh groups together:
+   if (requested_jobs.count("JOINTCLASSIFY") > 0) {
+      for (size_t i = 0; i < metadata_rows.size(); i++) {
+         if (metadata_rows[i].empty()) {
+            continue;
+         }
+         taskPaths paths;
+         if (findTaskPaths(metadata_rows[i], "JOINTCLASSIFY", paths)) {
+            return 4;
+         }
+         if (!paths.joint) {
+            continue;
+         }
+         string group_key = paths.caller + '\t' + paths.special + '\t' + paths.joint_prefix;
+         auto joint_iterator = joint_stages.find(group_key);
+         if (joint_iterator == joint_stages.end()) {
+            joint_stages[group_key] = stages.size();
+            stages.push_back(taskStage());
+            taskStage &stage = stages.back();
+            stage.job_type = "JOINTCLASSIFY";
+            stage.task_id = i+1;
+            stage.description = "JOINTCLASSIFY of joint VCF " + paths.joint_prefix + " caller " + paths.caller;
+            stage.manifest = groundtruth_path + '\n';
+            stage.inputs = paths.input_vcfs;
+            stage.inputs.push_back(groundtruth_path);
+            stage.inputs.push_back(groundtruth_path + ".bin");
+            stage.inputs.push_back(paths.ref + ".fai");
+            stage.tools = {local_array_call, script_dir + "classifyJointVCF.sh", compare_snp_logs};
+            stage.outputs.push_back(paths.joint_int_prefix + "_samples.tsv");
+            stage.stamp_path = paths.joint_int_prefix + "_JOINTCLASSIFY.stamp";
+            string joint_output_dir, joint_base_prefix;
+            splitPrefix(paths.joint_prefix, joint_output_dir, joint_base_prefix);
+            stage.log_prefix = joint_output_dir + "logs/" + joint_base_prefix;
+            joint_iterator = joint_stages.find(group_key);
+         }
+         taskStage &stage = stages[joint_iterator->second];
+         stage.manifest += metadata_lines[i] + '\n';
+         stage.outputs.push_back(paths.insnp);
+         for (unsigned int j = 0; j < 5; j++) {
+            if (j != 3) {
+               stage.outputs.push_back(paths.int_prefix + "_" + class_names[j] + "s.tsv");
+            }
+         }
+         stage.outputs.push_back(paths.int_prefix + "_compareSNPlogs.txt");
+         if (paths.special.find("indeldist") != string::npos) {
+            stage.outputs.push_back(paths.int_prefix + "_indel_dists_all.tsv");
+         }
+      }
+   }
+
+   //CLASSIFY, INDELDIST, and STATS stages of each metadata row:
+   for (size_t i = 0; i < metadata_rows.size(); i++) {
+      if (metadata_rows[i].empty()) {
+         continue;
+      }
+      for (auto job_iterator = job_types.begin(); job_iterator != job_types.end(); ++job_iterator) {
+         const string &job_type = *job_iterator;
+         if (job_type == "JOINTCLASSIFY") {
+            continue;
+         }
+         taskPaths paths;
+         if (findTaskPaths(metadata_rows[i], job_type, paths)) {
+            return 4;
+         }
+         callable_or_fai = callable_path.empty() ? paths.ref + ".fai" : callable_path;
+         taskStage stage;
+         stage.job_type = job_type;
+         stage.task_id = i+1;
+         stage.description = job_type + " of sample " + paths.prefix + " caller " + paths.caller + " (task " + to_string(i+1) + ")";
+         stage.manifest = metadata_lines[i] + '\n' + callable_path + '\n';
+         stage.inputs = paths.input_vcfs;
+         stage.inputs.push_back(callable_or_fai);
+         stage.tools = {local_array_call, pipeline_environment};
+         stage.stamp_path = paths.int_prefix + "_" + job_type + ".stamp";
+         stage.log_prefix = paths.log_prefix;
+         bool indeldist = paths.special.find("indeldist") != string::npos;
+         if (job_type == "CLASSIFY") {
+            stage.manifest += groundtruth_path + '\n';
+            stage.inputs.push_back(groundtruth_path);
+            stage.inputs.push_back(groundtruth_path + ".bin");
+            stage.inputs.push_back(paths.ref + ".fai");
+            stage.inputs.push_back(paths.int_prefix + "_sitesToMask.bed");
+            stage.tools.push_back(script_dir + "classifySites.sh");
+            stage.tools.push_back(compare_snp_logs);
+            stage.tools.push_back(script_dir + (paths.caller.find("HC") != string::npos ? "VCFtoUnfilteredINSNP_skipInsertions_GGVCFs.awk" : "VCFtoUnfilteredINSNP_skipInsertions_samtools.awk"));
+            //With JOINTCLASSIFY, the classification is an input rather than an output:
+            bool from_joint = paths.joint && requested_jobs.count("JOINTCLASSIFY") > 0;
+            vector<string> &classification = from_joint ? stage.inputs : stage.outputs;
+            classification.push_back(paths.insnp);
+            for (unsigned int j = 0; j < 5; j++) {
+               if (j != 3) {
+                  classification.push_back(paths.int_prefix + "_" + class_names[j] + "s.tsv");
+               }
+            }
+            if (from_joint) {
+               stage.inputs.push_back(paths.int_prefix + "_compareSNPlogs.txt");
+            }
+            if (indeldist) {
+               classification.push_back(paths.int_prefix + "_indel_dists_all.tsv");
+            }
+            for (unsigned int j = 0; j < 5; j++) {
+               stage.outputs.push_back(paths.int_prefix + "_" + class_names[j] + "s.bed");
+            }
+         } else if (job_type == "INDELDIST") {
+            //indelDist.sh names the MPILEUP INSNP and the class BEDs its own way:
+            string indeldist_insnp = paths.int_prefix + (paths.caller.find("HC") != string::npos ? "_GGVCFs_unfiltered_INSNP.tsv" : "_MPILEUP_unfiltered_INSNP.tsv");
+            stage.inputs.push_back(indeldist_insnp);
+            for (unsigned int j = 0; j < 5; j++) {
+               stage.inputs.push_back(paths.out_prefix + "_" + class_names[j] + "s.bed");
+            }
+            stage.inputs.push_back(paths.out_prefix + "_sitesToMask.bed");
+            stage.tools.push_back(script_dir + "indelDist.sh");
+            stage.tools.push_back(script_dir + "closestIndelDistance.pl");
+            stage.tools.push_back(script_dir + "subsetVCFstats.pl");
+            if (indeldist) {
+               stage.inputs.push_back(paths.int_prefix + "_indel_dists_all.tsv");
+            } else {
+               stage.outputs.push_back(paths.int_prefix + "_indel_dists_all.tsv");
+            }
+            for (unsigned int j = 0; j < 5; j++) {
+               stage.outputs.push_back(paths.int_prefix + "_indel_dists_" + class_names[j] + "s.tsv");
+               stage.outputs.push_back(paths.int_prefix + "_indel_dists_" + class_names[j] + "s_masked.tsv");
+            }
+         } else if (job_type == "STATS") {
+            stage.inputs.push_back(paths.ref);
+            for (unsigned int j = 0; j < 5; j++) {
+               stage.inputs.push_back(paths.int_prefix + "_" + class_names[j] + "s.bed");
+            }
+            stage.tools.push_back(script_dir + "extractStats.sh");
+            stage.tools.push_back(script_dir + "partitionVCFstats");
+            stage.tools.push_back(script_dir + "subsetVCFstats.pl");
+            stage.outputs.push_back(paths.int_prefix + "_allStats.tsv.gz");
+            stage.outputs.push_back(paths.int_prefix + "_statHeader.tsv");
+            for (unsigned int j = 0; j < 5; j++) {
+               stage.outputs.push_back(paths.int_prefix + "_" + class_names[j] + "_stats.tsv.gz");
+            }
+         }
+         if (job_type == "CLASSIFY") {
+            classify_stages[i+1] = stages.size();
+         }
+         stages.push_back(stage);
+      }
+   }
+
+   //Dependencies: JOINTCLASSIFY before the CLASSIFY of its samples, and
+   // CLASSIFY before the INDELDIST and STATS of the same row:
+   for (size_t i = 0; i < stages.size(); i++) {
+      taskStage &stage = stages[i];
+      if (stage.job_type == "CLASSIFY" && requested_jobs.count("JOINTCLASSIFY") > 0) {
+         taskPaths paths;
+         findTaskPaths(metadata_rows[stage.task_id-1], "JOINTCLASSIFY", paths);
+         auto joint_iterator = joint_stages.find(paths.caller + '\t' + paths.special + '\t' + paths.joint_prefix);
+         if (paths.joint && joint_iterator != joint_stages.end()) {
+            stages[joint_iterator->second].dependents.push_back(i);
+            stage.dependencies.push_back(joint_iterator->second);
+            stage.pending_dependencies++;
+         }
+      } else if (stage.job_type == "INDELDIST" || stage.job_type == "STATS") {
+         auto classify_iterator = classify_stages.find(stage.task_id);
+         if (classify_iterator != classify_stages.end()) {
+            stages[classify_iterator->second].dependents.push_back(i);
+            stage.dependencies.push_back(classify_iterator->second);
+            stage.pending_dependencies++;
+         }
+      }
+   }
+   cerr << "Task graph has " << stages.size() << " stages" << endl;
+   if (stages.empty()) {
+      return 0;
+   }
+
+   //Run the graph:
+   stagePool pool(num_threads);
+   pool.setRemaining(stages.size());
+   mutex graph_mutex;
+   //Print the messages of the workers a line at a time:
+   mutex message_mutex;
+   auto message = [&](const string &line) {
+      lock_guard<mutex> message_lock(message_mutex);
+      cerr << line << endl;
+   };
+   //Stages that reran (or would rerun, in a dry run), so downstream
+   // stages rerun in a dry run:
+   vector<bool> reran(stages.size(), 0);
+   unsigned int next_worker = 0;
+   for (size_t i = 0; i < stages.size(); i++) {
+      if (stages[i].pending_dependencies == 0) {
+         pool.push(next_worker, i);
+         next_worker = (next_worker + 1) % num_threads;
+      }
+   }
+   vector<thread> workers;
+   for (unsigned int t = 0; t < num_threads; t++) {
+      workers.push_back(thread([&, t]() {
+         size_t stage_index;
+         while (pool.pop(t, stage_index)) {
+            taskStage &stage = stages[stage_index];
+            bool upstream_reran = 0;
+            {
+               lock_guard<mutex> graph_lock(graph_mutex);
+               for (auto dependency_iterator = stage.dependencies.begin(); dependency_iterator != stage.dependencies.end(); ++dependency_iterator) {
+                  if (reran[*dependency_iterator]) {
+                     upstream_reran = 1;
+                  }
+               }
+            }
+            string fingerprint = stageFingerprint(stage, file_hashes);
+            bool current = !force && !(dry_run && upstream_reran) && stageIsCurrent(stage, fingerprint, file_hashes);
+            unsigned char state;
+            if (current) {
+               message("Skipping " + stage.description + ", outputs are current");
+               state = 1;
+            } else if (dry_run) {
+               message("Would run " + stage.description);
+               state = 2;
+            } else {
+               //Remove the old stamp first, so an interrupted stage reruns:
+               remove(stage.stamp_path.c_str());
+               string log_dir, log_base;
+               splitPrefix(stage.log_prefix, log_dir, log_base);
+               if (!log_dir.empty()) {
+                  mkdir(log_dir.c_str(), 0777);
+               }
+               string command = shellQuote(local_array_call) + " " + to_string(stage.task_id) + " " + stage.job_type + " " + shellQuote(metadata_path) + " " + shellQuote(groundtruth_path);
+               if (!callable_path.empty()) {
+                  command += " " + shellQuote(callable_path);
+               }
+               string stdout_path = stage.log_prefix + "_" + stage.job_type + "_runTasks.stdout";
+               string stderr_path = stage.log_prefix + "_" + stage.job_type + "_runTasks.stderr";
+               command += " > " + shellQuote(stdout_path) + " 2> " + shellQuote(stderr_path);
+               message("Running " + stage.description);
+               if (debug) {
+                  message(command);
+               }
+               auto start_time = chrono::steady_clock::now();
+               int status = system(command.c_str());
+               double elapsed = chrono::duration<double>(chrono::steady_clock::now() - start_time).count();
+               int exit_code = status == -1 ? -1 : (WIFEXITED(status) ? WEXITSTATUS(status) : 128 + WTERMSIG(status));
+               if (exit_code != 0) {
+                  message(stage.description + " failed with exit code " + to_string(exit_code) + ", see " + stderr_path + " and " + stdout_path);
+                  state = 3;
+               } else {
+                  ostringstream elapsed_stream;
+                  elapsed_stream << fixed << setprecision(1) << elapsed;
+                  message("Finished " + stage.description + " in " + elapsed_stream.str() + " s");
+                  state = 2;
+                  if (writeStamp(stage, fingerprint, file_hashes)) {
+                     message("Unable to write stamp " + stage.stamp_path + " for " + stage.description);
+                  }
+               }
+            }
+            //Release the dependents, or mark them and their dependents as not run:
+            vector<size_t> newly_ready;
+            size_t num_retired = 1;
+            {
+               lock_guard<mutex> graph_lock(graph_mutex);
+               stage.state = state;
+               reran[stage_index] = state == 2;
+               vector<size_t> to_release = stage.dependents;
+               while (!to_release.empty()) {
+                  size_t dependent_index = to_release.back();
+                  to_release.pop_back();
+                  taskStage &dependent = stages[dependent_index];
+                  if (state == 3) {
+                     if (dependent.state == 0) {
+                        dependent.state = 4;
+                        num_retired++;
+                        message("Not running " + dependent.description + " due to failed upstream stage");
+                        to_release.insert(to_release.end(), dependent.dependents.begin(), dependent.dependents.end());
+                     }
+                  } else if (--dependent.pending_dependencies == 0 && dependent.state == 0) {
+                     newly_ready.push_back(dependent_index);
+                  }
+               }
+            }
+            for (auto ready_iterator = newly_ready.begin(); ready_iterator != newly_ready.end(); ++ready_iterator) {
+               pool.push(t, *ready_iterator);
+            }
+            pool.retire(num_retired);
+         }
+      }));
+   }
+   for (auto worker_iterator = workers.begin(); worker_iterator != workers.end(); ++worker_iterator) {
+      worker_iterator->join();
+   }
+
+   if (!dry_run && file_hashes.write(cache_path)) {
+      cerr << "Unable to write file hash cache " << cache_path << endl;
+   }
+
+   array<size_t, 5> state_counts {};
+   for (auto stage_iterator = stages.begin(); stage_iterator != stages.end(); ++stage_iterator) {
+      state_counts[stage_iterator->state]++;
+   }
+   cerr << state_counts[2] << (dry_run ? " stages would run, " : " stages ran, ") << state_counts[1] << " skipped as current, " << state_counts[3] << " failed, and " << state_counts[4] << " not run due to failed upstream stages" << endl;
+   if (state_counts[3] > 0) {
+      return 5;
+   }
+   return 0;
+}
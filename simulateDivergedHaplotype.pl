@@ -12,7 +12,7 @@ Getopt::Long::Configure qw(gnu_getopt);
 # simulateDivergedHaplotype.pl                                                             #
 # Usage:                                                                                   #
 #  simulateDivergedHaplotype.pl [-i reference FASTA] [-o output FASTA] [-n] [-g geom param]#
-#   [-s PRNG seed] <% divergence>                                                                         #
+#   [-s PRNG seed] <% divergence> [<% divergence> ...]                                     #
 #                                                                                          #
 # Arguments:                                                                               #
 #  -i,--input_haplotype         FASTA of the first haplotype to use as a reference for     #
@@ -27,10 +27,18 @@ Getopt::Long::Configure qw(gnu_getopt);
 #                               (optional, decimal between 0 and 1, default: 0.1)          #
 #  -s,--prng_seed               Seed integer for pseudorandom number generator             #
 #                               (optional, default: 42)                                    #
+#  -m,--substitution_matrix     TSV of relative substitution rates (rows are the original  #
+#                               base, columns are A, C, G, T)                              #
+#                               (optional, default: equal rates)                           #
+#  -c,--context_rates           TSV of odd-length k-mers (centered on the mutated base) and#
+#                               relative mutation rates, with an optional class label      #
+#                               (optional, default: uniform placement)                     #
 #  % divergence                 Required parameter specifying the percent divergence       #
 #                               desired between the reference/input haplotype and the      #
 #                               new/output diverged haplotype                              #
 #                               (required, specify as decimal between 0 and 100)           #
+#                               Several give a nested series (requires -o), with one output#
+#                               FASTA and logs per level, named [output]_[% divergence]    #
 #                                                                                          #
 # Description:                                                                             #
 #  simulateDivergedHaplotype.pl simulates a diverged haplotype given a reference haplotype #
@@ -44,10 +52,13 @@ Getopt::Long::Configure qw(gnu_getopt);
 #                                                                                          #
 # Changelog:                                                                               #
 #  v1.1: Added PRNG seed argument so we can make reproducible runs                         #
+#  v1.2: Added substitution matrix and k-mer context rates, sampled via alias tables       #
+#  v1.3: Added nested divergence series, where each level's mutations are a subset of the  #
+#        next level's, all simulated in one pass                                           #
 ############################################################################################
 
 my $SCRIPTNAME = "simulateDivergedHaplotype.pl";
-my $VERSION = "1.1";
+my $VERSION = "1.3";
 
 =pod
 
@@ -57,7 +68,7 @@ simulateDivergedHaplotype.pl - Simulate a haplotype diverged from a reference ha
 
 =head1 SYNOPSIS
 
-simulateDivergedHaplotype.pl [options] <% divergence>
+simulateDivergedHaplotype.pl [options] <% divergence> [<% divergence> ...]
 
  Options:
   --help,-h,-?             Display this help documentation
@@ -76,6 +87,14 @@ simulateDivergedHaplotype.pl [options] <% divergence>
                            (optional, decimal between 0 and 1, default: 0.1)
   --prng_seed,-s           Seed for pseudorandom number generator
                            (optional, integer, default: 42)
+  --substitution_matrix,-m TSV of relative substitution rates, one row per
+                           original base (A, C, G, T in the first column),
+                           followed by the rates to A, C, G, and T
+                           (optional, default: equal rates to all 3 bases)
+  --context_rates,-c       TSV of k-mers centered on the mutated base and
+                           their relative mutation rates, with an optional
+                           third column giving a class label
+                           (optional, default: uniform SNP placement)
   --version,-v             Output version string
   --debug,-d               Print extra debugging information
 
@@ -85,6 +104,8 @@ simulateDivergedHaplotype.pl [options] <% divergence>
                            haplotype and the output haplotype
                            (required, specify as a real number between 0 and
                            100)
+                           Several percentages simulate a nested series of
+                           haplotypes in one run (requires -o)
 
 =head1 DESCRIPTION
 
@@ -99,6 +120,29 @@ distribution with adjustable parameter.  The default parameter value, p=0.1, was
 qualitatively estimated from Rimmer et al. 2014 Nature Genetics human data.  Two logs are
 generated to keep track of what and where SNPs and indels were generated.
 
+A substitution matrix (-m) replaces the equal-probability choice of alternate base with
+draws weighted by the row of the matrix for the original base, so a Ti/Tv ratio can be
+imposed.  A context rate table (-c) replaces the uniform placement of SNPs: every site is
+assigned to the class of the k-mer centered on it, and sites are drawn with probability
+proportional to the rate of their class.  k-mers in the table may use N as a wildcard, and
+later lines override earlier ones, so e.g. a line "NNN 1" followed by "NCG 10" and "CGN 10"
+elevates the rate at both bases of a CpG 10-fold.  k-mers not matched by the table (and
+sites too close to a scaffold end to have a full k-mer) have rate 1.  Both draws use
+precomputed Walker alias tables, so each SNP costs O(1) regardless of model size.  When a
+context table is used, the SNP log gains a 5th column with the class label (or the k-mer
+itself if no label was given, or "." at scaffold ends).
+
+When several divergences are given, a nested series of haplotypes is simulated in one pass
+over the reference: one random ordering of candidate SNP sites (and of indel sites) is drawn
+per scaffold at the highest divergence, each level takes the prefix of the ordering giving its
+number of mutations, and each site's alternate base (or indel) is drawn once and shared by all
+levels.  Overlapping SNPs and indels are resolved once among the sites of the highest level
+(as in a single run) before the levels take their prefixes, so the mutations of each level
+are a subset of those of the next level up.  Each level is
+written to its own FASTA and logs, named by inserting _[% divergence] before the extension of
+the -o path (e.g. -o diverged.fasta 0.5 1 gives diverged_0.5.fasta and diverged_0.5_SNPs.log).
+The random draws differ from a run at a single divergence with the same seed.
+
 This script assumes that the input haplotype FASTA is NOT line-wrapped.
 
 =cut
@@ -126,18 +170,284 @@ sub sampleWithoutReplacement($$) {
    return \%samples;
 }
 
-# insertMutations($divergence, $scaffold, $sorted_SNP_array, $sorted_indel_array)
+# buildAliasTable($reference_to_weight_array)
+# Returns references to the probability and alias arrays of a
+# Walker alias table (built with Vose's method) for the discrete
+# distribution proportional to the weights passed in, so that
+# sampleAlias() can draw from it in O(1) time.
+sub buildAliasTable($) {
+   my @weights = @{shift @_};
+   my $n = scalar(@weights);
+   my $total = 0;
+   $total += $_ for @weights;
+   die "Cannot build an alias table from weights summing to ${total}\n" unless $total > 0;
+   my @scaled = map { $_ * $n / $total } @weights;
+   my @prob = (1) x $n;
+   my @alias = (0 .. $n-1);
+   my @small = grep { $scaled[$_] < 1 } 0 .. $n-1;
+   my @large = grep { $scaled[$_] >= 1 } 0 .. $n-1;
+   while (scalar(@small) > 0 and scalar(@large) > 0) {
+      my $s = pop @small;
+      my $l = pop @large;
+      $prob[$s] = $scaled[$s];
+      $alias[$s] = $l;
+      $scaled[$l] = $scaled[$l] + $scaled[$s] - 1;
+      if ($scaled[$l] < 1) {
+         push @small, $l;
+      } else {
+         push @large, $l;
+      }
+   }
+   #Whatever remains (including roundoff leftovers) has probability 1:
+   $prob[$_] = 1 for (@small, @large);
+   return (\@prob, \@alias);
+}
+
+# sampleAlias($reference_to_prob_array, $reference_to_alias_array)
+# Returns the index drawn from a Walker alias table
+sub sampleAlias($$) {
+   my $prob = shift @_;
+   my $alias = shift @_;
+   my $column = int(rand(scalar(@{$prob})));
+   return rand() < $prob->[$column] ? $column : $alias->[$column];
+}
+
+# buildSumTree($reference_to_weight_array)
+# Returns a reference to a Fenwick tree over the weights passed in,
+# so that sampleSumTree() can draw an index in proportion to them and
+# updateSumTree() can change one of them, each in O(log n) time.
+sub buildSumTree($) {
+   my @weights = @{shift @_};
+   my $n = scalar(@weights);
+   my @tree = (0) x ($n+1);
+   for (my $i = 1; $i <= $n; $i++) {
+      $tree[$i] += $weights[$i-1];
+      my $parent = $i + ($i & -$i);
+      $tree[$parent] += $tree[$i] if $parent <= $n;
+   }
+   return \@tree;
+}
+
+# updateSumTree($reference_to_tree, $index, $delta)
+# Adds $delta to the weight of $index in a Fenwick tree
+sub updateSumTree($$$) {
+   my $tree = shift @_;
+   my $index = shift @_;
+   my $delta = shift @_;
+   for (my $i = $index+1; $i <= $#{$tree}; $i += $i & -$i) {
+      $tree->[$i] += $delta;
+   }
+}
+
+# sampleSumTree($reference_to_tree, $total_weight)
+# Returns the index drawn in proportion to the weights of a Fenwick
+# tree, given the sum of the weights
+sub sampleSumTree($$) {
+   my $tree = shift @_;
+   my $target = rand(shift @_);
+   my $n = $#{$tree};
+   my $step = 1;
+   $step *= 2 while $step*2 <= $n;
+   my $index = 0;
+   for (; $step >= 1; $step /= 2) {
+      if ($index + $step <= $n and $tree->[$index+$step] <= $target) {
+         $index += $step;
+         $target -= $tree->[$index];
+      }
+   }
+   return $index;
+}
+
+# readSubstitutionMatrix($matrix_path)
+# Returns a reference to a hash keyed by original base, each
+# containing the array of alternate bases and the alias table
+# over their relative rates from the substitution matrix.
+sub readSubstitutionMatrix($) {
+   my $matrix_path = shift @_;
+   my @int_to_nuc = ("A","C","G","T");
+   my %substitution_tables = ();
+   open my $matrix_fh, "<", $matrix_path or die "Failed to open substitution matrix ${matrix_path} due to error $!\n";
+   while (my $line = <$matrix_fh>) {
+      chomp $line;
+      next if $line =~ /^#/ or $line eq ""; #Skip header/comment lines
+      my ($from, @rates) = split /\s+/, $line;
+      $from = uc $from;
+      die "Substitution matrix row ${line} does not have 4 rates\n" unless scalar(@rates) == 4;
+      die "Substitution matrix row ${line} is not for one of A, C, G, or T\n" unless $from =~ /^[ACGT]$/;
+      my @alt_nucs = ();
+      my @alt_rates = ();
+      for (my $j = 0; $j < 4; $j++) {
+         next if $int_to_nuc[$j] eq $from; #Diagonal is ignored
+         push @alt_nucs, $int_to_nuc[$j];
+         push @alt_rates, $rates[$j];
+      }
+      my ($prob, $alias) = buildAliasTable(\@alt_rates);
+      $substitution_tables{$from} = {'alts' => \@alt_nucs, 'prob' => $prob, 'alias' => $alias};
+   }
+   close $matrix_fh;
+   for my $base (@int_to_nuc) {
+      die "Substitution matrix ${matrix_path} is missing a row for ${base}\n" unless exists($substitution_tables{$base});
+   }
+   return \%substitution_tables;
+}
+
+# readContextRates($context_path)
+# Returns the k-mer length and references to hashes of rates and
+# class labels keyed by concrete (wildcard-expanded) k-mer.
+# Later lines of the table override earlier ones.
+sub readContextRates($) {
+   my $context_path = shift @_;
+   my $k = 0;
+   my %rates = ();
+   my %labels = ();
+   open my $context_fh, "<", $context_path or die "Failed to open context rate table ${context_path} due to error $!\n";
+   while (my $line = <$context_fh>) {
+      chomp $line;
+      next if $line =~ /^#/ or $line eq ""; #Skip header/comment lines
+      my ($kmer, $rate, $label) = split /\t/, $line, 3;
+      $kmer = uc $kmer;
+      die "Context rate table line ${line} is missing a rate\n" unless defined($rate);
+      die "Context k-mer ${kmer} must be of odd length and only contain A, C, G, T, or N\n" unless length($kmer) % 2 == 1 and $kmer =~ /^[ACGTN]+$/;
+      $k = length($kmer) if $k == 0;
+      die "Context k-mers must all be the same length, but found ${kmer} after k-mers of length ${k}\n" unless length($kmer) == $k;
+      #Expand N wildcards into all concrete k-mers:
+      my @expanded = ("");
+      for my $base (split //, $kmer) {
+         my @choices = $base eq "N" ? ("A","C","G","T") : ($base);
+         @expanded = map { my $prefix = $_; map { $prefix . $_ } @choices } @expanded;
+      }
+      for my $concrete (@expanded) {
+         $rates{$concrete} = $rate;
+         if (defined($label) and $label ne "") {
+            $labels{$concrete} = $label;
+         } else {
+            delete $labels{$concrete};
+         }
+      }
+   }
+   close $context_fh;
+   die "Context rate table ${context_path} does not contain any k-mers\n" if $k == 0;
+   return ($k, \%rates, \%labels);
+}
+
+# shuffleArray($reference_to_array)
+# Shuffles the array passed in place (Fisher-Yates)
+sub shuffleArray($) {
+   my $array = shift @_;
+   for (my $i = $#{$array}; $i > 0; $i--) {
+      my $j = int(rand($i+1));
+      @{$array}[$i, $j] = @{$array}[$j, $i];
+   }
+}
+
+# sampleByContext($scaffold, $number_of_samples, $k, $reference_to_rates, $reference_to_labels)
+# Returns a reference to a hash of $number_of_samples distinct
+# positions (0-based, and short of the last position of the scaffold
+# like sampleWithoutReplacement($scaffold_length-1, ...)), each drawn
+# from a context class chosen in proportion to the rate of its k-mer
+# times its number of positions not yet drawn, with values being
+# the context class label of the position, and a reference to the
+# array of the positions in the order they were drawn (any prefix of
+# which is itself a sample drawn by context).
+sub sampleByContext($$$$$) {
+   my $scaffold = uc shift @_;
+   my $number_of_samples = shift @_;
+   my $k = shift @_;
+   my %rates = %{shift @_};
+   my %labels = %{shift @_};
+   my $half_k = ($k-1)/2;
+   my $scaffold_length = length($scaffold);
+   #Bin the positions by context class, storing them packed to save memory:
+   my %class_positions = ();
+   for (my $i = 0; $i < $scaffold_length-1; $i++) {
+      my $kmer = ($i < $half_k or $i + $half_k >= $scaffold_length) ? "." : substr($scaffold, $i-$half_k, $k);
+      $class_positions{$kmer} .= pack("N", $i);
+   }
+   my @classes = sort keys %class_positions; #Sorted so runs are reproducible given the seed
+   my @weights = map { (exists($rates{$_}) ? $rates{$_} : 1) * length($class_positions{$_})/4 } @classes;
+   my $total_weight = 0;
+   $total_weight += $_ for @weights;
+   my %samples = ();
+   my @sample_order = ();
+   return (\%samples, \@sample_order) if $number_of_samples == 0 or $total_weight == 0;
+   my $weight_tree = buildSumTree(\@weights);
+   #Number of positions of each class not yet drawn:
+   my @remaining = map { length($class_positions{$_})/4 } @classes;
+   my $available_sites = 0;
+   for (my $j = 0; $j <= $#classes; $j++) {
+      $available_sites += $remaining[$j] if $weights[$j] > 0;
+   }
+   $number_of_samples = $available_sites if $number_of_samples > $available_sites;
+   my $samples_drawn = 0;
+   while ($samples_drawn < $number_of_samples) {
+      my $j = sampleSumTree($weight_tree, $total_weight);
+      #Roundoff in the tree's sums may land past the last class or on one without weight left, so redraw:
+      next if $j > $#classes or $weights[$j] <= 0;
+      my $class = $classes[$j];
+      #Sample without replacement by moving the last free position of the class
+      # into the place of the one drawn:
+      my $r = int(rand($remaining[$j]));
+      my $position = unpack("N", substr($class_positions{$class}, 4*$r, 4));
+      $remaining[$j]--;
+      substr($class_positions{$class}, 4*$r, 4) = substr($class_positions{$class}, 4*$remaining[$j], 4);
+      $samples{$position} = exists($labels{$class}) ? $labels{$class} : $class;
+      push @sample_order, $position;
+      $samples_drawn++;
+      #The class loses the weight of the position drawn (all of it once it runs out, avoiding roundoff):
+      my $weight = $remaining[$j] == 0 ? 0 : (exists($rates{$class}) ? $rates{$class} : 1) * $remaining[$j];
+      updateSumTree($weight_tree, $j, $weight - $weights[$j]);
+      $total_weight += $weight - $weights[$j];
+      $weights[$j] = $weight;
+   }
+   return (\%samples, \@sample_order);
+}
+
+# drawAltBase($ref, $substitution_tables)
+# Returns the new base of a SNP at a site with base $ref, drawn from
+# the row of the substitution matrix if provided, else uniformly
+sub drawAltBase($$) {
+   my $ref = shift @_;
+   my $substitution_tables = shift @_;
+   if (defined($substitution_tables) and exists($substitution_tables->{uc $ref})) {
+      my $table = $substitution_tables->{uc $ref};
+      return $table->{'alts'}[sampleAlias($table->{'prob'}, $table->{'alias'})]; #Draw from the matrix row
+   }
+   my @alt_nucs = grep { $_ ne uc $ref } ("A","C","G","T"); #Generate an array of non-ref bases
+   return $alt_nucs[int(rand(3))]; #Choose a random non-ref base
+}
+
+# drawIndel($indel_geometric_parameter)
+# Returns the length of an indel and, for an insertion, the inserted
+# sequence (undef for a deletion)
+sub drawIndel($) {
+   my $indel_geometric_parameter = shift @_;
+   my @int_to_nuc = ("A","C","G","T");
+   #Inverse CDF method for generating random number from geometric distribution:
+   my $indel_length = int(log(1-rand())/log(1-$indel_geometric_parameter));
+   #Make sure we don't create a 0-length indel:
+   $indel_length = int(log(1-rand())/log(1-$indel_geometric_parameter)) while $indel_length == 0;
+   if (int(rand(2)) == 1) { #Choice of 1 is arbitrary, but this ensures 1/2 chance of insertion
+      my $indel = "";
+      for (my $j = 1; $j <= $indel_length; $j++) { #Compose the indel sequence (random nucleotides, no GC bias)
+         $indel .= $int_to_nuc[int(rand(4))];
+      }
+      return ($indel_length, $indel);
+   }
+   return ($indel_length, undef);
+}
+
+# insertMutations($divergence, $scaffold, $sorted_SNP_array, $sorted_indel_array, $indel_geom, $substitution_tables, $log_context)
 # Returns the mutated scaffold
 # Indel length simulation is done in this function
-sub insertMutations($$$$$) {
+sub insertMutations($$$$$$$) {
    my $divergence = shift @_;
    my $scaffold = shift @_;
    my %SNPs = %{shift @_};
    my %indels = %{shift @_};
    my $indel_geometric_parameter = shift @_;
+   my $substitution_tables = shift @_;
+   my $log_context = shift @_;
 
-   my @int_to_nuc = ("A","C","G","T");
-   
    my $mutated_scaffold = "";
    my @SNP_log = ();
    my @indel_log = ();
@@ -149,21 +459,17 @@ sub insertMutations($$$$$) {
       if ($SNP_index < $SNP_hash_size and defined($SNPs{$i})) { #SNP site, so mutate it
          #Note: If SNP and indel positions overlap, we mutate the SNP, but do not introduce the indel
          #Hence, the effective indel rate is slightly lower than expected.
-         my @alt_nucs = grep { $_ ne uc $ref } @int_to_nuc; #Generate an array of non-ref bases
-         my $new_base = $alt_nucs[int(rand(3))]; #Choose a random non-ref base
+         my $new_base = drawAltBase($ref, $substitution_tables);
          $mutated_scaffold .= $new_base; #Mutate the ref
-         push @SNP_log, join("\t", $i+1, $ref, $new_base);
+         if ($log_context) {
+            push @SNP_log, join("\t", $i+1, $ref, $new_base, $SNPs{$i});
+         } else {
+            push @SNP_log, join("\t", $i+1, $ref, $new_base);
+         }
          $SNP_index++;
       } elsif ($indel_index < $indel_hash_size and defined($indels{$i})) { #indel site
-         #Inverse CDF method for generating random number from geometric distribution:
-         my $indel_length = int(log(1-rand())/log(1-$indel_geometric_parameter));
-         #Make sure we don't create a 0-length indel:
-         $indel_length = int(log(1-rand())/log(1-$indel_geometric_parameter)) while $indel_length == 0;
-         if (int(rand(2)) == 1) { #Choice of 1 is arbitrary, but this ensures 1/2 chance of insertion
-            my $indel = "";
-            for (my $j = 1; $j <= $indel_length; $j++) { #Compose the indel sequence (random nucleotides, no GC bias)
-               $indel .= $int_to_nuc[int(rand(4))];
-            }
+         my ($indel_length, $indel) = drawIndel($indel_geometric_parameter);
+         if (defined($indel)) {
             $mutated_scaffold .= substr($scaffold, $i, 1) . $indel;
             push @indel_log, join("\t", $i+1, "ins", $indel_length, $indel);
          } else { #Deletion skips $indel_length bases in ref including the current base
@@ -182,6 +488,139 @@ sub insertMutations($$$$$) {
    return ($mutated_scaffold, \@SNP_log, \@indel_log);
 }
 
+# insertNestedMutations($scaffold, $reference_to_SNP_counts, $reference_to_indel_counts, $indel_geom, $substitution_tables, $context_k, $context_rates, $context_labels)
+# Returns a reference to an array with the mutated scaffold and
+# references to the SNP and indel logs of each level of a nested
+# series with the (ascending) numbers of SNPs and indels passed in.
+# The sites of the highest level are drawn in a random order, and
+# each level mutates the first sites of that order, with the new base
+# or indel of each site drawn once for all levels.  Overlaps are
+# resolved once on the sites of the highest level, so each level's
+# mutations are a subset of the next level's
+sub insertNestedMutations($$$$$$$$) {
+   my $scaffold = shift @_;
+   my @SNP_counts = @{shift @_};
+   my @indel_counts = @{shift @_};
+   my $indel_geometric_parameter = shift @_;
+   my $substitution_tables = shift @_;
+   my $context_k = shift @_;
+   my $context_rates = shift @_;
+   my $context_labels = shift @_;
+   my $scaffold_length = length($scaffold);
+
+   #Order the candidate SNP and indel sites of the highest level:
+   my %SNP_labels = ();
+   my @SNP_order = ();
+   if ($context_k > 0) {
+      my ($labels_reference, $order_reference) = sampleByContext($scaffold, $SNP_counts[-1], $context_k, $context_rates, $context_labels);
+      %SNP_labels = %{$labels_reference};
+      @SNP_order = @{$order_reference};
+   } else {
+      @SNP_order = sort { $a <=> $b } keys %{sampleWithoutReplacement($scaffold_length-1, $SNP_counts[-1])};
+      shuffleArray(\@SNP_order);
+   }
+   my @indel_order = sort { $a <=> $b } keys %{sampleWithoutReplacement($scaffold_length-1, $indel_counts[-1])};
+   shuffleArray(\@indel_order);
+   #Draw the mutation at each site once, so every level that includes a site agrees on it:
+   my (%SNP_rank, %new_bases, %indel_rank, %indel_draws);
+   for (my $j = 0; $j <= $#SNP_order; $j++) {
+      $new_bases{$SNP_order[$j]} = drawAltBase(substr($scaffold, $SNP_order[$j], 1), $substitution_tables);
+   }
+   for (my $j = 0; $j <= $#indel_order; $j++) {
+      $indel_draws{$indel_order[$j]} = [drawIndel($indel_geometric_parameter)];
+   }
+   #Resolve overlaps as insertMutations would at the highest level (a SNP at an indel site
+   # wins, and sites within a deletion are dropped), before any level takes its prefix:
+   my (%SNP_dropped, %indel_dropped);
+   my $free_from = 0; #First base past the last site kept
+   my %sites = map { $_ => 1 } (@SNP_order, @indel_order);
+   for my $position (sort { $a <=> $b } keys %sites) {
+      if ($position < $free_from) { #Within a deletion
+         $SNP_dropped{$position} = 1 if exists($new_bases{$position});
+         $indel_dropped{$position} = 1 if exists($indel_draws{$position});
+      } elsif (exists($new_bases{$position})) {
+         $indel_dropped{$position} = 1 if exists($indel_draws{$position});
+         $free_from = $position + 1;
+      } else {
+         my ($indel_length, $indel) = @{$indel_draws{$position}};
+         $free_from = defined($indel) ? $position + 1 : $position + $indel_length;
+      }
+   }
+   @SNP_order = grep { !exists($SNP_dropped{$_}) } @SNP_order;
+   @indel_order = grep { !exists($indel_dropped{$_}) } @indel_order;
+   for (my $j = 0; $j <= $#SNP_order; $j++) {
+      $SNP_rank{$SNP_order[$j]} = $j;
+   }
+   for (my $j = 0; $j <= $#indel_order; $j++) {
+      $indel_rank{$indel_order[$j]} = $j;
+   }
+   my @SNP_sites = sort { $a <=> $b } @SNP_order;
+   my @indel_sites = sort { $a <=> $b } @indel_order;
+
+   #Splice each level's mutations into the scaffold in order of position:
+   my @levels = ();
+   for (my $level = 0; $level <= $#SNP_counts; $level++) {
+      my ($num_SNPs, $num_indels) = ($SNP_counts[$level], $indel_counts[$level]);
+      my $mutated_scaffold = "";
+      my @SNP_log = ();
+      my @indel_log = ();
+      my ($SNP_index, $indel_index, $next_base) = (0, 0, 0);
+      while (1) {
+         $SNP_index++ while $SNP_index <= $#SNP_sites and $SNP_rank{$SNP_sites[$SNP_index]} >= $num_SNPs;
+         $indel_index++ while $indel_index <= $#indel_sites and $indel_rank{$indel_sites[$indel_index]} >= $num_indels;
+         last if $SNP_index > $#SNP_sites and $indel_index > $#indel_sites;
+         my $SNP_position = $SNP_index <= $#SNP_sites ? $SNP_sites[$SNP_index] : $scaffold_length;
+         my $indel_position = $indel_index <= $#indel_sites ? $indel_sites[$indel_index] : $scaffold_length;
+         if ($SNP_position < $indel_position) { #SNP site, so mutate it
+            $SNP_index++;
+            my $ref = substr $scaffold, $SNP_position, 1;
+            $mutated_scaffold .= substr($scaffold, $next_base, $SNP_position - $next_base) . $new_bases{$SNP_position};
+            if ($context_k > 0) {
+               push @SNP_log, join("\t", $SNP_position+1, $ref, $new_bases{$SNP_position}, $SNP_labels{$SNP_position});
+            } else {
+               push @SNP_log, join("\t", $SNP_position+1, $ref, $new_bases{$SNP_position});
+            }
+            $next_base = $SNP_position + 1;
+         } else { #indel site
+            $indel_index++;
+            my ($indel_length, $indel) = @{$indel_draws{$indel_position}};
+            $mutated_scaffold .= substr($scaffold, $next_base, $indel_position - $next_base);
+            if (defined($indel)) {
+               $mutated_scaffold .= substr($scaffold, $indel_position, 1) . $indel;
+               push @indel_log, join("\t", $indel_position+1, "ins", $indel_length, $indel);
+               $next_base = $indel_position + 1;
+            } else { #Deletion skips $indel_length bases in ref including the current base
+               if ($indel_position+$indel_length >= $scaffold_length) { #Unfortunately, this deletion will be smaller than expected:
+                  push @indel_log, join("\t", $indel_position+1, "del", $indel_length, substr($scaffold, $indel_position));
+               } else {
+                  push @indel_log, join("\t", $indel_position+1, "del", $indel_length, substr($scaffold, $indel_position, $indel_length));
+               }
+               $next_base = $indel_position + $indel_length;
+            }
+         }
+      }
+      $mutated_scaffold .= substr($scaffold, $next_base) if $next_base < $scaffold_length;
+      push @levels, [$mutated_scaffold, \@SNP_log, \@indel_log];
+   }
+   return \@levels;
+}
+
+# openOutputFASTA($out_path)
+# Returns a file handle for the output FASTA, gzipped if the path ends
+# in .gz, or STDOUT if the path is empty
+sub openOutputFASTA($) {
+   my $out_path = shift @_;
+   my $out;
+   if ($out_path =~ /\.gz$/) {
+      $out = new IO::Compress::Gzip $out_path or die "Failed to create Gzipped output FASTA file $out_path due to error $GzipError\n";
+   } elsif ($out_path eq '') {
+      open $out, ">&", \*STDOUT or die "Failed to duplicate STDOUT file handle for output FASTA due to error $!\n";
+   } else {
+      open $out, ">", $out_path or die "Failed to open output FASTA file due to error $!\n";
+   }
+   return $out;
+}
+
 #Parse options:
 my $help = 0;
 my $man = 0;
@@ -191,8 +630,10 @@ my $out_path = '';
 my $indels = 0;
 my $indel_geometric_parameter = 0.1;
 my $prng_seed = 42;
+my $matrix_path = '';
+my $context_path = '';
 my $dispversion = 0;
-GetOptions('input_haplotype|i=s' => \$ref_path, 'output_haplotype|o=s' => \$out_path, 'indels|n' => \$indels, 'indel_geom|g=f' => \$indel_geometric_parameter, 'prng_seed|s=i' => \$prng_seed, 'version|v' => \$dispversion, 'debug|d+' => \$debug, 'help|h|?+' => \$help, man => \$man) or pod2usage(2);
+GetOptions('input_haplotype|i=s' => \$ref_path, 'output_haplotype|o=s' => \$out_path, 'indels|n' => \$indels, 'indel_geom|g=f' => \$indel_geometric_parameter, 'prng_seed|s=i' => \$prng_seed, 'substitution_matrix|m=s' => \$matrix_path, 'context_rates|c=s' => \$context_path, 'version|v' => \$dispversion, 'debug|d+' => \$debug, 'help|h|?+' => \$help, man => \$man) or pod2usage(2);
 pod2usage(-exitval => 1, -verbose => $help, -output => \*STDERR) if $help;
 pod2usage(-exitval => 0, -output => \*STDERR, -verbose => 2) if $man;
 
@@ -200,13 +641,34 @@ print STDERR "${SCRIPTNAME} version ${VERSION}\n" if $dispversion;
 exit 0 if $dispversion;
 
 my $percent_divergence = 1.0;
+my @percent_divergences = ();
 if (scalar@ARGV < 1) { #Missing percent divergence parameter
    print STDERR "Missing the percent divergence parameter, exiting.\n";
    exit 2;
 } else {
    $percent_divergence = $ARGV[0];
+   #Several divergences make a nested series, from lowest to highest:
+   my %unique_divergences = map { $_ => 1 } @ARGV;
+   @percent_divergences = sort { $a <=> $b } keys %unique_divergences;
 }
 my $divergence = $percent_divergence/100;
+my $nested = scalar(@percent_divergences) > 1;
+if ($nested and $out_path eq '') {
+   print STDERR "A nested divergence series needs an output FASTA path (-o) to name the levels after, exiting.\n";
+   exit 2;
+}
+
+#Read in the mutation spectrum model, if provided:
+my $substitution_tables = undef;
+if ($matrix_path ne '') {
+   print STDERR "Using substitution matrix ${matrix_path}\n";
+   $substitution_tables = readSubstitutionMatrix($matrix_path);
+}
+my ($context_k, $context_rates, $context_labels) = (0, undef, undef);
+if ($context_path ne '') {
+   ($context_k, $context_rates, $context_labels) = readContextRates($context_path);
+   print STDERR "Using ${context_k}-mer context rate table ${context_path}\n";
+}
 
 #Open input and output files:
 my ($ref, $out);
@@ -217,22 +679,32 @@ if ($ref_path =~ /\.gz$/) {
 } else {
    open $ref, "<", $ref_path or die "Failed to open reference FASTA file due to error $!\n";
 }
-if ($out_path =~ /\.gz$/) {
-   $out = new IO::Compress::Gzip $out_path or die "Failed to create Gzipped output FASTA file $out_path due to error $GzipError\n";
-} elsif ($out_path eq '') {
-   open $out, ">&", \*STDOUT or die "Failed to duplicate STDOUT file handle for output FASTA due to error $!\n";
-} else {
-   open $out, ">", $out_path or die "Failed to open output FASTA file due to error $!\n";
+#Each level of a nested series gets its own FASTA and logs, named [output]_[% divergence]:
+my (@level_outs, @level_snplogs, @level_indellogs);
+if ($nested) {
+   my ($out_stem, $out_extension) = $out_path =~ /^(.*?)((?:\.\w+)?(?:\.gz)?)$/;
+   for my $level_percent (@percent_divergences) {
+      my $level_out = openOutputFASTA("${out_stem}_${level_percent}${out_extension}");
+      my ($level_snplog, $level_indellog);
+      open $level_snplog, ">", "${out_stem}_${level_percent}_SNPs.log" or die "Failed to open output SNP log file ${out_stem}_${level_percent}_SNPs.log due to error $!\n";
+      open $level_indellog, ">", "${out_stem}_${level_percent}_indels.log" or die "Failed to open output indel log file ${out_stem}_${level_percent}_indels.log due to error $!\n";
+      push @level_outs, $level_out;
+      push @level_snplogs, $level_snplog;
+      push @level_indellogs, $level_indellog;
+   }
+   print STDERR "Simulating a nested series of ", scalar(@percent_divergences), " divergences: ", join(", ", map { "${_} %" } @percent_divergences), "\n";
+}
+my ($snplog, $indellog);
+unless ($nested) {
+   $out = openOutputFASTA($out_path);
+   #Generate output SNP and indel log files:
+   $out_path =~ s/\.\w+(.gz)?$/_/;
+   my $log_prefix = $out_path;
+   my $SNP_log_path = $log_prefix . "SNPs.log";
+   my $indel_log_path = $log_prefix . "indels.log";
+   open $snplog, ">", $SNP_log_path or die "Failed to open output SNP log file $SNP_log_path due to error $!\n";
+   open $indellog, ">", $indel_log_path or die "Failed to open output indel log file $indel_log_path due to error $!\n";
 }
-#Generate output SNP and indel log files:
-$out_path =~ s/\.\w+(.gz)?$/_/;
-my $log_prefix = $out_path;
-my $SNP_log_path = $log_prefix . "SNPs.log";
-my $indel_log_path = $log_prefix . "indels.log";
-my $snplog;
-my $indellog;
-open $snplog, ">", $SNP_log_path or die "Failed to open output SNP log file $SNP_log_path due to error $!\n";
-open $indellog, ">", $indel_log_path or die "Failed to open output indel log file $indel_log_path due to error $!\n";
 
 #Set the PRNG seed so we can reproduce this run:
 print STDERR "Using PRNG seed ${prng_seed}\n";
@@ -249,22 +721,52 @@ my $scaffold_name = ""; #Keep track of the scaffold name
 my $line_num = 1;
 while (my $line = <$ref>) {
    if ($line =~ /^>/) {
-      print $out $line;
+      if ($nested) {
+         print $_ $line for @level_outs;
+      } else {
+         print $out $line;
+      }
       $scaffold_name = $line;
       chomp $scaffold_name;
       $scaffold_name =~ s/>//;
+   } elsif ($nested) {
+      chomp $line;
+      my $scaffold_length = length($line);
+      my @SNP_counts = map { int($scaffold_length*$_/100) } @percent_divergences;
+      my @indel_counts = map { $indels != 0 ? int($_/$indel_rate_fold_lower) : 0 } @SNP_counts;
+      print STDERR "Expecting to output ", join(", ", @SNP_counts), " SNPs and ", join(", ", @indel_counts), " indels.\n" if $debug;
+      #Output every level's mutated scaffold and logs from the same draws:
+      my $levels = insertNestedMutations($line, \@SNP_counts, \@indel_counts, $indel_geometric_parameter, $substitution_tables, $context_k, $context_rates, $context_labels);
+      for (my $level = 0; $level <= $#{$levels}; $level++) {
+         my ($mutated_scaffold, $SNP_log_reference, $indel_log_reference) = @{$levels->[$level]};
+         print {$level_outs[$level]} $mutated_scaffold, "\n";
+         for my $SNP (@{$SNP_log_reference}) {
+            print {$level_snplogs[$level]} $scaffold_name, "\t", $SNP, "\n";
+         }
+         for my $indel (@{$indel_log_reference}) {
+            print {$level_indellogs[$level]} $scaffold_name, "\t", $indel, "\n";
+         }
+      }
+      print STDERR "Really output ", join(", ", map { scalar@{$_->[1]} } @{$levels}), " SNPs and ", join(", ", map { scalar@{$_->[2]} } @{$levels}), " indels.\n" if $debug;
    } else {
       chomp $line;
       my %SNPs = ();
       my %indels = ();
       my $scaffold_length = length($line);
       my $num_SNPs = int($scaffold_length*$divergence);
-      #Simulate SNP and indel positions from a random discrete uniform distribution:
-      %SNPs = %{sampleWithoutReplacement($scaffold_length-1, $num_SNPs)};
+      #Simulate SNP positions from a random discrete uniform distribution, or
+      # weighted by context if a context rate table was provided:
+      if ($context_k > 0) {
+         my ($context_SNPs) = sampleByContext($line, $num_SNPs, $context_k, $context_rates, $context_labels);
+         %SNPs = %{$context_SNPs};
+      } else {
+         %SNPs = %{sampleWithoutReplacement($scaffold_length-1, $num_SNPs)};
+      }
+      #Simulate indel positions from a random discrete uniform distribution:
       %indels = %{sampleWithoutReplacement($scaffold_length-1, int($num_SNPs/$indel_rate_fold_lower))} if $indels != 0;
       print STDERR "Expecting to output ", scalar(keys %SNPs), " SNPs and ", scalar(keys %indels), " indels.\n" if $debug;
       #Output the desired mutated scaffold:
-      my ($mutated_scaffold, $SNP_log_reference, $indel_log_reference) = insertMutations($divergence, $line, \%SNPs, \%indels, $indel_geometric_parameter);
+      my ($mutated_scaffold, $SNP_log_reference, $indel_log_reference) = insertMutations($divergence, $line, \%SNPs, \%indels, $indel_geometric_parameter, $substitution_tables, $context_k > 0);
       print $out $mutated_scaffold, "\n";
       #Output the SNP and indel logs:
       for my $SNP (@{$SNP_log_reference}) {
@@ -280,9 +782,7 @@ while (my $line = <$ref>) {
    print STDERR "Line # ${line_num} is a header line\n" if $debug > 1 and $line =~ /^>/;
    if ($line !~ /^>/ and $line_num % 2 != 0) {
       close $ref;
-      close $out;
-      close $snplog;
-      close $indellog;
+      close $_ for grep { defined($_) } ($out, $snplog, $indellog, @level_outs, @level_snplogs, @level_indellogs);
       die "It seems your input FASTA ${ref_path} is line-wrapped -- please unwrap it for use with this script.";
    }
    $line_num++;
@@ -290,8 +790,6 @@ while (my $line = <$ref>) {
 
 #Close input and output files:
 close $ref;
-close $out;
-close $snplog;
-close $indellog;
+close $_ for grep { defined($_) } ($out, $snplog, $indellog, @level_outs, @level_snplogs, @level_indellogs);
 
 exit 0;
@@ -0,0 +1,686 @@
+/**********************************************************************************
+ * simulateReads.cpp                                                              *
+ * Written by Patrick Reilly                                                      *
+ * Version 1.0 written 2026/10/18                                                 *
+ * Description:                                                                   *
+ *  Simulates paired-end reads directly from haplotypes constructed in memory     *
+ *  from a reference FASTA and the SNP/indel logs of simulateDivergedHaplotype.pl,*
+ *  so no intermediate haplotype FASTAs need to be written.                       *
+ *                                                                                *
+ * Syntax: simulateReads -r [reference FASTA] -a [hap 1 SNP log]                  *
+ *         -A [hap 1 indel log] -b [hap 2 SNP log] -B [hap 2 indel log]           *
+ *         -o [output FASTQ prefix] -c [depth]                                    *
+ **********************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <getopt.h>
+#include <cctype>
+#include <cmath>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <array>
+#include <random>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <zlib.h>
+
+//Define constants for getopt:
+#define no_argument 0
+#define required_argument 1
+#define optional_argument 2
+
+//Version:
+#define VERSION "1.0"
+
+//Usage/help:
+#define USAGE "simulateReads\nUsage:\n simulateReads -r [reference FASTA] -o [output FASTQ prefix] -c [depth]\n\t-a [haplotype 1 SNP log] -A [haplotype 1 indel log]\n\t-b [haplotype 2 SNP log] -B [haplotype 2 indel log]\n\t-l [read length] -f [mean fragment length] -s [fragment length SD]\n\t-e [error rate at first cycle] -E [error rate at last cycle]\n\t-q [per-cycle error profile TSV] -t [threads] -S [PRNG seed] -z\n"
+
+//Number of read pairs simulated per work chunk:
+#define CHUNK_PAIRS 20000
+
+using namespace std;
+
+vector<string> splitString(string line_to_split, char delimiter) {
+   vector<string> line_vector;
+   string element;
+   istringstream line_to_split_stream(line_to_split);
+   while (getline(line_to_split_stream, element, delimiter)) {
+      line_vector.push_back(element);
+   }
+   return line_vector;
+}
+
+//A single mutation from a simulator log, in reference coordinates:
+struct mutation_record {
+   long position; //1-based, as in the logs
+   char type; //'S' for SNP, 'I' for insertion, 'D' for deletion
+   string bases; //New allele, inserted bases, or deleted bases
+   long length; //Length of the indel
+};
+
+bool readMutationLogs(string snplog_path, string indellog_path, map<string, vector<mutation_record>> &mutations) {
+   if (!snplog_path.empty()) {
+      ifstream snp_log;
+      snp_log.open(snplog_path);
+      if (!snp_log) {
+         cerr << "Error opening SNP log " << snplog_path << endl;
+         return 1;
+      }
+      string logline;
+      while (getline(snp_log, logline)) {
+         vector<string> line_vector = splitString(logline, '\t');
+         if (line_vector.size() < 4) {
+            continue;
+         }
+         mutation_record snp;
+         snp.position = stol(line_vector[1]);
+         snp.type = 'S';
+         snp.bases = line_vector[3];
+         snp.length = 1;
+         mutations[line_vector[0]].push_back(snp);
+      }
+      snp_log.close();
+   }
+   if (!indellog_path.empty()) {
+      ifstream indel_log;
+      indel_log.open(indellog_path);
+      if (!indel_log) {
+         cerr << "Error opening indel log " << indellog_path << endl;
+         return 1;
+      }
+      string logline;
+      while (getline(indel_log, logline)) {
+         vector<string> line_vector = splitString(logline, '\t');
+         if (line_vector.size() < 4) {
+            continue;
+         }
+         mutation_record indel;
+         indel.position = stol(line_vector[1]);
+         indel.type = line_vector[2] == "ins" ? 'I' : 'D';
+         indel.bases = line_vector.size() > 4 ? line_vector[4] : "";
+         indel.length = stol(line_vector[3]);
+         if (indel.length == 0) { //Zero-length indels don't change anything
+            continue;
+         }
+         mutations[line_vector[0]].push_back(indel);
+      }
+      indel_log.close();
+   }
+   //Sort each scaffold's mutations by position, with SNPs before indels at the same position:
+   for (auto scaffold_iterator = mutations.begin(); scaffold_iterator != mutations.end(); ++scaffold_iterator) {
+      stable_sort(scaffold_iterator->second.begin(), scaffold_iterator->second.end(), [](const mutation_record &a, const mutation_record &b) {
+         return a.position < b.position;
+      });
+   }
+   return 0;
+}
+
+//Apply the mutations of a haplotype to a reference scaffold:
+string buildHaplotype(const char *ref_seq, long ref_length, const vector<mutation_record> *mutations) {
+   string haplotype;
+   if (mutations == nullptr) {
+      return string(ref_seq, ref_length);
+   }
+   haplotype.reserve(ref_length + ref_length/50);
+   long ref_index = 0; //0-based index of next reference base to copy
+   for (auto m_iterator = mutations->begin(); m_iterator != mutations->end(); ++m_iterator) {
+      long m_index = m_iterator->position - 1;
+      if (m_index < ref_index || m_index >= ref_length) { //Inside a prior deletion or off the end
+         continue;
+      }
+      haplotype.append(ref_seq + ref_index, m_index - ref_index);
+      ref_index = m_index;
+      if (m_iterator->type == 'S') {
+         haplotype.push_back(m_iterator->bases[0]);
+         ref_index++;
+      } else if (m_iterator->type == 'I') { //Inserted bases follow the base at this position
+         haplotype.push_back(ref_seq[ref_index]);
+         haplotype.append(m_iterator->bases);
+         ref_index++;
+      } else { //Deletion starts at this position
+         ref_index = min(ref_length, ref_index + m_iterator->length);
+      }
+   }
+   haplotype.append(ref_seq + ref_index, ref_length - ref_index);
+   return haplotype;
+}
+
+char complementBase(char base) {
+   switch(base) {
+      case 'A':
+      case 'a':
+         return 'T';
+      case 'C':
+      case 'c':
+         return 'G';
+      case 'G':
+      case 'g':
+         return 'C';
+      case 'T':
+      case 't':
+         return 'A';
+      default:
+         return 'N';
+   }
+}
+
+//Parameters shared by all read simulation workers:
+struct read_parameters {
+   long read_length;
+   double fragment_mean;
+   double fragment_sd;
+   vector<double> cycle_error; //Substitution error probability per cycle
+   string cycle_quality; //Phred+33 quality per cycle
+   unsigned long seed;
+};
+
+//One unit of work, simulating pairs from one haplotype of one scaffold:
+struct read_chunk {
+   const string *haplotype;
+   string scaffold;
+   unsigned int haplotype_index;
+   unsigned long scaffold_index;
+   unsigned long chunk_index;
+   unsigned long num_pairs;
+   string read1;
+   string read2;
+   bool done;
+};
+
+void simulateRead(const string &haplotype, long start, long length, bool reverse, const read_parameters &params, mt19937_64 &prng, string &read) {
+   uniform_real_distribution<double> unit(0.0, 1.0);
+   uniform_int_distribution<int> other_base(1, 3);
+   const char bases[] = {'A', 'C', 'G', 'T'};
+   read.clear();
+   for (long i = 0; i < length; i++) {
+      char base = reverse ? complementBase(haplotype[start + length - 1 - i]) : toupper(haplotype[start + i]);
+      if (base != 'A' && base != 'C' && base != 'G' && base != 'T') {
+         base = 'N';
+      } else if (unit(prng) < params.cycle_error[i]) { //Substitution error
+         int base_index = base == 'A' ? 0 : base == 'C' ? 1 : base == 'G' ? 2 : 3;
+         base = bases[(base_index + other_base(prng)) % 4];
+      }
+      read.push_back(base);
+   }
+}
+
+void simulateChunk(read_chunk &chunk, const read_parameters &params) {
+   //Seed depends only on the chunk's identity, so output is independent of thread count:
+   seed_seq chunk_seed {(unsigned int)(params.seed & 0xFFFFFFFF), (unsigned int)(params.seed >> 32), chunk.haplotype_index, (unsigned int)chunk.scaffold_index, (unsigned int)chunk.chunk_index};
+   mt19937_64 prng(chunk_seed);
+   const string &haplotype = *chunk.haplotype;
+   long haplotype_length = haplotype.length();
+   //A standard deviation of 0 gives fragments of the mean length, so don't sample for it:
+   normal_distribution<double> fragment_length_distribution(params.fragment_mean, params.fragment_sd > 0.0 ? params.fragment_sd : 1.0);
+   uniform_int_distribution<int> coin(0, 1);
+   string sequence1, sequence2;
+   ostringstream read1_stream, read2_stream;
+   for (unsigned long i = 0; i < chunk.num_pairs; i++) {
+      long fragment_length = lround(params.fragment_sd > 0.0 ? fragment_length_distribution(prng) : params.fragment_mean);
+      fragment_length = max(fragment_length, params.read_length);
+      fragment_length = min(fragment_length, haplotype_length);
+      uniform_int_distribution<long> start_distribution(0, haplotype_length - fragment_length);
+      long start = start_distribution(prng);
+      bool reverse = coin(prng) == 1;
+      //Read 1 comes off the 5' end of the fragment strand, read 2 off the other end:
+      if (reverse) {
+         simulateRead(haplotype, start + fragment_length - params.read_length, params.read_length, true, params, prng, sequence1);
+         simulateRead(haplotype, start, params.read_length, false, params, prng, sequence2);
+      } else {
+         simulateRead(haplotype, start, params.read_length, false, params, prng, sequence1);
+         simulateRead(haplotype, start + fragment_length - params.read_length, params.read_length, true, params, prng, sequence2);
+      }
+      ostringstream read_name;
+      read_name << "@hap" << chunk.haplotype_index << ':' << chunk.scaffold << ':' << start + 1 << '-' << start + fragment_length << ':' << (reverse ? '-' : '+') << ':' << chunk.chunk_index << '_' << i;
+      read1_stream << read_name.str() << "/1\n" << sequence1 << "\n+\n" << params.cycle_quality << '\n';
+      read2_stream << read_name.str() << "/2\n" << sequence2 << "\n+\n" << params.cycle_quality << '\n';
+   }
+   chunk.read1 = read1_stream.str();
+   chunk.read2 = read2_stream.str();
+}
+
+//Output FASTQ that may or may not be gzipped:
+struct fastq_output {
+   bool gzipped;
+   ofstream plain;
+   gzFile compressed;
+};
+
+bool writeFASTQ(fastq_output &output, const string &records) {
+   if (output.gzipped) {
+      return gzwrite(output.compressed, records.data(), records.size()) != (int)records.size();
+   }
+   output.plain << records;
+   return !output.plain;
+}
+
+int main(int argc, char **argv) {
+   //Input paths:
+   string ref_path, hap1_snp_path, hap1_indel_path, hap2_snp_path, hap2_indel_path;
+   string error_profile_path = "";
+
+   //Output FASTQ prefix:
+   string output_prefix;
+   bool gzip_output = 0;
+
+   //Read simulation parameters:
+   double depth = 0.0;
+   long read_length = 150;
+   double fragment_mean = 400.0, fragment_sd = 50.0;
+   double start_error = 0.001, end_error = 0.01;
+   unsigned long seed = 42;
+   unsigned int num_threads = 1;
+
+   //Option for debugging:
+   bool debug = 0;
+
+   //Variables for getopt_long:
+   int optchar;
+   int structindex = 0;
+   extern int optind;
+   //Create the struct used for getopt:
+   const struct option longoptions[] {
+      {"reference", required_argument, 0, 'r'},
+      {"hap1_snp_log", required_argument, 0, 'a'},
+      {"hap1_indel_log", required_argument, 0, 'A'},
+      {"hap2_snp_log", required_argument, 0, 'b'},
+      {"hap2_indel_log", required_argument, 0, 'B'},
+      {"output_prefix", required_argument, 0, 'o'},
+      {"depth", required_argument, 0, 'c'},
+      {"read_length", required_argument, 0, 'l'},
+      {"fragment_mean", required_argument, 0, 'f'},
+      {"fragment_sd", required_argument, 0, 's'},
+      {"start_error", required_argument, 0, 'e'},
+      {"end_error", required_argument, 0, 'E'},
+      {"error_profile", required_argument, 0, 'q'},
+      {"threads", required_argument, 0, 't'},
+      {"prng_seed", required_argument, 0, 'S'},
+      {"gzip", no_argument, 0, 'z'},
+      {"debug", no_argument, 0, 'd'},
+      {"version", no_argument, 0, 'v'},
+      {"help", no_argument, 0, 'h'}
+   };
+   //Read in the options:
+   while ((optchar = getopt_long(argc, argv, "r:a:A:b:B:o:c:l:f:s:e:E:q:t:S:zdvh", longoptions, &structindex)) > -1) {
+      switch(optchar) {
+         case 'r':
+            cerr << "Using reference FASTA: " << optarg << endl;
+            ref_path = optarg;
+            break;
+         case 'a':
+            cerr << "Using haplotype 1 SNP log: " << optarg << endl;
+            hap1_snp_path = optarg;
+            break;
+         case 'A':
+            cerr << "Using haplotype 1 indel log: " << optarg << endl;
+            hap1_indel_path = optarg;
+            break;
+         case 'b':
+            cerr << "Using haplotype 2 SNP log: " << optarg << endl;
+            hap2_snp_path = optarg;
+            break;
+         case 'B':
+            cerr << "Using haplotype 2 indel log: " << optarg << endl;
+            hap2_indel_path = optarg;
+            break;
+         case 'o':
+            cerr << "Outputting reads to FASTQs with prefix: " << optarg << endl;
+            output_prefix = optarg;
+            break;
+         case 'c':
+            cerr << "Simulating reads to a depth of " << optarg << endl;
+            depth = stod(optarg);
+            break;
+         case 'l':
+            cerr << "Using read length " << optarg << endl;
+            read_length = stol(optarg);
+            break;
+         case 'f':
+            cerr << "Using mean fragment length " << optarg << endl;
+            fragment_mean = stod(optarg);
+            break;
+         case 's':
+            cerr << "Using fragment length standard deviation " << optarg << endl;
+            fragment_sd = stod(optarg);
+            break;
+         case 'e':
+            cerr << "Using substitution error rate at first cycle " << optarg << endl;
+            start_error = stod(optarg);
+            break;
+         case 'E':
+            cerr << "Using substitution error rate at last cycle " << optarg << endl;
+            end_error = stod(optarg);
+            break;
+         case 'q':
+            cerr << "Using per-cycle error profile " << optarg << endl;
+            error_profile_path = optarg;
+            break;
+         case 't':
+            cerr << "Using " << optarg << " threads" << endl;
+            num_threads = stoul(optarg);
+            break;
+         case 'S':
+            cerr << "Using PRNG seed " << optarg << endl;
+            seed = stoul(optarg);
+            break;
+         case 'z':
+            cerr << "Gzipping output FASTQs" << endl;
+            gzip_output = 1;
+            break;
+         case 'd':
+            cerr << "Debugging mode enabled." << endl;
+            debug = 1;
+            break;
+         case 'v':
+            cerr << "simulateReads version " << VERSION << endl;
+            return 0;
+            break;
+         case 'h':
+            cerr << USAGE;
+            return 0;
+            break;
+         default:
+            cerr << "Unknown option " << (unsigned char)optchar << " supplied." << endl;
+            cerr << USAGE;
+            return 1;
+            break;
+      }
+   }
+
+   //Ignore positional arguments
+   if (optind < argc) {
+      cerr << "Ignoring extra positional arguments starting at " << argv[optind++] << endl;
+   }
+
+   //Check that the required arguments are set:
+   if (ref_path.empty() || output_prefix.empty() || depth <= 0.0) {
+      cerr << "Missing the reference FASTA, output prefix, or a positive depth.  Quitting." << endl;
+      return 2;
+   }
+   if (read_length <= 0 || fragment_mean < read_length || num_threads == 0) {
+      cerr << "Read length must be positive and no longer than the mean fragment length, and threads must be positive.  Quitting." << endl;
+      return 2;
+   }
+   if (fragment_sd < 0.0) {
+      cerr << "Fragment length standard deviation can't be negative.  Quitting." << endl;
+      return 2;
+   }
+   //A haplotype may have only an indel log:
+   bool hap1_mutated = !hap1_snp_path.empty() || !hap1_indel_path.empty();
+   bool hap2_mutated = !hap2_snp_path.empty() || !hap2_indel_path.empty();
+   if (!hap1_mutated && hap2_mutated) {
+      hap1_snp_path.swap(hap2_snp_path);
+      hap1_indel_path.swap(hap2_indel_path);
+      swap(hap1_mutated, hap2_mutated);
+   }
+
+   //Construct the per-cycle error model:
+   read_parameters params;
+   params.read_length = read_length;
+   params.fragment_mean = fragment_mean;
+   params.fragment_sd = fragment_sd;
+   params.seed = seed;
+   if (!error_profile_path.empty()) {
+      ifstream error_profile;
+      error_profile.open(error_profile_path);
+      if (!error_profile) {
+         cerr << "Error opening per-cycle error profile " << error_profile_path << ".  Quitting." << endl;
+         return 3;
+      }
+      string profileline;
+      while (getline(error_profile, profileline)) {
+         if (profileline.empty() || profileline[0] == '#') {
+            continue;
+         }
+         vector<string> line_vector = splitString(profileline, '\t');
+         try {
+            params.cycle_error.push_back(stod(line_vector.back()));
+         } catch (const exception &e) {
+            cerr << "Per-cycle error profile line has a non-numeric error rate: " << profileline << ".  Quitting." << endl;
+            return 3;
+         }
+      }
+      error_profile.close();
+      if ((long)params.cycle_error.size() < read_length) {
+         cerr << "Per-cycle error profile has fewer cycles (" << params.cycle_error.size() << ") than the read length.  Quitting." << endl;
+         return 3;
+      }
+      params.cycle_error.resize(read_length);
+   } else {
+      for (long i = 0; i < read_length; i++) {
+         params.cycle_error.push_back(read_length > 1 ? start_error + (end_error - start_error)*(double)i/(double)(read_length-1) : start_error);
+      }
+   }
+   for (long i = 0; i < read_length; i++) {
+      long phred = params.cycle_error[i] > 0.0 ? lround(-10.0*log10(params.cycle_error[i])) : 41;
+      phred = max(2L, min(41L, phred));
+      params.cycle_quality.push_back((char)(phred + 33));
+   }
+
+   //Read in the mutations for each haplotype:
+   vector<map<string, vector<mutation_record>>> haplotype_mutations;
+   if (hap1_mutated) {
+      haplotype_mutations.emplace_back();
+      if (readMutationLogs(hap1_snp_path, hap1_indel_path, haplotype_mutations.back())) {
+         return 4;
+      }
+   }
+   if (hap2_mutated) {
+      haplotype_mutations.emplace_back();
+      if (readMutationLogs(hap2_snp_path, hap2_indel_path, haplotype_mutations.back())) {
+         return 4;
+      }
+   }
+   unsigned int num_haplotypes = haplotype_mutations.empty() ? 1 : haplotype_mutations.size();
+   cerr << "Simulating reads from " << num_haplotypes << " haplotype(s)" << endl;
+
+   //Memory-map the reference FASTA:
+   int ref_fd = open(ref_path.c_str(), O_RDONLY);
+   if (ref_fd < 0) {
+      cerr << "Error opening reference FASTA " << ref_path << ".  Quitting." << endl;
+      return 5;
+   }
+   struct stat ref_stat;
+   if (fstat(ref_fd, &ref_stat) != 0) {
+      cerr << "Error reading the size of reference FASTA " << ref_path << ".  Quitting." << endl;
+      close(ref_fd);
+      return 5;
+   }
+   if (ref_stat.st_size == 0) {
+      cerr << "Reference FASTA " << ref_path << " is empty.  Quitting." << endl;
+      close(ref_fd);
+      return 5;
+   }
+   size_t ref_size = ref_stat.st_size;
+   const char *ref_map = (const char *)mmap(NULL, ref_size, PROT_READ, MAP_PRIVATE, ref_fd, 0);
+   if (ref_map == MAP_FAILED) {
+      cerr << "Error memory-mapping reference FASTA " << ref_path << ".  Quitting." << endl;
+      close(ref_fd);
+      return 5;
+   }
+   madvise((void *)ref_map, ref_size, MADV_SEQUENTIAL);
+
+   //Open the output FASTQs:
+   array<fastq_output, 2> fastqs;
+   for (unsigned int read = 0; read < 2; read++) {
+      string fastq_path = output_prefix + "_" + to_string(read+1) + (gzip_output ? ".fastq.gz" : ".fastq");
+      fastqs[read].gzipped = gzip_output;
+      if (gzip_output) {
+         fastqs[read].compressed = gzopen(fastq_path.c_str(), "wb6");
+         if (fastqs[read].compressed == NULL) {
+            cerr << "Error opening output FASTQ " << fastq_path << ".  Quitting." << endl;
+            return 6;
+         }
+      } else {
+         fastqs[read].plain.open(fastq_path);
+         if (!fastqs[read].plain) {
+            cerr << "Error opening output FASTQ " << fastq_path << ".  Quitting." << endl;
+            return 6;
+         }
+      }
+   }
+
+   //Iterate over scaffolds of the reference, building haplotypes in memory and simulating reads from them:
+   size_t offset = 0;
+   unsigned long scaffold_index = 0;
+   unsigned long total_pairs = 0;
+   bool write_failed = 0;
+   while (offset < ref_size) {
+      //Parse the header line:
+      if (ref_map[offset] != '>') {
+         cerr << "Malformed FASTA at byte " << offset << " of " << ref_path << ".  Quitting." << endl;
+         munmap((void *)ref_map, ref_size);
+         close(ref_fd);
+         return 7;
+      }
+      size_t header_end = offset;
+      while (header_end < ref_size && ref_map[header_end] != '\n') {
+         header_end++;
+      }
+      string scaffold(ref_map + offset + 1, header_end - offset - 1);
+      size_t name_end = scaffold.find_first_of(" \t\r");
+      if (name_end != string::npos) {
+         scaffold.erase(name_end);
+      }
+      //Find the extent of the sequence, using the mapping directly if it's on one line:
+      size_t sequence_start = header_end + 1;
+      size_t sequence_end = sequence_start;
+      while (sequence_end < ref_size && ref_map[sequence_end] != '>') {
+         sequence_end++;
+      }
+      offset = sequence_end;
+      const char *ref_seq = ref_map + sequence_start;
+      long ref_length = sequence_end - sequence_start;
+      string unwrapped;
+      size_t first_newline = sequence_start;
+      while (first_newline < sequence_end && ref_map[first_newline] != '\n' && ref_map[first_newline] != '\r') {
+         first_newline++;
+      }
+      if (first_newline + 1 < sequence_end) { //Line-wrapped, so copy out the bases
+         unwrapped.reserve(ref_length);
+         for (size_t i = sequence_start; i < sequence_end; i++) {
+            if (ref_map[i] != '\n' && ref_map[i] != '\r') {
+               unwrapped.push_back(ref_map[i]);
+            }
+         }
+         ref_seq = unwrapped.data();
+         ref_length = unwrapped.length();
+      } else {
+         ref_length = first_newline - sequence_start;
+      }
+
+      //Build the haplotypes for this scaffold:
+      vector<string> haplotypes;
+      for (unsigned int h = 0; h < num_haplotypes; h++) {
+         const vector<mutation_record> *mutations = nullptr;
+         if (!haplotype_mutations.empty() && haplotype_mutations[h].count(scaffold) > 0) {
+            mutations = &haplotype_mutations[h][scaffold];
+         }
+         haplotypes.push_back(buildHaplotype(ref_seq, ref_length, mutations));
+      }
+
+      //Split the read pairs for each haplotype into chunks:
+      vector<read_chunk> chunks;
+      for (unsigned int h = 0; h < num_haplotypes; h++) {
+         long haplotype_length = haplotypes[h].length();
+         if (haplotype_length < read_length) {
+            if (debug) {
+               cerr << "Skipping haplotype " << h+1 << " of scaffold " << scaffold << " since it is shorter than a read" << endl;
+            }
+            continue;
+         }
+         unsigned long num_pairs = lround(depth/(double)num_haplotypes*(double)haplotype_length/(2.0*(double)read_length));
+         for (unsigned long chunk_index = 0; chunk_index*CHUNK_PAIRS < num_pairs; chunk_index++) {
+            read_chunk chunk;
+            chunk.haplotype = &haplotypes[h];
+            chunk.scaffold = scaffold;
+            chunk.haplotype_index = h+1;
+            chunk.scaffold_index = scaffold_index;
+            chunk.chunk_index = chunk_index;
+            chunk.num_pairs = min((unsigned long)CHUNK_PAIRS, num_pairs - chunk_index*CHUNK_PAIRS);
+            chunk.done = 0;
+            chunks.push_back(chunk);
+         }
+         total_pairs += num_pairs;
+      }
+      if (debug) {
+         cerr << "Simulating " << chunks.size() << " chunks of reads for scaffold " << scaffold << endl;
+      }
+
+      //Workers simulate chunks in any order, and the main thread writes them out in order:
+      atomic<size_t> next_chunk(0);
+      mutex chunk_mutex;
+      condition_variable chunk_done;
+      size_t max_in_flight = 4*num_threads;
+      size_t written = 0;
+      vector<thread> workers;
+      for (unsigned int t = 0; t < num_threads; t++) {
+         workers.emplace_back([&]() {
+            while (true) {
+               size_t c;
+               {
+                  //Don't get too far ahead of the writer, to bound memory use:
+                  unique_lock<mutex> lock(chunk_mutex);
+                  chunk_done.wait(lock, [&]() { return next_chunk.load() < written + max_in_flight || next_chunk.load() >= chunks.size(); });
+                  c = next_chunk++;
+               }
+               if (c >= chunks.size()) {
+                  break;
+               }
+               simulateChunk(chunks[c], params);
+               {
+                  lock_guard<mutex> lock(chunk_mutex);
+                  chunks[c].done = 1;
+               }
+               chunk_done.notify_all();
+            }
+         });
+      }
+      for (; written < chunks.size();) {
+         {
+            unique_lock<mutex> lock(chunk_mutex);
+            chunk_done.wait(lock, [&]() { return chunks[written].done; });
+         }
+         write_failed |= writeFASTQ(fastqs[0], chunks[written].read1);
+         write_failed |= writeFASTQ(fastqs[1], chunks[written].read2);
+         {
+            lock_guard<mutex> lock(chunk_mutex);
+            string().swap(chunks[written].read1);
+            string().swap(chunks[written].read2);
+            written++;
+         }
+         chunk_done.notify_all();
+      }
+      for (auto worker_iterator = workers.begin(); worker_iterator != workers.end(); ++worker_iterator) {
+         worker_iterator->join();
+      }
+      scaffold_index++;
+   }
+
+   munmap((void *)ref_map, ref_size);
+   close(ref_fd);
+   for (unsigned int read = 0; read < 2; read++) {
+      if (fastqs[read].gzipped) {
+         gzclose(fastqs[read].compressed);
+      } else {
+         fastqs[read].plain.close();
+      }
+   }
+   if (write_failed) {
+      cerr << "Error writing output FASTQs.  Quitting." << endl;
+      return 8;
+   }
+   cerr << "Done simulating " << total_pairs << " read pairs from " << scaffold_index << " scaffolds" << endl;
+
+   return 0;
+}
@@ -0,0 +1,270 @@
+/**********************************************************************************
+ * snpLogStore.h                                                                  *
+ * Written by Patrick Reilly                                                      *
+ * Version 1.0 written 2026/10/18                                                 *
+ * Description:                                                                   *
+ *  Scaffold names interned to dense integer IDs (e.g. in .fai order), and SNP   *
+ *  log/INSNP records held as struct-of-arrays (uint32 position, uint8 old and    *
+ *  new alleles) grouped by scaffold ID with a per-scaffold offset range, so      *
+ *  walking the records of a scaffold touches contiguous memory and never looks  *
+ *  up or compares a scaffold name.  Alleles are stored as whatever bytes the    *
+ *  tool chooses (allele codes or raw bases); stores of raw bases keep the rare  *
+ *  alleles that aren't a single base (indels, missing alleles) aside as strings.*
+ *  Indel log records are parsed once into numeric records grouped the same way.  *
+ **********************************************************************************/
+
+#ifndef SNPLOGSTORE_H
+#define SNPLOGSTORE_H
+
+#include <string>
+#include <vector>
+#include <istream>
+#include <array>
+#include <unordered_map>
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdlib>
+
+//Dense IDs of scaffold names in the order they were added:
+class scaffoldIDs {
+   public:
+      static const uint32_t missing = 0xFFFFFFFF;
+      uint32_t add(const std::string &name) {
+         auto id_iterator = ids.find(name);
+         if (id_iterator != ids.end()) {
+            return id_iterator->second;
+         }
+         ids[name] = names.size();
+         names.push_back(name);
+         return names.size() - 1;
+      }
+      //Intern the scaffold named by the first name_length characters of a line:
+      uint32_t add(const std::string &line, size_t name_length) {
+         uint32_t id = find(line, name_length);
+         return id == missing ? add(line.substr(0, name_length)) : id;
+      }
+      uint32_t find(const std::string &name) const {
+         auto id_iterator = ids.find(name);
+         return id_iterator == ids.end() ? missing : id_iterator->second;
+      }
+      //ID of the scaffold named by the first name_length characters of a line,
+      // checking the last scaffold found first since records come sorted by scaffold
+      // (safe to call from several threads, which just share the guess):
+      uint32_t find(const std::string &line, size_t name_length) const {
+         uint32_t guess = last_id.load(std::memory_order_relaxed);
+         if (guess != missing && names[guess].length() == name_length && line.compare(0, name_length, names[guess]) == 0) {
+            return guess;
+         }
+         uint32_t id = find(line.substr(0, name_length));
+         if (id != missing) {
+            last_id.store(id, std::memory_order_relaxed);
+         }
+         return id;
+      }
+      const std::string &name(uint32_t id) const {
+         return names[id];
+      }
+      size_t size() const {
+         return names.size();
+      }
+   private:
+      std::unordered_map<std::string, uint32_t> ids;
+      std::vector<std::string> names;
+      mutable std::atomic<uint32_t> last_id {missing};
+};
+
+//Boundaries of the first max_fields tab-separated fields of a line (ends exclusive),
+// returning the number of fields found, without copying any of them:
+inline size_t fieldBounds(const std::string &line, size_t *starts, size_t *ends, size_t max_fields) {
+   size_t num_fields = 0;
+   size_t start = 0;
+   while (num_fields < max_fields) {
+      size_t tab = line.find('\t', start);
+      starts[num_fields] = start;
+      ends[num_fields] = tab == std::string::npos ? line.length() : tab;
+      num_fields++;
+      if (tab == std::string::npos) {
+         break;
+      }
+      start = tab + 1;
+   }
+   return num_fields;
+}
+
+//SNP log records as struct-of-arrays, appended in any scaffold order and then grouped
+// by scaffold ID (keeping their order within each scaffold) by group():
+class snpRecordStore {
+   public:
+      std::vector<uint32_t> positions;
+      std::vector<uint8_t> old_alleles, new_alleles;
+      void add(uint32_t scaffold_id, uint32_t position, uint8_t old_allele, uint8_t new_allele) {
+         scaffold_ids.push_back(scaffold_id);
+         positions.push_back(position);
+         old_alleles.push_back(old_allele);
+         new_alleles.push_back(new_allele);
+      }
+      //Add a record of raw alleles, storing 0 for (and keeping aside) any allele that isn't a single base:
+      void addAlleles(uint32_t scaffold_id, uint32_t position, const char *old_allele, size_t old_length, const char *new_allele, size_t new_length) {
+         if (old_length == 1 && new_length == 1 && old_allele[0] != '\0' && new_allele[0] != '\0') {
+            add(scaffold_id, position, old_allele[0], new_allele[0]);
+         } else {
+            long_alleles.push_back(std::make_pair(positions.size(), std::array<std::string, 2>{{std::string(old_allele, old_length), std::string(new_allele, new_length)}}));
+            add(scaffold_id, position, old_length == 1 ? old_allele[0] : 0, new_length == 1 ? new_allele[0] : 0);
+         }
+      }
+      //Counting sort of the records by scaffold ID, which is stable:
+      void group(size_t num_scaffolds) {
+         for (auto id_iterator = scaffold_ids.begin(); id_iterator != scaffold_ids.end(); ++id_iterator) {
+            num_scaffolds = std::max(num_scaffolds, (size_t)*id_iterator + 1);
+         }
+         offsets.assign(num_scaffolds + 1, 0);
+         for (auto id_iterator = scaffold_ids.begin(); id_iterator != scaffold_ids.end(); ++id_iterator) {
+            offsets[*id_iterator + 1]++;
+         }
+         for (size_t i = 0; i < num_scaffolds; i++) {
+            offsets[i+1] += offsets[i];
+         }
+         std::vector<size_t> destinations(scaffold_ids.size());
+         std::vector<size_t> next_record(offsets.begin(), offsets.end() - 1);
+         bool in_order = 1;
+         for (size_t i = 0; i < scaffold_ids.size(); i++) {
+            destinations[i] = next_record[scaffold_ids[i]]++;
+            in_order = in_order && destinations[i] == i;
+         }
+         if (!in_order) {
+            permute(positions, destinations);
+            permute(old_alleles, destinations);
+            permute(new_alleles, destinations);
+            for (auto long_iterator = long_alleles.begin(); long_iterator != long_alleles.end(); ++long_iterator) {
+               long_iterator->first = destinations[long_iterator->first];
+            }
+            std::sort(long_alleles.begin(), long_alleles.end(), [](const std::pair<size_t, std::array<std::string, 2>> &a, const std::pair<size_t, std::array<std::string, 2>> &b) {
+               return a.first < b.first;
+            });
+         }
+         std::vector<uint32_t>().swap(scaffold_ids);
+      }
+      //Range of the records of a scaffold once grouped:
+      size_t begin(uint32_t scaffold_id) const {
+         return scaffold_id + 1 < offsets.size() ? offsets[scaffold_id] : 0;
+      }
+      size_t end(uint32_t scaffold_id) const {
+         return scaffold_id + 1 < offsets.size() ? offsets[scaffold_id + 1] : 0;
+      }
+      size_t size() const {
+         return positions.size();
+      }
+      //Scaffold ID of a record, until the records are grouped:
+      uint32_t scaffoldID(size_t i) const {
+         return scaffold_ids[i];
+      }
+      void clear() {
+         positions.clear();
+         old_alleles.clear();
+         new_alleles.clear();
+         scaffold_ids.clear();
+         long_alleles.clear();
+         offsets.clear();
+      }
+      //Alleles of a record of raw alleles as strings:
+      bool isLong(size_t i) const {
+         return old_alleles[i] == 0 || new_alleles[i] == 0;
+      }
+      const std::array<std::string, 2> &longAlleles(size_t i) const {
+         auto long_iterator = std::lower_bound(long_alleles.begin(), long_alleles.end(), i, [](const std::pair<size_t, std::array<std::string, 2>> &a, size_t index) {
+            return a.first < index;
+         });
+         return long_iterator->second;
+      }
+      std::string oldAllele(size_t i) const {
+         return isLong(i) ? longAlleles(i)[0] : std::string(1, (char)old_alleles[i]);
+      }
+      std::string newAllele(size_t i) const {
+         return isLong(i) ? longAlleles(i)[1] : std::string(1, (char)new_alleles[i]);
+      }
+   private:
+      std::vector<uint32_t> scaffold_ids;
+      std::vector<size_t> offsets;
+      std::vector<std::pair<size_t, std::array<std::string, 2>>> long_alleles;
+      template <typename T> static void permute(std::vector<T> &values, const std::vector<size_t> &destinations) {
+         std::vector<T> permuted(values.size());
+         for (size_t i = 0; i < values.size(); i++) {
+            permuted[destinations[i]] = values[i];
+         }
+         values.swap(permuted);
+      }
+};
+
+//An indel log record (position, ins/del, length, and optional sequence and zygosity), with the
+// size parsed once (the length of the sequence if there is one, as in the simulator):
+struct indelLogRecord {
+   uint32_t position;
+   long size;
+   bool insertion;
+   //Haploid indel logs have no zygosity column, so their indels are homozygous:
+   bool homozygous;
+   std::string length;
+   std::string sequence;
+   bool operator==(const indelLogRecord &other) const {
+      return position == other.position && insertion == other.insertion && size == other.size && length == other.length && sequence == other.sequence;
+   }
+};
+
+//Indel log records grouped by scaffold ID, each scaffold sorted by position:
+class indelLogStore {
+   public:
+      std::vector<std::vector<indelLogRecord>> scaffolds;
+      //Read an indel log, interning new scaffolds if add_scaffolds is set, and otherwise
+      // skipping records of scaffolds without an ID:
+      void read(std::istream &indel_log, scaffoldIDs &scaffold_ids, bool add_scaffolds) {
+         readRecords(indel_log, [&](const std::string &logline, size_t name_length) {
+            return add_scaffolds ? scaffold_ids.add(logline, name_length) : scaffold_ids.find(logline, name_length);
+         });
+         scaffolds.resize(std::max(scaffolds.size(), scaffold_ids.size()));
+         sortByPosition();
+      }
+      //Read an indel log, skipping records of scaffolds without an ID:
+      void read(std::istream &indel_log, const scaffoldIDs &scaffold_ids) {
+         readRecords(indel_log, [&](const std::string &logline, size_t name_length) {
+            return scaffold_ids.find(logline, name_length);
+         });
+         scaffolds.resize(std::max(scaffolds.size(), scaffold_ids.size()));
+         sortByPosition();
+      }
+      void sortByPosition() {
+         for (auto scaffold_iterator = scaffolds.begin(); scaffold_iterator != scaffolds.end(); ++scaffold_iterator) {
+            std::stable_sort(scaffold_iterator->begin(), scaffold_iterator->end(), [](const indelLogRecord &a, const indelLogRecord &b) {
+               return a.position < b.position;
+            });
+         }
+      }
+   private:
+      template <typename Lookup> void readRecords(std::istream &indel_log, Lookup lookup) {
+         std::string logline;
+         size_t starts[6], ends[6];
+         while (std::getline(indel_log, logline)) {
+            size_t num_fields = fieldBounds(logline, starts, ends, 6);
+            if (num_fields < 4) {
+               continue;
+            }
+            uint32_t scaffold_id = lookup(logline, ends[0]);
+            if (scaffold_id == scaffoldIDs::missing) {
+               continue;
+            }
+            if (scaffold_id >= scaffolds.size()) {
+               scaffolds.resize(scaffold_id + 1);
+            }
+            indelLogRecord record;
+            record.position = strtoul(logline.c_str() + starts[1], NULL, 10);
+            record.insertion = logline.compare(starts[2], ends[2] - starts[2], "ins") == 0;
+            record.length = logline.substr(starts[3], ends[3] - starts[3]);
+            record.sequence = num_fields > 4 ? logline.substr(starts[4], ends[4] - starts[4]) : "";
+            record.size = record.sequence.empty() ? strtol(record.length.c_str(), NULL, 10) : record.sequence.length();
+            record.homozygous = num_fields < 6 || logline.compare(starts[5], ends[5] - starts[5], "hom") == 0;
+            scaffolds[scaffold_id].push_back(record);
+         }
+      }
+};
+
+#endif
@@ -0,0 +1,476 @@
+/**********************************************************************************
+ * statHistograms.cpp                                                             *
+ * Written by Patrick Reilly                                                      *
+ * Version 1.0 written 2026/10/18                                                 *
+ * Description:                                                                   *
+ *  Computes histograms of many VCF statistics at once from the site class stats *
+ *  files made by the STATS task, counting exact values in a single scan of each *
+ *  file.  The per-sample histograms can then be merged across samples into      *
+ *  PDFs and ECDFs (as combineSampleStats.pl does) with the merge mode.           *
+ *                                                                                *
+ * Syntax: statHistograms -H [stat header TSV] -i [class stats prefix]            *
+ *         -p [sample prefix] -c [caller] -s [comma-separated stats]              *
+ *         statHistograms -m [per-sample histogram TSVs]                          *
+ **********************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <getopt.h>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <sstream>
+#include <algorithm>
+#include <regex>
+#include <thread>
+#include <atomic>
+#include <zlib.h>
+
+//Define constants for getopt:
+#define no_argument 0
+#define required_argument 1
+#define optional_argument 2
+
+//Version:
+#define VERSION "1.0"
+
+//Usage/help:
+#define USAGE "statHistograms\nUsage:\n statHistograms -H [stat header TSV] -i [class stats prefix] -p [sample prefix]\n\t-c [caller] -s [comma-separated statistics] -S [sample ID] -o [output TSV]\n\t-l [comma-separated site classes] -t [threads]\n statHistograms -m [per-sample histogram TSVs, default STDIN] -o [output TSV]\n"
+
+using namespace std;
+
+vector<string> splitString(string line_to_split, char delimiter) {
+   vector<string> line_vector;
+   string element;
+   istringstream line_to_split_stream(line_to_split);
+   while (getline(line_to_split_stream, element, delimiter)) {
+      line_vector.push_back(element);
+   }
+   return line_vector;
+}
+
+//Read a line from a gzipped or plain file of arbitrary length:
+bool gzGetline(gzFile input_file, string &line) {
+   char buffer[65536];
+   line.clear();
+   while (gzgets(input_file, buffer, sizeof(buffer)) != NULL) {
+      line.append(buffer);
+      if (!line.empty() && line.back() == '\n') {
+         line.pop_back();
+         return 1;
+      }
+   }
+   return !line.empty();
+}
+
+//Stat values treated as missing, matching combineSampleStats.pl:
+bool isNA(const string &value) {
+   return value.compare(0, 2, "NA") == 0 || (!value.empty() && value.back() == '.');
+}
+
+//Numerical comparison with NAs sorted first, matching combineSampleStats.pl:
+bool numericalLessWithNA(const string &a, const string &b) {
+   bool a_na = isNA(a);
+   bool b_na = isNA(b);
+   if (a_na || b_na) {
+      return a_na && !b_na;
+   }
+   double a_value = strtod(a.c_str(), NULL);
+   double b_value = strtod(b.c_str(), NULL);
+   //Break ties (e.g. 1 and 1.0) by string so the order is reproducible:
+   return a_value < b_value || (a_value == b_value && a < b);
+}
+
+//Format a fraction the way Perl prints numbers:
+string formatFraction(double fraction) {
+   char buffer[32];
+   snprintf(buffer, sizeof(buffer), "%.15g", fraction);
+   return string(buffer);
+}
+
+//Identify the column of each statistic from the stats header, as stat_histograms.awk does:
+bool findStatColumns(string header_path, string prefix, vector<string> &stats, vector<size_t> &stat_columns) {
+   ifstream header_file;
+   header_file.open(header_path);
+   if (!header_file) {
+      cerr << "Failed to open stats header file " << header_path << endl;
+      return 1;
+   }
+   string headerline;
+   getline(header_file, headerline);
+   header_file.close();
+   vector<string> header_vector = splitString(headerline, '\t');
+   vector<string> colids, altcolids;
+   regex leading_hash_whitespace("[#]?\\s+");
+   regex bcftools_column_number("\\[[0-9]+\\]");
+   for (auto header_iterator = header_vector.begin(); header_iterator != header_vector.end(); ++header_iterator) {
+      //Remove any prefixed # and whitespace, and the [number] of the BCFtools query header:
+      string column = regex_replace(regex_replace(*header_iterator, leading_hash_whitespace, ""), bcftools_column_number, "");
+      //Check for FORMAT fields with sample prefixes:
+      size_t separator = column.find_first_of(":.");
+      if (separator != string::npos && column.substr(0, separator) == prefix) {
+         size_t end = column.find_first_of(":.", separator+1);
+         colids.push_back(column.substr(separator+1, end == string::npos ? string::npos : end-separator-1));
+         altcolids.push_back("FORMAT" + colids.back());
+      } else {
+         colids.push_back(column);
+         altcolids.push_back("INFO" + column);
+      }
+   }
+   //Without any statistics specified, use all columns after scaffold and position,
+   // only disambiguating INFO and FORMAT fields when their names collide:
+   if (stats.empty()) {
+      for (size_t i = 2; i < colids.size(); i++) {
+         bool collides = count(colids.begin()+2, colids.end(), colids[i]) > 1;
+         stats.push_back(collides ? altcolids[i] : colids[i]);
+         stat_columns.push_back(i);
+      }
+      return 0;
+   }
+   //Otherwise, choose the last/right-most column matching each statistic:
+   for (auto stat_iterator = stats.begin(); stat_iterator != stats.end(); ++stat_iterator) {
+      size_t stat_column = colids.size();
+      for (size_t i = 0; i < colids.size(); i++) {
+         if (colids[i] == *stat_iterator || altcolids[i] == *stat_iterator) {
+            stat_column = i;
+         }
+      }
+      if (stat_column == colids.size()) {
+         cerr << "Unable to find a column for statistic " << *stat_iterator << " in header " << header_path << endl;
+         return 1;
+      }
+      cerr << "Column for statistic " << *stat_iterator << " is " << stat_column+1 << endl;
+      stat_columns.push_back(stat_column);
+   }
+   return 0;
+}
+
+//Count the values of each statistic in a single scan of one class stats file:
+bool countClassStats(string stats_path, const vector<size_t> &stat_columns, vector<unordered_map<string, unsigned long>> &stat_counts, bool debug) {
+   gzFile stats_file = gzopen(stats_path.c_str(), "rb");
+   if (stats_file == NULL) {
+      cerr << "Failed to open class stats file " << stats_path << endl;
+      return 1;
+   }
+   gzbuffer(stats_file, 1048576);
+   size_t max_column = *max_element(stat_columns.begin(), stat_columns.end());
+   vector<pair<size_t, size_t>> fields(max_column+1);
+   string statsline, value;
+   unsigned long num_lines = 0;
+   while (gzGetline(stats_file, statsline)) {
+      if (statsline.empty() || statsline[0] == '#') {
+         continue;
+      }
+      num_lines++;
+      //Find the bounds of each field up to the last one we need:
+      size_t field_start = 0;
+      for (size_t i = 0; i <= max_column; i++) {
+         size_t field_end = field_start > statsline.length() ? string::npos : statsline.find('\t', field_start);
+         if (field_end == string::npos) {
+            field_end = statsline.length();
+         }
+         fields[i] = make_pair(field_start, field_end);
+         field_start = field_end + 1;
+      }
+      for (size_t s = 0; s < stat_columns.size(); s++) {
+         const pair<size_t, size_t> &field = fields[stat_columns[s]];
+         //Missing fields count as empty values, as awk would print:
+         if (field.first >= statsline.length()) {
+            value.clear();
+         } else {
+            value.assign(statsline, field.first, field.second - field.first);
+         }
+         stat_counts[s][value]++;
+      }
+   }
+   gzclose(stats_file);
+   if (debug) {
+      cerr << "Counted " << num_lines << " sites from class stats file " << stats_path << endl;
+   }
+   return 0;
+}
+
+//Sort the values of a histogram numerically, with NAs first:
+vector<pair<string, unsigned long>> sortedHistogram(const unordered_map<string, unsigned long> &counts) {
+   vector<pair<string, unsigned long>> histogram(counts.begin(), counts.end());
+   stable_sort(histogram.begin(), histogram.end(), [](const pair<string, unsigned long> &a, const pair<string, unsigned long> &b) {
+      return numericalLessWithNA(a.first, b.first);
+   });
+   return histogram;
+}
+
+//Merge per-sample histograms into PDFs and ECDFs, as combineSampleStats.pl does:
+int mergeHistograms(vector<string> input_paths, ostream &output) {
+   if (input_paths.empty()) {
+      input_paths.push_back("-");
+   }
+   //Counts per caller, category, and statistic, then per value:
+   map<string, unordered_map<string, unsigned long>> counts;
+   map<string, unsigned long> total_counts;
+   bool header_printed = 0;
+   for (auto path_iterator = input_paths.begin(); path_iterator != input_paths.end(); ++path_iterator) {
+      gzFile histogram_file = *path_iterator == "-" ? gzdopen(0, "rb") : gzopen(path_iterator->c_str(), "rb");
+      if (histogram_file == NULL) {
+         cerr << "Error opening input stat histogram TSV file " << *path_iterator << endl;
+         return 2;
+      }
+      string histogramline;
+      //Feed the header line through, excluding the sample ID column:
+      if (gzGetline(histogram_file, histogramline) && !header_printed) {
+         size_t first_tab = histogramline.find('\t');
+         output << (first_tab == string::npos ? "" : histogramline.substr(first_tab+1)) << "\tFraction\tCumulativeFraction" << endl;
+         header_printed = 1;
+      }
+      while (gzGetline(histogram_file, histogramline)) {
+         //SampleID, Caller, Category, Statistic, Count, Value:
+         size_t tabs[5];
+         size_t tab = string::npos;
+         bool malformed = 0;
+         for (size_t i = 0; i < 5; i++) {
+            tab = histogramline.find('\t', tab+1);
+            if (tab == string::npos) {
+               malformed = 1;
+               break;
+            }
+            tabs[i] = tab;
+         }
+         if (malformed) {
+            cerr << "Stat histogram line does not have the appropriate number of fields: " << histogramline << endl;
+            gzclose(histogram_file);
+            return 3;
+         }
+         string mainkey = histogramline.substr(tabs[0]+1, tabs[3]-tabs[0]-1);
+         string count = histogramline.substr(tabs[3]+1, tabs[4]-tabs[3]-1);
+         string statvalue = histogramline.substr(tabs[4]+1);
+         //Fix the broken input case where count is blank and statvalue is a
+         // left-padded space-separated pair of count and statvalue:
+         if (count.empty()) {
+            size_t count_start = statvalue.find_first_not_of(" \t");
+            size_t count_end = statvalue.find_first_of(" \t", count_start);
+            size_t value_start = statvalue.find_first_not_of(" \t", count_end);
+            size_t value_end = statvalue.find_last_not_of(" \t");
+            count = statvalue.substr(count_start, count_end - count_start);
+            statvalue = value_start == string::npos ? "" : statvalue.substr(value_start, value_end - value_start + 1);
+         }
+         unsigned long count_value = stoul(count);
+         counts[mainkey][statvalue] += count_value;
+         //NAs don't contribute to the total used for fractions:
+         unsigned long &total_count = total_counts[mainkey];
+         if (!isNA(statvalue)) {
+            total_count += count_value;
+         }
+      }
+      gzclose(histogram_file);
+   }
+   for (auto key_iterator = counts.begin(); key_iterator != counts.end(); ++key_iterator) {
+      unsigned long total_count = total_counts[key_iterator->first];
+      unsigned long cumulative_count = 0;
+      vector<pair<string, unsigned long>> histogram = sortedHistogram(key_iterator->second);
+      for (auto value_iterator = histogram.begin(); value_iterator != histogram.end(); ++value_iterator) {
+         output << key_iterator->first << '\t' << value_iterator->second << '\t' << value_iterator->first << '\t';
+         if (isNA(value_iterator->first)) {
+            output << "NA\tNA" << endl;
+         } else {
+            cumulative_count += value_iterator->second;
+            output << formatFraction((double)value_iterator->second/total_count) << '\t' << formatFraction((double)cumulative_count/total_count) << endl;
+         }
+      }
+   }
+   return 0;
+}
+
+int main(int argc, char **argv) {
+   //Path to the header of the allStats file:
+   string header_path;
+   //Prefix of the class stats files:
+   string input_prefix;
+   //Sample prefix used in FORMAT field names, and sample ID for the output:
+   string sample_prefix, sample_id;
+   //Variant caller:
+   string caller;
+   //Statistics to compute histograms of:
+   vector<string> stats;
+   //Site classes to compute histograms for:
+   vector<string> site_classes = {"ER", "FN", "FP", "TN", "TP"};
+   //Output path:
+   string output_path = "-";
+   //Number of class stats files to scan at once:
+   unsigned int num_threads = 1;
+   //Merge per-sample histograms instead of computing them:
+   bool merge_mode = 0;
+
+   //Option for debugging:
+   bool debug = 0;
+
+   //Variables for getopt_long:
+   int optchar;
+   int structindex = 0;
+   extern int optind;
+   //Create the struct used for getopt:
+   const struct option longoptions[] {
+      {"stat_header", required_argument, 0, 'H'},
+      {"input_prefix", required_argument, 0, 'i'},
+      {"prefix", required_argument, 0, 'p'},
+      {"sample_id", required_argument, 0, 'S'},
+      {"caller", required_argument, 0, 'c'},
+      {"stats", required_argument, 0, 's'},
+      {"classes", required_argument, 0, 'l'},
+      {"output", required_argument, 0, 'o'},
+      {"threads", required_argument, 0, 't'},
+      {"merge", no_argument, 0, 'm'},
+      {"debug", no_argument, 0, 'd'},
+      {"version", no_argument, 0, 'v'},
+      {"help", no_argument, 0, 'h'}
+   };
+   //Read in the options:
+   while ((optchar = getopt_long(argc, argv, "H:i:p:S:c:s:l:o:t:mdvh", longoptions, &structindex)) > -1) {
+      switch(optchar) {
+         case 'H':
+            cerr << "Using stat header: " << optarg << endl;
+            header_path = optarg;
+            break;
+         case 'i':
+            cerr << "Using class stats files with prefix: " << optarg << endl;
+            input_prefix = optarg;
+            break;
+         case 'p':
+            cerr << "Using sample prefix: " << optarg << endl;
+            sample_prefix = optarg;
+            break;
+         case 'S':
+            cerr << "Using sample ID: " << optarg << endl;
+            sample_id = optarg;
+            break;
+         case 'c':
+            cerr << "Using variant caller: " << optarg << endl;
+            caller = optarg;
+            break;
+         case 's':
+            cerr << "Computing histograms of statistics: " << optarg << endl;
+            stats = splitString(optarg, ',');
+            break;
+         case 'l':
+            cerr << "Computing histograms for site classes: " << optarg << endl;
+            site_classes = splitString(optarg, ',');
+            break;
+         case 'o':
+            cerr << "Outputting histograms to: " << optarg << endl;
+            output_path = optarg;
+            break;
+         case 't':
+            cerr << "Using " << optarg << " threads" << endl;
+            num_threads = stoul(optarg);
+            break;
+         case 'm':
+            cerr << "Merging per-sample histograms" << endl;
+            merge_mode = 1;
+            break;
+         case 'd':
+            cerr << "Debugging mode enabled." << endl;
+            debug = 1;
+            break;
+         case 'v':
+            cerr << "statHistograms version " << VERSION << endl;
+            return 0;
+            break;
+         case 'h':
+            cerr << USAGE;
+            return 0;
+            break;
+         default:
+            cerr << "Unknown option " << (unsigned char)optchar << " supplied." << endl;
+            cerr << USAGE;
+            return 1;
+            break;
+      }
+   }
+
+   //Open the output:
+   ofstream output_file;
+   if (output_path != "-") {
+      output_file.open(output_path);
+      if (!output_file) {
+         cerr << "Failed to open output file " << output_path << endl;
+         return 5;
+      }
+   }
+   ostream &output = output_path == "-" ? cout : output_file;
+
+   //Merge mode takes the per-sample histograms as positional arguments:
+   if (merge_mode) {
+      vector<string> input_paths;
+      while (optind < argc) {
+         input_paths.push_back(argv[optind++]);
+      }
+      return mergeHistograms(input_paths, output);
+   }
+
+   //Ignore positional arguments
+   if (optind < argc) {
+      cerr << "Ignoring extra positional arguments starting at " << argv[optind++] << endl;
+   }
+
+   if (header_path.empty() || input_prefix.empty() || caller.empty()) {
+      cerr << "Missing one of the stat header, class stats prefix, or variant caller.  Quitting." << endl;
+      return 2;
+   }
+   if (sample_id.empty()) {
+      sample_id = sample_prefix;
+   }
+   if (num_threads == 0) {
+      num_threads = 1;
+   }
+
+   //Find the columns of the statistics:
+   vector<size_t> stat_columns;
+   if (findStatColumns(header_path, sample_prefix, stats, stat_columns)) {
+      return 3;
+   }
+   if (stat_columns.empty()) {
+      cerr << "No statistics found in header " << header_path << ".  Quitting." << endl;
+      return 3;
+   }
+
+   //Scan each class stats file once, several at a time:
+   vector<vector<unordered_map<string, unsigned long>>> class_counts(site_classes.size(), vector<unordered_map<string, unsigned long>>(stats.size()));
+   vector<char> class_failed(site_classes.size(), 0);
+   atomic<size_t> next_class(0);
+   vector<thread> workers;
+   for (unsigned int t = 0; t < min((size_t)num_threads, site_classes.size()); t++) {
+      workers.push_back(thread([&]() {
+         size_t c;
+         while ((c = next_class++) < site_classes.size()) {
+            string stats_path = input_prefix + "_" + site_classes[c] + "_stats.tsv.gz";
+            class_failed[c] = countClassStats(stats_path, stat_columns, class_counts[c], debug);
+         }
+      }));
+   }
+   for (auto worker_iterator = workers.begin(); worker_iterator != workers.end(); ++worker_iterator) {
+      worker_iterator->join();
+   }
+   if (find(class_failed.begin(), class_failed.end(), 1) != class_failed.end()) {
+      return 4;
+   }
+
+   //Output the per-sample histograms in the format combineSampleStats.pl and
+   // the merge mode take:
+   output << "SampleID\tCaller\tCategory\tStatistic\tCount\tValue" << endl;
+   for (size_t c = 0; c < site_classes.size(); c++) {
+      for (size_t s = 0; s < stats.size(); s++) {
+         vector<pair<string, unsigned long>> histogram = sortedHistogram(class_counts[c][s]);
+         for (auto value_iterator = histogram.begin(); value_iterator != histogram.end(); ++value_iterator) {
+            output << sample_id << '\t' << caller << '\t' << site_classes[c] << '\t' << stats[s] << '\t' << value_iterator->second << '\t' << value_iterator->first << '\n';
+         }
+      }
+   }
+   output.flush();
+   if (output_path != "-") {
+      output_file.close();
+   }
+
+   return 0;
+}
@@ -0,0 +1,543 @@
+/**********************************************************************************
+ * sweepThresholds.cpp                                                            *
+ * Written by Patrick Reilly                                                      *
+ * Version 1.0 written 2026/10/18                                                 *
+ * Description:                                                                   *
+ *  Evaluates a grid of masking thresholds on VCF statistics in a single pass    *
+ *  over the site class stats files made by the STATS task, outputting the       *
+ *  masked class counts, FPR, FDR, FNR, and % masked sites (as classifySites.sh  *
+ *  calculates them) for every point of the grid.                                 *
+ *  Each site is binned once per statistic, and the grid is evaluated from      *
+ *  cumulative sums of the per-class N-dimensional histograms, so the cost of    *
+ *  the scan does not depend on the size of the grid.                            *
+ *                                                                                *
+ * Syntax: sweepThresholds -H [stat header TSV] -i [class prefix]                 *
+ *         -b [callable BED or .fai] -s [STAT:min|max:t1,t2,...] [-s ...]         *
+ **********************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <string>
+#include <getopt.h>
+#include <cstdlib>
+#include <vector>
+#include <map>
+#include <sstream>
+#include <iomanip>
+#include <algorithm>
+#include <regex>
+#include <thread>
+#include <atomic>
+#include <zlib.h>
+
+//Define constants for getopt:
+#define no_argument 0
+#define required_argument 1
+#define optional_argument 2
+
+//Version:
+#define VERSION "1.0"
+
+//Usage/help:
+#define USAGE "sweepThresholds\nUsage:\n sweepThresholds -H [stat header TSV] -i [class BED and stats prefix] -b [callable BED or .fai]\n\t-s [STAT:min|max:comma-separated thresholds] [-s ...] -p [sample prefix]\n\t-o [output TSV] -t [threads]\n"
+
+//Maximum number of cells of the grid histograms:
+#define MAX_GRID_CELLS 100000000
+
+using namespace std;
+
+vector<string> splitString(string line_to_split, char delimiter) {
+   vector<string> line_vector;
+   string element;
+   istringstream line_to_split_stream(line_to_split);
+   while (getline(line_to_split_stream, element, delimiter)) {
+      line_vector.push_back(element);
+   }
+   return line_vector;
+}
+
+//Read a line from a gzipped or plain file of arbitrary length:
+bool gzGetline(gzFile input_file, string &line) {
+   char buffer[65536];
+   line.clear();
+   while (gzgets(input_file, buffer, sizeof(buffer)) != NULL) {
+      line.append(buffer);
+      if (!line.empty() && line.back() == '\n') {
+         line.pop_back();
+         return 1;
+      }
+   }
+   return !line.empty();
+}
+
+//A statistic and the thresholds to sweep over:
+struct stat_thresholds {
+   string name;
+   //Keep sites with values >= threshold (min) or <= threshold (max):
+   bool is_min;
+   vector<double> thresholds;
+   size_t column;
+};
+
+//Parse a STAT:min|max:t1,t2,... sweep specification:
+bool parseStatThresholds(string spec, stat_thresholds &stat) {
+   vector<string> spec_vector = splitString(spec, ':');
+   if (spec_vector.size() != 3 || (spec_vector[1] != "min" && spec_vector[1] != "max")) {
+      cerr << "Unable to parse threshold specification " << spec << ", should be STAT:min:t1,t2,... or STAT:max:t1,t2,..." << endl;
+      return 1;
+   }
+   stat.name = spec_vector[0];
+   stat.is_min = spec_vector[1] == "min";
+   vector<string> threshold_vector = splitString(spec_vector[2], ',');
+   for (auto threshold_iterator = threshold_vector.begin(); threshold_iterator != threshold_vector.end(); ++threshold_iterator) {
+      stat.thresholds.push_back(stod(*threshold_iterator));
+   }
+   sort(stat.thresholds.begin(), stat.thresholds.end());
+   stat.thresholds.erase(unique(stat.thresholds.begin(), stat.thresholds.end()), stat.thresholds.end());
+   if (stat.thresholds.empty()) {
+      cerr << "No thresholds given for statistic " << stat.name << endl;
+      return 1;
+   }
+   return 0;
+}
+
+//Identify the column of each statistic from the stats header, as stat_histograms.awk does:
+bool findStatColumns(string header_path, string prefix, vector<stat_thresholds> &stats) {
+   ifstream header_file;
+   header_file.open(header_path);
+   if (!header_file) {
+      cerr << "Failed to open stats header file " << header_path << endl;
+      return 1;
+   }
+   string headerline;
+   getline(header_file, headerline);
+   header_file.close();
+   vector<string> header_vector = splitString(headerline, '\t');
+   regex leading_hash_whitespace("[#]?\\s+");
+   regex bcftools_column_number("\\[[0-9]+\\]");
+   for (auto stat_iterator = stats.begin(); stat_iterator != stats.end(); ++stat_iterator) {
+      stat_iterator->column = header_vector.size();
+   }
+   for (size_t i = 0; i < header_vector.size(); i++) {
+      //Remove any prefixed # and whitespace, and the [number] of the BCFtools query header:
+      string column = regex_replace(regex_replace(header_vector[i], leading_hash_whitespace, ""), bcftools_column_number, "");
+      //Check for FORMAT fields with sample prefixes:
+      string colid, altcolid;
+      size_t separator = column.find_first_of(":.");
+      if (separator != string::npos && column.substr(0, separator) == prefix) {
+         size_t end = column.find_first_of(":.", separator+1);
+         colid = column.substr(separator+1, end == string::npos ? string::npos : end-separator-1);
+         altcolid = "FORMAT" + colid;
+      } else {
+         colid = column;
+         altcolid = "INFO" + column;
+      }
+      //Choose the last/right-most column matching each statistic:
+      for (auto stat_iterator = stats.begin(); stat_iterator != stats.end(); ++stat_iterator) {
+         if (colid == stat_iterator->name || altcolid == stat_iterator->name) {
+            stat_iterator->column = i;
+         }
+      }
+   }
+   for (auto stat_iterator = stats.begin(); stat_iterator != stats.end(); ++stat_iterator) {
+      if (stat_iterator->column == header_vector.size()) {
+         cerr << "Unable to find a column for statistic " << stat_iterator->name << " in header " << header_path << endl;
+         return 1;
+      }
+      cerr << "Column for statistic " << stat_iterator->name << " is " << stat_iterator->column+1 << endl;
+   }
+   return 0;
+}
+
+//Read a BED (or .fai, as whole scaffolds) into per-scaffold sorted, merged intervals:
+bool readIntervals(string path, bool is_fai, map<string, vector<pair<long, long>>> &intervals) {
+   ifstream input_file;
+   input_file.open(path);
+   if (!input_file) {
+      cerr << "Failed to open " << (is_fai ? "FASTA index " : "BED file ") << path << endl;
+      return 1;
+   }
+   string line;
+   while (getline(input_file, line)) {
+      if (line.empty() || line[0] == '#') {
+         continue;
+      }
+      vector<string> line_vector = splitString(line, '\t');
+      if (line_vector.size() < (is_fai ? 2 : 3)) {
+         cerr << "Line does not have the appropriate number of fields in " << path << ": " << line << endl;
+         input_file.close();
+         return 1;
+      }
+      if (is_fai) {
+         intervals[line_vector[0]].push_back(make_pair(0, stol(line_vector[1])));
+      } else {
+         intervals[line_vector[0]].push_back(make_pair(stol(line_vector[1]), stol(line_vector[2])));
+      }
+   }
+   input_file.close();
+   for (auto scaffold_iterator = intervals.begin(); scaffold_iterator != intervals.end(); ++scaffold_iterator) {
+      vector<pair<long, long>> &scaffold_intervals = scaffold_iterator->second;
+      sort(scaffold_intervals.begin(), scaffold_intervals.end());
+      vector<pair<long, long>> merged;
+      for (auto interval_iterator = scaffold_intervals.begin(); interval_iterator != scaffold_intervals.end(); ++interval_iterator) {
+         if (!merged.empty() && interval_iterator->first <= merged.back().second) {
+            merged.back().second = max(merged.back().second, interval_iterator->second);
+         } else {
+            merged.push_back(*interval_iterator);
+         }
+      }
+      scaffold_intervals.swap(merged);
+   }
+   return 0;
+}
+
+//Total length of the intersection of two sets of merged intervals:
+unsigned long intersectionLength(map<string, vector<pair<long, long>>> &a, map<string, vector<pair<long, long>>> &b) {
+   unsigned long length = 0;
+   for (auto scaffold_iterator = a.begin(); scaffold_iterator != a.end(); ++scaffold_iterator) {
+      auto b_scaffold = b.find(scaffold_iterator->first);
+      if (b_scaffold == b.end()) {
+         continue;
+      }
+      auto a_iterator = scaffold_iterator->second.begin();
+      auto b_iterator = b_scaffold->second.begin();
+      while (a_iterator != scaffold_iterator->second.end() && b_iterator != b_scaffold->second.end()) {
+         long overlap = min(a_iterator->second, b_iterator->second) - max(a_iterator->first, b_iterator->first);
+         if (overlap > 0) {
+            length += overlap;
+         }
+         if (a_iterator->second < b_iterator->second) {
+            ++a_iterator;
+         } else {
+            ++b_iterator;
+         }
+      }
+   }
+   return length;
+}
+
+//Bin of a value among a statistic's thresholds, such that a site passes threshold j iff
+// j < bin for min thresholds, or j >= bin for max thresholds (missing values never pass):
+size_t thresholdBin(const stat_thresholds &stat, const char *value, size_t value_length) {
+   size_t num_thresholds = stat.thresholds.size();
+   if (value_length == 0) {
+      return stat.is_min ? 0 : num_thresholds;
+   }
+   char *value_end;
+   double numeric_value = strtod(value, &value_end);
+   if (value_end == value) {
+      return stat.is_min ? 0 : num_thresholds;
+   }
+   if (stat.is_min) {
+      return upper_bound(stat.thresholds.begin(), stat.thresholds.end(), numeric_value) - stat.thresholds.begin();
+   } else {
+      return lower_bound(stat.thresholds.begin(), stat.thresholds.end(), numeric_value) - stat.thresholds.begin();
+   }
+}
+
+//Histogram a class stats file over the grid cells in a single scan:
+bool histogramClassStats(string stats_path, const vector<stat_thresholds> &stats, const vector<size_t> &strides, vector<unsigned long> &histogram, unsigned long &num_sites, bool debug) {
+   gzFile stats_file = gzopen(stats_path.c_str(), "rb");
+   if (stats_file == NULL) {
+      cerr << "Failed to open class stats file " << stats_path << endl;
+      return 1;
+   }
+   gzbuffer(stats_file, 1048576);
+   size_t max_column = 0;
+   for (auto stat_iterator = stats.begin(); stat_iterator != stats.end(); ++stat_iterator) {
+      max_column = max(max_column, stat_iterator->column);
+   }
+   vector<pair<size_t, size_t>> fields(max_column+1);
+   string statsline;
+   num_sites = 0;
+   while (gzGetline(stats_file, statsline)) {
+      if (statsline.empty() || statsline[0] == '#') {
+         continue;
+      }
+      num_sites++;
+      //Find the bounds of each field up to the last one we need:
+      size_t field_start = 0;
+      for (size_t i = 0; i <= max_column; i++) {
+         size_t field_end = field_start > statsline.length() ? string::npos : statsline.find('\t', field_start);
+         if (field_end == string::npos) {
+            field_end = statsline.length();
+         }
+         fields[i] = make_pair(min(field_start, statsline.length()), field_end);
+         field_start = field_end + 1;
+      }
+      size_t cell = 0;
+      for (size_t s = 0; s < stats.size(); s++) {
+         const pair<size_t, size_t> &field = fields[stats[s].column];
+         cell += strides[s] * thresholdBin(stats[s], statsline.c_str() + field.first, field.second - field.first);
+      }
+      histogram[cell]++;
+   }
+   gzclose(stats_file);
+   if (debug) {
+      cerr << "Binned " << num_sites << " sites from class stats file " << stats_path << endl;
+   }
+   return 0;
+}
+
+//Turn a grid histogram into counts of sites passing each grid point, by cumulative
+// sums along each statistic (suffix sums for min, prefix sums for max):
+void cumulateHistogram(const vector<stat_thresholds> &stats, const vector<size_t> &strides, vector<unsigned long> &histogram) {
+   for (size_t s = 0; s < stats.size(); s++) {
+      size_t dimension = stats[s].thresholds.size() + 1;
+      size_t stride = strides[s];
+      for (size_t cell = 0; cell < histogram.size(); cell++) {
+         //Start each line of cells along this dimension at its bin 0:
+         if ((cell / stride) % dimension != 0) {
+            continue;
+         }
+         if (stats[s].is_min) {
+            for (size_t b = dimension-1; b > 0; b--) {
+               histogram[cell + (b-1)*stride] += histogram[cell + b*stride];
+            }
+         } else {
+            for (size_t b = 1; b < dimension; b++) {
+               histogram[cell + b*stride] += histogram[cell + (b-1)*stride];
+            }
+         }
+      }
+   }
+}
+
+//Percentage as bc -l would calculate it, or NA without a denominator:
+string percentage(unsigned long numerator, unsigned long denominator) {
+   if (denominator == 0) {
+      return "NA";
+   }
+   ostringstream percentage_stream;
+   percentage_stream << setprecision(15) << 100.0*(double)numerator/(double)denominator;
+   return percentage_stream.str();
+}
+
+int main(int argc, char **argv) {
+   //Path to the header of the allStats file:
+   string header_path;
+   //Prefix of the class BEDs and class stats files:
+   string class_prefix;
+   //Callable sites BED or .fai:
+   string callable_path;
+   //Sample prefix used in FORMAT field names:
+   string sample_prefix;
+   //Statistics and thresholds to sweep over:
+   vector<stat_thresholds> stats;
+   //Output path:
+   string output_path = "-";
+   //Number of class stats files to scan at once:
+   unsigned int num_threads = 1;
+
+   //Option for debugging:
+   bool debug = 0;
+
+   //Variables for getopt_long:
+   int optchar;
+   int structindex = 0;
+   extern int optind;
+   //Create the struct used for getopt:
+   const struct option longoptions[] {
+      {"stat_header", required_argument, 0, 'H'},
+      {"input_prefix", required_argument, 0, 'i'},
+      {"callable", required_argument, 0, 'b'},
+      {"prefix", required_argument, 0, 'p'},
+      {"stat_thresholds", required_argument, 0, 's'},
+      {"output", required_argument, 0, 'o'},
+      {"threads", required_argument, 0, 't'},
+      {"debug", no_argument, 0, 'd'},
+      {"version", no_argument, 0, 'v'},
+      {"help", no_argument, 0, 'h'}
+   };
+   //Read in the options:
+   while ((optchar = getopt_long(argc, argv, "H:i:b:p:s:o:t:dvh", longoptions, &structindex)) > -1) {
+      switch(optchar) {
+         case 'H':
+            cerr << "Using stat header: " << optarg << endl;
+            header_path = optarg;
+            break;
+         case 'i':
+            cerr << "Using class BEDs and stats files with prefix: " << optarg << endl;
+            class_prefix = optarg;
+            break;
+         case 'b':
+            cerr << "Using callable sites: " << optarg << endl;
+            callable_path = optarg;
+            break;
+         case 'p':
+            cerr << "Using sample prefix: " << optarg << endl;
+            sample_prefix = optarg;
+            break;
+         case 's':
+            cerr << "Sweeping thresholds: " << optarg << endl;
+            stats.push_back(stat_thresholds());
+            if (parseStatThresholds(optarg, stats.back())) {
+               return 1;
+            }
+            break;
+         case 'o':
+            cerr << "Outputting sweep to: " << optarg << endl;
+            output_path = optarg;
+            break;
+         case 't':
+            cerr << "Using " << optarg << " threads" << endl;
+            num_threads = stoul(optarg);
+            break;
+         case 'd':
+            cerr << "Debugging mode enabled." << endl;
+            debug = 1;
+            break;
+         case 'v':
+            cerr << "sweepThresholds version " << VERSION << endl;
+            return 0;
+            break;
+         case 'h':
+            cerr << USAGE;
+            return 0;
+            break;
+         default:
+            cerr << "Unknown option " << (unsigned char)optchar << " supplied." << endl;
+            cerr << USAGE;
+            return 1;
+            break;
+      }
+   }
+
+   //Ignore positional arguments
+   if (optind < argc) {
+      cerr << "Ignoring extra positional arguments starting at " << argv[optind++] << endl;
+   }
+
+   if (header_path.empty() || class_prefix.empty() || callable_path.empty() || stats.empty()) {
+      cerr << "Missing one of the stat header, class prefix, callable sites, or thresholds.  Quitting." << endl;
+      return 2;
+   }
+   if (num_threads == 0) {
+      num_threads = 1;
+   }
+   if (findStatColumns(header_path, sample_prefix, stats)) {
+      return 3;
+   }
+
+   //Lay out the grid histograms, with one more bin than thresholds per statistic:
+   vector<size_t> strides(stats.size());
+   size_t num_cells = 1;
+   for (size_t s = stats.size(); s-- > 0;) {
+      strides[s] = num_cells;
+      num_cells *= stats[s].thresholds.size() + 1;
+      if (num_cells > MAX_GRID_CELLS) {
+         cerr << "Threshold grid is too large.  Quitting." << endl;
+         return 2;
+      }
+   }
+
+   //Count the callable sites in each class, as classifySites.sh does:
+   const vector<string> site_classes = {"ER", "FN", "FP", "TN", "TP"};
+   map<string, vector<pair<long, long>>> callable_intervals;
+   bool callable_is_fai = callable_path.length() > 4 && callable_path.substr(callable_path.length()-4) == ".fai";
+   if (readIntervals(callable_path, callable_is_fai, callable_intervals)) {
+      return 4;
+   }
+   unsigned long total_sites = 0;
+   for (auto scaffold_iterator = callable_intervals.begin(); scaffold_iterator != callable_intervals.end(); ++scaffold_iterator) {
+      for (auto interval_iterator = scaffold_iterator->second.begin(); interval_iterator != scaffold_iterator->second.end(); ++interval_iterator) {
+         total_sites += interval_iterator->second - interval_iterator->first;
+      }
+   }
+   vector<unsigned long> class_sites(site_classes.size());
+   for (size_t c = 0; c < site_classes.size(); c++) {
+      map<string, vector<pair<long, long>>> class_intervals;
+      if (readIntervals(class_prefix + "_" + site_classes[c] + "s.bed", 0, class_intervals)) {
+         return 4;
+      }
+      class_sites[c] = intersectionLength(class_intervals, callable_intervals);
+      cerr << "Unmasked " << site_classes[c] << "=" << class_sites[c] << endl;
+   }
+
+   //Histogram each class stats file over the grid, several at a time:
+   vector<vector<unsigned long>> class_histograms(site_classes.size(), vector<unsigned long>(num_cells, 0));
+   vector<unsigned long> class_stats_sites(site_classes.size(), 0);
+   vector<char> class_failed(site_classes.size(), 0);
+   atomic<size_t> next_class(0);
+   vector<thread> workers;
+   for (unsigned int t = 0; t < min((size_t)num_threads, site_classes.size()); t++) {
+      workers.push_back(thread([&]() {
+         size_t c;
+         while ((c = next_class++) < site_classes.size()) {
+            string stats_path = class_prefix + "_" + site_classes[c] + "_stats.tsv.gz";
+            class_failed[c] = histogramClassStats(stats_path, stats, strides, class_histograms[c], class_stats_sites[c], debug);
+            if (!class_failed[c]) {
+               cumulateHistogram(stats, strides, class_histograms[c]);
+            }
+         }
+      }));
+   }
+   for (auto worker_iterator = workers.begin(); worker_iterator != workers.end(); ++worker_iterator) {
+      worker_iterator->join();
+   }
+   if (find(class_failed.begin(), class_failed.end(), 1) != class_failed.end()) {
+      return 5;
+   }
+   for (size_t c = 0; c < site_classes.size(); c++) {
+      if (class_stats_sites[c] > class_sites[c]) {
+         cerr << "Warning: more " << site_classes[c] << " sites in stats file (" << class_stats_sites[c] << ") than callable " << site_classes[c] << " sites (" << class_sites[c] << ")" << endl;
+      }
+   }
+
+   //Open the output:
+   ofstream output_file;
+   if (output_path != "-") {
+      output_file.open(output_path);
+      if (!output_file) {
+         cerr << "Failed to open output file " << output_path << endl;
+         return 6;
+      }
+   }
+   ostream &output = output_path == "-" ? cout : output_file;
+
+   //Evaluate every grid point, with sites missing from the stats files counted as masked:
+   for (size_t s = 0; s < stats.size(); s++) {
+      output << stats[s].name << (stats[s].is_min ? ">=" : "<=") << '\t';
+   }
+   output << "ER\tFN\tFP\tTN\tTP\tmasked\ttotal\tFPR\tFDR\tFNR\tPctMasked" << endl;
+   vector<size_t> grid_point(stats.size(), 0);
+   size_t num_grid_points = 1;
+   for (size_t s = 0; s < stats.size(); s++) {
+      num_grid_points *= stats[s].thresholds.size();
+   }
+   for (size_t g = 0; g < num_grid_points; g++) {
+      //Cell holding the count of sites passing this grid point:
+      size_t cell = 0;
+      for (size_t s = 0; s < stats.size(); s++) {
+         output << stats[s].thresholds[grid_point[s]] << '\t';
+         cell += strides[s] * (stats[s].is_min ? grid_point[s] + 1 : grid_point[s]);
+      }
+      vector<unsigned long> unmasked(site_classes.size());
+      unsigned long unmasked_sites = 0;
+      for (size_t c = 0; c < site_classes.size(); c++) {
+         unmasked[c] = class_histograms[c][cell];
+         unmasked_sites += unmasked[c];
+         output << unmasked[c] << '\t';
+      }
+      unsigned long masked_sites = total_sites > unmasked_sites ? total_sites - unmasked_sites : 0;
+      //ER, FN, FP, TN, TP:
+      unsigned long ers = unmasked[0], fns = unmasked[1], fps = unmasked[2], tns = unmasked[3], tps = unmasked[4];
+      output << masked_sites << '\t' << total_sites << '\t';
+      output << percentage(fps+ers, fps+ers+tns) << '\t';
+      output << percentage(fps+ers, fps+ers+tps) << '\t';
+      output << percentage(fns, fns+tps) << '\t';
+      output << percentage(masked_sites, total_sites) << endl;
+      //Advance to the next grid point, with the last statistic varying fastest:
+      for (size_t s = stats.size(); s-- > 0;) {
+         if (++grid_point[s] < stats[s].thresholds.size()) {
+            break;
+         }
+         grid_point[s] = 0;
+      }
+   }
+   if (output_path != "-") {
+      output_file.close();
+   }
+
+   return 0;
+}